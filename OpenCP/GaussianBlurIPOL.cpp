@@ -1,5 +1,6 @@
-#include "libGaussian\gaussian_conv.h"
+#include "libGaussian/gaussian_conv.h"
 #include "opencp.hpp"
+#include "GaussianFilterRecursive.h"
 
 using namespace std;
 using namespace cv;
@@ -186,9 +187,9 @@ namespace cp
 
 		if (src.depth() == CV_64F)
 		{
+			srcf = src.clone();
 			if (src.channels() == 1)
 			{
-				srcf = src.clone();
 				am_gaussian_conv_image(srcf.ptr<double>(0), srcf.ptr<double>(0), src.cols, src.rows, 1, sigma, K, tol, true);
 			}
 			else if (src.channels() == 3)
@@ -201,17 +202,17 @@ namespace cp
 		}
 		else
 		{
+			Mat workspace;
 			src.convertTo(srcf, CV_32F);
 			if (src.channels() == 1)
 			{
-				srcf = src.clone();
-				am_gaussian_conv_image(srcf.ptr<float>(0), srcf.ptr<float>(0), src.cols, src.rows, 1, (float)sigma, K, (float)tol, true);
+				am_gaussian_conv_image_parallel(srcf.ptr<float>(0), srcf.ptr<float>(0), src.cols, src.rows, 1, (float)sigma, K, (float)tol, true, workspace);
 			}
 			else if (src.channels() == 3)
 			{
 				Mat plane;
 				cvtColorBGR2PLANE(srcf, plane);
-				am_gaussian_conv_image(plane.ptr<float>(0), plane.ptr<float>(0), src.cols, src.rows, 3, (float)sigma, K, (float)tol, true);
+				am_gaussian_conv_image_parallel(plane.ptr<float>(0), plane.ptr<float>(0), src.cols, src.rows, 3, (float)sigma, K, (float)tol, true, workspace);
 				cvtColorPLANE2BGR(plane, srcf);
 			}
 		}
@@ -222,7 +223,7 @@ namespace cp
 			srcf.copyTo(dest);
 	}
 
-	void GaussianBlurIPOLDeriche(InputArray src_, OutputArray dest, const double sigma, const int K)
+	void GaussianBlurIPOLDeriche(InputArray src_, OutputArray dest, const double sigma, const int K, const double tol)
 	{
 		Mat src = src_.getMat();
 		Mat srcf;
@@ -237,7 +238,7 @@ namespace cp
 		{
 			srcf = src.clone();
 			deriche_coeffs<double> c;
-			deriche_precomp(&c, sigma, clip_k, 1e-6);
+			deriche_precomp(&c, sigma, clip_k, tol);
 
 			Mat buffer(src.cols * 2 * src.rows, 1, CV_64F);
 
@@ -257,20 +258,20 @@ namespace cp
 		{
 			src.convertTo(srcf, CV_32F);
 			deriche_coeffs<float> c;
-			deriche_precomp(&c, (float)sigma, clip_k, (float)1e-6);
+			deriche_precomp(&c, (float)sigma, clip_k, (float)tol);
 
-			Mat buffer(src.cols * 2 * src.rows, 1, CV_32F);
+			Mat workspace;
 
 			if (src_.channels() == 3)
 			{
 				Mat plane;
 				cvtColorBGR2PLANE(srcf, plane);
-				deriche_gaussian_conv_image(c, plane.ptr<float>(0), buffer.ptr<float>(0), plane.ptr<float>(0), src.cols, src.rows, 3);
+				deriche_gaussian_conv_image_parallel(c, plane.ptr<float>(0), plane.ptr<float>(0), src.cols, src.rows, 3, workspace);
 				cvtColorPLANE2BGR(plane, srcf);
 			}
 			else if (src_.channels() == 1)
 			{
-				deriche_gaussian_conv_image(c, srcf.ptr<float>(0), buffer.ptr<float>(0), srcf.ptr<float>(0), src.cols, src.rows, 1);
+				deriche_gaussian_conv_image_parallel(c, srcf.ptr<float>(0), srcf.ptr<float>(0), src.cols, src.rows, 1, workspace);
 			}
 		}
 
@@ -313,18 +314,19 @@ namespace cp
 		{
 			vyv_coeffs<float> c;
 			vyv_precomp(&c, (float)sigma_space, clip_k, (float)tol);
+			Mat workspace;
 			if (src.depth() == CV_32F) srcf = src.clone();
 			else  src.convertTo(srcf, CV_32F);
 			if (src_.channels() == 3)
 			{
 				Mat plane;
 				cvtColorBGR2PLANE(srcf, plane);
-				vyv_gaussian_conv_image(c, plane.ptr<float>(0), plane.ptr<float>(0), src.cols, src.rows, 3);
+				vyv_gaussian_conv_image_parallel(c, plane.ptr<float>(0), plane.ptr<float>(0), src.cols, src.rows, 3, workspace);
 				cvtColorPLANE2BGR(plane, srcf);
 			}
 			else if (src_.channels() == 1)
 			{
-				vyv_gaussian_conv_image(c, srcf.ptr<float>(0), src.ptr<float>(0), src.cols, src.rows, 1);
+				vyv_gaussian_conv_image_parallel(c, srcf.ptr<float>(0), srcf.ptr<float>(0), src.cols, src.rows, 1, workspace);
 			}
 		}
 
@@ -367,12 +369,15 @@ namespace cp
 			break;
 		case GAUSSIAN_FILTER_DERICHE:
 			K = (K != 0) ? K_ : 3;
-			GaussianBlurIPOLDeriche(src, dest, sigma_space, K);
+			GaussianBlurIPOLDeriche(src, dest, sigma_space, K, tol);
 			break;
 		case GAUSSIAN_FILTER_VYV:
 			K = (K != 0) ? K_ : 4;
 			GaussianBlurIPOLVYV(src, dest, sigma_space, K, tol);
 			break;
+		case GAUSSIAN_FILTER_AUTO:
+			GaussianFilter(src, dest, sigma_space, getGaussianFilterAutoMethod(src, sigma_space, tol), 0, tol);
+			break;
 		default:
 		case GAUSSIAN_FILTER_SR:
 			GaussianBlurSR(src, dest, sigma_space);
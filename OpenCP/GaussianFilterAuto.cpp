@@ -0,0 +1,259 @@
+#include "opencp.hpp"
+#include <cfloat>
+#include <climits>
+#include <map>
+
+using namespace std;
+using namespace cv;
+
+namespace cp
+{
+	//tuning table of GAUSSIAN_FILTER_AUTO.
+	//key: sigma bucket (quarter octave), resolution bucket (half octave of pixels), tol bucket (tenth decade), depth and channels.
+	//value: the fastest method whose PSNR to the exact Gaussian is higher than the accuracy threshold.
+	//the table is stored with a signature of the machine and the threshold; a table of another signature is discarded.
+	class GaussianFilterTuningTable
+	{
+		cv::Mutex mutex;
+		map<string, int> table;
+		string path;
+		bool isLoaded;
+		double accuracy;
+
+		static string defaultPath()
+		{
+			const char* env = getenv("OPENCP_GAUSSIAN_TUNING_FILE");
+			if (env != NULL) return string(env);
+#ifdef _WIN32
+			const char* home = getenv("USERPROFILE");
+#else
+			const char* home = getenv("HOME");
+#endif
+			if (home == NULL) return string();
+			return string(home) + "/.opencp_gaussian_tuning.yml";
+		}
+
+		string signature()
+		{
+			return format("v2_sse41_%d_avx2_%d_avx512f_%d_cpus_%d_threads_%d_psnr_%d",
+				checkHardwareSupport(CV_CPU_SSE4_1) ? 1 : 0,
+				checkHardwareSupport(CV_CPU_AVX2) ? 1 : 0,
+				checkHardwareSupport(CV_CPU_AVX_512F) ? 1 : 0,
+				getNumberOfCPUs(), getNumThreads(), cvRound(accuracy));
+		}
+
+		void load()
+		{
+			isLoaded = true;
+			if (path.empty()) return;
+
+			FileStorage fs;
+			try
+			{
+				if (!fs.open(path, FileStorage::READ)) return;
+			}
+			catch (cv::Exception&)
+			{
+				return;
+			}
+			string sig;
+			fs["signature"] >> sig;
+			if (sig != signature()) return;
+
+			FileNode node = fs["table"];
+			for (FileNodeIterator it = node.begin(); it != node.end(); ++it)
+			{
+				table[(*it).name()] = (int)(*it);
+			}
+		}
+
+		void save()
+		{
+			if (path.empty()) return;
+
+			FileStorage fs;
+			try
+			{
+				if (!fs.open(path, FileStorage::WRITE)) return;
+			}
+			catch (cv::Exception&)
+			{
+				return;
+			}
+			fs << "signature" << signature();
+			fs << "table" << "{";
+			for (map<string, int>::iterator it = table.begin(); it != table.end(); ++it)
+			{
+				fs << it->first << it->second;
+			}
+			fs << "}";
+		}
+
+		static string key(Size size, int type, double sigma, double tol)
+		{
+			const int sigmaBucket = cvRound(4.0 * log(max(sigma, 0.01)) / log(2.0));
+			const int areaBucket = cvRound(2.0 * log((double)max(size.area(), 1)) / log(2.0));
+			//tol changes the order/kernel size of several methods, so that it changes both accuracy and speed
+			const int tolBucket = cvRound(10.0 * log10(max(tol, 1.0e-30)));
+			return format("s%d_a%d_t%d_d%d_c%d", sigmaBucket, areaBucket, tolBucket, CV_MAT_DEPTH(type), CV_MAT_CN(type));
+		}
+
+		//PSNR of the method to the exact (64F, large kernel) Gaussian filter on a crop of the source
+		static double accuracyPSNR(const Mat& src, const double sigma, const int method, const double tol)
+		{
+			Mat proxy = src(Rect(0, 0, min(src.cols, 256), min(src.rows, 256)));
+
+			Mat ref, out;
+			proxy.convertTo(ref, CV_64F);
+			const int r = max(1, cvRound(4.0 * sigma));
+			GaussianBlur(ref, ref, Size(2 * r + 1, 2 * r + 1), sigma, sigma, BORDER_REFLECT);
+
+			GaussianFilter(proxy, out, sigma, method, 0, tol);
+			out.convertTo(out, CV_64F);
+
+			//boundary handling is different among methods, so that only interior is compared
+			const int margin = min(cvRound(3.0 * sigma), min(proxy.cols, proxy.rows) / 4);
+			Rect roi(margin, margin, proxy.cols - 2 * margin, proxy.rows - 2 * margin);
+
+			double peak = 255.0;
+			if (src.depth() != CV_8U)
+			{
+				double minv, maxv;
+				minMaxLoc(proxy.reshape(1), &minv, &maxv);
+				peak = (maxv - minv > 0.0) ? maxv - minv : 1.0;
+			}
+			const double mse = norm(ref(roi), out(roi), NORM_L2SQR) / (double)(roi.area()*proxy.channels());
+			if (mse == 0.0) return DBL_MAX;
+			return 10.0 * log10(peak*peak / mse);
+		}
+
+		static double benchmark(const Mat& src, const double sigma, const int method, const double tol)
+		{
+			Mat dest;
+			GaussianFilter(src, dest, sigma, method, 0, tol);//warm up
+
+			int64 minTime = LLONG_MAX;
+			for (int i = 0; i < 3; i++)
+			{
+				const int64 start = getTickCount();
+				GaussianFilter(src, dest, sigma, method, 0, tol);
+				minTime = min(minTime, getTickCount() - start);
+			}
+			return (double)minTime;
+		}
+
+		int tune(const Mat& src, const double sigma, const double tol)
+		{
+			const int methods[] =
+			{
+				GAUSSIAN_FILTER_DCT, GAUSSIAN_FILTER_FIR, GAUSSIAN_FILTER_BOX, GAUSSIAN_FILTER_EBOX, GAUSSIAN_FILTER_SII,
+				GAUSSIAN_FILTER_AM, GAUSSIAN_FILTER_AM2, GAUSSIAN_FILTER_DERICHE, GAUSSIAN_FILTER_VYV, GAUSSIAN_FILTER_SR
+			};
+
+			int fastest = -1;
+			double fastestTime = DBL_MAX;
+			int mostAccurate = GAUSSIAN_FILTER_SR;
+			double bestPSNR = -DBL_MAX;
+			for (int i = 0; i < 10; i++)
+			{
+				const int method = methods[i];
+				//FIR, BOX, EBOX and SII do not support color images
+				if (src.channels() != 1 && (method == GAUSSIAN_FILTER_FIR || method == GAUSSIAN_FILTER_BOX || method == GAUSSIAN_FILTER_EBOX || method == GAUSSIAN_FILTER_SII)) continue;
+
+				try
+				{
+					const double psnr = accuracyPSNR(src, sigma, method, tol);
+					if (psnr > bestPSNR)
+					{
+						bestPSNR = psnr;
+						mostAccurate = method;
+					}
+					if (psnr < accuracy) continue;
+
+					const double time = benchmark(src, sigma, method, tol);
+					if (time < fastestTime)
+					{
+						fastestTime = time;
+						fastest = method;
+					}
+				}
+				catch (cv::Exception&)
+				{
+					continue;
+				}
+			}
+			return (fastest >= 0) ? fastest : mostAccurate;
+		}
+
+	public:
+		GaussianFilterTuningTable() : path(defaultPath()), isLoaded(false), accuracy(40.0)
+		{
+			;
+		}
+
+		int getMethod(const Mat& src, const double sigma, const double tol)
+		{
+			cv::AutoLock lock(mutex);
+			if (!isLoaded) load();
+
+			const string k = key(src.size(), src.type(), sigma, tol);
+			map<string, int>::iterator it = table.find(k);
+			if (it != table.end()) return it->second;
+
+			const int method = tune(src, sigma, tol);
+			table[k] = method;
+			save();
+			return method;
+		}
+
+		void setAccuracy(const double psnr)
+		{
+			cv::AutoLock lock(mutex);
+			accuracy = psnr;
+			table.clear();
+			isLoaded = false;
+		}
+
+		void setPath(const string& path_)
+		{
+			cv::AutoLock lock(mutex);
+			path = path_;
+			table.clear();
+			isLoaded = false;
+		}
+
+		void clear()
+		{
+			cv::AutoLock lock(mutex);
+			table.clear();
+			save();
+		}
+	};
+
+	static GaussianFilterTuningTable& getGaussianFilterTuningTable()
+	{
+		static GaussianFilterTuningTable instance;
+		return instance;
+	}
+
+	int getGaussianFilterAutoMethod(InputArray src, const double sigma_space, const double tol)
+	{
+		CV_Assert(!src.empty());
+		return getGaussianFilterTuningTable().getMethod(src.getMat(), sigma_space, tol);
+	}
+
+	void setGaussianFilterAutoAccuracy(const double psnr)
+	{
+		getGaussianFilterTuningTable().setAccuracy(psnr);
+	}
+
+	void setGaussianFilterTuningFile(const string& path)
+	{
+		getGaussianFilterTuningTable().setPath(path);
+	}
+
+	void clearGaussianFilterTuningTable()
+	{
+		getGaussianFilterTuningTable().clear();
+	}
+}
@@ -0,0 +1,342 @@
+#include "libGaussian/gaussian_conv.h"
+#include "opencp.hpp"
+#include "GaussianFilterRecursive.h"
+
+using namespace std;
+using namespace cv;
+
+namespace cp
+{
+	void GaussianBlurSR(cv::InputArray src, cv::OutputArray dest, const double sigma);
+	void GaussianBlurAM(cv::InputArray src, cv::OutputArray dest, float sigma, int iteration);
+
+	static int getGaussianFilterDefaultK(const int method)
+	{
+		switch (method)
+		{
+		case GAUSSIAN_FILTER_BOX: return 3;
+		case GAUSSIAN_FILTER_EBOX: return 4;
+		case GAUSSIAN_FILTER_SII: return 3;
+		case GAUSSIAN_FILTER_AM: return 5;
+		case GAUSSIAN_FILTER_AM2: return 5;
+		case GAUSSIAN_FILTER_DERICHE: return 3;
+		case GAUSSIAN_FILTER_VYV: return 4;
+		default: return 0;
+		}
+	}
+
+	//recursive filters: the parallel SIMD drivers for float, and libGaussian for double
+	static void recursiveGaussianConvImage(const deriche_coeffs<float>& c, float* data, float*, int width, int height, int cn, Mat& workspace)
+	{
+		deriche_gaussian_conv_image_parallel(c, data, data, width, height, cn, workspace);
+	}
+
+	static void recursiveGaussianConvImage(const deriche_coeffs<double>& c, double* data, double* buffer, int width, int height, int cn, Mat&)
+	{
+		deriche_gaussian_conv_image(c, data, buffer, data, width, height, cn);
+	}
+
+	static void recursiveGaussianConvImage(const vyv_coeffs<float>& c, float* data, int width, int height, int cn, Mat& workspace)
+	{
+		vyv_gaussian_conv_image_parallel(c, data, data, width, height, cn, workspace);
+	}
+
+	static void recursiveGaussianConvImage(const vyv_coeffs<double>& c, double* data, int width, int height, int cn, Mat&)
+	{
+		vyv_gaussian_conv_image(c, data, data, width, height, cn);
+	}
+
+	static void amGaussianConvImage(float* data, int width, int height, int cn, float sigma, int K, float tol, Mat& workspace)
+	{
+		am_gaussian_conv_image_parallel(data, data, width, height, cn, sigma, K, tol, true, workspace);
+	}
+
+	static void amGaussianConvImage(double* data, int width, int height, int cn, double sigma, int K, double tol, Mat&)
+	{
+		am_gaussian_conv_image(data, data, width, height, cn, sigma, K, tol, true);
+	}
+
+	class GaussianFilterPlan::Impl
+	{
+	public:
+		virtual ~Impl(){ ; }
+		virtual void setSigma(const double sigma, const double tol) = 0;
+		virtual void run(const Mat& src, OutputArray dest) = 0;
+	};
+
+	//T: working precision (float for all types except for 64F)
+	template <typename T>
+	class GaussianFilterPlanImpl_ : public GaussianFilterPlan::Impl
+	{
+		const Size size;
+		const int type;
+		const int method;
+		const int K;
+
+		Mat interleave;//working precision, interleaved (color only)
+		Mat work;//working precision, planar (w x h*cn)
+		Mat out;//output of out-of-place methods (DCT, FIR)
+		Mat buffer;
+		Mat workspace;//task buffers of the parallel recursive filters (float)
+
+		dct_coeffs<T> dct;
+		fir_coeffs<T> fir;
+		ebox_coeffs<T> ebox;
+		sii_coeffs<T> sii;
+		deriche_coeffs<T> deriche;
+		vyv_coeffs<T> vyv;
+		bool isDCTPlanned;
+		bool isFIRAllocated;
+
+		T sigma;
+		T tol;
+
+		void freeCoeffs()
+		{
+			if (isDCTPlanned) dct_free(&dct);
+			if (isFIRAllocated) fir_free(&fir);
+			isDCTPlanned = false;
+			isFIRAllocated = false;
+		}
+
+	public:
+		GaussianFilterPlanImpl_(Size size_, int type_, int method_, int K_)
+			: size(size_), type(type_), method(method_), K(K_), isDCTPlanned(false), isFIRAllocated(false), sigma(0), tol(0)
+		{
+			const int wtype = DataType<T>::depth;
+			const int cn = CV_MAT_CN(type);
+			const int n = max(size.width, size.height);
+
+			if (cn != 1) interleave.create(size, CV_MAKETYPE(wtype, cn));
+			work.create(Size(size.width, size.height * cn), wtype);
+
+			if (method == GAUSSIAN_FILTER_DCT)
+			{
+				out.create(work.size(), wtype);
+				//the FFTW plan is tied to the buffers and the size, so that it is created only once
+				if (!dct_precomp_image(&dct, out.ptr<T>(0), work.ptr<T>(0), size.width, size.height, cn, (T)1))
+					CV_Error(Error::StsInternal, "FFTW planning failed in GaussianFilterPlan");
+				isDCTPlanned = true;
+			}
+			else if (method == GAUSSIAN_FILTER_FIR)
+			{
+				out.create(work.size(), wtype);
+				buffer.create(Size(n, 1), wtype);
+			}
+			else if (method == GAUSSIAN_FILTER_BOX || method == GAUSSIAN_FILTER_EBOX)
+			{
+				buffer.create(Size(n, 1), wtype);
+			}
+			else if (method == GAUSSIAN_FILTER_DERICHE)
+			{
+				buffer.create(Size(2 * n, 1), wtype);
+			}
+		}
+
+		~GaussianFilterPlanImpl_()
+		{
+			freeCoeffs();
+		}
+
+		void setSigma(const double sigma_, const double tol_)
+		{
+			if (sigma == (T)sigma_ && tol == (T)tol_) return;
+			sigma = (T)sigma_;
+			tol = (T)tol_;
+
+			const int n = max(size.width, size.height);
+			switch (method)
+			{
+			case GAUSSIAN_FILTER_DCT:
+			{
+				//same as dct_precomp_image without replanning
+				double temp = (sigma * CV_PI) / size.width;
+				dct.dims.image.alpha_x = (T)(temp * temp / 2);
+				temp = (sigma * CV_PI) / size.height;
+				dct.dims.image.alpha_y = (T)(temp * temp / 2);
+				break;
+			}
+			case GAUSSIAN_FILTER_FIR:
+				if (isFIRAllocated) fir_free(&fir);
+				isFIRAllocated = false;
+				if (!fir_precomp(&fir, sigma, tol))
+					CV_Error(Error::StsNoMem, "fir_precomp failed in GaussianFilterPlan");
+				isFIRAllocated = true;
+				break;
+			case GAUSSIAN_FILTER_EBOX:
+				ebox_precomp(&ebox, sigma, K);
+				break;
+			case GAUSSIAN_FILTER_SII:
+				CV_Assert(SII_VALID_K(K));
+				sii_precomp(sii, sigma, K);
+				buffer.create(Size(sii_buffer_size(sii, n), 1), DataType<T>::depth);
+				break;
+			case GAUSSIAN_FILTER_DERICHE:
+				CV_Assert(DERICHE_VALID_K(K));
+				deriche_precomp(&deriche, sigma, K, tol);//tol truncates the boundary initialization
+				break;
+			case GAUSSIAN_FILTER_VYV:
+				CV_Assert(VYV_VALID_K(K));
+				vyv_precomp(&vyv, sigma, K, tol);
+				break;
+			default:
+				break;
+			}
+		}
+
+		void run(const Mat& src, OutputArray dest)
+		{
+			CV_Assert(src.size() == size && src.type() == type);
+			const int cn = src.channels();
+			const int w = size.width;
+			const int h = size.height;
+
+			if (cn == 1)
+			{
+				src.convertTo(work, work.depth());
+			}
+			else
+			{
+				src.convertTo(interleave, interleave.depth());
+				cvtColorBGR2PLANE(interleave, work);
+			}
+
+			T* s = work.ptr<T>(0);
+			Mat* result = &work;
+			switch (method)
+			{
+			case GAUSSIAN_FILTER_DCT:
+				dct_gaussian_conv(dct);
+				result = &out;
+				break;
+			case GAUSSIAN_FILTER_FIR:
+				fir_gaussian_conv_image(fir, out.ptr<T>(0), buffer.ptr<T>(0), s, w, h, cn);
+				result = &out;
+				break;
+			case GAUSSIAN_FILTER_BOX:
+				box_gaussian_conv_image(s, buffer.ptr<T>(0), s, w, h, cn, sigma, K);
+				break;
+			case GAUSSIAN_FILTER_EBOX:
+				ebox_gaussian_conv_image(ebox, s, buffer.ptr<T>(0), s, w, h, cn);
+				break;
+			case GAUSSIAN_FILTER_SII:
+				sii_gaussian_conv_image(sii, s, buffer.ptr<T>(0), s, w, h, cn);
+				break;
+			case GAUSSIAN_FILTER_AM:
+				amGaussianConvImage(s, w, h, cn, sigma, K, tol, workspace);
+				break;
+			case GAUSSIAN_FILTER_DERICHE:
+				recursiveGaussianConvImage(deriche, s, buffer.ptr<T>(0), w, h, cn, workspace);
+				break;
+			case GAUSSIAN_FILTER_VYV:
+				recursiveGaussianConvImage(vyv, s, w, h, cn, workspace);
+				break;
+			}
+
+			if (cn != 1)
+			{
+				cvtColorPLANE2BGR(*result, interleave);
+				result = &interleave;
+			}
+
+			const int depth = CV_MAT_DEPTH(type);
+			if (depth == CV_8U || depth == CV_16S || depth == CV_16U || depth == CV_32S)
+				result->convertTo(dest, depth, 1.0, 0.5);
+			else
+				result->convertTo(dest, depth);
+		}
+	};
+
+	//AM2 and SR are not libGaussian methods; they are called directly.
+	class GaussianFilterPlanDirect_ : public GaussianFilterPlan::Impl
+	{
+		const int method;
+		const int K;
+		double sigma;
+
+	public:
+		GaussianFilterPlanDirect_(int method_, int K_) : method(method_), K(K_), sigma(0)
+		{
+			;
+		}
+
+		void setSigma(const double sigma_, const double)
+		{
+			sigma = sigma_;
+		}
+
+		void run(const Mat& src, OutputArray dest)
+		{
+			if (method == GAUSSIAN_FILTER_AM2) GaussianBlurAM(src, dest, (float)sigma, K);
+			else GaussianBlurSR(src, dest, sigma);
+		}
+	};
+
+	GaussianFilterPlan::GaussianFilterPlan() : impl(NULL), size(0, 0), type(-1), method(-1), K(0), sigma_space(0.0), tol(0.0)
+	{
+		;
+	}
+
+	GaussianFilterPlan::GaussianFilterPlan(Size size_, int type_, double sigma_space_, int filter_method, int K_, double tol_)
+		: impl(NULL), size(0, 0), type(-1), method(-1), K(0), sigma_space(0.0), tol(0.0)
+	{
+		init(size_, type_, sigma_space_, filter_method, K_, tol_);
+	}
+
+	GaussianFilterPlan::~GaussianFilterPlan()
+	{
+		delete impl;
+	}
+
+	void GaussianFilterPlan::init(Size size_, int type_, double sigma_space_, int filter_method, int K_, double tol_)
+	{
+		CV_Assert(size_.area() > 0 && sigma_space_ > 0.0);
+		CV_Assert(CV_MAT_CN(type_) == 1 || CV_MAT_CN(type_) == 3);
+		CV_Assert(filter_method != GAUSSIAN_FILTER_AUTO);
+
+		const int k = (K_ != 0) ? K_ : getGaussianFilterDefaultK(filter_method);
+		if (impl == NULL || size_ != size || type_ != type || filter_method != method || k != K)
+		{
+			delete impl;
+			impl = NULL;
+			size = size_;
+			type = type_;
+			method = filter_method;
+			K = k;
+
+			if (method == GAUSSIAN_FILTER_AM2 || method == GAUSSIAN_FILTER_SR || method < GAUSSIAN_FILTER_DCT || method > GAUSSIAN_FILTER_SR)
+			{
+				if (method != GAUSSIAN_FILTER_AM2) method = GAUSSIAN_FILTER_SR;
+				impl = new GaussianFilterPlanDirect_(method, K);
+			}
+			else if (CV_MAT_DEPTH(type) == CV_64F)
+				impl = new GaussianFilterPlanImpl_<double>(size, type, method, K);
+			else
+				impl = new GaussianFilterPlanImpl_<float>(size, type, method, K);
+		}
+		sigma_space = sigma_space_;
+		tol = tol_;
+		impl->setSigma(sigma_space, tol);
+	}
+
+	void GaussianFilterPlan::setSigma(double sigma_space_)
+	{
+		CV_Assert(impl != NULL && sigma_space_ > 0.0);
+		sigma_space = sigma_space_;
+		impl->setSigma(sigma_space, tol);
+	}
+
+	void GaussianFilterPlan::operator()(InputArray src, OutputArray dest)
+	{
+		CV_Assert(impl != NULL);
+		impl->run(src.getMat(), dest);
+	}
+
+	void GaussianFilterPlan::operator()(InputArray src, OutputArray dest, double sigma_space_)
+	{
+		CV_Assert(impl != NULL);
+		if (src.size() != size || src.type() != type) init(src.size(), src.type(), sigma_space_, method, K, tol);
+		else setSigma(sigma_space_);
+		impl->run(src.getMat(), dest);
+	}
+}
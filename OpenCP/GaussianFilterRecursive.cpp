@@ -0,0 +1,88 @@
+#include "opencp.hpp"
+#include "GaussianFilterRecursive.h"
+
+using namespace std;
+using namespace cv;
+
+#include "GaussianFilterRecursiveKernel.hpp"
+
+namespace cp
+{
+	struct VecSSE
+	{
+		typedef __m128 V;
+		enum { W = 4 };
+		static inline V load(const float* p) { return _mm_loadu_ps(p); }
+		static inline void store(float* p, const V a) { _mm_storeu_ps(p, a); }
+		static inline V set1(const float v) { return _mm_set1_ps(v); }
+		static inline V zero() { return _mm_setzero_ps(); }
+		static inline V add(const V a, const V b) { return _mm_add_ps(a, b); }
+		static inline V mul(const V a, const V b) { return _mm_mul_ps(a, b); }
+		static inline V fmadd(const V a, const V b, const V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+		static inline V fnmadd(const V a, const V b, const V c) { return _mm_sub_ps(c, _mm_mul_ps(a, b)); }
+	};
+
+	static inline void copyIfNeeded(float* dest, const float* src, const int width, const int height, const int num_channels)
+	{
+		if (dest != src) memcpy(dest, src, sizeof(float) * width * height * num_channels);
+	}
+
+	void deriche_gaussian_conv_image_parallel(const deriche_coeffs<float>& c, float* dest, const float* src, int width, int height, int num_channels, Mat& workspace)
+	{
+		CV_Assert(DERICHE_VALID_K(c.K));
+		if (width <= 4 || height <= 4)
+		{
+			//special case for very short signals in libGaussian
+			workspace.create(1, 2 * max(width, height), CV_32F);
+			deriche_gaussian_conv_image(c, dest, workspace.ptr<float>(0), src, width, height, num_channels);
+			return;
+		}
+
+		copyIfNeeded(dest, src, width, height, num_channels);
+		if (haveGaussianFilterRecursiveAVX2())
+		{
+			deriche_gaussian_conv_image_AVX2(c, dest, width, height, num_channels, workspace);
+			return;
+		}
+		recursiveGaussianImage<VecSSE>(DericheStrip<VecSSE>(c), dest, width, height, num_channels, workspace);
+	}
+
+	void vyv_gaussian_conv_image_parallel(const vyv_coeffs<float>& c, float* dest, const float* src, int width, int height, int num_channels, Mat& workspace)
+	{
+		CV_Assert(VYV_VALID_K(c.K));
+		if (width <= 4 || height <= 4)
+		{
+			vyv_gaussian_conv_image(c, dest, src, width, height, num_channels);
+			return;
+		}
+
+		copyIfNeeded(dest, src, width, height, num_channels);
+		if (haveGaussianFilterRecursiveAVX2())
+		{
+			vyv_gaussian_conv_image_AVX2(c, dest, width, height, num_channels, workspace);
+			return;
+		}
+		recursiveGaussianImage<VecSSE>(VYVStrip<VecSSE>(c), dest, width, height, num_channels, workspace);
+	}
+
+	void am_gaussian_conv_image_parallel(float* dest, const float* src, int width, int height, int num_channels, float sigma, int K, float tol, bool use_adjusted_q, Mat& workspace)
+	{
+		CV_Assert(sigma > 0.f && K > 0 && tol > 0.f);
+
+		//same coefficients as am_gaussian_conv in libGaussian
+		const double q = (use_adjusted_q) ? sigma * (1.0 + (0.3165 * K + 0.5695) / ((K + 0.7818) * (K + 0.7818))) : sigma;
+		const double lambda = (q * q) / (2.0 * K);
+		const double dnu = (1.0 + 2.0 * lambda - sqrt(1.0 + 4.0 * lambda)) / (2.0 * lambda);
+		const long num_terms = (long)ceil(log((1.0 - dnu) * tol) / log(dnu));
+		const float nu = (float)dnu;
+		const float scale = (float)pow(dnu / lambda, K);
+
+		copyIfNeeded(dest, src, width, height, num_channels);
+		if (haveGaussianFilterRecursiveAVX2())
+		{
+			am_gaussian_conv_image_AVX2(dest, width, height, num_channels, nu, scale, num_terms, K, workspace);
+			return;
+		}
+		recursiveGaussianImage<VecSSE>(AMStrip<VecSSE>(nu, scale, num_terms, K), dest, width, height, num_channels, workspace);
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "libGaussian/gaussian_conv.h"
+#include <opencv2/opencv.hpp>
+
+namespace cp
+{
+	//parallel drivers of the recursive Gaussian filters in libGaussian (float, planar: width x height*num_channels).
+	//the vertical pass filters a strip of 8 (SSE) or 16 (AVX2) columns at a time as SIMD lanes,
+	//and the horizontal pass filters a band of the same number of rows by transposing the band into a strip.
+	//strips and bands are split into getNumThreads() tasks.
+	//workspace is reused among calls; dest may be equal to src.
+	void deriche_gaussian_conv_image_parallel(const deriche_coeffs<float>& c, float* dest, const float* src, int width, int height, int num_channels, cv::Mat& workspace);
+	void vyv_gaussian_conv_image_parallel(const vyv_coeffs<float>& c, float* dest, const float* src, int width, int height, int num_channels, cv::Mat& workspace);
+	void am_gaussian_conv_image_parallel(float* dest, const float* src, int width, int height, int num_channels, float sigma, int K, float tol, bool use_adjusted_q, cv::Mat& workspace);
+
+	//AVX2 kernels (GaussianFilterRecursiveAVX2.cpp), in-place
+	bool haveGaussianFilterRecursiveAVX2();
+	void deriche_gaussian_conv_image_AVX2(const deriche_coeffs<float>& c, float* data, int width, int height, int num_channels, cv::Mat& workspace);
+	void vyv_gaussian_conv_image_AVX2(const vyv_coeffs<float>& c, float* data, int width, int height, int num_channels, cv::Mat& workspace);
+	void am_gaussian_conv_image_AVX2(float* data, int width, int height, int num_channels, float nu, float scale, long num_terms, int K, cv::Mat& workspace);
+}
@@ -0,0 +1,71 @@
+#include "opencp.hpp"
+#include "GaussianFilterRecursive.h"
+
+using namespace std;
+using namespace cv;
+
+#if defined(__AVX2__)
+#include "GaussianFilterRecursiveKernel.hpp"
+#endif
+
+namespace cp
+{
+#if defined(__AVX2__)
+
+	bool haveGaussianFilterRecursiveAVX2()
+	{
+		return checkHardwareSupport(CV_CPU_AVX2) && checkHardwareSupport(CV_CPU_FMA3);
+	}
+
+	struct VecAVX2
+	{
+		typedef __m256 V;
+		enum { W = 8 };
+		static inline V load(const float* p) { return _mm256_loadu_ps(p); }
+		static inline void store(float* p, const V a) { _mm256_storeu_ps(p, a); }
+		static inline V set1(const float v) { return _mm256_set1_ps(v); }
+		static inline V zero() { return _mm256_setzero_ps(); }
+		static inline V add(const V a, const V b) { return _mm256_add_ps(a, b); }
+		static inline V mul(const V a, const V b) { return _mm256_mul_ps(a, b); }
+		static inline V fmadd(const V a, const V b, const V c) { return _mm256_fmadd_ps(a, b, c); }
+		static inline V fnmadd(const V a, const V b, const V c) { return _mm256_fnmadd_ps(a, b, c); }
+	};
+
+	void deriche_gaussian_conv_image_AVX2(const deriche_coeffs<float>& c, float* data, int width, int height, int num_channels, Mat& workspace)
+	{
+		recursiveGaussianImage<VecAVX2>(DericheStrip<VecAVX2>(c), data, width, height, num_channels, workspace);
+	}
+
+	void vyv_gaussian_conv_image_AVX2(const vyv_coeffs<float>& c, float* data, int width, int height, int num_channels, Mat& workspace)
+	{
+		recursiveGaussianImage<VecAVX2>(VYVStrip<VecAVX2>(c), data, width, height, num_channels, workspace);
+	}
+
+	void am_gaussian_conv_image_AVX2(float* data, int width, int height, int num_channels, float nu, float scale, long num_terms, int K, Mat& workspace)
+	{
+		recursiveGaussianImage<VecAVX2>(AMStrip<VecAVX2>(nu, scale, num_terms, K), data, width, height, num_channels, workspace);
+	}
+
+#else //compiled without AVX2 code generation
+
+	bool haveGaussianFilterRecursiveAVX2()
+	{
+		return false;
+	}
+
+	void deriche_gaussian_conv_image_AVX2(const deriche_coeffs<float>& c, float* data, int width, int height, int num_channels, Mat& workspace)
+	{
+		CV_Error(Error::StsNotImplemented, "GaussianFilterRecursiveAVX2.cpp is compiled without AVX2");
+	}
+
+	void vyv_gaussian_conv_image_AVX2(const vyv_coeffs<float>& c, float* data, int width, int height, int num_channels, Mat& workspace)
+	{
+		CV_Error(Error::StsNotImplemented, "GaussianFilterRecursiveAVX2.cpp is compiled without AVX2");
+	}
+
+	void am_gaussian_conv_image_AVX2(float* data, int width, int height, int num_channels, float nu, float scale, long num_terms, int K, Mat& workspace)
+	{
+		CV_Error(Error::StsNotImplemented, "GaussianFilterRecursiveAVX2.cpp is compiled without AVX2");
+	}
+#endif
+}
@@ -0,0 +1,387 @@
+#pragma once
+
+//column strip kernels of the recursive Gaussian filters (Deriche, VYV, AM) and their parallel image driver.
+//this file is included by GaussianFilterRecursive.cpp (SSE) and GaussianFilterRecursiveAVX2.cpp (AVX2) with a vector trait class:
+//  V: vector type, W: number of lanes, load, store, set1, zero, add, mul, fmadd(a, b, c) = a*b+c, fnmadd(a, b, c) = c-a*b
+//a strip is B = 2W columns, i.e., two independent recurrences per row to hide the latency of the recursion.
+//everything is in an unnamed namespace, since the file is compiled with different instruction sets.
+
+#include "GaussianFilterRecursive.h"
+
+namespace cp
+{
+	namespace
+	{
+		//p: top of the strip, N: length, stride: offset between rows, work: N*B floats
+		template<class Vec, int K>
+		void dericheStrip(const deriche_coeffs<float>& c, float* p, const int N, const long stride, float* work)
+		{
+			typedef typename Vec::V V;
+			const int W = Vec::W;
+			const int B = 2 * W;
+
+			//boundaries are initialized from the source before it is overwritten
+			CV_DECL_ALIGNED(64) float yc[DERICHE_MAX_K][B];
+			CV_DECL_ALIGNED(64) float ya[DERICHE_MAX_K][B];
+			float q[DERICHE_MAX_K];
+			for (int l = 0; l < B; l++)
+			{
+				init_recursive_filter(q, p + l, N, stride, c.b_causal, K - 1, c.a, K, c.sum_causal, c.tol, c.max_iter);
+				for (int k = 0; k < K; k++) yc[k][l] = q[k];
+				init_recursive_filter(q, p + l + stride * (N - 1), N, -stride, c.b_anticausal, K, c.a, K, c.sum_anticausal, c.tol, c.max_iter);
+				for (int k = 0; k < K; k++) ya[k][l] = q[k];
+			}
+
+			V b[K], a[K + 1], ba[K + 1];
+			for (int k = 0; k < K; k++) b[k] = Vec::set1(c.b_causal[k]);
+			for (int k = 1; k <= K; k++)
+			{
+				a[k] = Vec::set1(c.a[k]);
+				ba[k] = Vec::set1(c.b_anticausal[k]);
+			}
+
+			//causal filter to work
+			for (int n = 0; n < K; n++)
+			{
+				Vec::store(work + n * B, Vec::load(yc[n]));
+				Vec::store(work + n * B + W, Vec::load(yc[n] + W));
+			}
+			for (int n = K; n < N; n++)
+			{
+				const float* s = p + stride * n;
+				float* y = work + n * B;
+				for (int j = 0; j < B; j += W)
+				{
+					V acc = Vec::mul(b[0], Vec::load(s + j));
+					for (int k = 1; k < K; k++) acc = Vec::fmadd(b[k], Vec::load(s + j - stride * k), acc);
+					for (int k = 1; k <= K; k++) acc = Vec::fnmadd(a[k], Vec::load(y + j - B * k), acc);
+					Vec::store(y + j, acc);
+				}
+			}
+
+			//anticausal filter, summed with the causal response; the last K source rows and responses are kept in registers
+			V sh[K][2], yh[K][2];
+			for (int n = 0; n < K; n++)
+			{
+				float* d = p + stride * (N - 1 - n);
+				const float* y = work + (N - 1 - n) * B;
+				for (int j = 0; j < 2; j++)
+				{
+					for (int k = n; k > 0; k--)
+					{
+						sh[k][j] = sh[k - 1][j];
+						yh[k][j] = yh[k - 1][j];
+					}
+					sh[0][j] = Vec::load(d + j * W);
+					yh[0][j] = Vec::load(ya[n] + j * W);
+					Vec::store(d + j * W, Vec::add(Vec::load(y + j * W), yh[0][j]));
+				}
+			}
+			for (int n = K; n < N; n++)
+			{
+				float* d = p + stride * (N - 1 - n);
+				const float* y = work + (N - 1 - n) * B;
+				for (int j = 0; j < 2; j++)
+				{
+					V acc = Vec::mul(ba[1], sh[0][j]);
+					for (int k = 2; k <= K; k++) acc = Vec::fmadd(ba[k], sh[k - 1][j], acc);
+					for (int k = 1; k <= K; k++) acc = Vec::fnmadd(a[k], yh[k - 1][j], acc);
+					for (int k = K - 1; k > 0; k--)
+					{
+						sh[k][j] = sh[k - 1][j];
+						yh[k][j] = yh[k - 1][j];
+					}
+					sh[0][j] = Vec::load(d + j * W);
+					yh[0][j] = acc;
+					Vec::store(d + j * W, Vec::add(Vec::load(y + j * W), acc));
+				}
+			}
+		}
+
+		template<class Vec, int K>
+		void vyvStrip(const vyv_coeffs<float>& c, float* p, const int N, const long stride)
+		{
+			typedef typename Vec::V V;
+			const int W = Vec::W;
+			const int B = 2 * W;
+
+			//left boundary
+			float q[VYV_MAX_K];
+			for (int l = 0; l < B; l++)
+			{
+				init_recursive_filter(q, p + l, N, stride, c.filter, 0, c.filter, K, 1.f, c.tol, c.max_iter);
+				for (int m = 0; m < K; m++) p[l + stride * m] = q[m];
+			}
+
+			V f[K + 1];
+			for (int k = 0; k <= K; k++) f[k] = Vec::set1(c.filter[k]);
+
+			//causal filter
+			for (int n = K; n < N; n++)
+			{
+				float* d = p + stride * n;
+				for (int j = 0; j < B; j += W)
+				{
+					V acc = Vec::mul(f[0], Vec::load(d + j));
+					for (int k = 1; k <= K; k++) acc = Vec::fnmadd(f[k], Vec::load(d + j - stride * k), acc);
+					Vec::store(d + j, acc);
+				}
+			}
+
+			//right boundary: dest(N-K+m) = sum_n M(m, n) dest(N-K+n)
+			for (int j = 0; j < B; j += W)
+			{
+				V v[K];
+				for (int m = 0; m < K; m++) v[m] = Vec::load(p + stride * (N - K + m) + j);
+				for (int m = 0; m < K; m++)
+				{
+					V acc = Vec::zero();
+					for (int n = 0; n < K; n++) acc = Vec::fmadd(Vec::set1(c.M[m + K * n]), v[n], acc);
+					Vec::store(p + stride * (N - K + m) + j, acc);
+				}
+			}
+
+			//anticausal filter
+			for (int n = N - K - 1; n >= 0; n--)
+			{
+				float* d = p + stride * n;
+				for (int j = 0; j < B; j += W)
+				{
+					V acc = Vec::mul(f[0], Vec::load(d + j));
+					for (int k = 1; k <= K; k++) acc = Vec::fnmadd(f[k], Vec::load(d + j + stride * k), acc);
+					Vec::store(d + j, acc);
+				}
+			}
+		}
+
+		template<class Vec>
+		void amStrip(float* p, const int N, const long stride, const float nu, const float scale, const long num_terms, const int K)
+		{
+			typedef typename Vec::V V;
+			const int W = Vec::W;
+			const int B = 2 * W;
+
+			const V vnu = Vec::set1(nu);
+			const V vscale = Vec::set1(scale);
+			const V vright = Vec::set1(1.f / (1.f - nu));
+			for (int n = 0; n < N; n++)
+			{
+				float* d = p + stride * n;
+				for (int j = 0; j < B; j += W) Vec::store(d + j, Vec::mul(Vec::load(d + j), vscale));
+			}
+
+			for (int pass = 0; pass < K; pass++)
+			{
+				for (int j = 0; j < B; j += W)
+				{
+					//left boundary
+					V acc = Vec::load(p + j);
+					float h = 1.f;
+					for (long m = 1; m < num_terms; m++)
+					{
+						h *= nu;
+						acc = Vec::fmadd(Vec::set1(h), Vec::load(p + stride * extension(N, -m) + j), acc);
+					}
+					Vec::store(p + j, acc);
+
+					//causal filter
+					for (int n = 1; n < N; n++)
+					{
+						float* d = p + stride * n + j;
+						acc = Vec::fmadd(vnu, acc, Vec::load(d));
+						Vec::store(d, acc);
+					}
+
+					//right boundary
+					acc = Vec::mul(acc, vright);
+					Vec::store(p + stride * (N - 1) + j, acc);
+
+					//anticausal filter
+					for (int n = N - 2; n >= 0; n--)
+					{
+						float* d = p + stride * n + j;
+						acc = Vec::fmadd(vnu, acc, Vec::load(d));
+						Vec::store(d, acc);
+					}
+				}
+			}
+		}
+
+		template<class Vec>
+		struct DericheStrip
+		{
+			const deriche_coeffs<float>& c;
+			DericheStrip(const deriche_coeffs<float>& c_) : c(c_) { ; }
+
+			void operator()(float* p, const int N, const long stride, float* work) const
+			{
+				switch (c.K)
+				{
+				case 2: dericheStrip<Vec, 2>(c, p, N, stride, work); break;
+				case 3: dericheStrip<Vec, 3>(c, p, N, stride, work); break;
+				case 4: dericheStrip<Vec, 4>(c, p, N, stride, work); break;
+				}
+			}
+		};
+
+		template<class Vec>
+		struct VYVStrip
+		{
+			const vyv_coeffs<float>& c;
+			VYVStrip(const vyv_coeffs<float>& c_) : c(c_) { ; }
+
+			void operator()(float* p, const int N, const long stride, float* work) const
+			{
+				switch (c.K)
+				{
+				case 3: vyvStrip<Vec, 3>(c, p, N, stride); break;
+				case 4: vyvStrip<Vec, 4>(c, p, N, stride); break;
+				case 5: vyvStrip<Vec, 5>(c, p, N, stride); break;
+				}
+			}
+		};
+
+		template<class Vec>
+		struct AMStrip
+		{
+			const float nu;
+			const float scale;
+			const long num_terms;
+			const int K;
+			AMStrip(float nu_, float scale_, long num_terms_, int K_) : nu(nu_), scale(scale_), num_terms(num_terms_), K(K_) { ; }
+
+			void operator()(float* p, const int N, const long stride, float* work) const
+			{
+				amStrip<Vec>(p, N, stride, nu, scale, num_terms, K);
+			}
+		};
+
+		//workspace of a task: a transposed band or a partial strip (n*B) and the work buffer of the strip kernel (n*B)
+		template<class Vec>
+		int getRecursiveGaussianTaskSize(const int width, const int height)
+		{
+			return 2 * std::max(width, height) * 2 * Vec::W;
+		}
+
+		//horizontal pass: row bands of B rows are transposed to strips of length width
+		template<class Vec, class Strip>
+		class RecursiveGaussianHorizontal_Invoker : public cv::ParallelLoopBody
+		{
+			float* data;
+			const int width;
+			const int rows;
+			const int tasks;
+			const Strip& strip;
+			cv::Mat& workspace;
+
+		public:
+			RecursiveGaussianHorizontal_Invoker(float* data_, int width_, int rows_, int tasks_, const Strip& strip_, cv::Mat& workspace_)
+				: data(data_), width(width_), rows(rows_), tasks(tasks_), strip(strip_), workspace(workspace_)
+			{
+				;
+			}
+
+			void operator()(const cv::Range& range) const
+			{
+				const int B = 2 * Vec::W;
+				const int bands = (rows + B - 1) / B;
+				for (int t = range.start; t < range.end; t++)
+				{
+					float* band = workspace.ptr<float>(t);
+					float* work = band + width * B;
+					for (int i = bands * t / tasks; i < bands * (t + 1) / tasks; i++)
+					{
+						const int y0 = i * B;
+						const int h = std::min(B, rows - y0);
+						for (int l = 0; l < h; l++)
+						{
+							const float* s = data + (long)width * (y0 + l);
+							for (int x = 0; x < width; x++) band[x * B + l] = s[x];
+						}
+						for (int l = h; l < B; l++)
+						{
+							for (int x = 0; x < width; x++) band[x * B + l] = 0.f;
+						}
+
+						strip(band, width, B, work);
+
+						for (int l = 0; l < h; l++)
+						{
+							float* d = data + (long)width * (y0 + l);
+							for (int x = 0; x < width; x++) d[x] = band[x * B + l];
+						}
+					}
+				}
+			}
+		};
+
+		//vertical pass: strips of B columns are filtered in place; the last partial strip is padded in the workspace
+		template<class Vec, class Strip>
+		class RecursiveGaussianVertical_Invoker : public cv::ParallelLoopBody
+		{
+			float* data;
+			const int width;
+			const int height;
+			const int channels;
+			const int tasks;
+			const Strip& strip;
+			cv::Mat& workspace;
+
+		public:
+			RecursiveGaussianVertical_Invoker(float* data_, int width_, int height_, int channels_, int tasks_, const Strip& strip_, cv::Mat& workspace_)
+				: data(data_), width(width_), height(height_), channels(channels_), tasks(tasks_), strip(strip_), workspace(workspace_)
+			{
+				;
+			}
+
+			void operator()(const cv::Range& range) const
+			{
+				const int B = 2 * Vec::W;
+				const int strips = (width + B - 1) / B;
+				const int units = strips * channels;
+				for (int t = range.start; t < range.end; t++)
+				{
+					float* pad = workspace.ptr<float>(t);
+					float* work = pad + height * B;
+					for (int i = units * t / tasks; i < units * (t + 1) / tasks; i++)
+					{
+						const int x0 = (i % strips) * B;
+						float* p = data + (long)width * height * (i / strips) + x0;
+						const int w = std::min(B, width - x0);
+						if (w == B)
+						{
+							strip(p, height, width, work);
+							continue;
+						}
+
+						for (int y = 0; y < height; y++)
+						{
+							for (int l = 0; l < w; l++) pad[y * B + l] = p[(long)width * y + l];
+							for (int l = w; l < B; l++) pad[y * B + l] = 0.f;
+						}
+						strip(pad, height, B, work);
+						for (int y = 0; y < height; y++)
+						{
+							for (int l = 0; l < w; l++) p[(long)width * y + l] = pad[y * B + l];
+						}
+					}
+				}
+			}
+		};
+
+		//in-place filtering of planar data; rows of workspace are the task buffers
+		template<class Vec, class Strip>
+		void recursiveGaussianImage(const Strip& strip, float* data, const int width, const int height, const int num_channels, cv::Mat& workspace)
+		{
+			const int B = 2 * Vec::W;
+			const int units = std::max((height * num_channels + B - 1) / B, (width + B - 1) / B * num_channels);
+			const int tasks = std::max(1, std::min(cv::getNumThreads(), units));
+			workspace.create(tasks, getRecursiveGaussianTaskSize<Vec>(width, height), CV_32F);
+
+			RecursiveGaussianHorizontal_Invoker<Vec, Strip> hbody(data, width, height * num_channels, tasks, strip, workspace);
+			cv::parallel_for_(cv::Range(0, tasks), hbody, tasks);
+			RecursiveGaussianVertical_Invoker<Vec, Strip> vbody(data, width, height, num_channels, tasks, strip, workspace);
+			cv::parallel_for_(cv::Range(0, tasks), vbody, tasks);
+		}
+	}
+}
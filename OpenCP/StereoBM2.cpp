@@ -44,6 +44,7 @@
 *    Contributed by Kurt Konolige                                                        *
 \****************************************************************************************/
 #include "opencp.hpp"
+#include "StereoTemporal.h"
 using namespace cv;
 using namespace std;
 
@@ -972,6 +973,10 @@ namespace cp
 
 		medianKernel = 0;
 		isOcclusion = 0;
+
+		pyramidLevels = 0;
+		pyramidTileSize = 64;
+		pyramidMargin = 2;
 	}
 	void StereoBMEx::showPostFilter()
 	{
@@ -1022,6 +1027,87 @@ namespace cp
 		imshow("R", sr);
 		imshow("L", sl);
 	}
+	//the full range is searched only at the coarsest level, and each finer level runs BM in tiles on the bands around the upsampled disparity.
+	//a tile is extended to the left by its range and the halo of the window and the prefilter, and the right image is shifted by the minimum of the band,
+	//so that BM of the tile is [0, range). the output has the invalid value of BM, (minDisparity - 1) * 16.
+	void StereoBMEx::getDisparityPyramid(Mat& sl, Mat& sr, Mat& disp)
+	{
+		const int levels = pyramidLevels;
+		vector<Mat> L(levels + 1), R(levels + 1);
+		L[0] = sl;
+		R[0] = sr;
+		for (int n = 1; n <= levels; n++)
+		{
+			pyrDown(L[n - 1], L[n]);
+			pyrDown(R[n - 1], R[n]);
+		}
+
+		const int minD0 = bm.state->minDisparity;
+		const int numD0 = bm.state->numberOfDisparities;
+		const int speckleWindow = bm.state->speckleWindowSize;
+		const int maxD = minD0 + numD0;
+		const int h = bm.state->SADWindowSize / 2 + bm.state->preFilterSize / 2 + 1;
+		Mat prev, lt, rt, dt;
+		int prevInvalid = 0;
+		vector<StereoTile> tiles;
+		for (int n = levels; n >= 0; n--)
+		{
+			const int s = 1 << n;
+			const int minD = (n == 0) ? minD0 : cvFloor((double)minD0 / s);
+			const int range = (n == 0) ? numD0 : max((cvCeil((double)maxD / s) - minD + 15) / 16 * 16, 16);
+			const int invalid = (minD - 1) << 4;
+
+			Mat d(L[n].size(), CV_16S);
+			if (n == levels)
+			{
+				bm.state->minDisparity = minD;
+				bm.state->numberOfDisparities = range;
+				bm(L[n], R[n], d);
+			}
+			else
+			{
+				Mat prior;
+				upsampleDisparityPrior(prev, d.size(), prevInvalid, invalid, prior);
+				planStereoTiles(Mat(), Mat(), Mat(), Mat(), prior, invalid, pyramidTileSize, 0, pyramidMargin, minD, range, 16, tiles);
+
+				//the speckles are removed on the whole level
+				bm.state->minDisparity = 0;
+				bm.state->speckleWindowSize = 0;
+				d.setTo(invalid);
+				for (size_t i = 0; i < tiles.size(); i++)
+				{
+					const Rect& roi = tiles[i].roi;
+					const int D = tiles[i].numberOfDisparities;
+					const int offset = 16 * tiles[i].minDisparity;
+					const Rect troi(roi.x - D - h, roi.y - h, roi.width + D + 2 * h, roi.height + 2 * h);
+					copyStereoTileROI(L[n], troi, lt);
+					copyStereoTileROI(R[n], troi - Point(tiles[i].minDisparity, 0), rt);
+					bm.state->numberOfDisparities = D;
+					bm(lt, rt, dt);
+					for (int j = 0; j < roi.height; j++)
+					{
+						const short* src = dt.ptr<short>(j + h) + D + h;
+						short* dst = d.ptr<short>(roi.y + j) + roi.x;
+						for (int x = 0; x < roi.width; x++) dst[x] = (src[x] < 0) ? (short)invalid : (short)(src[x] + offset);
+					}
+				}
+				bm.state->speckleWindowSize = speckleWindow;
+
+				//as the full-frame BM, the pixels without the full window or range are invalid
+				const Rect valid = getValidDisparityROI(Rect(0, 0, d.cols, d.rows), Rect(0, 0, d.cols, d.rows), minD, range, bm.state->SADWindowSize);
+				Mat mask(d.size(), CV_8U, Scalar::all(255));
+				mask(valid).setTo(0);
+				d.setTo(invalid, mask);
+				if (bm.state->speckleRange >= 0 && speckleWindow > 0) filterSpeckles(d, invalid, speckleWindow, bm.state->speckleRange);
+			}
+			prevInvalid = invalid;
+			prev = d;
+		}
+		bm.state->minDisparity = minD0;
+		bm.state->numberOfDisparities = numD0;
+		prev.copyTo(disp);
+	}
+
 	void StereoBMEx::operator()(Mat& leftim, Mat& rightim, Mat& dispL, Mat& dispR, int bd)
 	{
 		parameterUpdate();
@@ -1042,14 +1128,16 @@ namespace cp
 		cv::copyMakeBorder(sl, slb, bs, bs, bd, bd, cv::BORDER_REPLICATE);
 		cv::copyMakeBorder(sr, srb, bs, bs, bd, bd, cv::BORDER_REPLICATE);
 
-		bm(slb, srb, disp2);
+		if (pyramidLevels > 0) getDisparityPyramid(slb, srb, disp2);
+		else bm(slb, srb, disp2);
 		Mat(disp2(cv::Rect(bd, bs, leftim.cols, leftim.rows))).copyTo(dispL);
 		cv::threshold(dispL, dispL, (minDisparity << 4) - 1, 0, cv::THRESH_TOZERO);
 
 		cv::flip(slb, slb, -1);
 		cv::flip(srb, srb, -1);
 		disp2.setTo(0);
-		bm(srb, slb, disp2);
+		if (pyramidLevels > 0) getDisparityPyramid(srb, slb, disp2);
+		else bm(srb, slb, disp2);
 		Mat(disp2(cv::Rect(bd, bs, leftim.cols, leftim.rows))).copyTo(dispR);
 		cv::flip(dispR, dispR, -1);
 		cv::threshold(dispR, dispR, (minDisparity << 4) - 1, 0, cv::THRESH_TOZERO);
@@ -1116,7 +1204,8 @@ namespace cp
 		bm.state->trySmallerWindows = trySmallerWindows;
 		bm.state->disp12MaxDiff = disp12MaxDiff;
 
-		bm(slb, srb, disp2);
+		if (pyramidLevels > 0) getDisparityPyramid(slb, srb, disp2);
+		else bm(slb, srb, disp2);
 		Mat(disp2(cv::Rect(bd, bs, leftim.cols, leftim.rows))).copyTo(disp);
 		cv::threshold(disp, disp, (minDisparity << 4) - 1, 0, cv::THRESH_TOZERO);
 
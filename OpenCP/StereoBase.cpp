@@ -1,4 +1,6 @@
 #include "opencp.hpp"
+#include "StereoCost.h"
+#include "StereoTemporal.h"
 using namespace std;
 using namespace cv;
 
@@ -526,11 +528,25 @@ namespace cp
 		prefParam = 50;
 		prefParam2 = 20;
 		isBT = false;
+		isCensus = false;
+		censusWindow = Size(5, 5);
 		isMinCostFilter = true;
 
 		isProcessLBorder = true;
 		P1 = 0;
 		P2 = 0;
+		bandHeight = 0;
+
+		isTemporal = false;
+		temporalTileSize = 32;
+		temporalMargin = 2;
+		temporalDiffThreshold = 8;
+		temporalRefreshInterval = 30;
+		temporalFrame = 0;
+
+		pyramidLevels = 0;
+		pyramidTileSize = 32;
+		pyramidMargin = 2;
 	}
 
 	void StereoBMSimple::imshowDisparity(string wname, Mat& disp, int option, OutputArray output)
@@ -566,9 +582,15 @@ namespace cp
 		uchar* s2 = src2.ptr<uchar>(0);
 		if (dest.empty())dest.create(src1.size(), CV_8U);
 		uchar* d = dest.ptr<uchar>(0);
+		if (haveStereoCostAVX2())
+		{
+			absdifftruncate_AVX2(s1, s2, thresh, d, size);
+			return;
+		}
 
 		const __m128i trunc = _mm_set1_epi8(thresh);
-		for (int i = 0; i < size; i += 16)
+		int i = 0;
+		for (; i <= size - 16; i += 16)
 		{
 			__m128i a = _mm_loadu_si128((__m128i*)(s1));
 			__m128i b = _mm_loadu_si128((__m128i*)(s2));
@@ -579,7 +601,10 @@ namespace cp
 			s2 += 16;
 			d += 16;
 		}
-
+		for (; i < size; i++)
+		{
+			*d++ = (uchar)min((schar)abs(*s1++ - *s2++), (schar)thresh);//same as _mm_min_epi8
+		}
 	}
 
 	void StereoBMSimple::textureAlpha(Mat& src, Mat& dest, const int th1, const int th2, const int r)
@@ -698,9 +723,15 @@ namespace cp
 		uchar* s1 = src.ptr<uchar>(0);
 		uchar* s2 = srcp.ptr<uchar>(0);
 		uchar* s3 = srcm.ptr<uchar>(0);
+		if (haveStereoCostAVX2())
+		{
+			halfPixel_AVX2(s1, s2, s3, size);
+			return;
+		}
 
 		const __m128i zero = _mm_setzero_si128();
-		for (int i = 0; i < size; i += 16)
+		int i = 0;
+		for (; i <= size - 16; i += 16)
 		{
 			__m128i a1 = _mm_load_si128((__m128i*)(s1));
 			__m128i b1 = _mm_load_si128((__m128i*)(s2));
@@ -732,6 +763,12 @@ namespace cp
 			s2 += 16;
 			s3 += 16;
 		}
+		for (; i < size; i++)
+		{
+			*s2 = (uchar)((*s1 + *s2) >> 1);
+			*s3 = (uchar)((*s1 + *s3) >> 1);
+			s1++; s2++; s3++;
+		}
 	}
 
 	void StereoBMSimple::getMatchingCostBTAlpha(vector<Mat>& target, vector<Mat>& refference, Mat& alpha, const int d, Mat& dest)
@@ -892,6 +929,30 @@ namespace cp
 		//min(dest,error_truncate,dest);
 	}
 
+	void StereoBMSimple::getMatchingCostCensus(Mat& tcensus, Mat& rcensus, const int d, Mat& dest)
+	{
+		dest.create(tcensus.size(), CV_8U);
+		const int width = tcensus.cols;
+		const int dd = min(abs(d), width);
+		for (int j = 0; j < tcensus.rows; j++)
+		{
+			const unsigned int* t = tcensus.ptr<unsigned int>(j);
+			const unsigned int* r = rcensus.ptr<unsigned int>(j);
+			uchar* dst = dest.ptr<uchar>(j);
+			//the reference is shifted with the replicated border as shiftImage
+			if (d >= 0)
+			{
+				for (int i = 0; i < dd; i++) dst[i] = (uchar)_mm_popcnt_u32(t[i] ^ r[0]);
+				hammingDistance32s(t + dd, r, 1, dst + dd, width - dd);
+			}
+			else
+			{
+				hammingDistance32s(t, r + dd, 1, dst, width - dd);
+				for (int i = width - dd; i < width; i++) dst[i] = (uchar)_mm_popcnt_u32(t[i] ^ r[width - 1]);
+			}
+		}
+	}
+
 	void StereoBMSimple::getOptScanline()
 	{
 		cout << "opt scan\n";
@@ -980,7 +1041,11 @@ namespace cp
 
 	void StereoBMSimple::getMatchingCost(const int d, Mat& dest)
 	{
-		if (isBT)
+		if (isCensus)
+		{
+			getMatchingCostCensus(targetCensus, refferenceCensus, d, dest);
+		}
+		else if (isBT)
 		{
 			//getMatchingCostBT(target,refference,d,dest);
 			Mat alpha;
@@ -1181,6 +1246,11 @@ namespace cp
 
 		prefilterXSobel(target[0], target[1], preFilterCap);
 		prefilterXSobel(refference[0], refference[1], preFilterCap);
+		if (isCensus)
+		{
+			censusTrans32s(target[0], targetCensus, censusWindow);
+			censusTrans32s(refference[0], refferenceCensus, censusWindow);
+		}
 		//GaussianBlur(target[0],target[0],Size(2*prefSize+1,2*prefSize+1),1.0);
 		//GaussianBlur(refference[0],refference[0],Size(2*prefSize+1,2*prefSize+1),1.0);
 
@@ -1246,6 +1316,35 @@ namespace cp
 		}
 	}
 
+	//f: cost at integer disparity d, p and m: costs at d+1 and d-1
+	static inline short subpixelQuad(const int d, const int f, const int p, const int m, const short disp)
+	{
+		const int md = ((p + m - (f << 1)) << 1);
+		if (md == 0) return disp;
+		const double dd = (double)d - (double)(p - m) / (double)md;
+		return (short)(16.0*dd + 0.5);
+	}
+
+	static inline short subpixelLinear(const int d, const int f, const int p, const int m)
+	{
+		const double m1 = (double)f;
+		const double m3 = (double)p;
+		const double m2 = (double)m;
+		const double m31 = m3 - m1;
+		const double m21 = m2 - m1;
+		double md;
+
+		if (m2 > m3)
+		{
+			md = 0.5 - 0.25*((m31*m31) / (m21*m21) + m31 / m21);
+		}
+		else
+		{
+			md = -(0.5 - 0.25*((m21*m21) / (m31*m31) + m21 / m31));
+		}
+		return (short)(16.0*((double)d + md) + 0.5);
+	}
+
 	void StereoBMSimple::subpixelInterpolation(Mat& dest, int method)
 	{
 		if (method == SUBPIXEL_NONE)return;
@@ -1263,16 +1362,7 @@ namespace cp
 				}
 				else
 				{
-					int f = DSI[l].data[j];
-					int p = DSI[l + 1].data[j];
-					int m = DSI[l - 1].data[j];
-
-					int md = ((p + m - (f << 1)) << 1);
-					if (md != 0)
-					{
-						double dd = (double)d - (double)(p - m) / (double)md;
-						disp[j] = (short)(16.0*dd + 0.5);
-					}
+					disp[j] = subpixelQuad(d, DSI[l].data[j], DSI[l + 1].data[j], DSI[l - 1].data[j], disp[j]);
 				}
 			}
 		}
@@ -1288,25 +1378,7 @@ namespace cp
 				}
 				else
 				{
-					const double m1 = (double)DSI[l].data[j];
-					const double m3 = (double)DSI[l + 1].data[j];
-					const double m2 = (double)DSI[l - 1].data[j];
-					const double m31 = m3 - m1;
-					const double m21 = m2 - m1;
-					double md;
-
-					if (m2 > m3)
-					{
-						md = 0.5 - 0.25*((m31*m31) / (m21*m21) + m31 / m21);
-					}
-					else
-					{
-						md = -(0.5 - 0.25*((m21*m21) / (m31*m31) + m21 / m31));
-
-					}
-
-					disp[j] = (short)(16.0*((double)d + md) + 0.5);
-
+					disp[j] = subpixelLinear(d, DSI[l].data[j], DSI[l + 1].data[j], DSI[l - 1].data[j]);
 				}
 			}
 		}
@@ -1534,20 +1606,311 @@ namespace cp
 		}
 	}
 
+	//cost computation, aggregation, WTA, uniqueness and subpixel interpolation in a band of rows.
+	//only the aggregated costs of the current and previous two disparities are kept for the band, and the running states for each pixel are
+	//the minimum cost and its index, the costs of the neighbors of the minimum, the prefix minimum up to d-2 and the second minimum excluding the neighbors.
+	void StereoBMSimple::getDisparityRowBand(Mat& alpha, Mat& dest)
+	{
+		getDisparityBand(target, refference, targetCensus, refferenceCensus, alpha, minDisparity, numberOfDisparities, 0, bandHeight, minCostMap, dest);
+	}
+
+	//the disparities [minD, minD + range) are searched; ref is already shifted by refShift pixels, i.e., ref(x) is the reference at x - refShift
+	void StereoBMSimple::getDisparityBand(vector<Mat>& tgt, vector<Mat>& ref, Mat& tcensus, Mat& rcensus, Mat& alpha, const int minD, const int range, const int refShift, const int bandRows, Mat& costMap, Mat& dest)
+	{
+		const Size size = tgt[0].size();
+		const int halo = (SADWindowSize != 1) ? max(1, SADWindowSizeH / 2) : 0;
+		const int bh = min(bandRows, size.height);
+		const double mul = 1.0 + uniquenessRatio / 100.0;
+
+		bandWinner.create(bh, size.width, CV_16S);
+		bandMinus.create(bh, size.width, CV_8U);
+		bandPlus.create(bh, size.width, CV_8U);
+		bandPrefixMin.create(bh, size.width, CV_16U);
+		bandSecond.create(bh, size.width, CV_16U);
+
+		vector<Mat> t(2), r(2);
+		for (int y0 = 0; y0 < size.height; y0 += bh)
+		{
+			const int y1 = min(y0 + bh, size.height);
+			const int ys = max(y0 - halo, 0);
+			const int ye = min(y1 + halo, size.height);
+			const int offset = (y0 - ys) * size.width;
+			const int n = (y1 - y0) * size.width;
+			for (int c = 0; c < 2; c++)
+			{
+				t[c] = tgt[c].rowRange(ys, ye);
+				r[c] = ref[c].rowRange(ys, ye);
+			}
+			Mat tc, rc;
+			if (isCensus)
+			{
+				tc = tcensus.rowRange(ys, ye);
+				rc = rcensus.rowRange(ys, ye);
+			}
+			alpha.rowRange(ys, ye).copyTo(bandAlpha);//aligned for alphaBlend
+			bandCost.create(ye - ys, size.width, CV_8U);
+
+			short* win = bandWinner.ptr<short>(0);
+			uchar* cm = bandMinus.ptr<uchar>(0);
+			uchar* cp = bandPlus.ptr<uchar>(0);
+			ushort* prefix = bandPrefixMin.ptr<ushort>(0);
+			ushort* second = bandSecond.ptr<ushort>(0);
+			uchar* cost = costMap.ptr<uchar>(y0);
+			short* disp = dest.ptr<short>(y0);
+			for (int j = 0; j < n; j++)
+			{
+				win[j] = -1;
+				prefix[j] = USHRT_MAX;
+				second[j] = USHRT_MAX;
+			}
+
+			for (int i = 0; i < range; i++)
+			{
+				const int d = minD + i - refShift;
+				if (isCensus) getMatchingCostCensus(tc, rc, d, bandCost);
+				else if (isBT) getMatchingCostBTAlpha(t, r, bandAlpha, d, bandCost);
+				else getMatchingCostSADAlpha(t, r, bandAlpha, d, bandCost);
+				getCostAggregation(bandCost, bandAggregation[i % 3]);
+
+				const uchar* c0 = bandAggregation[i % 3].ptr<uchar>(0) + offset;
+				const uchar* c1 = (i >= 1) ? bandAggregation[(i + 2) % 3].ptr<uchar>(0) + offset : NULL;
+				const uchar* c2 = (i >= 2) ? bandAggregation[(i + 1) % 3].ptr<uchar>(0) + offset : NULL;
+				for (int j = 0; j < n; j++)
+				{
+					if (i >= 2) prefix[j] = min(prefix[j], (ushort)c2[j]);
+					if (c0[j] < cost[j])
+					{
+						cost[j] = c0[j];
+						win[j] = i;
+						cm[j] = (i >= 1) ? c1[j] : 0;
+						if (i >= 2) second[j] = prefix[j];
+					}
+					else
+					{
+						if (i >= 2 && abs(i - 2 - win[j]) > 1) second[j] = min(second[j], (ushort)c2[j]);
+						if (i == win[j] + 1) cp[j] = c0[j];
+					}
+				}
+			}
+
+			const int last = range - 1;
+			const uchar* c0 = bandAggregation[last % 3].ptr<uchar>(0) + offset;
+			const uchar* c1 = (last >= 1) ? bandAggregation[(last + 2) % 3].ptr<uchar>(0) + offset : NULL;
+			for (int j = 0; j < n; j++)
+			{
+				const int w = win[j];
+				if (w < 0) continue;//all costs are saturated
+				disp[j] = (short)((minD + w) << 4);
+
+				if (uniquenessRatio != 0)
+				{
+					int sc = second[j];
+					if (last >= 1 && abs(last - 1 - w) > 1) sc = min(sc, (int)c1[j]);
+					if (abs(last - w) > 1) sc = min(sc, (int)c0[j]);
+					if (sc <= (int)(cost[j] * mul))
+					{
+						disp[j] = 0;
+						continue;
+					}
+				}
+
+				if (w < 1 || w > range - 2) continue;
+				if (subpixMethod == SUBPIXEL_QUAD) disp[j] = subpixelQuad(minD + w, cost[j], cp[j], cm[j], disp[j]);
+				else if (subpixMethod == SUBPIXEL_LINEAR) disp[j] = subpixelLinear(minD + w, cost[j], cp[j], cm[j]);
+			}
+		}
+	}
+
+	void StereoBMSimple::getDisparityTemporal(Mat& gray, Mat& grayR, Mat& alpha, Mat& dest)
+	{
+		vector<StereoTile> tiles;
+		planStereoTiles(gray, temporalGray, grayR, temporalGrayR, temporalPrior, 0, temporalTileSize, temporalDiffThreshold, temporalMargin, minDisparity, numberOfDisparities, 1, tiles);
+		getDisparityTiles(tiles, alpha, dest);
+	}
+
+	//the tiles are searched in their bands on target and refference, and the static tiles are copied from the previous frame
+	void StereoBMSimple::getDisparityTiles(const vector<StereoTile>& tiles, Mat& alpha, Mat& dest)
+	{
+		const int hx = SADWindowSize / 2 + 1;
+		const int hy = SADWindowSizeH / 2 + 1;
+		vector<Mat> t(2), r(2);
+		Mat tc, rc, a, cost, disp;
+		for (size_t i = 0; i < tiles.size(); i++)
+		{
+			const StereoTile& tile = tiles[i];
+			const Rect& roi = tile.roi;
+			if (tile.type == STEREO_TILE_STATIC)
+			{
+				temporalRaw(roi).copyTo(dest(roi));
+				temporalCost(roi).copyTo(minCostMap(roi));
+				continue;
+			}
+
+			//the tile is extended to the left by the range, and the reference is shifted by minDisparity, so that the shifts of the search are [0, range)
+			const int D = tile.numberOfDisparities;
+			const int minD = tile.minDisparity;
+			const Rect troi(roi.x - D - hx, roi.y - hy, roi.width + D + 2 * hx, roi.height + 2 * hy);
+			const Rect rroi = troi - Point(minD, 0);
+			for (int c = 0; c < 2; c++)
+			{
+				copyStereoTileROI(target[c], troi, t[c]);
+				copyStereoTileROI(refference[c], rroi, r[c]);
+			}
+			if (isCensus)
+			{
+				copyStereoTileROI(targetCensus, troi, tc);
+				copyStereoTileROI(refferenceCensus, rroi, rc);
+			}
+			copyStereoTileROI(alpha, troi, a);
+			cost.create(troi.size(), CV_8U); cost.setTo(255);
+			disp.create(troi.size(), CV_16S); disp.setTo(0);
+			getDisparityBand(t, r, tc, rc, a, minD, D, minD, troi.height, cost, disp);
+
+			const Rect inner(D + hx, hy, roi.width, roi.height);
+			disp(inner).copyTo(dest(roi));
+			cost(inner).copyTo(minCostMap(roi));
+		}
+	}
+
+	//the full range is searched only at the coarsest level of the pyramid, and each finer level searches the bands around the upsampled disparity.
+	//target and refference of the full resolution are already prefiltered, and alpha is the texture weight of them.
+	void StereoBMSimple::getDisparityPyramid(Mat& leftim, Mat& rightim, Mat& alpha, Mat& dest)
+	{
+		const int levels = pyramidLevels;
+		vector<Mat> L(levels + 1), R(levels + 1);
+		L[0] = leftim;
+		R[0] = rightim;
+		for (int l = 1; l <= levels; l++)
+		{
+			pyrDown(L[l - 1], L[l]);
+			pyrDown(R[l - 1], R[l]);
+		}
+
+		vector<Mat> t0, r0;
+		t0.swap(target);
+		r0.swap(refference);
+		Mat tc0 = targetCensus, rc0 = refferenceCensus, cost0 = minCostMap;
+		targetCensus.release();
+		refferenceCensus.release();
+		minCostMap.release();
+
+		const int maxD = minDisparity + numberOfDisparities;
+		Mat disp, a;
+		vector<StereoTile> tiles;
+		for (int l = levels; l >= 0; l--)
+		{
+			const int s = 1 << l;
+			const int minD = (l == 0) ? minDisparity : cvFloor((double)minDisparity / s);
+			const int range = (l == 0) ? numberOfDisparities : cvCeil((double)maxD / s) - minD;
+			if (l == 0)
+			{
+				t0.swap(target);
+				r0.swap(refference);
+				targetCensus = tc0;
+				refferenceCensus = rc0;
+				minCostMap = cost0;
+				a = alpha;
+			}
+			else
+			{
+				prefilter(L[l], R[l]);
+				minCostMap.create(L[l].size(), CV_8U);
+				textureAlpha(target[0], a, prefParam2, prefParam, prefSize);
+			}
+			minCostMap.setTo(255);
+
+			Mat d = (l == 0) ? dest : Mat(L[l].size(), CV_16S);
+			d.setTo(0);
+			if (l == levels)
+			{
+				getDisparityBand(target, refference, targetCensus, refferenceCensus, a, minD, range, 0, (bandHeight > 0) ? bandHeight : d.rows, minCostMap, d);
+			}
+			else
+			{
+				Mat prior;
+				upsampleDisparityPrior(disp, d.size(), 0, 0, prior);
+				planStereoTiles(Mat(), Mat(), Mat(), Mat(), prior, 0, pyramidTileSize, 0, pyramidMargin, minD, range, 1, tiles);
+				getDisparityTiles(tiles, a, d);
+			}
+			disp = d;
+		}
+	}
+
+	void StereoBMSimple::setTemporalFrame(Mat& gray, Mat& grayR, Mat& dest)
+	{
+		gray.copyTo(temporalGray);
+		grayR.copyTo(temporalGrayR);
+		dest.copyTo(temporalRaw);
+		minCostMap.copyTo(temporalCost);
+		temporalFrame++;
+	}
+
+	void StereoBMSimple::resetTemporal()
+	{
+		temporalGray.release();
+		temporalGrayR.release();
+		temporalRaw.release();
+		temporalCost.release();
+		temporalPrior.release();
+		temporalFrame = 0;
+	}
+
 	void StereoBMSimple::operator()(Mat& leftim, Mat& rightim, Mat& dest)
 	{
 		if (dest.empty()) dest.create(leftim.size(), CV_16S);
 		minCostMap.create(leftim.size(), CV_8U); minCostMap.setTo(255);
-		if ((int)DSI.size() < numberOfDisparities)DSI.resize(numberOfDisparities);
 
-		Mat joint;
+		Mat joint, jointR;
 		cvtColor(leftim, joint, CV_BGR2GRAY);
+		if (isTemporal) cvtColor(rightim, jointR, CV_BGR2GRAY);
 
 		{
 			CalcTime t("pre filter");
 			prefilter(leftim, rightim);
 			cout << "pref end" << endl;
 		}
+
+		//the temporal and the coarse-to-fine modes, as the row-band pipeline, do not store DSI
+		const bool isTemporalFrame = isTemporal && (P1 == 0 || P2 == 0) &&
+			temporalPrior.size() == leftim.size() && temporalRaw.size() == leftim.size() &&
+			!(temporalRefreshInterval > 0 && temporalFrame % temporalRefreshInterval == 0);
+		const bool isPyramid = pyramidLevels > 0 && (P1 == 0 || P2 == 0);
+		if (isTemporalFrame || isPyramid || (bandHeight > 0 && (P1 == 0 || P2 == 0)))
+		{
+			if (isTemporalFrame)
+			{
+				CalcTime t("Temporal tiles cost, aggregation and WTA");
+				Mat alpha;
+				textureAlpha(target[0], alpha, prefParam2, prefParam, prefSize);
+				getDisparityTemporal(joint, jointR, alpha, dest);
+			}
+			else if (isPyramid)
+			{
+				CalcTime t("Coarse-to-fine cost, aggregation and WTA");
+				Mat alpha;
+				textureAlpha(target[0], alpha, prefParam2, prefParam, prefSize);
+				getDisparityPyramid(leftim, rightim, alpha, dest);
+			}
+			else
+			{
+				CalcTime t("Row-band cost, aggregation and WTA");
+				Mat alpha;
+				textureAlpha(target[0], alpha, prefParam2, prefParam, prefSize);
+				getDisparityRowBand(alpha, dest);
+			}
+			if (isTemporal) setTemporalFrame(joint, jointR, dest);
+			{
+				CalcTime t("Post Filterings");
+				binalyWeightedRangeFilter(dest, dest, subboxWindowR, subboxRange);
+				fastLRCheck(minCostMap, dest);
+				minCostFilter(minCostMap, dest);
+				filterSpeckles(dest, 0, speckleWindowSize, speckleRange, specklebuffer);
+			}
+			if (isTemporal) dest.copyTo(temporalPrior);
+			return;
+		}
+
+		if ((int)DSI.size() < numberOfDisparities)DSI.resize(numberOfDisparities);
 	{
 		CalcTime t("Cost computation");
 		for (int i = 0; i < numberOfDisparities; i++)
@@ -1592,6 +1955,7 @@ namespace cp
 		{
 			CalcTime t("Post: subpix");
 			subpixelInterpolation(dest, subpixMethod);
+			if (isTemporal) setTemporalFrame(joint, jointR, dest);
 			binalyWeightedRangeFilter(dest, dest, subboxWindowR, subboxRange);
 		}
 		//R depth map;
@@ -1608,6 +1972,7 @@ namespace cp
 			CalcTime t("Post: filterSpeckles");
 			filterSpeckles(dest, 0, speckleWindowSize, speckleRange, specklebuffer);
 		}
+		if (isTemporal) dest.copyTo(temporalPrior);
 
 
 	}
@@ -2611,6 +2976,74 @@ namespace cp
 		}
 	}
 
+	void censusTrans32s(const Mat& src, Mat& dest, const Size window)
+	{
+		CV_Assert(window.width % 2 == 1 && window.height % 2 == 1 && window.area() - 1 <= 32);
+		Mat gray;
+		if (src.channels() == 3) cvtColor(src, gray, COLOR_BGR2GRAY);
+		else gray = src;
+		CV_Assert(gray.type() == CV_8U);
+
+		const int rx = window.width / 2;
+		const int ry = window.height / 2;
+		Mat im; copyMakeBorder(gray, im, ry, ry, rx, rx, cv::BORDER_REPLICATE);
+		dest.create(gray.size(), CV_32S);
+
+		const int w = gray.cols;
+		const int h = gray.rows;
+		for (int j = 0; j < h; j++)
+		{
+			unsigned int* d = dest.ptr<unsigned int>(j);
+			const uchar* c = im.ptr<uchar>(j + ry) + rx;
+			memset(d, 0, sizeof(unsigned int)*w);
+			//one neighbor for the whole row at a time, in raster order without the center
+			for (int k = -ry; k <= ry; k++)
+			{
+				const uchar* s = im.ptr<uchar>(j + ry + k) + rx;
+				for (int l = -rx; l <= rx; l++)
+				{
+					if (k == 0 && l == 0) continue;
+					for (int i = 0; i < w; i++)
+						d[i] = (d[i] << 1) | (s[i + l] < c[i] ? 1 : 0);
+				}
+			}
+		}
+	}
+
+	void hammingDistance32s(const unsigned int* s1, const unsigned int* s2, const int scale, uchar* dest, const int size)
+	{
+		if (haveStereoCostAVX512())
+		{
+			hammingDistance32s_AVX512(s1, s2, scale, dest, size);
+		}
+		else if (haveStereoCostAVX2())
+		{
+			hammingDistance32s_AVX2(s1, s2, scale, dest, size);
+		}
+		else
+		{
+			for (int i = 0; i < size; i++)
+				dest[i] = saturate_cast<uchar>((int)_mm_popcnt_u32(s1[i] ^ s2[i])*scale);
+		}
+	}
+
+	void hammingCostRow(const unsigned int code, const unsigned int* codes, const short scale, short* cost, const int D)
+	{
+		if (haveStereoCostAVX512())
+		{
+			hammingCostRow_AVX512(code, codes, scale, cost, D);
+		}
+		else if (haveStereoCostAVX2())
+		{
+			hammingCostRow_AVX2(code, codes, scale, cost, D);
+		}
+		else
+		{
+			for (int d = 0; d < D; d++)
+				cost[d] = (short)(_mm_popcnt_u32(code ^ codes[d])*scale);
+		}
+	}
+
 	void censusTrans8u_9x1(Mat& src, Mat& dest)
 	{
 		if (dest.empty())dest.create(src.size(), CV_8U);
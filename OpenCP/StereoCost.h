@@ -0,0 +1,33 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+namespace cp
+{
+	//the census cost is the Hamming distance times this scale, which is about the range of the BT cost with the default truncation
+	const int STEREO_CENSUS_SCALE = 4;
+
+	//census transform over the window (width*height - 1 <= 32 bits; a bit is set when the neighbor is darker than the center), CV_32S.
+	//color images are converted to gray, and the border is replicated.
+	void censusTrans32s(const cv::Mat& src, cv::Mat& dest, const cv::Size window);
+	//dest[i] = saturate(popcount(s1[i] ^ s2[i]) * scale)
+	void hammingDistance32s(const unsigned int* s1, const unsigned int* s2, const int scale, uchar* dest, const int size);
+	//cost[d] = popcount(code ^ codes[d]) * scale, d = 0,...,D-1
+	void hammingCostRow(const unsigned int code, const unsigned int* codes, const short scale, short* cost, const int D);
+
+	//AVX2 kernels (StereoCostAVX2.cpp): 32 disparities (BT) or 32 pixels (SAD, half pixel) per iteration, popcount by a nibble table
+	bool haveStereoCostAVX2();
+	//cost[d] += min(BT(u; v[d]), dmax) * scale, d = 0,...,D-1 (D % 16 == 0), where v0/v1 are the min/max of v over the half pixels
+	void pixelCostBT_AVX2(const int u, const int u0, const int u1, const uchar* v, const uchar* v0, const uchar* v1, const short scale, const uchar dmax, short* cost, const int D);
+	//dest = min(|s1 - s2|, thresh) with the signed min of absdifftruncateSSE
+	void absdifftruncate_AVX2(const uchar* s1, const uchar* s2, const uchar thresh, uchar* dest, const int size);
+	//srcp = (src + srcp) / 2, srcm = (src + srcm) / 2
+	void halfPixel_AVX2(const uchar* src, uchar* srcp, uchar* srcm, const int size);
+	void hammingDistance32s_AVX2(const unsigned int* s1, const unsigned int* s2, const int scale, uchar* dest, const int size);
+	void hammingCostRow_AVX2(const unsigned int code, const unsigned int* codes, const short scale, short* cost, const int D);
+
+	//AVX-512 kernels with VPOPCNTDQ (StereoCostAVX512.cpp)
+	bool haveStereoCostAVX512();
+	void hammingDistance32s_AVX512(const unsigned int* s1, const unsigned int* s2, const int scale, uchar* dest, const int size);
+	void hammingCostRow_AVX512(const unsigned int code, const unsigned int* codes, const short scale, short* cost, const int D);
+}
@@ -0,0 +1,169 @@
+#include "opencp.hpp"
+#include "StereoCost.h"
+
+using namespace std;
+using namespace cv;
+
+namespace cp
+{
+#if defined(__AVX2__)
+
+	bool haveStereoCostAVX2()
+	{
+		//the TU is compiled with -mfma
+		return checkHardwareSupport(CV_CPU_AVX2) && checkHardwareSupport(CV_CPU_FMA3);
+	}
+
+	//popcount of each 32-bit element by the nibble table
+	static inline __m256i _mm256_popcnt_epi32_lut(const __m256i a)
+	{
+		const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+		const __m256i mask = _mm256_set1_epi8(0x0f);
+		const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(a, mask));
+		const __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(a, 4), mask));
+		return _mm256_madd_epi16(_mm256_maddubs_epi16(_mm256_add_epi8(lo, hi), _mm256_set1_epi8(1)), _mm256_set1_epi16(1));
+	}
+
+	void pixelCostBT_AVX2(const int u, const int u0, const int u1, const uchar* v, const uchar* v0, const uchar* v1, const short scale, const uchar dmax, short* cost, const int D)
+	{
+		const __m256i _u = _mm256_set1_epi8((char)u), _u0 = _mm256_set1_epi8((char)u0), _u1 = _mm256_set1_epi8((char)u1);
+		const __m256i ds = _mm256_set1_epi16(scale);
+		const __m256i dm = _mm256_set1_epi8((char)dmax);
+
+		int d = 0;
+		for (; d <= D - 32; d += 32)
+		{
+			const __m256i _v = _mm256_loadu_si256((const __m256i*)(v + d));
+			const __m256i _v0 = _mm256_loadu_si256((const __m256i*)(v0 + d));
+			const __m256i _v1 = _mm256_loadu_si256((const __m256i*)(v1 + d));
+			const __m256i c0 = _mm256_max_epu8(_mm256_subs_epu8(_u, _v1), _mm256_subs_epu8(_v0, _u));
+			const __m256i c1 = _mm256_max_epu8(_mm256_subs_epu8(_v, _u1), _mm256_subs_epu8(_u0, _v));
+			const __m256i diff = _mm256_min_epu8(dm, _mm256_min_epu8(c0, c1));
+
+			const __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(diff));
+			const __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(diff, 1));
+			_mm256_storeu_si256((__m256i*)(cost + d), _mm256_adds_epi16(_mm256_loadu_si256((const __m256i*)(cost + d)), _mm256_mullo_epi16(lo, ds)));
+			_mm256_storeu_si256((__m256i*)(cost + d + 16), _mm256_adds_epi16(_mm256_loadu_si256((const __m256i*)(cost + d + 16)), _mm256_mullo_epi16(hi, ds)));
+		}
+		for (; d < D; d += 16)
+		{
+			const __m128i _v = _mm_loadu_si128((const __m128i*)(v + d));
+			const __m128i _v0 = _mm_loadu_si128((const __m128i*)(v0 + d));
+			const __m128i _v1 = _mm_loadu_si128((const __m128i*)(v1 + d));
+			const __m128i c0 = _mm_max_epu8(_mm_subs_epu8(_mm256_castsi256_si128(_u), _v1), _mm_subs_epu8(_v0, _mm256_castsi256_si128(_u)));
+			const __m128i c1 = _mm_max_epu8(_mm_subs_epu8(_v, _mm256_castsi256_si128(_u1)), _mm_subs_epu8(_mm256_castsi256_si128(_u0), _v));
+			const __m256i diff = _mm256_cvtepu8_epi16(_mm_min_epu8(_mm256_castsi256_si128(dm), _mm_min_epu8(c0, c1)));
+			_mm256_storeu_si256((__m256i*)(cost + d), _mm256_adds_epi16(_mm256_loadu_si256((const __m256i*)(cost + d)), _mm256_mullo_epi16(diff, ds)));
+		}
+	}
+
+	void absdifftruncate_AVX2(const uchar* s1, const uchar* s2, const uchar thresh, uchar* dest, const int size)
+	{
+		const __m256i trunc = _mm256_set1_epi8(thresh);
+		int i = 0;
+		for (; i <= size - 32; i += 32)
+		{
+			const __m256i a = _mm256_loadu_si256((const __m256i*)(s1 + i));
+			const __m256i b = _mm256_loadu_si256((const __m256i*)(s2 + i));
+			_mm256_storeu_si256((__m256i*)(dest + i), _mm256_min_epi8(_mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a)), trunc));
+		}
+		for (; i < size; i++)
+		{
+			dest[i] = (uchar)min((schar)abs(s1[i] - s2[i]), (schar)thresh);
+		}
+	}
+
+	void halfPixel_AVX2(const uchar* src, uchar* srcp, uchar* srcm, const int size)
+	{
+		//(a + b) >> 1 = (a & b) + ((a ^ b) >> 1) without the carry
+		const __m256i mask = _mm256_set1_epi8(0x7f);
+		int i = 0;
+		for (; i <= size - 32; i += 32)
+		{
+			const __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+			__m256i b = _mm256_loadu_si256((const __m256i*)(srcp + i));
+			b = _mm256_add_epi8(_mm256_and_si256(a, b), _mm256_and_si256(_mm256_srli_epi16(_mm256_xor_si256(a, b), 1), mask));
+			_mm256_storeu_si256((__m256i*)(srcp + i), b);
+
+			b = _mm256_loadu_si256((const __m256i*)(srcm + i));
+			b = _mm256_add_epi8(_mm256_and_si256(a, b), _mm256_and_si256(_mm256_srli_epi16(_mm256_xor_si256(a, b), 1), mask));
+			_mm256_storeu_si256((__m256i*)(srcm + i), b);
+		}
+		for (; i < size; i++)
+		{
+			srcp[i] = (uchar)((src[i] + srcp[i]) >> 1);
+			srcm[i] = (uchar)((src[i] + srcm[i]) >> 1);
+		}
+	}
+
+	void hammingDistance32s_AVX2(const unsigned int* s1, const unsigned int* s2, const int scale, uchar* dest, const int size)
+	{
+		const __m256i ds = _mm256_set1_epi16((short)scale);
+		const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+		int i = 0;
+		for (; i <= size - 32; i += 32)
+		{
+			const __m256i a = _mm256_popcnt_epi32_lut(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(s1 + i)), _mm256_loadu_si256((const __m256i*)(s2 + i))));
+			const __m256i b = _mm256_popcnt_epi32_lut(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(s1 + i + 8)), _mm256_loadu_si256((const __m256i*)(s2 + i + 8))));
+			const __m256i c = _mm256_popcnt_epi32_lut(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(s1 + i + 16)), _mm256_loadu_si256((const __m256i*)(s2 + i + 16))));
+			const __m256i e = _mm256_popcnt_epi32_lut(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(s1 + i + 24)), _mm256_loadu_si256((const __m256i*)(s2 + i + 24))));
+			const __m256i ab = _mm256_mullo_epi16(_mm256_packs_epi32(a, b), ds);
+			const __m256i ce = _mm256_mullo_epi16(_mm256_packs_epi32(c, e), ds);
+			_mm256_storeu_si256((__m256i*)(dest + i), _mm256_permutevar8x32_epi32(_mm256_packus_epi16(ab, ce), order));
+		}
+		for (; i < size; i++)
+		{
+			dest[i] = saturate_cast<uchar>((int)_mm_popcnt_u32(s1[i] ^ s2[i]) * scale);
+		}
+	}
+
+	void hammingCostRow_AVX2(const unsigned int code, const unsigned int* codes, const short scale, short* cost, const int D)
+	{
+		const __m256i c = _mm256_set1_epi32((int)code);
+		const __m256i ds = _mm256_set1_epi16(scale);
+		int d = 0;
+		for (; d <= D - 16; d += 16)
+		{
+			const __m256i a = _mm256_popcnt_epi32_lut(_mm256_xor_si256(c, _mm256_loadu_si256((const __m256i*)(codes + d))));
+			const __m256i b = _mm256_popcnt_epi32_lut(_mm256_xor_si256(c, _mm256_loadu_si256((const __m256i*)(codes + d + 8))));
+			_mm256_storeu_si256((__m256i*)(cost + d), _mm256_mullo_epi16(_mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0)), ds));
+		}
+		for (; d < D; d++)
+		{
+			cost[d] = (short)(_mm_popcnt_u32(code ^ codes[d]) * scale);
+		}
+	}
+
+#else //compiled without AVX2 code generation
+
+	bool haveStereoCostAVX2()
+	{
+		return false;
+	}
+
+	void pixelCostBT_AVX2(const int u, const int u0, const int u1, const uchar* v, const uchar* v0, const uchar* v1, const short scale, const uchar dmax, short* cost, const int D)
+	{
+		CV_Error(Error::StsNotImplemented, "StereoCostAVX2.cpp is compiled without AVX2");
+	}
+
+	void absdifftruncate_AVX2(const uchar* s1, const uchar* s2, const uchar thresh, uchar* dest, const int size)
+	{
+		CV_Error(Error::StsNotImplemented, "StereoCostAVX2.cpp is compiled without AVX2");
+	}
+
+	void halfPixel_AVX2(const uchar* src, uchar* srcp, uchar* srcm, const int size)
+	{
+		CV_Error(Error::StsNotImplemented, "StereoCostAVX2.cpp is compiled without AVX2");
+	}
+
+	void hammingDistance32s_AVX2(const unsigned int* s1, const unsigned int* s2, const int scale, uchar* dest, const int size)
+	{
+		CV_Error(Error::StsNotImplemented, "StereoCostAVX2.cpp is compiled without AVX2");
+	}
+
+	void hammingCostRow_AVX2(const unsigned int code, const unsigned int* codes, const short scale, short* cost, const int D)
+	{
+		CV_Error(Error::StsNotImplemented, "StereoCostAVX2.cpp is compiled without AVX2");
+	}
+#endif
+}
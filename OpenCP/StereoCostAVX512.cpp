@@ -0,0 +1,95 @@
+#include "opencp.hpp"
+#include "StereoCost.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+using namespace std;
+using namespace cv;
+
+namespace cp
+{
+	//MSVC has the VPOPCNTDQ intrinsics with /arch:AVX512, and gcc/clang need -mavx512vpopcntdq
+#if defined(__AVX512F__) && defined(__AVX512BW__) && (defined(_MSC_VER) || defined(__AVX512VPOPCNTDQ__))
+
+	//VPOPCNTDQ is not in the feature list of checkHardwareSupport: CPUID.(EAX=7, ECX=0):ECX[bit 14]
+	static bool cpuHasVPOPCNTDQ()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuidex(info, 7, 0);
+		return (info[2] & (1 << 14)) != 0;
+#else
+		unsigned int a, b, c, d;
+		if (__get_cpuid_max(0, 0) < 7) return false;
+		__cpuid_count(7, 0, a, b, c, d);
+		return (c & (1 << 14)) != 0;
+#endif
+	}
+
+	bool haveStereoCostAVX512()
+	{
+		static const bool vpopcnt = cpuHasVPOPCNTDQ();
+		//the TU is compiled with F/BW/DQ/VL, and the compiler may emit any of them
+		return vpopcnt && checkHardwareSupport(CV_CPU_AVX_512F) && checkHardwareSupport(CV_CPU_AVX_512BW)
+			&& checkHardwareSupport(CV_CPU_AVX_512DQ) && checkHardwareSupport(CV_CPU_AVX_512VL);
+	}
+
+	void hammingDistance32s_AVX512(const unsigned int* s1, const unsigned int* s2, const int scale, uchar* dest, const int size)
+	{
+		const __m512i ds = _mm512_set1_epi32(scale);
+		const __m512i vmax = _mm512_set1_epi32(255);
+		int i = 0;
+		for (; i <= size - 16; i += 16)
+		{
+			const __m512i a = _mm512_popcnt_epi32(_mm512_xor_si512(_mm512_loadu_si512(s1 + i), _mm512_loadu_si512(s2 + i)));
+			_mm_storeu_si128((__m128i*)(dest + i), _mm512_cvtepi32_epi8(_mm512_min_epi32(_mm512_mullo_epi32(a, ds), vmax)));
+		}
+		if (i < size)
+		{
+			const __mmask16 m = (__mmask16)((1 << (size - i)) - 1);
+			const __m512i a = _mm512_popcnt_epi32(_mm512_xor_si512(_mm512_maskz_loadu_epi32(m, s1 + i), _mm512_maskz_loadu_epi32(m, s2 + i)));
+			_mm512_mask_cvtepi32_storeu_epi8(dest + i, m, _mm512_min_epi32(_mm512_mullo_epi32(a, ds), vmax));
+		}
+	}
+
+	void hammingCostRow_AVX512(const unsigned int code, const unsigned int* codes, const short scale, short* cost, const int D)
+	{
+		const __m512i c = _mm512_set1_epi32((int)code);
+		const __m512i ds = _mm512_set1_epi32(scale);
+		int d = 0;
+		for (; d <= D - 32; d += 32)
+		{
+			const __m512i a = _mm512_popcnt_epi32(_mm512_xor_si512(c, _mm512_loadu_si512(codes + d)));
+			const __m512i b = _mm512_popcnt_epi32(_mm512_xor_si512(c, _mm512_loadu_si512(codes + d + 16)));
+			_mm256_storeu_si256((__m256i*)(cost + d), _mm512_cvtepi32_epi16(_mm512_mullo_epi32(a, ds)));
+			_mm256_storeu_si256((__m256i*)(cost + d + 16), _mm512_cvtepi32_epi16(_mm512_mullo_epi32(b, ds)));
+		}
+		for (; d < D; d += 16)
+		{
+			const __mmask16 m = (__mmask16)((D - d) >= 16 ? 0xffff : (1 << (D - d)) - 1);
+			const __m512i a = _mm512_popcnt_epi32(_mm512_xor_si512(c, _mm512_maskz_loadu_epi32(m, codes + d)));
+			_mm512_mask_cvtepi32_storeu_epi16(cost + d, m, _mm512_mullo_epi32(a, ds));
+		}
+	}
+
+#else //compiled without AVX-512 (VPOPCNTDQ) code generation
+
+	bool haveStereoCostAVX512()
+	{
+		return false;
+	}
+
+	void hammingDistance32s_AVX512(const unsigned int* s1, const unsigned int* s2, const int scale, uchar* dest, const int size)
+	{
+		CV_Error(Error::StsNotImplemented, "StereoCostAVX512.cpp is compiled without AVX-512");
+	}
+
+	void hammingCostRow_AVX512(const unsigned int code, const unsigned int* codes, const short scale, short* cost, const int D)
+	{
+		CV_Error(Error::StsNotImplemented, "StereoCostAVX512.cpp is compiled without AVX-512");
+	}
+#endif
+}
@@ -50,6 +50,8 @@ SGBM (Semi-global block matching)
 */
 
 #include "opencp.hpp"
+#include "StereoCost.h"
+#include "StereoTemporal.h"
 
 using namespace std;
 using namespace cv;
@@ -81,6 +83,19 @@ namespace cp
 		ad_max = 31;
 		subpixel_r = 4;
 		subpixel_th = 32;
+		parallelMode = PARALLEL_NONE;
+		stripeOverlap = 64;
+		costType = COST_BT;
+		censusWindowSize = Size(5, 5);
+		isTemporal = false;
+		temporalTileSize = 64;
+		temporalMargin = 2;
+		temporalDiffThreshold = 8;
+		temporalRefreshInterval = 30;
+		temporalFrame = 0;
+		pyramidLevels = 0;
+		pyramidTileSize = 64;
+		pyramidMargin = 2;
 	}
 
 
@@ -104,7 +119,19 @@ namespace cp
 		ad_max = _ad_max;
 		subpixel_r = _subpixel_r;
 		subpixel_th = _subpixel_th;
-
+		parallelMode = PARALLEL_NONE;
+		stripeOverlap = 64;
+		costType = COST_BT;
+		censusWindowSize = Size(5, 5);
+		isTemporal = false;
+		temporalTileSize = 64;
+		temporalMargin = 2;
+		temporalDiffThreshold = 8;
+		temporalRefreshInterval = 30;
+		temporalFrame = 0;
+		pyramidLevels = 0;
+		pyramidTileSize = 64;
+		pyramidMargin = 2;
 	}
 
 
@@ -196,6 +223,7 @@ namespace cp
 
 #if CV_SSE2    
 		volatile bool useSIMD = checkHardwareSupport(CV_CPU_SSE2);
+		const bool useAVX2 = haveStereoCostAVX2();
 #endif
 
 		//sobel
@@ -224,7 +252,11 @@ namespace cp
 				int u1 = max(ul, ur); u1 = max(u1, u);
 
 #if CV_SSE2
-				if (useSIMD)
+				if (useAVX2)
+				{
+					pixelCostBT_AVX2(u, u0, u1, prow2 + width - x - 1 + minD, buffer + width - x - 1 + minD, buffer + width - x - 1 + minD + width2, CSB, 255, cost + x*D + minD, D);
+				}
+				else if (useSIMD)
 				{
 					__m128i _u = _mm_set1_epi8((char)u), _u0 = _mm_set1_epi8((char)u0);
 					__m128i _u1 = _mm_set1_epi8((char)u1), z = _mm_setzero_si128();
@@ -298,7 +330,11 @@ namespace cp
 				int u1 = max(ul, ur); u1 = max(u1, u);
 
 #if CV_SSE2
-				if (useSIMD)
+				if (useAVX2)
+				{
+					pixelCostBT_AVX2(u, u0, u1, prow2 + width - x - 1 + minD, buffer + width - x - 1 + minD, buffer + width - x - 1 + minD + width2, CAD, (uchar)AD_MAX, cost + x*D + minD, D);
+				}
+				else if (useSIMD)
 				{
 					__m128i _u = _mm_set1_epi8((char)u), _u0 = _mm_set1_epi8((char)u0);
 					__m128i _u1 = _mm_set1_epi8((char)u1), z = _mm_setzero_si128();
@@ -369,6 +405,50 @@ namespace cp
 		}
 	}
 
+	/*
+	the census version of calcPixelCostBT: cost[(x-minX)*(maxD - minD) + (d - minD)] is the Hamming distance
+	between the census codes census1(y, x) and census2(y, x-d) times STEREO_CENSUS_SCALE.
+	the temporary buffer should contain width elements
+	*/
+	static void calcPixelCostCensus(const Mat& census1, const Mat& census2, int y,
+		int minD, int maxD, CostType* cost, unsigned int* buffer)
+	{
+		const int width = census1.cols;
+		const int minX1 = max(maxD, 0), maxX1 = width + min(minD, 0);
+		const int D = maxD - minD;
+		const unsigned int* row1 = census1.ptr<unsigned int>(y);
+		const unsigned int* row2 = census2.ptr<unsigned int>(y);
+
+		// reverse the right row so that census2(y, x-d) is contiguous for d
+		for (int x = 0; x < width; x++)
+			buffer[width - 1 - x] = row2[x];
+
+		for (int x = minX1; x < maxX1; x++)
+			hammingCostRow(row1[x], buffer + width - 1 - x + minD, (short)STEREO_CENSUS_SCALE, cost + (x - minX1)*D, D);
+	}
+
+	//census1 and census2 are empty for COST_BT
+	static void calcPixelCost(const Mat& img1, const Mat& img2, const Mat& census1, const Mat& census2, int y,
+		int minD, int maxD, CostType* cost,
+		PixType* buffer, const PixType* tab,
+		int tabOfs, int b, double costAlpha, int AD_MAX)
+	{
+		if (census1.empty())
+			calcPixelCostBT(img1, img2, y, minD, maxD, cost, buffer, tab, tabOfs, b, costAlpha, AD_MAX);
+		else
+			//the temporary buffer follows short arrays, so that it is aligned for the 32-bit codes (it has width*16 bytes)
+			calcPixelCostCensus(census1, census2, y, minD, maxD, cost, alignPtr((unsigned int*)buffer, (int)sizeof(unsigned int)));
+	}
+
+	static void calcCensusSGBM(const Mat& img1, const Mat& img2, const StereoSGBM2& params, Mat& census1, Mat& census2)
+	{
+		if (params.costType == StereoSGBM2::COST_CENSUS)
+		{
+			censusTrans32s(img1, census1, params.censusWindowSize);
+			censusTrans32s(img2, census2, params.censusWindowSize);
+		}
+	}
+
 	/*
 	static void calcPixelCostBT2( const Mat& img1, const Mat& img2,
 	int minD, int maxD, CostType* cost,
@@ -380,7 +460,7 @@ namespace cp
 	int minX2 = max(minX1 - maxD, 0), maxX2 = min(maxX1 - minD, width);
 	int D = maxD - minD, width1 = maxX1 - minX1, width2 = maxX2 - minX2;
 
-	#pragma omp parallel for
+	//#pragma omp parallel for
 	for(int y=0;y<img1.rows;y++)
 	{
 	const PixType*tab = ttab[omp_get_thread_num()] ;
@@ -613,6 +693,8 @@ namespace cp
 		const int ad_max = max(params.ad_max, 0);
 		const double costAlpha = min(max(params.costAlpha, 0.0), 1.0);
 		PixType clipTab[TAB_SIZE];
+		Mat census1, census2;
+		calcCensusSGBM(img1, img2, params, census1, census2);
 
 
 		//for( int th = 0; th < 8; th++ )
@@ -654,7 +736,7 @@ namespace cp
 			width*(sizeof(CostType) + sizeof(DispType)) + 1024; // disp2cost + disp2
 
 		if (!buffer.data || !buffer.isContinuous() ||
-			buffer.cols*buffer.rows*buffer.elemSize() < totalBufSize)
+			buffer.total()*buffer.elemSize() < totalBufSize)
 			buffer.create(1, (int)totalBufSize, CV_8U);
 
 		// summary cost over different (nDirs) directions
@@ -699,7 +781,7 @@ namespace cp
 				// thus we shift the pointers by 8 (8*sizeof(short) == 16 - ideal alignment)
 				Lr[k] = pixDiff + costBufSize + LrSize*k + NRD2*LrBorder + 8;
 				memset(Lr[k] - LrBorder*NRD2 - 8, 0, LrSize*sizeof(CostType));
-				minLr[k] = pixDiff + costBufSize + LrSize*NLR + minLrSize*k + NR2 * 2;
+				minLr[k] = pixDiff + costBufSize + LrSize*NLR + minLrSize*k + NR2*LrBorder;
 				memset(minLr[k] - LrBorder*NR2, 0, minLrSize*sizeof(CostType));
 			}
 
@@ -714,6 +796,10 @@ namespace cp
 
 				if (pass == 1) // compute C on the first pass, and reuse it on the second pass, if any.
 				{
+					// in fullDP, the rows near the bottom and the first column are not updated below, so they keep the previous row as in !fullDP
+					if (params.fullDP && y > 0)
+						memcpy(C, C - costBufSize, costBufSize*sizeof(CostType));
+
 					int dy1 = y == 0 ? 0 : y + SH2, dy2 = y == 0 ? SH2 : dy1;
 					for (int k = dy1; k <= dy2; k++)
 					{
@@ -721,7 +807,7 @@ namespace cp
 
 						if (k < height)
 						{
-							calcPixelCostBT(img1, img2, k, minD, maxD, pixDiff, tempBuf, clipTab, TAB_OFS, ftzero, params.costAlpha, params.ad_max);
+							calcPixelCost(img1, img2, census1, census2, k, minD, maxD, pixDiff, tempBuf, clipTab, TAB_OFS, ftzero, params.costAlpha, params.ad_max);
 
 							memset(hsumAdd, 0, D*sizeof(CostType));
 							for (x = 0; x <= SW2*D; x += D)
@@ -1127,6 +1213,713 @@ namespace cp
 		}
 	}
 
+	/*
+	Multithreaded versions of computeDisparitySGBM.
+
+	PARALLEL_EXACT keeps C and S for the whole image (as fullDP does) and computes them in three steps:
+	1. C is computed for row stripes,
+	2. each direction r is aggregated into S separately: the horizontal paths are split into rows,
+	the vertical paths into columns, and the diagonal paths into bands of the lines along r;
+	every thread has its own cyclic L_r buffer of two rows,
+	3. the winner takes all, the uniqueness check and the left-right check are done for rows.
+	The arithmetic is the same as computeDisparitySGBM, so the result is identical as long as the 16-bit costs are not saturated
+	(which is also the condition that the SSE2 and the C code of computeDisparitySGBM give the same result).
+
+	PARALLEL_STRIPE runs computeDisparitySGBM for row stripes with their own buffers.
+	The paths from the top (and from the bottom in fullDP) start stripeOverlap rows outside of each stripe, thus it is an approximation.
+	*/
+
+	//horizontal sum of pixDiff over the SAD window, same as the first row of computeDisparitySGBM
+	static void calcHSumSGBM(const CostType* pixDiff, CostType* hsumAdd, int width1, int D, int SW2)
+	{
+		memset(hsumAdd, 0, D*sizeof(CostType));
+		for (int x = 0; x <= SW2*D; x += D)
+		{
+			int scale = x == 0 ? SW2 + 1 : 1;
+			for (int d = 0; d < D; d++)
+				hsumAdd[d] = (CostType)(hsumAdd[d] + pixDiff[x + d] * scale);
+		}
+
+		for (int x = D; x < width1*D; x += D)
+		{
+			const CostType* pixAdd = pixDiff + min(x + SW2*D, (width1 - 1)*D);
+			const CostType* pixSub = pixDiff + max(x - (SW2 + 1)*D, 0);
+
+			for (int d = 0; d < D; d++)
+				hsumAdd[x + d] = (CostType)(hsumAdd[x - D + d] + pixAdd[d] - pixSub[d]);
+		}
+	}
+
+	//L_r(p, d) for a single direction from Lp = L_r(p-r, .) and minLp = min_k L_r(p-r, k). L_r is added to S.
+	static inline CostType updatePathCostSGBM(const CostType* Cp, CostType* Lp, int minLp, CostType* L, CostType* Sp, int D, int P1, int P2, bool useSIMD)
+	{
+		const CostType MAX_COST = SHRT_MAX;
+		const int delta = minLp + P2;
+		Lp[-1] = Lp[D] = MAX_COST;
+
+#if CV_SSE2
+		if (useSIMD)
+		{
+			__m128i _P1 = _mm_set1_epi16((short)P1);
+			__m128i _delta = _mm_set1_epi16((short)delta);
+			__m128i _minL = _mm_set1_epi16(MAX_COST);
+
+			for (int d = 0; d < D; d += 8)
+			{
+				__m128i Ld = _mm_load_si128((const __m128i*)(Lp + d));
+				Ld = _mm_min_epi16(Ld, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(Lp + d - 1)), _P1));
+				Ld = _mm_min_epi16(Ld, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(Lp + d + 1)), _P1));
+				Ld = _mm_min_epi16(Ld, _delta);
+				Ld = _mm_adds_epi16(_mm_subs_epi16(Ld, _delta), _mm_load_si128((const __m128i*)(Cp + d)));
+
+				_mm_store_si128((__m128i*)(L + d), Ld);
+				_minL = _mm_min_epi16(_minL, Ld);
+				_mm_store_si128((__m128i*)(Sp + d), _mm_adds_epi16(_mm_load_si128((const __m128i*)(Sp + d)), Ld));
+			}
+
+			_minL = _mm_min_epi16(_minL, _mm_srli_si128(_minL, 8));
+			_minL = _mm_min_epi16(_minL, _mm_srli_si128(_minL, 4));
+			_minL = _mm_min_epi16(_minL, _mm_srli_si128(_minL, 2));
+			return (CostType)_mm_cvtsi128_si32(_minL);
+		}
+#endif
+		int minL = MAX_COST;
+		for (int d = 0; d < D; d++)
+		{
+			int Ld = Cp[d] + min((int)Lp[d], min(Lp[d - 1] + P1, min(Lp[d + 1] + P1, delta))) - delta;
+			L[d] = (CostType)Ld;
+			minL = min(minL, Ld);
+			Sp[d] = saturate_cast<CostType>(Sp[d] + Ld);
+		}
+		return (CostType)minL;
+	}
+
+	//C for the rows [0, rows) split into stripes; the remaining rows and the first column are copied by the caller
+	class SGBMCost_Invoker : public cv::ParallelLoopBody
+	{
+		const Mat* img1;
+		const Mat* img2;
+		const Mat* census1;
+		const Mat* census2;
+		CostType* Cbuf;
+		const PixType* clipTab;
+		int rows, stripes, height, width1, minD, maxD, SW2, SH2, P2, TAB_OFS, ftzero, ad_max;
+		double costAlpha;
+
+	public:
+		SGBMCost_Invoker(const Mat& img1_, const Mat& img2_, const Mat& census1_, const Mat& census2_, CostType* Cbuf_, const PixType* clipTab_, int rows_, int stripes_, int width1_,
+			int minD_, int maxD_, int SW2_, int SH2_, int P2_, int TAB_OFS_, int ftzero_, double costAlpha_, int ad_max_)
+			: img1(&img1_), img2(&img2_), census1(&census1_), census2(&census2_), Cbuf(Cbuf_), clipTab(clipTab_), rows(rows_), stripes(stripes_), height(img1_.rows), width1(width1_),
+			minD(minD_), maxD(maxD_), SW2(SW2_), SH2(SH2_), P2(P2_), TAB_OFS(TAB_OFS_), ftzero(ftzero_), ad_max(ad_max_), costAlpha(costAlpha_)
+		{
+			;
+		}
+
+		void operator()(const Range& range) const
+		{
+			const int D = maxD - minD;
+			const size_t costBufSize = width1*D;
+			const int hsumBufNRows = SH2 * 2 + 2;
+
+			Mat buf(1, (int)(costBufSize*(hsumBufNRows + 1)*sizeof(CostType) + img1->cols * 16 * img1->channels()*sizeof(PixType) + 16), CV_8U);
+			CostType* hsumBuf = (CostType*)alignPtr(buf.data, 16);
+			CostType* pixDiff = hsumBuf + costBufSize*hsumBufNRows;
+			PixType* tempBuf = (PixType*)(pixDiff + costBufSize);
+
+			for (int s = range.start; s < range.end; s++)
+			{
+				const int y0 = rows*s / stripes, y1 = rows*(s + 1) / stripes;
+				if (y0 == y1) continue;
+
+				for (int k = max(y0 - SH2, 0); k <= min(y0 + SH2, height - 1); k++)
+				{
+					calcPixelCost(*img1, *img2, *census1, *census2, k, minD, maxD, pixDiff, tempBuf, clipTab, TAB_OFS, ftzero, costAlpha, ad_max);
+					calcHSumSGBM(pixDiff, hsumBuf + (k % hsumBufNRows)*costBufSize, width1, D, SW2);
+				}
+
+				// the first row of the stripe is the direct sum over the window, and the others are updated as computeDisparitySGBM
+				CostType* C = Cbuf + y0*costBufSize;
+				for (size_t x = 0; x < costBufSize; x++)
+				{
+					int v = P2;
+					for (int k = y0 - SH2; k <= y0 + SH2; k++)
+						v += hsumBuf[(min(max(k, 0), height - 1) % hsumBufNRows)*costBufSize + x];
+					C[x] = (CostType)v;
+				}
+
+				for (int y = y0 + 1; y < y1; y++)
+				{
+					const int k = y + SH2;
+					CostType* hsumAdd = hsumBuf + (k % hsumBufNRows)*costBufSize;
+					calcPixelCost(*img1, *img2, *census1, *census2, k, minD, maxD, pixDiff, tempBuf, clipTab, TAB_OFS, ftzero, costAlpha, ad_max);
+					calcHSumSGBM(pixDiff, hsumAdd, width1, D, SW2);
+
+					const CostType* hsumSub = hsumBuf + (max(y - SH2 - 1, 0) % hsumBufNRows)*costBufSize;
+					const CostType* Cprev = Cbuf + (y - 1)*costBufSize;
+					C = Cbuf + y*costBufSize;
+					for (size_t x = 0; x < costBufSize; x++)
+						C[x] = (CostType)(Cprev[x] + hsumAdd[x] - hsumSub[x]);
+				}
+			}
+		}
+	};
+
+	//aggregation of a single direction; the predecessor of (x, y) is (x - rx, y - ry)
+	class SGBMPath_Invoker : public cv::ParallelLoopBody
+	{
+		const CostType* Cbuf;
+		CostType* Sbuf;
+		int width1, height, D, P1, P2, rx, ry, cmin;
+		bool useSIMD;
+
+	public:
+		SGBMPath_Invoker(const CostType* Cbuf_, CostType* Sbuf_, int width1_, int height_, int D_, int P1_, int P2_, int rx_, int ry_, bool useSIMD_)
+			: Cbuf(Cbuf_), Sbuf(Sbuf_), width1(width1_), height(height_), D(D_), P1(P1_), P2(P2_), rx(rx_), ry(ry_), useSIMD(useSIMD_)
+		{
+			cmin = getLineRange().start;
+		}
+
+		//the lines along r are indexed by c = ry*x - rx*y (ry != 0), the horizontal paths are indexed by y
+		Range getLineRange() const
+		{
+			if (ry == 0) return Range(0, height);
+			int cmn = INT_MAX, cmx = INT_MIN;
+			for (int j = 0; j < 4; j++)
+			{
+				const int x = (j & 1) ? width1 - 1 : 0, y = (j & 2) ? height - 1 : 0;
+				cmn = min(cmn, ry*x - rx*y);
+				cmx = max(cmx, ry*x - rx*y);
+			}
+			return Range(cmn, cmx + 1);
+		}
+
+		void operator()(const Range& range) const
+		{
+			const int D2 = D + 16;
+			const size_t costBufSize = width1*D;
+			const size_t LrSize = (width1 + 2)*D2;
+
+			// two rows of L_r with a border column on each side, and min_k L_r
+			Mat buf(1, (int)((LrSize + width1 + 2) * 2 * sizeof(CostType) + 16), CV_8U);
+			buf = Scalar::all(0);
+			CostType* Lr[2], *minLr[2];
+			Lr[0] = (CostType*)alignPtr(buf.data, 16) + D2 + 8;
+			Lr[1] = Lr[0] + LrSize;
+			minLr[0] = Lr[0] - D2 - 8 + LrSize * 2 + 1;
+			minLr[1] = minLr[0] + width1 + 2;
+
+			if (ry == 0)
+			{
+				for (int y = range.start; y < range.end; y++)
+				{
+					const CostType* C = Cbuf + y*costBufSize;
+					CostType* S = Sbuf + y*costBufSize;
+					const int x1 = rx > 0 ? 0 : width1 - 1, x2 = rx > 0 ? width1 : -1;
+					for (int x = x1; x != x2; x += rx)
+					{
+						const int xp = x - rx;
+						minLr[0][x] = updatePathCostSGBM(C + x*D, Lr[0] + xp*D2, minLr[0][xp], Lr[0] + x*D2, S + x*D, D, P1, P2, useSIMD);
+					}
+				}
+				return;
+			}
+
+			const int c0 = cmin + range.start, c1 = cmin + range.end;
+			const int y1 = ry > 0 ? 0 : height - 1, y2 = ry > 0 ? height : -1;
+			for (int y = y1; y != y2; y += ry)
+			{
+				const CostType* C = Cbuf + y*costBufSize;
+				CostType* S = Sbuf + y*costBufSize;
+
+				// x = ry*(c + rx*y) for c in [c0, c1)
+				int xs = (ry > 0) ? c0 + rx*y : -c1 - rx*y + 1;
+				int xe = (ry > 0) ? c1 + rx*y : -c0 - rx*y + 1;
+				xs = max(xs, 0);
+				xe = min(xe, width1);
+				for (int x = xs; x < xe; x++)
+				{
+					const int xp = x - rx;
+					minLr[0][x] = updatePathCostSGBM(C + x*D, Lr[1] + xp*D2, minLr[1][xp], Lr[0] + x*D2, S + x*D, D, P1, P2, useSIMD);
+				}
+
+				// now shift the cyclic buffers
+				std::swap(Lr[0], Lr[1]);
+				std::swap(minLr[0], minLr[1]);
+			}
+		}
+	};
+
+	//the winner takes all, the uniqueness check, and the left-right check for rows, same as the last pass of computeDisparitySGBM
+	class SGBMSelect_Invoker : public cv::ParallelLoopBody
+	{
+		const CostType* Sbuf;
+		Mat* disp1;
+		Mat* disp2;
+		int minD, D, width1, uniquenessRatio, disp12MaxDiff;
+		bool laneSelect;
+
+		//the lane order of the SSE2 code in computeDisparitySGBM is kept for the ties
+		int getBestDisparity(const CostType* Sp, int& minS) const
+		{
+			int bestDisp = -1;
+			minS = SHRT_MAX;
+			if (laneSelect)
+			{
+				int lane = 0;
+				for (int j = 0; j < 8; j++)
+				{
+					for (int d = j; d < D; d += 8) minS = min(minS, (int)Sp[d]);
+				}
+				for (; lane < 8; lane++)
+				{
+					int d = lane;
+					for (; d < D; d += 8)
+						if (Sp[d] == minS) break;
+					if (d < D)
+					{
+						bestDisp = d;
+						break;
+					}
+				}
+			}
+			else
+			{
+				for (int d = 0; d < D; d++)
+				{
+					if (Sp[d] < minS)
+					{
+						minS = Sp[d];
+						bestDisp = d;
+					}
+				}
+			}
+			return bestDisp;
+		}
+
+	public:
+		SGBMSelect_Invoker(const CostType* Sbuf_, Mat& disp1_, Mat& disp2_, int minD_, int D_, int width1_, int uniquenessRatio_, int disp12MaxDiff_, bool laneSelect_)
+			: Sbuf(Sbuf_), disp1(&disp1_), disp2(&disp2_), minD(minD_), D(D_), width1(width1_), uniquenessRatio(uniquenessRatio_), disp12MaxDiff(disp12MaxDiff_), laneSelect(laneSelect_)
+		{
+			;
+		}
+
+		void operator()(const Range& range) const
+		{
+			const int DISP_SHIFT = StereoSGBM2::DISP_SHIFT;
+			const int DISP_SCALE = StereoSGBM2::DISP_SCALE;
+			const int width = disp1->cols;
+			const int minX1 = max(minD + D, 0), maxX1 = minX1 + width1;
+			const int INVALID_DISP_SCALED = (minD - 1)*DISP_SCALE;
+			vector<CostType> disp2cost(width);
+
+			for (int y = range.start; y < range.end; y++)
+			{
+				const CostType* S = Sbuf + (size_t)y*width1*D;
+				DispType* disp1ptr = disp1->ptr<DispType>(y);
+				DispType* disp2ptr = disp2->ptr<DispType>(y);
+				int x, d;
+
+				for (x = 0; x < width; x++)
+				{
+					disp1ptr[x] = disp2ptr[x] = (DispType)INVALID_DISP_SCALED;
+					disp2cost[x] = SHRT_MAX;
+				}
+
+				for (x = width1 - 1; x >= 0; x--)
+				{
+					const CostType* Sp = S + x*D;
+					int minS;
+					const int bestDisp = getBestDisparity(Sp, minS);
+
+					for (d = 0; d < D; d++)
+					{
+						if (Sp[d] * (100 - uniquenessRatio) < minS * 100 && std::abs(bestDisp - d) > 1)
+							break;
+					}
+					if (d < D)
+						continue;
+					d = bestDisp;
+					int x2 = x + minX1 - d - minD;
+					if (disp2cost[x2] > minS)
+					{
+						disp2cost[x2] = (CostType)minS;
+						disp2ptr[x2] = (DispType)((d + minD)*DISP_SCALE);
+					}
+
+					if (0 < d && d < D - 1)
+					{
+						int denom2 = max(Sp[d - 1] + Sp[d + 1] - 2 * Sp[d], 1);
+						d = d*DISP_SCALE + ((Sp[d - 1] - Sp[d + 1])*DISP_SCALE + denom2) / (denom2 * 2);
+					}
+					else
+					{
+						d *= DISP_SCALE;
+					}
+
+					disp1ptr[x + minX1] = (DispType)(d + minD*DISP_SCALE);
+				}
+
+				for (x = minX1; x < maxX1; x++)
+				{
+					int d = disp1ptr[x];
+					if (d == INVALID_DISP_SCALED)
+						continue;
+					int _d = d >> DISP_SHIFT;
+					int d_ = (d + DISP_SCALE - 1) >> DISP_SHIFT;
+					int _x = x - _d, x_ = x - d_;
+					if (0 <= _x && _x < width && disp2ptr[_x] >= minD << DISP_SHIFT && std::abs((disp2ptr[_x] >> DISP_SHIFT) - _d) > disp12MaxDiff &&
+						0 <= x_ && x_ < width && disp2ptr[x_] >= minD << DISP_SHIFT && std::abs((disp2ptr[x_] >> DISP_SHIFT) - d_) > disp12MaxDiff)
+					{
+						disp1ptr[x] = (DispType)INVALID_DISP_SCALED;
+					}
+				}
+			}
+		}
+	};
+
+	static void computeDisparitySGBMParallel(const Mat& img1, const Mat& img2,
+		Mat& disp1, Mat& disp2, const StereoSGBM2& params,
+		Mat& buffer)
+	{
+#if CV_SSE2
+		volatile bool useSIMD = checkHardwareSupport(CV_CPU_SSE2);
+#else
+		bool useSIMD = false;
+#endif
+		const int ALIGN = 16;
+		const int DISP_SCALE = StereoSGBM2::DISP_SCALE;
+
+		int minD = params.minDisparity, maxD = minD + params.numberOfDisparities;
+		Size SADWindowSize;
+		SADWindowSize.width = params.SADWindowSize.width > 0 ? params.SADWindowSize.width : 5;
+		SADWindowSize.height = params.SADWindowSize.height > 0 ? params.SADWindowSize.height : 5;
+
+		const int ftzero = max(params.preFilterCap, 1) | 1;
+		const int uniquenessRatio = params.uniquenessRatio > 0 ? params.uniquenessRatio : 10;
+		const int disp12MaxDiff = params.disp12MaxDiff > 0 ? params.disp12MaxDiff : 1;
+		const int P1 = params.P1 > 0 ? params.P1 : 2, P2 = max(params.P2 > 0 ? params.P2 : 5, P1 + 1);
+		const int width = disp1.cols, height = disp1.rows;
+		const int minX1 = max(maxD, 0), maxX1 = width + min(minD, 0);
+		const int D = maxD - minD, width1 = maxX1 - minX1;
+		const int INVALID_DISP_SCALED = (minD - 1)*DISP_SCALE;
+		const int SW2 = SADWindowSize.width / 2, SH2 = SADWindowSize.height / 2;
+		const int TAB_OFS = 256 * 4, TAB_SIZE = 256 + TAB_OFS * 2;
+		PixType clipTab[TAB_SIZE];
+		Mat census1, census2;
+		calcCensusSGBM(img1, img2, params, census1, census2);
+
+		for (int k = 0; k < TAB_SIZE; k++)
+		{
+			clipTab[k] = (PixType)(min(max(k - TAB_OFS, -ftzero), ftzero) + ftzero);
+		}
+
+		if (minX1 >= maxX1)
+		{
+			disp1 = Scalar::all(INVALID_DISP_SCALED);
+			disp2 = Scalar::all(INVALID_DISP_SCALED);
+			return;
+		}
+
+		CV_Assert(D % 16 == 0);
+
+		//the whole C and S volumes; the size is checked in double so that it does not wrap around,
+		//and the buffer is allocated as rows of 1 MiB since the sizes of Mat::create are int
+		const double maxBufSize = min((double)StereoSGBM2::PARALLEL_EXACT_MAX_BUFFER_GB * (1 << 30), (double)std::numeric_limits<size_t>::max());
+		CV_Assert((double)width1*D*height * 2 * sizeof(CostType) + ALIGN <= maxBufSize);
+		const size_t costBufSize = (size_t)width1*D;
+		const size_t totalBufSize = costBufSize*height * 2 * sizeof(CostType) + ALIGN;
+		const size_t bufRowSize = (size_t)1 << 20;
+		if (!buffer.data || !buffer.isContinuous() ||
+			buffer.total()*buffer.elemSize() < totalBufSize)
+			buffer.create((int)((totalBufSize + bufRowSize - 1) / bufRowSize), (int)bufRowSize, CV_8U);
+
+		CostType* Cbuf = (CostType*)alignPtr(buffer.data, ALIGN);
+		CostType* Sbuf = Cbuf + costBufSize*height;
+		const int nstripes = getNumThreads();
+
+		// C is updated until the window reaches the bottom, and the first column keeps the value of the first row
+		const int rows = max(height - 1 - SH2, 0) + 1;
+		parallel_for_(Range(0, nstripes), SGBMCost_Invoker(img1, img2, census1, census2, Cbuf, clipTab, rows, nstripes, width1, minD, maxD, SW2, SH2, P2, TAB_OFS, ftzero, params.costAlpha, params.ad_max), nstripes);
+		for (int y = 1; y < height; y++)
+		{
+			CostType* C = Cbuf + y*costBufSize;
+			if (y >= rows) memcpy(C, Cbuf + (rows - 1)*costBufSize, costBufSize*sizeof(CostType));
+			memcpy(C, Cbuf, D*sizeof(CostType));
+		}
+		memset(Sbuf, 0, costBufSize*height*sizeof(CostType));
+
+		// the directions in the order of computeDisparitySGBM; without fullDP, the last one is the right-to-left path
+		const int dirs[8][2] = { { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { 1, -1 }, { 0, -1 }, { -1, -1 } };
+		const int ndirs = params.fullDP ? 8 : 5;
+		for (int i = 0; i < ndirs; i++)
+		{
+			SGBMPath_Invoker body(Cbuf, Sbuf, width1, height, D, P1, P2, dirs[i][0], dirs[i][1], useSIMD);
+			const Range r = body.getLineRange();
+			parallel_for_(Range(0, r.size()), body, nstripes);
+		}
+
+		parallel_for_(Range(0, height), SGBMSelect_Invoker(Sbuf, disp1, disp2, minD, D, width1, uniquenessRatio, disp12MaxDiff, useSIMD && !params.fullDP), nstripes);
+	}
+
+	//each stripe runs computeDisparitySGBM on the rows [y0 - overlap, y1 + overlap) and keeps [y0, y1)
+	class SGBMStripe_Invoker : public cv::ParallelLoopBody
+	{
+		const Mat* img1;
+		const Mat* img2;
+		Mat* disp1;
+		Mat* disp2;
+		const StereoSGBM2* params;
+		vector<Mat>* buffers;
+		int stripes, overlapTop, overlapBottom;
+
+	public:
+		SGBMStripe_Invoker(const Mat& img1_, const Mat& img2_, Mat& disp1_, Mat& disp2_, const StereoSGBM2& params_, vector<Mat>& buffers_, int overlapTop_, int overlapBottom_)
+			: img1(&img1_), img2(&img2_), disp1(&disp1_), disp2(&disp2_), params(&params_), buffers(&buffers_), stripes((int)buffers_.size()), overlapTop(overlapTop_), overlapBottom(overlapBottom_)
+		{
+			;
+		}
+
+		void operator()(const Range& range) const
+		{
+			const int height = img1->rows;
+			for (int s = range.start; s < range.end; s++)
+			{
+				const int y0 = height*s / stripes, y1 = height*(s + 1) / stripes;
+				if (y0 == y1) continue;
+				const int ys = max(y0 - overlapTop, 0), ye = min(y1 + overlapBottom, height);
+
+				Mat d1(ye - ys, img1->cols, CV_16S), d2(ye - ys, img1->cols, CV_16S);
+				computeDisparitySGBM(img1->rowRange(ys, ye), img2->rowRange(ys, ye), d1, d2, *params, (*buffers)[s]);
+				d1.rowRange(y0 - ys, y1 - ys).copyTo(disp1->rowRange(y0, y1));
+				d2.rowRange(y0 - ys, y1 - ys).copyTo(disp2->rowRange(y0, y1));
+			}
+		}
+	};
+
+	void StereoSGBM2::computeDisparity(const Mat& left, const Mat& right, Mat& disp_l, Mat& disp_r)
+	{
+		if (parallelMode == PARALLEL_EXACT)
+		{
+			computeDisparitySGBMParallel(left, right, disp_l, disp_r, *this, buffer);
+		}
+		else if (parallelMode == PARALLEL_STRIPE)
+		{
+			// the cost of the boundary rows of a stripe is exact with SH2 + 1 rows (and the census half window), and the paths need more rows to converge
+			const int SH2 = (SADWindowSize.height > 0 ? SADWindowSize.height : 5) / 2 + (costType == COST_CENSUS ? censusWindowSize.height / 2 : 0);
+			const int overlap = max(stripeOverlap, SH2 + 1);
+			const int nstripes = max(1, min(getNumThreads(), left.rows / max(overlap, 1)));
+			stripeBuffer.resize(nstripes);
+			parallel_for_(Range(0, nstripes), SGBMStripe_Invoker(left, right, disp_l, disp_r, *this, stripeBuffer, overlap, fullDP ? overlap : SH2 + 1), nstripes);
+		}
+		else
+		{
+			computeDisparitySGBM(left, right, disp_l, disp_r, *this, buffer);
+		}
+	}
+
+	//tiles of the temporal mode; the stripe s processes the tiles s, s + stripes, ... with its own buffer.
+	//rights[i] is the right disparity of the tile i for mergeStereoTilesR, which is copied from prevDispR for the static tiles.
+	class SGBMTile_Invoker : public cv::ParallelLoopBody
+	{
+		const Mat* img1;
+		const Mat* img2;
+		Mat* disp1;
+		const Mat* prevDisp;
+		const Mat* prevDispR;
+		const vector<StereoTile>* tiles;
+		vector<Mat>* rights;
+		const StereoSGBM2* params;
+		vector<Mat>* buffers;
+		int stripes;
+
+	public:
+		SGBMTile_Invoker(const Mat& img1_, const Mat& img2_, Mat& disp1_, const Mat& prevDisp_, const Mat& prevDispR_, const vector<StereoTile>& tiles_, vector<Mat>& rights_, const StereoSGBM2& params_, vector<Mat>& buffers_)
+			: img1(&img1_), img2(&img2_), disp1(&disp1_), prevDisp(&prevDisp_), prevDispR(&prevDispR_), tiles(&tiles_), rights(&rights_), params(&params_), buffers(&buffers_), stripes((int)buffers_.size())
+		{
+			;
+		}
+
+		void operator()(const Range& range) const
+		{
+			const int DISP_SCALE = StereoSGBM2::DISP_SCALE;
+			const bool isCensus = params->costType == StereoSGBM2::COST_CENSUS;
+			const int SW2 = (params->SADWindowSize.width > 0 ? params->SADWindowSize.width : 5) / 2 + (isCensus ? params->censusWindowSize.width / 2 : 0);
+			const int SH2 = (params->SADWindowSize.height > 0 ? params->SADWindowSize.height : 5) / 2 + (isCensus ? params->censusWindowSize.height / 2 : 0);
+			// the paths are warmed up over the halo as PARALLEL_STRIPE
+			const int hx = SW2 + 16, hy = SH2 + 16;
+			const int INVALID_DISP_SCALED = (params->minDisparity - 1)*DISP_SCALE;
+
+			StereoSGBM2 p = *params;
+			for (int s = range.start; s < range.end; s++)
+			{
+				for (int i = s; i < (int)tiles->size(); i += stripes)
+				{
+					const StereoTile& tile = (*tiles)[i];
+					const Rect& roi = tile.roi;
+					const int D = tile.numberOfDisparities, minD = tile.minDisparity;
+					Mat& right = (*rights)[i];
+					right.create(roi.height, roi.width + D, CV_16S);
+					if (tile.type == STEREO_TILE_STATIC)
+					{
+						(*prevDisp)(roi).copyTo((*disp1)(roi));
+						const int x0 = roi.x - minD - D;
+						for (int j = 0; j < roi.height; j++)
+						{
+							const DispType* src = prevDispR->ptr<DispType>(roi.y + j);
+							DispType* dst = right.ptr<DispType>(j);
+							for (int c = 0; c < right.cols; c++)
+								dst[c] = (x0 + c < 0 || x0 + c >= prevDispR->cols) ? (DispType)INVALID_DISP_SCALED : src[x0 + c];
+						}
+						continue;
+					}
+
+					// the tile is extended to the left by the range to be in the valid area (x >= maxD),
+					// and the right image is shifted by minDisparity so that the search is [0, numberOfDisparities)
+					const Rect troi(roi.x - D - hx, roi.y - hy, roi.width + D + 2 * hx, roi.height + 2 * hy);
+					Mat L, R;
+					copyStereoTileROI(*img1, troi, L);
+					copyStereoTileROI(*img2, troi - Point(minD, 0), R);
+
+					Mat d1(L.size(), CV_16S), d2(L.size(), CV_16S);
+					p.minDisparity = 0;
+					p.numberOfDisparities = D;
+					computeDisparitySGBM(L, R, d1, d2, p, (*buffers)[s]);
+
+					for (int j = 0; j < roi.height; j++)
+					{
+						const DispType* src = d1.ptr<DispType>(j + hy) + D + hx;
+						DispType* dst = disp1->ptr<DispType>(roi.y + j) + roi.x;
+						for (int x = 0; x < roi.width; x++)
+							dst[x] = (src[x] == -DISP_SCALE) ? (DispType)INVALID_DISP_SCALED : (DispType)(src[x] + minD*DISP_SCALE);
+					}
+					// the right pixel roi.x - minD - D + c is the column c + hx of d2
+					for (int j = 0; j < roi.height; j++)
+					{
+						const DispType* src = d2.ptr<DispType>(j + hy) + hx;
+						DispType* dst = right.ptr<DispType>(j);
+						for (int c = 0; c < right.cols; c++)
+							dst[c] = (src[c] == -DISP_SCALE) ? (DispType)INVALID_DISP_SCALED : (DispType)(src[c] + minD*DISP_SCALE);
+					}
+				}
+			}
+		}
+	};
+
+	//the full-frame solve has no match in x < minDisparity + numberOfDisparities and x >= width + min(minDisparity, 0),
+	//while a tile there is solved on the replicated border; they are invalidated so that the tiled output is the same as the full frame.
+	static void invalidateStereoTileBorder(Mat& disp, const int minD, const int numD, const int invalid)
+	{
+		const int minX1 = min(max(minD + numD, 0), disp.cols), maxX1 = max(disp.cols + min(minD, 0), minX1);
+		if (minX1 > 0) disp.colRange(0, minX1).setTo(invalid);
+		if (maxX1 < disp.cols) disp.colRange(maxX1, disp.cols).setTo(invalid);
+	}
+
+	void StereoSGBM2::computeDisparityTemporal(const Mat& left, const Mat& right, Mat& disp_l, Mat& disp_r)
+	{
+		Mat gray, grayR;
+		if (left.channels() == 3)
+		{
+			cvtColor(left, gray, COLOR_BGR2GRAY);
+			cvtColor(right, grayR, COLOR_BGR2GRAY);
+		}
+		else
+		{
+			gray = left;
+			grayR = right;
+		}
+
+		const bool isRefresh = temporalPrior.size() != left.size() || temporalRaw.size() != left.size() || temporalRawR.size() != left.size() ||
+			(temporalRefreshInterval > 0 && temporalFrame % temporalRefreshInterval == 0);
+		if (isRefresh)
+		{
+			if (pyramidLevels > 0) computeDisparityPyramid(left, right, disp_l, disp_r);
+			else computeDisparity(left, right, disp_l, disp_r);
+		}
+		else
+		{
+			const int invalid = (minDisparity - 1)*DISP_SCALE;
+			vector<StereoTile> tiles;
+			planStereoTiles(gray, temporalGray, grayR, temporalGrayR, temporalPrior, invalid, temporalTileSize, temporalDiffThreshold, temporalMargin,
+				minDisparity, numberOfDisparities, 16, tiles);
+
+			// disp_r of the solved tiles comes from their right costs, and that of the static tiles from the previous frame
+			vector<Mat> rights(tiles.size());
+			const int nstripes = max(1, min(getNumThreads(), (int)tiles.size()));
+			stripeBuffer.resize(nstripes);
+			parallel_for_(Range(0, nstripes), SGBMTile_Invoker(left, right, disp_l, temporalRaw, temporalRawR, tiles, rights, *this, stripeBuffer), nstripes);
+			invalidateStereoTileBorder(disp_l, minDisparity, numberOfDisparities, invalid);
+			mergeStereoTilesR(tiles, rights, invalid, max(minDisparity + numberOfDisparities, 0), left.cols + min(minDisparity, 0), disp_r);
+		}
+		gray.copyTo(temporalGray);
+		grayR.copyTo(temporalGrayR);
+		disp_l.copyTo(temporalRaw);
+		disp_r.copyTo(temporalRawR);
+		temporalFrame++;
+	}
+
+	void StereoSGBM2::computeDisparityPyramid(const Mat& left, const Mat& right, Mat& disp_l, Mat& disp_r)
+	{
+		const int levels = pyramidLevels;
+		vector<Mat> L(levels + 1), R(levels + 1);
+		L[0] = left;
+		R[0] = right;
+		for (int l = 1; l <= levels; l++)
+		{
+			pyrDown(L[l - 1], L[l]);
+			pyrDown(R[l - 1], R[l]);
+		}
+
+		// the range of the level l covers [minDisparity, minDisparity + numberOfDisparities) / 2^l
+		StereoSGBM2 p = *this;
+		p.isTemporal = false;
+		p.pyramidLevels = 0;
+		const int maxD = minDisparity + numberOfDisparities;
+		const int s = 1 << levels;
+		p.minDisparity = cvFloor((double)minDisparity / s);
+		p.numberOfDisparities = max(((cvCeil((double)maxD / s) - p.minDisparity) + 15) / 16 * 16, 16);
+
+		Mat dl(L[levels].size(), CV_16S), dr(L[levels].size(), CV_16S);
+		p.computeDisparity(L[levels], R[levels], dl, dr);
+
+		vector<StereoTile> tiles;
+		for (int l = levels - 1; l >= 0; l--)
+		{
+			const int invalidCoarse = (p.minDisparity - 1)*DISP_SCALE;
+			const int sl = 1 << l;
+			p.minDisparity = cvFloor((double)minDisparity / sl);
+			p.numberOfDisparities = (l == 0) ? numberOfDisparities : max(((cvCeil((double)maxD / sl) - p.minDisparity) + 15) / 16 * 16, 16);
+			const int invalid = (p.minDisparity - 1)*DISP_SCALE;
+
+			// the coarse disparity is the prior of the bands; the tiles without the confident prior search the full range of the level
+			Mat prior;
+			upsampleDisparityPrior(dl, L[l].size(), invalidCoarse, invalid, prior);
+			planStereoTiles(Mat(), Mat(), Mat(), Mat(), prior, invalid, pyramidTileSize, 0, pyramidMargin, p.minDisparity, p.numberOfDisparities, 16, tiles);
+
+			Mat d = (l == 0) ? disp_l : Mat(L[l].size(), CV_16S);
+			vector<Mat> rights(tiles.size());
+			const int nstripes = max(1, min(getNumThreads(), (int)tiles.size()));
+			stripeBuffer.resize(nstripes);
+			parallel_for_(Range(0, nstripes), SGBMTile_Invoker(L[l], R[l], d, prior, Mat(), tiles, rights, p, stripeBuffer), nstripes);
+			// disp_r comes from the right costs of the finest level
+			if (l == 0)
+			{
+				invalidateStereoTileBorder(d, minDisparity, numberOfDisparities, invalid);
+				mergeStereoTilesR(tiles, rights, invalid, max(maxD, 0), left.cols + min(minDisparity, 0), disp_r);
+			}
+			dl = d;
+		}
+	}
+
+	void StereoSGBM2::resetTemporal()
+	{
+		temporalGray.release();
+		temporalGrayR.release();
+		temporalRaw.release();
+		temporalRawR.release();
+		temporalPrior.release();
+		temporalFrame = 0;
+	}
+
 	void StereoSGBM2::operator ()(const Mat& left, const Mat& right, Mat& disp_l, Mat& disp_r)
 	{
 		CV_Assert(left.size() == right.size() && left.type() == right.type() &&
@@ -1135,7 +1928,9 @@ namespace cp
 		disp_l.create(left.size(), CV_16S);
 		disp_r.create(left.size(), CV_16S);
 
-		computeDisparitySGBM(left, right, disp_l, disp_r, *this, buffer);
+		if (isTemporal) computeDisparityTemporal(left, right, disp_l, disp_r);
+		else if (pyramidLevels > 0) computeDisparityPyramid(left, right, disp_l, disp_r);
+		else computeDisparity(left, right, disp_l, disp_r);
 		medianBlur(disp_l, disp_l, 3);
 		medianBlur(disp_r, disp_r, 3);
 
@@ -1143,6 +1938,7 @@ namespace cp
 		{
 			filterSpeckles(disp_l, (minDisparity - 1)*DISP_SCALE, speckleWindowSize, speckleRange, buffer);
 		}
+		if (isTemporal) disp_l.copyTo(temporalPrior);
 	}
 
 	static void computeDisparitySGBMTest(const Mat& img1, const Mat& img2,
@@ -1238,7 +2034,7 @@ namespace cp
 			width*(sizeof(CostType) + sizeof(DispType)) + 1024; // disp2cost + disp2
 
 		if (!buffer.data || !buffer.isContinuous() ||
-			buffer.cols*buffer.rows*buffer.elemSize() < totalBufSize)
+			buffer.total()*buffer.elemSize() < totalBufSize)
 			buffer.create(1, (int)totalBufSize, CV_8U);
 
 		// summary cost over different (nDirs) directions
@@ -1283,7 +2079,7 @@ namespace cp
 				// thus we shift the pointers by 8 (8*sizeof(short) == 16 - ideal alignment)
 				Lr[k] = pixDiff + costBufSize + LrSize*k + NRD2*LrBorder + 8;
 				memset(Lr[k] - LrBorder*NRD2 - 8, 0, LrSize*sizeof(CostType));
-				minLr[k] = pixDiff + costBufSize + LrSize*NLR + minLrSize*k + NR2 * 2;
+				minLr[k] = pixDiff + costBufSize + LrSize*NLR + minLrSize*k + NR2*LrBorder;
 				memset(minLr[k] - LrBorder*NR2, 0, minLrSize*sizeof(CostType));
 			}
 
@@ -1735,13 +2531,16 @@ namespace cp
 		disp_l.create(left.size(), CV_16S);
 		Mat disp_r(left.size(), CV_16S);
 
-		computeDisparitySGBM(left, right, disp_l, disp_r, *this, buffer);
+		if (isTemporal) computeDisparityTemporal(left, right, disp_l, disp_r);
+		else if (pyramidLevels > 0) computeDisparityPyramid(left, right, disp_l, disp_r);
+		else computeDisparity(left, right, disp_l, disp_r);
 		medianBlur(disp_l, disp_l, 3);
 
 		if (speckleRange >= 0 && speckleWindowSize > 0)
 		{
 			filterSpeckles(disp_l, (minDisparity - 1)*DISP_SCALE, speckleWindowSize, speckleRange, buffer);
 		}
+		if (isTemporal) disp_l.copyTo(temporalPrior);
 	}
 
 	void StereoSGBM2::test(const Mat& left, const Mat& right, Mat& disp_l, Point& pt, Mat& gt)
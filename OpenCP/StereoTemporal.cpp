@@ -0,0 +1,160 @@
+#include "opencp.hpp"
+#include "StereoTemporal.h"
+
+using namespace std;
+using namespace cv;
+
+namespace cp
+{
+	void planStereoTiles(const Mat& gray, const Mat& prevGray, const Mat& grayR, const Mat& prevGrayR, const Mat& prevDisp, const int invalidDisparity,
+		const int tileSize, const int diffThreshold, const int margin, const int minDisparity, const int numberOfDisparities, const int rangeAlign, vector<StereoTile>& tiles)
+	{
+		const bool isDiff = !prevGray.empty();
+		const bool isDiffR = isDiff && !prevGrayR.empty();
+		CV_Assert(prevDisp.type() == CV_16S);
+		CV_Assert(!isDiff || (gray.type() == CV_8U && prevGray.type() == CV_8U && gray.size() == prevGray.size() && gray.size() == prevDisp.size()));
+		CV_Assert(!isDiffR || (grayR.type() == CV_8U && prevGrayR.type() == CV_8U && grayR.size() == gray.size() && prevGrayR.size() == gray.size()));
+
+		const int ts = max(tileSize, 8);
+		const int maxD = minDisparity + numberOfDisparities;
+		const Size size = prevDisp.size();
+		tiles.clear();
+		for (int y0 = 0; y0 < size.height; y0 += ts)
+		{
+			const size_t rowStart = tiles.size();
+			for (int x0 = 0; x0 < size.width; x0 += ts)
+			{
+				StereoTile tile;
+				tile.roi = Rect(x0, y0, min(ts, size.width - x0), min(ts, size.height - y0));
+				tile.type = STEREO_TILE_FULL;
+				tile.minDisparity = minDisparity;
+				tile.numberOfDisparities = numberOfDisparities;
+
+				const int area = tile.roi.area();
+				int changed = isDiff ? 0 : area;//without the previous image, all tiles are changed but not new
+				int valid = 0;
+				int dmin = INT_MAX, dmax = INT_MIN;
+				for (int j = tile.roi.y; j < tile.roi.y + tile.roi.height; j++)
+				{
+					const uchar* s = isDiff ? gray.ptr<uchar>(j) : NULL;
+					const uchar* p = isDiff ? prevGray.ptr<uchar>(j) : NULL;
+					const short* d = prevDisp.ptr<short>(j);
+					for (int i = tile.roi.x; i < tile.roi.x + tile.roi.width; i++)
+					{
+						if (isDiff && abs(s[i] - p[i]) > diffThreshold) changed++;
+						if (d[i] != invalidDisparity)
+						{
+							valid++;
+							dmin = min(dmin, (int)d[i]);
+							dmax = max(dmax, (int)d[i]);
+						}
+					}
+				}
+
+				//the right columns matched by the tile: the previous disparities with the margin, or the full range
+				int changedR = 0, areaR = 0;
+				if (isDiffR && changed * 100 <= area)
+				{
+					const int lo = (valid > 0) ? max(minDisparity, (dmin >> 4) - margin) : minDisparity;
+					const int hi = (valid > 0) ? min(maxD, ((dmax + 15) >> 4) + margin + 1) : maxD;
+					const int xs = max(tile.roi.x - hi + 1, 0);
+					const int xe = min(tile.roi.x + tile.roi.width - lo, size.width);
+					for (int j = tile.roi.y; j < tile.roi.y + tile.roi.height; j++)
+					{
+						const uchar* s = grayR.ptr<uchar>(j);
+						const uchar* p = prevGrayR.ptr<uchar>(j);
+						for (int i = xs; i < xe; i++)
+						{
+							if (abs(s[i] - p[i]) > diffThreshold) changedR++;
+						}
+					}
+					areaR = max(xe - xs, 0) * tile.roi.height;
+				}
+
+				//1% of changed pixels are regarded as noise, and more than half means a new scene
+				if (isDiff && changed * 100 <= area && changedR * 100 <= areaR)
+				{
+					tile.type = STEREO_TILE_STATIC;
+				}
+				else if ((!isDiff || changed * 2 <= area) && valid * 2 >= area)
+				{
+					const int lo = max(minDisparity, (dmin >> 4) - margin);
+					const int hi = min(maxD, ((dmax + 15) >> 4) + margin + 1);
+					const int align = max(rangeAlign, 1);
+					const int range = (hi - lo + align - 1) / align * align;
+					if (range < numberOfDisparities)
+					{
+						tile.type = STEREO_TILE_BAND;
+						tile.minDisparity = min(lo, maxD - range);
+						tile.numberOfDisparities = range;
+					}
+				}
+
+				//span of the adjacent tiles, which saves the extension of each tile and the seams of the solver
+				if (tiles.size() > rowStart)
+				{
+					StereoTile& prev = tiles.back();
+					if (prev.type == tile.type && tile.type != STEREO_TILE_STATIC &&
+						prev.minDisparity == tile.minDisparity && prev.numberOfDisparities == tile.numberOfDisparities)
+					{
+						prev.roi.width += tile.roi.width;
+						continue;
+					}
+				}
+				tiles.push_back(tile);
+			}
+		}
+	}
+
+	void copyStereoTileROI(const Mat& src, const Rect& roi, Mat& dest)
+	{
+		const Rect inner = roi & Rect(0, 0, src.cols, src.rows);
+		CV_Assert(inner.area() > 0);
+		copyMakeBorder(src(inner), dest, inner.y - roi.y, roi.y + roi.height - inner.y - inner.height,
+			inner.x - roi.x, roi.x + roi.width - inner.x - inner.width, BORDER_REPLICATE);
+	}
+
+	void upsampleDisparityPrior(const Mat& src, const Size size, const int invalidSrc, const int invalidDest, Mat& dest)
+	{
+		CV_Assert(src.type() == CV_16S);
+		dest.create(size, CV_16S);
+		const double sx = (double)size.width / src.cols;
+		const double sy = (double)size.height / src.rows;
+		for (int j = 0; j < size.height; j++)
+		{
+			const short* s = src.ptr<short>(min((int)(j / sy), src.rows - 1));
+			short* d = dest.ptr<short>(j);
+			for (int i = 0; i < size.width; i++)
+			{
+				const short v = s[min((int)(i / sx), src.cols - 1)];
+				d[i] = (v == invalidSrc) ? (short)invalidDest : saturate_cast<short>(cvRound(v * sx));
+			}
+		}
+	}
+
+	void mergeStereoTilesR(const vector<StereoTile>& tiles, const vector<Mat>& rights, const int invalidDisparity, const int minX, const int maxX, Mat& dispR)
+	{
+		CV_Assert(tiles.size() == rights.size());
+		CV_Assert(dispR.type() == CV_16S);
+		dispR.setTo(invalidDisparity);
+		for (size_t n = 0; n < tiles.size(); n++)
+		{
+			const Rect& roi = tiles[n].roi;
+			const int x0 = roi.x - tiles[n].minDisparity - tiles[n].numberOfDisparities;
+			CV_Assert(rights[n].type() == CV_16S && rights[n].rows == roi.height && rights[n].cols == roi.width + tiles[n].numberOfDisparities);
+			for (int j = 0; j < roi.height; j++)
+			{
+				const short* s = rights[n].ptr<short>(j);
+				short* r = dispR.ptr<short>(roi.y + j);
+				for (int c = 0; c < rights[n].cols; c++)
+				{
+					const int x = x0 + c;
+					if (s[c] == invalidDisparity || x < 0 || x >= dispR.cols) continue;
+					const int xl = x + ((s[c] + 8) >> 4);
+					if (xl < max(roi.x, minX) || xl >= min(roi.x + roi.width, maxX)) continue;
+					if (r[x] == invalidDisparity || r[x] < s[c]) r[x] = s[c];
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+namespace cp
+{
+	//tiles of the temporal stereo mode
+	enum
+	{
+		STEREO_TILE_STATIC = 0,//the left image is not changed: the previous disparity is reused
+		STEREO_TILE_BAND,//the disparity is searched around the previous one
+		STEREO_TILE_FULL//the image is changed or the previous disparity is not confident: full range search
+	};
+
+	struct StereoTile
+	{
+		cv::Rect roi;
+		int type;
+		int minDisparity;
+		int numberOfDisparities;
+	};
+
+	//classify the tiles by the difference between the current and the previous left images (CV_8U) and the valid pixels of the previous disparity map (CV_16S, x16).
+	//a STATIC tile also needs the unchanged right image (grayR and prevGrayR) in the columns matched by the tile; without prevGrayR (empty), only the left image is compared.
+	//the band of a tile is [min - margin, max + margin] of the previous disparities, and its width is rounded up to a multiple of rangeAlign.
+	//without prevGray (empty), prevDisp is a prior such as the upsampled coarse disparity, and the tiles are BAND or FULL.
+	//the horizontally adjacent tiles of the same type and range are merged into a span, which is solved at once.
+	void planStereoTiles(const cv::Mat& gray, const cv::Mat& prevGray, const cv::Mat& grayR, const cv::Mat& prevGrayR, const cv::Mat& prevDisp, const int invalidDisparity,
+		const int tileSize, const int diffThreshold, const int margin, const int minDisparity, const int numberOfDisparities, const int rangeAlign, std::vector<StereoTile>& tiles);
+
+	//copy of src(roi); the roi can be outside of src, and the border is replicated
+	void copyStereoTileROI(const cv::Mat& src, const cv::Rect& roi, cv::Mat& dest);
+
+	//nearest neighbor upsampling of a disparity map (CV_16S) to size, where the disparities are scaled by the width ratio
+	void upsampleDisparityPrior(const cv::Mat& src, const cv::Size size, const int invalidSrc, const int invalidDest, cv::Mat& dest);
+
+	//right disparity map of the tiles: rights[i] (CV_16S, x16) has the rows of tiles[i].roi and the right pixels [roi.x - maxD, roi.x + roi.width - minD) of the range of the tile.
+	//only the right pixels matched to the left pixels in the roi and in [minX, maxX) (the valid columns of the full frame) are written, and the larger (occluding) disparity wins.
+	void mergeStereoTilesR(const std::vector<StereoTile>& tiles, const std::vector<cv::Mat>& rights, const int invalidDisparity, const int minX, const int maxX, cv::Mat& dispR);
+}
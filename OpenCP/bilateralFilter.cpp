@@ -1,6 +1,7 @@
 #include "opencp.hpp"
 #include "fmath.hpp"
 #include "filterCore.h"
+#include "bilateralFilterSIMD.h"
 
 using namespace std;
 using namespace cv;
@@ -119,52 +120,54 @@ namespace cp
 			}
 		}
 
-#pragma omp parallel for
-		for (int i = 0; i < size.height; i++)
+		parallelFor(Range(0, size.height), [&](const Range& range)
 		{
-			//cout<<i<<endl;
-			const uchar* sptr = sim.ptr<uchar>(i + radius) + radius*cn;
-			uchar* dptr = dst.ptr<uchar>(i);
-
-			if (cn == 1)
+			for (int i = range.start; i < range.end; i++)
 			{
-				for (int j = 0; j < size.width; j++)
+				//cout<<i<<endl;
+				const uchar* sptr = sim.ptr<uchar>(i + radius) + radius*cn;
+				uchar* dptr = dst.ptr<uchar>(i);
+
+				if (cn == 1)
 				{
-					float sum = 0.f, wsum = 0.f;
-					uchar val0 = sptr[j];
-					for (int k = 0; k < maxk; k++)
+					for (int j = 0; j < size.width; j++)
 					{
-						uchar val = sptr[j + space_ofs_src[k]];
-						float w = space_weight[k] * fmath::exp((val - val0)*(val - val0)*gauss_color_coeff);
-						sum += val*w;
-						wsum += w;
+						float sum = 0.f, wsum = 0.f;
+						uchar val0 = sptr[j];
+						for (int k = 0; k < maxk; k++)
+						{
+							uchar val = sptr[j + space_ofs_src[k]];
+							float w = space_weight[k] * fmath::exp((val - val0)*(val - val0)*gauss_color_coeff);
+							sum += val*w;
+							wsum += w;
+						}
+						dptr[j] = cvRound(sum / wsum);
 					}
-					dptr[j] = cvRound(sum / wsum);
 				}
-			}
-			else if (cn == 3)
-			{
-				for (int j = 0; j < size.width * 3; j += 3)
+				else if (cn == 3)
 				{
-					float sum_b = 0.f, sum_g = 0.f, sum_r = 0.f, wsum = 0.f;
-					uchar b0 = sptr[j], g0 = sptr[j + 1], r0 = sptr[j + 2];
-					for (int k = 0; k < maxk; k++)
+					for (int j = 0; j < size.width * 3; j += 3)
 					{
-						const uchar* sptr_k = sptr + j + space_ofs_src[k];
-						uchar b = sptr_k[0], g = sptr_k[1], r = sptr_k[2];
+						float sum_b = 0.f, sum_g = 0.f, sum_r = 0.f, wsum = 0.f;
+						uchar b0 = sptr[j], g0 = sptr[j + 1], r0 = sptr[j + 2];
+						for (int k = 0; k < maxk; k++)
+						{
+							const uchar* sptr_k = sptr + j + space_ofs_src[k];
+							uchar b = sptr_k[0], g = sptr_k[1], r = sptr_k[2];
 
-						float c_w = fmath::exp(((b - b0)*(b - b0) + (g - g0)*(g - g0) + (r - r0)*(r - r0)) *gauss_color_coeff);
-						float w = space_weight[k] * c_w;
+							float c_w = fmath::exp(((b - b0)*(b - b0) + (g - g0)*(g - g0) + (r - r0)*(r - r0)) *gauss_color_coeff);
+							float w = space_weight[k] * c_w;
 
-						sum_b += b*w; sum_g += g*w; sum_r += r*w;
-						wsum += w;
+							sum_b += b*w; sum_g += g*w; sum_r += r*w;
+							wsum += w;
+						}
+						dptr[j] = cvRound(sum_b / wsum);
+						dptr[j + 1] = cvRound(sum_g / wsum);
+						dptr[j + 2] = cvRound(sum_r / wsum);
 					}
-					dptr[j] = cvRound(sum_b / wsum);
-					dptr[j + 1] = cvRound(sum_g / wsum);
-					dptr[j + 2] = cvRound(sum_r / wsum);
 				}
 			}
-		}
+		});
 	}
 
 	void bilateralFilterL2Base_32f(const Mat& src, Mat& dst, int radius, double sigma_color, double sigma_space, int borderType)
@@ -207,52 +210,54 @@ namespace cp
 			}
 		}
 
-#pragma omp parallel for
-		for (int i = 0; i < size.height; i++)
+		parallelFor(Range(0, size.height), [&](const Range& range)
 		{
-			//cout<<i<<endl;
-			const float* sptr = sim.ptr<float>(i + radius) + radius*cn;
-			float* dptr = dst.ptr<float>(i);
-
-			if (cn == 1)
+			for (int i = range.start; i < range.end; i++)
 			{
-				for (int j = 0; j < size.width; j++)
+				//cout<<i<<endl;
+				const float* sptr = sim.ptr<float>(i + radius) + radius*cn;
+				float* dptr = dst.ptr<float>(i);
+
+				if (cn == 1)
 				{
-					float sum = 0, wsum = 0;
-					float val0 = sptr[j];
-					for (int k = 0; k < maxk; k++)
+					for (int j = 0; j < size.width; j++)
 					{
-						float val = sptr[j + space_ofs_src[k]];
-						float w = space_weight[k] * fmath::exp((val - val0)*(val - val0)*gauss_color_coeff);
-						sum += val*w;
-						wsum += w;
+						float sum = 0, wsum = 0;
+						float val0 = sptr[j];
+						for (int k = 0; k < maxk; k++)
+						{
+							float val = sptr[j + space_ofs_src[k]];
+							float w = space_weight[k] * fmath::exp((val - val0)*(val - val0)*gauss_color_coeff);
+							sum += val*w;
+							wsum += w;
+						}
+						dptr[j] = sum / wsum;
 					}
-					dptr[j] = sum / wsum;
 				}
-			}
-			else if (cn == 3)
-			{
-				for (int j = 0; j < size.width * 3; j += 3)
+				else if (cn == 3)
 				{
-					float sum_b = 0, sum_g = 0, sum_r = 0, wsum = 0;
-					float b0 = sptr[j], g0 = sptr[j + 1], r0 = sptr[j + 2];
-					for (int k = 0; k < maxk; k++)
+					for (int j = 0; j < size.width * 3; j += 3)
 					{
-						const float* sptr_k = sptr + j + space_ofs_src[k];
-						float b = sptr_k[0], g = sptr_k[1], r = sptr_k[2];
+						float sum_b = 0, sum_g = 0, sum_r = 0, wsum = 0;
+						float b0 = sptr[j], g0 = sptr[j + 1], r0 = sptr[j + 2];
+						for (int k = 0; k < maxk; k++)
+						{
+							const float* sptr_k = sptr + j + space_ofs_src[k];
+							float b = sptr_k[0], g = sptr_k[1], r = sptr_k[2];
 
-						float c_w = fmath::exp(((b - b0)*(b - b0) + (g - g0)*(g - g0) + (r - r0)*(r - r0)) *gauss_color_coeff);
-						float w = space_weight[k] * c_w;
+							float c_w = fmath::exp(((b - b0)*(b - b0) + (g - g0)*(g - g0) + (r - r0)*(r - r0)) *gauss_color_coeff);
+							float w = space_weight[k] * c_w;
 
-						sum_b += b*w; sum_g += g*w; sum_r += r*w;
-						wsum += w;
+							sum_b += b*w; sum_g += g*w; sum_r += r*w;
+							wsum += w;
+						}
+						dptr[j] = sum_b / wsum;
+						dptr[j + 1] = sum_g / wsum;
+						dptr[j + 2] = sum_r / wsum;
 					}
-					dptr[j] = sum_b / wsum;
-					dptr[j + 1] = sum_g / wsum;
-					dptr[j + 2] = sum_r / wsum;
 				}
 			}
-		}
+		});
 	}
 
 	class BilateralFilter_L2Naive_32f_InvokerSSE4 : public cv::ParallelLoopBody
@@ -3260,7 +3265,7 @@ namespace cp
 							__m128 gval1 = _mm_set1_ps(0.0f);
 							__m128 bval1 = _mm_set1_ps(0.0f);
 
-							for (k = 0; k < maxk; k++, ofs++, spw++)
+							for (k = 0; k < maxk; k++, ofs++, wofs++, spw++)
 							{
 								__m128 bref = _mm_loadu_ps((sptrbj + *ofs));
 								__m128 gref = _mm_loadu_ps((sptrgj + *ofs));
@@ -3720,6 +3725,13 @@ namespace cp
 		float *space_weight, *color_weight;
 	};
 
+	int getBilateralFilterSIMDWidth()
+	{
+		if (haveBilateralFilterAVX512()) return 16;
+		else if (haveBilateralFilterAVX2()) return 8;
+		else return 4;
+	}
+
 	void weightedBilateralFilter_32f(const Mat& src, Mat& weight, Mat& dst, Size kernelSize, double sigma_color, double sigma_space, int borderType, bool isRectangle)
 	{
 		if (kernelSize.width == 0 || kernelSize.height == 0){ src.copyTo(dst); return; }
@@ -3744,11 +3756,11 @@ namespace cp
 		int radiusV = kernelSize.height >> 1;
 
 		Mat temp, tempw;
-		int dpad = (4 - src.cols % 4) % 4;
-		int spad = dpad + (4 - (2 * radiusH) % 4) % 4;
-		if (spad < 4) spad += 4;
-		int lpad = 4 * (radiusH / 4 + 1) - radiusH;
-		int rpad = spad - lpad;
+		//pixel unit of the SSE4/AVX2/AVX-512 invoker
+		const int simdWidth = getBilateralFilterSIMDWidth();
+		int dpad = (simdWidth - src.cols % simdWidth) % simdWidth;
+		int lpad = simdWidth * (radiusH / simdWidth + 1) - radiusH;
+		int rpad = dpad + (simdWidth - (src.cols + 2 * radiusH + lpad + dpad) % simdWidth) % simdWidth;
 		if (cn == 1)
 		{
 			copyMakeBorder(src, temp, radiusV, radiusV, radiusH + lpad, radiusH + rpad, borderType);
@@ -3767,7 +3779,8 @@ namespace cp
 		minMaxLoc(src, &minv, &maxv);
 		const int color_range = cvRound(maxv - minv);
 
-		vector<float> _color_weight(cn*color_range);
+		//+1 for rounding of the maximum difference
+		vector<float> _color_weight(cn*(color_range + 1));
 		vector<float> _space_weight(kernelSize.area() + 1);
 		vector<int> _space_ofs(kernelSize.area() + 1);
 		vector<int> _space_w_ofs(kernelSize.area() + 1);
@@ -3778,7 +3791,7 @@ namespace cp
 
 		// initialize color-related bilateral filter coefficients
 
-		for (i = 0; i < cn*color_range; i++)
+		for (i = 0; i < cn*(color_range + 1); i++)
 			color_weight[i] = (float)std::exp(i*i*gauss_color_coeff);
 
 		// initialize space-related bilateral filter coefficients
@@ -3814,8 +3827,19 @@ namespace cp
 			}
 		}
 		Mat dest = Mat::zeros(Size(src.cols + dpad, src.rows), dst.type());
-		WeightedBilateralFilter_32f_InvokerSSE4 body(dest, temp, tempw, radiusH, radiusV, maxk, space_ofs, space_w_ofs, space_weight, color_weight);
-		parallel_for_(Range(0, size.height), body);
+		if (simdWidth == 16)
+		{
+			weightedBilateralFilter_32f_AVX512(dest, temp, tempw, radiusH, radiusV, maxk, space_ofs, space_w_ofs, space_weight, color_weight);
+		}
+		else if (simdWidth == 8)
+		{
+			weightedBilateralFilter_32f_AVX2(dest, temp, tempw, radiusH, radiusV, maxk, space_ofs, space_w_ofs, space_weight, color_weight);
+		}
+		else
+		{
+			WeightedBilateralFilter_32f_InvokerSSE4 body(dest, temp, tempw, radiusH, radiusV, maxk, space_ofs, space_w_ofs, space_weight, color_weight);
+			parallel_for_(Range(0, size.height), body);
+		}
 		Mat(dest(Rect(0, 0, dst.cols, dst.rows))).copyTo(dst);
 	}
 
@@ -3910,8 +3934,19 @@ namespace cp
 			}
 		}
 		Mat dest = Mat::zeros(Size(src.cols + dpad, src.rows), dst.type());
-		WeightedBilateralFilter_8u_InvokerSSE4 body(dest, temp, tempw, radiusH, radiusV, maxk, space_ofs, space_w_ofs, space_weight, color_weight);
-		parallel_for_(Range(0, size.height), body);
+		if (haveBilateralFilterAVX512())
+		{
+			weightedBilateralFilter_8u_AVX512(dest, temp, tempw, radiusH, radiusV, maxk, space_ofs, space_w_ofs, space_weight, color_weight);
+		}
+		else if (haveBilateralFilterAVX2())
+		{
+			weightedBilateralFilter_8u_AVX2(dest, temp, tempw, radiusH, radiusV, maxk, space_ofs, space_w_ofs, space_weight, color_weight);
+		}
+		else
+		{
+			WeightedBilateralFilter_8u_InvokerSSE4 body(dest, temp, tempw, radiusH, radiusV, maxk, space_ofs, space_w_ofs, space_weight, color_weight);
+			parallel_for_(Range(0, size.height), body);
+		}
 		Mat(dest(Rect(0, 0, dst.cols, dst.rows))).copyTo(dst);
 	}
 
@@ -4216,11 +4251,11 @@ namespace cp
 
 		Mat temp;
 
-		int dpad = (4 - src.cols % 4) % 4;
-		int spad = dpad + (4 - (2 * radiusH) % 16) % 4;
-		if (spad < 4) spad += 4;
-		int lpad = 4 * (radiusH / 4 + 1) - radiusH;
-		int rpad = spad - lpad;
+		//pixel unit of the SSE4/AVX2/AVX-512 invoker
+		const int simdWidth = getBilateralFilterSIMDWidth();
+		int dpad = (simdWidth - src.cols % simdWidth) % simdWidth;
+		int lpad = simdWidth * (radiusH / simdWidth + 1) - radiusH;
+		int rpad = dpad + (simdWidth - (src.cols + 2 * radiusH + lpad + dpad) % simdWidth) % simdWidth;
 		if (cn == 1)
 		{
 			copyMakeBorder(src, temp, radiusV, radiusV, radiusH + lpad, radiusH + rpad, borderType);
@@ -4234,7 +4269,8 @@ namespace cp
 
 		double minv, maxv;
 		minMaxLoc(src, &minv, &maxv);
-		const int color_range = cvRound(maxv - minv);
+		//+1 for rounding of the maximum difference
+		const int color_range = cvRound(maxv - minv) + 1;
 
 		vector<float> _color_weight(cn*color_range);
 
@@ -4256,8 +4292,19 @@ namespace cp
 		setSpaceKernel(space_weight, space_ofs, maxk, radiusH, radiusV, gauss_space_coeff, temp.cols*cn, isRectangle);
 
 		Mat dest = Mat::zeros(Size(src.cols + dpad, src.rows), dst.type());
-		BilateralFilter_32f_InvokerSSE4 body(dest, temp, radiusH, radiusV, maxk, space_ofs, space_weight, color_weight);
-		parallel_for_(Range(0, size.height), body);
+		if (simdWidth == 16)
+		{
+			bilateralFilter_32f_AVX512(dest, temp, radiusH, radiusV, maxk, space_ofs, space_weight, color_weight);
+		}
+		else if (simdWidth == 8)
+		{
+			bilateralFilter_32f_AVX2(dest, temp, radiusH, radiusV, maxk, space_ofs, space_weight, color_weight);
+		}
+		else
+		{
+			BilateralFilter_32f_InvokerSSE4 body(dest, temp, radiusH, radiusV, maxk, space_ofs, space_weight, color_weight);
+			parallel_for_(Range(0, size.height), body);
+		}
 		Mat(dest(Rect(0, 0, dst.cols, dst.rows))).copyTo(dst);
 	}
 
@@ -4440,8 +4487,19 @@ namespace cp
 		setSpaceKernel(space_weight, space_ofs, maxk, radiusH, radiusV, gauss_space_coeff, temp.cols*cn, isRectangle);
 
 		Mat dest = Mat::zeros(Size(src.cols + dpad, src.rows), src.type());
-		BilateralFilter_8u_InvokerSSE4 body(dest, temp, radiusH, radiusV, maxk, space_ofs, space_weight, color_weight);
-		parallel_for_(Range(0, size.height), body, 1);
+		if (haveBilateralFilterAVX512())
+		{
+			bilateralFilter_8u_AVX512(dest, temp, radiusH, radiusV, maxk, space_ofs, space_weight, color_weight, 1);
+		}
+		else if (haveBilateralFilterAVX2())
+		{
+			bilateralFilter_8u_AVX2(dest, temp, radiusH, radiusV, maxk, space_ofs, space_weight, color_weight, 1);
+		}
+		else
+		{
+			BilateralFilter_8u_InvokerSSE4 body(dest, temp, radiusH, radiusV, maxk, space_ofs, space_weight, color_weight);
+			parallel_for_(Range(0, size.height), body, 1);
+		}
 		Mat(dest(Rect(0, 0, dst.cols, dst.rows))).copyTo(dst);
 	}
 
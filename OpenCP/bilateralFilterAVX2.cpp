@@ -0,0 +1,397 @@
+#include "opencp.hpp"
+#include "bilateralFilterSIMD.h"
+
+using namespace std;
+using namespace cv;
+
+namespace cp
+{
+#if defined(__AVX2__)
+
+	bool haveBilateralFilterAVX2()
+	{
+		return checkHardwareSupport(CV_CPU_AVX2) && checkHardwareSupport(CV_CPU_FMA3);
+	}
+
+	//store planar b, g, r (4 pixels) as bgrbgr...
+	static inline void _mm_storeu_bgr_ps(float* dst, const __m128 b, const __m128 g, const __m128 r)
+	{
+		__m128 a = _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 0, 1, 2));
+		__m128 bb = _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 3, 0));
+		__m128 c = _mm_shuffle_ps(g, g, _MM_SHUFFLE(2, 3, 0, 1));
+
+		_mm_storeu_ps((dst), _mm_blend_ps(_mm_blend_ps(bb, a, 4), c, 2));
+		_mm_storeu_ps((dst + 4), _mm_blend_ps(_mm_blend_ps(c, bb, 4), a, 2));
+		_mm_storeu_ps((dst + 8), _mm_blend_ps(_mm_blend_ps(a, c, 4), bb, 2));
+	}
+
+	//store planar b, g, r (8 pixels) as bgrbgr...
+	static inline void _mm256_storeu_bgr_ps(float* dst, const __m256 b, const __m256 g, const __m256 r)
+	{
+		_mm_storeu_bgr_ps(dst, _mm256_castps256_ps128(b), _mm256_castps256_ps128(g), _mm256_castps256_ps128(r));
+		_mm_storeu_bgr_ps(dst + 12, _mm256_extractf128_ps(b, 1), _mm256_extractf128_ps(g, 1), _mm256_extractf128_ps(r, 1));
+	}
+
+	//pack 2x8 float to 16 uchar with saturation
+	static inline __m128i _mm256_cvtps_epu8x2(const __m256 a, const __m256 b)
+	{
+		__m256i v = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+		v = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+		return _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	}
+
+	//store planar b, g, r (16 pixels) as bgrbgr...
+	static inline void _mm_storeu_bgr_epi8(uchar* dst, __m128i a, __m128i b, __m128i c)
+	{
+		const __m128i mask1 = _mm_setr_epi8(0, 11, 6, 1, 12, 7, 2, 13, 8, 3, 14, 9, 4, 15, 10, 5);
+		const __m128i mask2 = _mm_setr_epi8(5, 0, 11, 6, 1, 12, 7, 2, 13, 8, 3, 14, 9, 4, 15, 10);
+		const __m128i mask3 = _mm_setr_epi8(10, 5, 0, 11, 6, 1, 12, 7, 2, 13, 8, 3, 14, 9, 4, 15);
+
+		const __m128i bmask1 = _mm_setr_epi8
+			(0, 255, 255, 0, 255, 255, 0, 255, 255, 0, 255, 255, 0, 255, 255, 0);
+
+		const __m128i bmask2 = _mm_setr_epi8
+			(255, 255, 0, 255, 255, 0, 255, 255, 0, 255, 255, 0, 255, 255, 0, 255);
+
+		a = _mm_shuffle_epi8(a, mask1);
+		b = _mm_shuffle_epi8(b, mask2);
+		c = _mm_shuffle_epi8(c, mask3);
+		_mm_storeu_si128((__m128i*)(dst), _mm_blendv_epi8(c, _mm_blendv_epi8(a, b, bmask1), bmask2));
+		_mm_storeu_si128((__m128i*)(dst + 16), _mm_blendv_epi8(b, _mm_blendv_epi8(a, c, bmask2), bmask1));
+		_mm_storeu_si128((__m128i*)(dst + 32), _mm_blendv_epi8(c, _mm_blendv_epi8(b, a, bmask2), bmask1));
+	}
+
+	static inline __m128i _mm_absdiff_epu8(const __m128i a, const __m128i b)
+	{
+		return _mm_add_epi8(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+	}
+
+	class BilateralFilter_8u_InvokerAVX2 : public cv::ParallelLoopBody
+	{
+	public:
+		BilateralFilter_8u_InvokerAVX2(Mat& _dest, const Mat& _temp, const Mat* _weightMap, int _radiusH, int _radiusV, int _maxk,
+			int* _space_ofs, int* _space_w_ofs, float *_space_weight, float *_color_weight) :
+			temp(&_temp), weightMap(_weightMap), dest(&_dest), radiusH(_radiusH), radiusV(_radiusV),
+			maxk(_maxk), space_ofs(_space_ofs), space_w_ofs(_space_w_ofs), space_weight(_space_weight), color_weight(_color_weight)
+		{
+		}
+
+		virtual void operator() (const Range& range) const
+		{
+			int i, j, k;
+			const int cn = dest->channels();
+			const Size size = dest->size();
+			const bool isWeighted = (weightMap != NULL);
+			const int wstep = (isWeighted) ? weightMap->cols : 0;
+			const float* wptr = (isWeighted) ? weightMap->ptr<float>(range.start + radiusV) + 16 * (radiusH / 16 + 1) : NULL;
+
+			if (cn == 1)
+			{
+				const uchar* sptr = temp->ptr<uchar>(range.start + radiusV) + 16 * (radiusH / 16 + 1);
+				uchar* dptr = dest->ptr<uchar>(range.start);
+
+				const int sstep = temp->cols;
+				const int dstep = dest->cols;
+
+				for (i = range.start; i != range.end; i++, dptr += dstep, sptr += sstep, wptr += wstep)
+				{
+					for (j = 0; j < size.width; j += 16)//16 pixel unit
+					{
+						const int* ofs = space_ofs;
+						const int* wofs = space_w_ofs;
+						const float* spw = space_weight;
+
+						const uchar* sptrj = sptr + j;
+						const __m128i sval0 = _mm_loadu_si128((const __m128i*)(sptrj));
+
+						__m256 wval1 = _mm256_setzero_ps();
+						__m256 tval1 = _mm256_setzero_ps();
+						__m256 wval2 = _mm256_setzero_ps();
+						__m256 tval2 = _mm256_setzero_ps();
+
+						for (k = 0; k < maxk; k++, ofs++, spw++)
+						{
+							const __m128i sref = _mm_loadu_si128((const __m128i*)(sptrj + *ofs));
+							const __m128i diff = _mm_absdiff_epu8(sval0, sref);
+							const __m256 _sw = _mm256_set1_ps(*spw);
+
+							__m256 _w1 = _mm256_mul_ps(_sw, _mm256_i32gather_ps(color_weight, _mm256_cvtepu8_epi32(diff), 4));
+							__m256 _w2 = _mm256_mul_ps(_sw, _mm256_i32gather_ps(color_weight, _mm256_cvtepu8_epi32(_mm_srli_si128(diff, 8)), 4));
+							if (isWeighted)
+							{
+								const float* wptrj = wptr + j + *wofs++;
+								_w1 = _mm256_mul_ps(_w1, _mm256_loadu_ps(wptrj));
+								_w2 = _mm256_mul_ps(_w2, _mm256_loadu_ps(wptrj + 8));
+							}
+
+							tval1 = _mm256_add_ps(tval1, _mm256_mul_ps(_w1, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(sref))));
+							wval1 = _mm256_add_ps(wval1, _w1);
+							tval2 = _mm256_add_ps(tval2, _mm256_mul_ps(_w2, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(sref, 8)))));
+							wval2 = _mm256_add_ps(wval2, _w2);
+						}
+						tval1 = _mm256_div_ps(tval1, wval1);
+						tval2 = _mm256_div_ps(tval2, wval2);
+						_mm_storeu_si128((__m128i*)(dptr + j), _mm256_cvtps_epu8x2(tval1, tval2));
+					}
+				}
+			}
+			else
+			{
+				const int sstep = 3 * temp->cols;
+				const int dstep = 3 * dest->cols;
+
+				const uchar* sptrb = temp->ptr<uchar>(3 * radiusV + 3 * range.start) + 16 * (radiusH / 16 + 1);
+				const uchar* sptrg = temp->ptr<uchar>(3 * radiusV + 3 * range.start + 1) + 16 * (radiusH / 16 + 1);
+				const uchar* sptrr = temp->ptr<uchar>(3 * radiusV + 3 * range.start + 2) + 16 * (radiusH / 16 + 1);
+				uchar* dptr = dest->ptr<uchar>(range.start);
+
+				for (i = range.start; i != range.end; i++, sptrr += sstep, sptrg += sstep, sptrb += sstep, dptr += dstep, wptr += wstep)
+				{
+					for (j = 0; j < size.width; j += 16)//16 pixel unit
+					{
+						const int* ofs = space_ofs;
+						const int* wofs = space_w_ofs;
+						const float* spw = space_weight;
+
+						const uchar* sptrbj = sptrb + j;
+						const uchar* sptrgj = sptrg + j;
+						const uchar* sptrrj = sptrr + j;
+
+						const __m128i bval0 = _mm_loadu_si128((const __m128i*)(sptrbj));
+						const __m128i gval0 = _mm_loadu_si128((const __m128i*)(sptrgj));
+						const __m128i rval0 = _mm_loadu_si128((const __m128i*)(sptrrj));
+
+						__m256 wval1 = _mm256_setzero_ps();
+						__m256 bval1 = _mm256_setzero_ps();
+						__m256 gval1 = _mm256_setzero_ps();
+						__m256 rval1 = _mm256_setzero_ps();
+						__m256 wval2 = _mm256_setzero_ps();
+						__m256 bval2 = _mm256_setzero_ps();
+						__m256 gval2 = _mm256_setzero_ps();
+						__m256 rval2 = _mm256_setzero_ps();
+
+						for (k = 0; k < maxk; k++, ofs++, spw++)
+						{
+							const __m128i bref = _mm_loadu_si128((const __m128i*)(sptrbj + *ofs));
+							const __m128i gref = _mm_loadu_si128((const __m128i*)(sptrgj + *ofs));
+							const __m128i rref = _mm_loadu_si128((const __m128i*)(sptrrj + *ofs));
+
+							//sum of absolute differences of 3 channels (<=765) in 16 bit
+							const __m256i diff = _mm256_add_epi16(_mm256_add_epi16(
+								_mm256_cvtepu8_epi16(_mm_absdiff_epu8(bval0, bref)),
+								_mm256_cvtepu8_epi16(_mm_absdiff_epu8(gval0, gref))),
+								_mm256_cvtepu8_epi16(_mm_absdiff_epu8(rval0, rref)));
+
+							const __m256 _sw = _mm256_set1_ps(*spw);
+							__m256 _w1 = _mm256_mul_ps(_sw, _mm256_i32gather_ps(color_weight, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(diff)), 4));
+							__m256 _w2 = _mm256_mul_ps(_sw, _mm256_i32gather_ps(color_weight, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(diff, 1)), 4));
+							if (isWeighted)
+							{
+								const float* wptrj = wptr + j + *wofs++;
+								_w1 = _mm256_mul_ps(_w1, _mm256_loadu_ps(wptrj));
+								_w2 = _mm256_mul_ps(_w2, _mm256_loadu_ps(wptrj + 8));
+							}
+
+							bval1 = _mm256_add_ps(bval1, _mm256_mul_ps(_w1, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bref))));
+							gval1 = _mm256_add_ps(gval1, _mm256_mul_ps(_w1, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(gref))));
+							rval1 = _mm256_add_ps(rval1, _mm256_mul_ps(_w1, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(rref))));
+							wval1 = _mm256_add_ps(wval1, _w1);
+
+							bval2 = _mm256_add_ps(bval2, _mm256_mul_ps(_w2, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(bref, 8)))));
+							gval2 = _mm256_add_ps(gval2, _mm256_mul_ps(_w2, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(gref, 8)))));
+							rval2 = _mm256_add_ps(rval2, _mm256_mul_ps(_w2, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(rref, 8)))));
+							wval2 = _mm256_add_ps(wval2, _w2);
+						}
+
+						wval1 = _mm256_div_ps(_mm256_set1_ps(1.f), wval1);
+						wval2 = _mm256_div_ps(_mm256_set1_ps(1.f), wval2);
+						const __m128i b = _mm256_cvtps_epu8x2(_mm256_mul_ps(bval1, wval1), _mm256_mul_ps(bval2, wval2));
+						const __m128i g = _mm256_cvtps_epu8x2(_mm256_mul_ps(gval1, wval1), _mm256_mul_ps(gval2, wval2));
+						const __m128i r = _mm256_cvtps_epu8x2(_mm256_mul_ps(rval1, wval1), _mm256_mul_ps(rval2, wval2));
+						_mm_storeu_bgr_epi8(dptr + 3 * j, b, g, r);
+					}
+				}
+			}
+		}
+	private:
+		const Mat *temp;
+		const Mat *weightMap;
+		Mat *dest;
+		int radiusH, radiusV, maxk, *space_ofs, *space_w_ofs;
+		float *space_weight, *color_weight;
+	};
+
+	class BilateralFilter_32f_InvokerAVX2 : public cv::ParallelLoopBody
+	{
+	public:
+		BilateralFilter_32f_InvokerAVX2(Mat& _dest, const Mat& _temp, const Mat* _weightMap, int _radiusH, int _radiusV, int _maxk,
+			int* _space_ofs, int* _space_w_ofs, float *_space_weight, float *_color_weight) :
+			temp(&_temp), weightMap(_weightMap), dest(&_dest), radiusH(_radiusH), radiusV(_radiusV),
+			maxk(_maxk), space_ofs(_space_ofs), space_w_ofs(_space_w_ofs), space_weight(_space_weight), color_weight(_color_weight)
+		{
+		}
+
+		virtual void operator() (const Range& range) const
+		{
+			int i, j, k;
+			const int cn = dest->channels();
+			const Size size = dest->size();
+			const __m256 v32f_absmask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+			const bool isWeighted = (weightMap != NULL);
+			const int wstep = (isWeighted) ? weightMap->cols : 0;
+			const float* wptr = (isWeighted) ? weightMap->ptr<float>(range.start + radiusV) + 8 * (radiusH / 8 + 1) : NULL;
+
+			if (cn == 1)
+			{
+				const float* sptr = temp->ptr<float>(range.start + radiusV) + 8 * (radiusH / 8 + 1);
+				float* dptr = dest->ptr<float>(range.start);
+
+				const int sstep = temp->cols;
+				const int dstep = dest->cols;
+
+				for (i = range.start; i != range.end; i++, dptr += dstep, sptr += sstep, wptr += wstep)
+				{
+					for (j = 0; j < size.width; j += 8)//8 pixel unit
+					{
+						const int* ofs = space_ofs;
+						const int* wofs = space_w_ofs;
+						const float* spw = space_weight;
+
+						const float* sptrj = sptr + j;
+						const __m256 sval0 = _mm256_loadu_ps(sptrj);
+
+						__m256 tval = _mm256_setzero_ps();
+						__m256 wval = _mm256_setzero_ps();
+
+						for (k = 0; k < maxk; k++, ofs++, spw++)
+						{
+							const __m256 sref = _mm256_loadu_ps(sptrj + *ofs);
+							const __m256i idx = _mm256_cvtps_epi32(_mm256_and_ps(_mm256_sub_ps(sval0, sref), v32f_absmask));
+							__m256 _w = _mm256_mul_ps(_mm256_set1_ps(*spw), _mm256_i32gather_ps(color_weight, idx, 4));
+							if (isWeighted) _w = _mm256_mul_ps(_w, _mm256_loadu_ps(wptr + j + *wofs++));
+
+							tval = _mm256_add_ps(tval, _mm256_mul_ps(_w, sref));
+							wval = _mm256_add_ps(wval, _w);
+						}
+						_mm256_storeu_ps(dptr + j, _mm256_div_ps(tval, wval));
+					}
+				}
+			}
+			else
+			{
+				const int sstep = 3 * temp->cols;
+				const int dstep = 3 * dest->cols;
+				const float* sptrb = temp->ptr<float>(3 * radiusV + 3 * range.start) + 8 * (radiusH / 8 + 1);
+				const float* sptrg = temp->ptr<float>(3 * radiusV + 3 * range.start + 1) + 8 * (radiusH / 8 + 1);
+				const float* sptrr = temp->ptr<float>(3 * radiusV + 3 * range.start + 2) + 8 * (radiusH / 8 + 1);
+				float* dptr = dest->ptr<float>(range.start);
+
+				for (i = range.start; i != range.end; i++, sptrr += sstep, sptrg += sstep, sptrb += sstep, dptr += dstep, wptr += wstep)
+				{
+					for (j = 0; j < size.width; j += 8)//8 pixel unit
+					{
+						const int* ofs = space_ofs;
+						const int* wofs = space_w_ofs;
+						const float* spw = space_weight;
+
+						const float* sptrbj = sptrb + j;
+						const float* sptrgj = sptrg + j;
+						const float* sptrrj = sptrr + j;
+
+						const __m256 bval = _mm256_loadu_ps(sptrbj);
+						const __m256 gval = _mm256_loadu_ps(sptrgj);
+						const __m256 rval = _mm256_loadu_ps(sptrrj);
+
+						__m256 wval1 = _mm256_setzero_ps();
+						__m256 bval1 = _mm256_setzero_ps();
+						__m256 gval1 = _mm256_setzero_ps();
+						__m256 rval1 = _mm256_setzero_ps();
+
+						for (k = 0; k < maxk; k++, ofs++, spw++)
+						{
+							const __m256 bref = _mm256_loadu_ps(sptrbj + *ofs);
+							const __m256 gref = _mm256_loadu_ps(sptrgj + *ofs);
+							const __m256 rref = _mm256_loadu_ps(sptrrj + *ofs);
+
+							const __m256i idx = _mm256_cvtps_epi32(
+								_mm256_add_ps(
+								_mm256_add_ps(
+								_mm256_and_ps(_mm256_sub_ps(bval, bref), v32f_absmask),
+								_mm256_and_ps(_mm256_sub_ps(gval, gref), v32f_absmask)),
+								_mm256_and_ps(_mm256_sub_ps(rval, rref), v32f_absmask)));
+
+							__m256 _w = _mm256_mul_ps(_mm256_set1_ps(*spw), _mm256_i32gather_ps(color_weight, idx, 4));
+							if (isWeighted) _w = _mm256_mul_ps(_w, _mm256_loadu_ps(wptr + j + *wofs++));
+
+							bval1 = _mm256_add_ps(bval1, _mm256_mul_ps(_w, bref));
+							gval1 = _mm256_add_ps(gval1, _mm256_mul_ps(_w, gref));
+							rval1 = _mm256_add_ps(rval1, _mm256_mul_ps(_w, rref));
+							wval1 = _mm256_add_ps(wval1, _w);
+						}
+
+						wval1 = _mm256_div_ps(_mm256_set1_ps(1.f), wval1);
+						_mm256_storeu_bgr_ps(dptr + 3 * j, _mm256_mul_ps(bval1, wval1), _mm256_mul_ps(gval1, wval1), _mm256_mul_ps(rval1, wval1));
+					}
+				}
+			}
+		}
+	private:
+		const Mat *temp;
+		const Mat *weightMap;
+		Mat *dest;
+		int radiusH, radiusV, maxk, *space_ofs, *space_w_ofs;
+		float *space_weight, *color_weight;
+	};
+
+	void bilateralFilter_8u_AVX2(Mat& dest, const Mat& temp, int radiusH, int radiusV, int maxk, int* space_ofs, float* space_weight, float* color_weight, int nstripes)
+	{
+		BilateralFilter_8u_InvokerAVX2 body(dest, temp, NULL, radiusH, radiusV, maxk, space_ofs, NULL, space_weight, color_weight);
+		parallel_for_(Range(0, dest.rows), body, nstripes);
+	}
+
+	void bilateralFilter_32f_AVX2(Mat& dest, const Mat& temp, int radiusH, int radiusV, int maxk, int* space_ofs, float* space_weight, float* color_weight)
+	{
+		BilateralFilter_32f_InvokerAVX2 body(dest, temp, NULL, radiusH, radiusV, maxk, space_ofs, NULL, space_weight, color_weight);
+		parallel_for_(Range(0, dest.rows), body);
+	}
+
+	void weightedBilateralFilter_8u_AVX2(Mat& dest, const Mat& temp, const Mat& weightMap, int radiusH, int radiusV, int maxk, int* space_ofs, int* space_w_ofs, float* space_weight, float* color_weight)
+	{
+		BilateralFilter_8u_InvokerAVX2 body(dest, temp, &weightMap, radiusH, radiusV, maxk, space_ofs, space_w_ofs, space_weight, color_weight);
+		parallel_for_(Range(0, dest.rows), body);
+	}
+
+	void weightedBilateralFilter_32f_AVX2(Mat& dest, const Mat& temp, const Mat& weightMap, int radiusH, int radiusV, int maxk, int* space_ofs, int* space_w_ofs, float* space_weight, float* color_weight)
+	{
+		BilateralFilter_32f_InvokerAVX2 body(dest, temp, &weightMap, radiusH, radiusV, maxk, space_ofs, space_w_ofs, space_weight, color_weight);
+		parallel_for_(Range(0, dest.rows), body);
+	}
+
+#else //compiled without AVX2 code generation
+
+	bool haveBilateralFilterAVX2()
+	{
+		return false;
+	}
+
+	void bilateralFilter_8u_AVX2(Mat& dest, const Mat& temp, int radiusH, int radiusV, int maxk, int* space_ofs, float* space_weight, float* color_weight, int nstripes)
+	{
+		CV_Error(Error::StsNotImplemented, "bilateralFilterAVX2.cpp is compiled without AVX2");
+	}
+
+	void bilateralFilter_32f_AVX2(Mat& dest, const Mat& temp, int radiusH, int radiusV, int maxk, int* space_ofs, float* space_weight, float* color_weight)
+	{
+		CV_Error(Error::StsNotImplemented, "bilateralFilterAVX2.cpp is compiled without AVX2");
+	}
+
+	void weightedBilateralFilter_8u_AVX2(Mat& dest, const Mat& temp, const Mat& weightMap, int radiusH, int radiusV, int maxk, int* space_ofs, int* space_w_ofs, float* space_weight, float* color_weight)
+	{
+		CV_Error(Error::StsNotImplemented, "bilateralFilterAVX2.cpp is compiled without AVX2");
+	}
+
+	void weightedBilateralFilter_32f_AVX2(Mat& dest, const Mat& temp, const Mat& weightMap, int radiusH, int radiusV, int maxk, int* space_ofs, int* space_w_ofs, float* space_weight, float* color_weight)
+	{
+		CV_Error(Error::StsNotImplemented, "bilateralFilterAVX2.cpp is compiled without AVX2");
+	}
+#endif
+}
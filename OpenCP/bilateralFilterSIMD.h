@@ -0,0 +1,27 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+namespace cp
+{
+	//wide vector kernels of bilateralFilter.cpp, which are selected at runtime.
+	//bilateralFilterAVX2.cpp and bilateralFilterAVX512.cpp are compiled with AVX2 and AVX-512F code generation, respectively.
+	//have*() returns false when the translation unit is compiled without the instruction set or the CPU does not support it,
+	//then the SSE4 invokers in bilateralFilter.cpp are used.
+
+	//8u kernels process 16 pixel units, which is the same padding as the SSE4 invokers.
+	//32f kernels process getBilateralFilterSIMDWidth() pixel units, so that the source/destination must be padded by this width.
+	int getBilateralFilterSIMDWidth();
+
+	bool haveBilateralFilterAVX2();
+	void bilateralFilter_8u_AVX2(cv::Mat& dest, const cv::Mat& temp, int radiusH, int radiusV, int maxk, int* space_ofs, float* space_weight, float* color_weight, int nstripes = -1);
+	void bilateralFilter_32f_AVX2(cv::Mat& dest, const cv::Mat& temp, int radiusH, int radiusV, int maxk, int* space_ofs, float* space_weight, float* color_weight);
+	void weightedBilateralFilter_8u_AVX2(cv::Mat& dest, const cv::Mat& temp, const cv::Mat& weightMap, int radiusH, int radiusV, int maxk, int* space_ofs, int* space_w_ofs, float* space_weight, float* color_weight);
+	void weightedBilateralFilter_32f_AVX2(cv::Mat& dest, const cv::Mat& temp, const cv::Mat& weightMap, int radiusH, int radiusV, int maxk, int* space_ofs, int* space_w_ofs, float* space_weight, float* color_weight);
+
+	bool haveBilateralFilterAVX512();
+	void bilateralFilter_8u_AVX512(cv::Mat& dest, const cv::Mat& temp, int radiusH, int radiusV, int maxk, int* space_ofs, float* space_weight, float* color_weight, int nstripes = -1);
+	void bilateralFilter_32f_AVX512(cv::Mat& dest, const cv::Mat& temp, int radiusH, int radiusV, int maxk, int* space_ofs, float* space_weight, float* color_weight);
+	void weightedBilateralFilter_8u_AVX512(cv::Mat& dest, const cv::Mat& temp, const cv::Mat& weightMap, int radiusH, int radiusV, int maxk, int* space_ofs, int* space_w_ofs, float* space_weight, float* color_weight);
+	void weightedBilateralFilter_32f_AVX512(cv::Mat& dest, const cv::Mat& temp, const cv::Mat& weightMap, int radiusH, int radiusV, int maxk, int* space_ofs, int* space_w_ofs, float* space_weight, float* color_weight);
+}
@@ -0,0 +1,424 @@
+#include "opencp.hpp"
+
+using namespace std;
+using namespace cv;
+
+void dct4x4_llm_sse(float* a, float* b, float* temp, int flag);
+void fDCT8x8_32f(const float* s, float* d, float* temp);
+void iDCT8x8_32f(const float* s, float* d, float* temp);
+
+namespace cp
+{
+	//sum of squared differences of 4x4 and 8x8 patches
+	inline float patchSSD4x4_SSE(const float* a, const float* b, const int step)
+	{
+		__m128 ms = _mm_setzero_ps();
+		for (int j = 0; j < 4; j++)
+		{
+			__m128 d = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+			ms = _mm_add_ps(ms, _mm_mul_ps(d, d));
+			a += step;
+			b += step;
+		}
+		ms = _mm_hadd_ps(ms, ms);
+		ms = _mm_hadd_ps(ms, ms);
+		return _mm_cvtss_f32(ms);
+	}
+
+	inline float patchSSD8x8_SSE(const float* a, const float* b, const int step)
+	{
+		__m128 ms0 = _mm_setzero_ps();
+		__m128 ms1 = _mm_setzero_ps();
+		for (int j = 0; j < 8; j++)
+		{
+			__m128 d0 = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+			__m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + 4), _mm_loadu_ps(b + 4));
+			ms0 = _mm_add_ps(ms0, _mm_mul_ps(d0, d0));
+			ms1 = _mm_add_ps(ms1, _mm_mul_ps(d1, d1));
+			a += step;
+			b += step;
+		}
+		ms0 = _mm_add_ps(ms0, ms1);
+		ms0 = _mm_hadd_ps(ms0, ms0);
+		ms0 = _mm_hadd_ps(ms0, ms0);
+		return _mm_cvtss_f32(ms0);
+	}
+
+	//normalized Walsh-Hadamard transform across the group of n patches (n is a power of 2), which is the inverse of itself
+	inline void groupHadamard(float* group, const int n, const int patch_area)
+	{
+		const __m128 mnorm = _mm_set1_ps(0.70710678f);
+		for (int h = 1; h < n; h <<= 1)
+		{
+			for (int k = 0; k < n; k += 2 * h)
+			{
+				for (int l = k; l < k + h; l++)
+				{
+					float* a = group + patch_area * l;
+					float* b = group + patch_area * (l + h);
+					for (int i = 0; i < patch_area; i += 4)
+					{
+						const __m128 ma = _mm_load_ps(a + i);
+						const __m128 mb = _mm_load_ps(b + i);
+						_mm_store_ps(a + i, _mm_mul_ps(_mm_add_ps(ma, mb), mnorm));
+						_mm_store_ps(b + i, _mm_mul_ps(_mm_sub_ps(ma, mb), mnorm));
+					}
+				}
+			}
+		}
+	}
+
+	//2D DCT of the n patches in the group
+	inline void groupDCT(float* group, const int n, const int patch_size, float* temp, const bool isForward)
+	{
+		const int patch_area = patch_size * patch_size;
+		for (int l = 0; l < n; l++)
+		{
+			float* p = group + patch_area * l;
+			if (patch_size == 4)
+			{
+				dct4x4_llm_sse(p, temp + 64, temp, (isForward) ? 0 : 1);
+				memcpy(p, temp + 64, sizeof(float) * 16);
+			}
+			else
+			{
+				if (isForward) fDCT8x8_32f(p, temp + 64, temp);
+				else iDCT8x8_32f(p, temp + 64, temp);
+				memcpy(p, temp + 64, sizeof(float) * 64);
+			}
+		}
+	}
+
+	//accumulation buffers of a row band; the bands of stripes overlap by the search range and are summed after the parallel loop
+	struct BM3DBand
+	{
+		int y;
+		std::vector<Mat> numer;
+		Mat denom;
+		int groups;//number of the groups and the sum of their sizes
+		double groupSizeSum;
+	};
+
+	//one stage of BM3D parallelized over the rows of reference blocks.
+	//the groups are matched on channel 0 of match (the noisy image for the hard thresholding, the basic estimate for the Wiener filtering).
+	class BM3DStage_Invoker : public cv::ParallelLoopBody
+	{
+		const vector<Mat>* noisy;
+		const vector<Mat>* pilot;//NULL for the hard thresholding stage
+		const vector<int>* refy;
+		const vector<int>* refx;
+		vector<BM3DBand>* bands;
+		const float* kaiser;
+		int patch_size;
+		int search_range;
+		int max_group;
+		float match_thresh;
+		float sigma;
+		float thresh;
+		int nstripes;
+
+	public:
+		BM3DStage_Invoker(const vector<Mat>& noisy_, const vector<Mat>* pilot_, const vector<int>& refy_, const vector<int>& refx_, vector<BM3DBand>& bands_, const float* kaiser_,
+			int patch_size_, int search_range_, int max_group_, float match_thresh_, float sigma_, float thresh_, int nstripes_) :
+			noisy(&noisy_), pilot(pilot_), refy(&refy_), refx(&refx_), bands(&bands_), kaiser(kaiser_),
+			patch_size(patch_size_), search_range(search_range_), max_group(max_group_), match_thresh(match_thresh_), sigma(sigma_), thresh(thresh_), nstripes(nstripes_)
+		{
+		}
+
+		void operator()(const Range& range) const
+		{
+			const int cn = (int)noisy->size();
+			const int width = (*noisy)[0].cols;
+			const int height = (*noisy)[0].rows;
+			const int step = (int)((*noisy)[0].step / sizeof(float));
+			const int ps = patch_size;
+			const int patch_area = ps * ps;
+			const bool isWiener = pilot != NULL;
+			const vector<Mat>& match = (isWiener) ? *pilot : *noisy;
+			const float* m0 = match[0].ptr<float>(0);
+			const float dth = match_thresh * patch_area;
+			const float sigma2 = sigma * sigma;
+
+			vector<pair<float, int> > cand;
+			cand.reserve((2 * search_range + 1) * (2 * search_range + 1));
+			AutoBuffer<float> group_buf(max_group * patch_area * cn + 4);
+			AutoBuffer<float> pilot_buf(max_group * patch_area * cn + 4);
+			AutoBuffer<float> temp_buf(128 + 4);
+			float* group = alignPtr((float*)group_buf, 16);
+			float* group_pilot = alignPtr((float*)pilot_buf, 16);
+			float* temp = alignPtr((float*)temp_buf, 16);
+
+			for (int n = range.start; n < range.end; n++)
+			{
+				BM3DBand& band = (*bands)[n];
+				const int r0 = (int)refy->size() * n / nstripes;
+				const int r1 = (int)refy->size() * (n + 1) / nstripes;
+
+				for (int r = r0; r < r1; r++)
+				{
+					const int y = (*refy)[r];
+					const int sy0 = max(0, y - search_range);
+					const int sy1 = min(height - ps, y + search_range);
+
+					for (int c = 0; c < (int)refx->size(); c++)
+					{
+						const int x = (*refx)[c];
+						const int sx0 = max(0, x - search_range);
+						const int sx1 = min(width - ps, x + search_range);
+						const float* ref = m0 + step * y + x;
+
+						//block matching; the reference block is always the first of the group, so that every pixel is covered
+						cand.clear();
+						cand.push_back(make_pair(0.f, step * y + x));
+						for (int j = sy0; j <= sy1; j++)
+						{
+							const float* s = m0 + step * j;
+							if (ps == 4)
+							{
+								for (int i = sx0; i <= sx1; i++)
+								{
+									const float d = patchSSD4x4_SSE(ref, s + i, step);
+									if (d <= dth && (i != x || j != y)) cand.push_back(make_pair(d, step * j + i));
+								}
+							}
+							else
+							{
+								for (int i = sx0; i <= sx1; i++)
+								{
+									const float d = patchSSD8x8_SSE(ref, s + i, step);
+									if (d <= dth && (i != x || j != y)) cand.push_back(make_pair(d, step * j + i));
+								}
+							}
+						}
+						int gsize = min((int)cand.size(), max_group);
+						partial_sort(cand.begin() + 1, cand.begin() + gsize, cand.end());
+						int g = 1;
+						while (2 * g <= gsize) g <<= 1;
+						gsize = g;
+						band.groups++;
+						band.groupSizeSum += gsize;
+
+						//grouping
+						for (int ch = 0; ch < cn; ch++)
+						{
+							const float* sn = (*noisy)[ch].ptr<float>(0);
+							const float* sp = (isWiener) ? (*pilot)[ch].ptr<float>(0) : NULL;
+							for (int l = 0; l < gsize; l++)
+							{
+								float* d = group + (ch * max_group + l) * patch_area;
+								float* dp = group_pilot + (ch * max_group + l) * patch_area;
+								for (int j = 0; j < ps; j++)
+								{
+									memcpy(d + ps * j, sn + cand[l].second + step * j, sizeof(float) * ps);
+									if (isWiener) memcpy(dp + ps * j, sp + cand[l].second + step * j, sizeof(float) * ps);
+								}
+							}
+						}
+
+						//3D transform, shrinkage and inverse transform
+						float wsum = 0.f;
+						for (int ch = 0; ch < cn; ch++)
+						{
+							float* gr = group + ch * max_group * patch_area;
+							groupDCT(gr, gsize, ps, temp, true);
+							groupHadamard(gr, gsize, patch_area);
+
+							const int size = gsize * patch_area;
+							if (!isWiener)
+							{
+								const __m128 mth = _mm_set1_ps(thresh);
+								const __m128 mabs = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+								//the mask is -1 as an integer, so subtracting it counts the retained coefficients
+								__m128i mcount = _mm_setzero_si128();
+								for (int i = 0; i < size; i += 4)
+								{
+									const __m128 v = _mm_load_ps(gr + i);
+									const __m128 msk = _mm_cmpgt_ps(_mm_and_ps(v, mabs), mth);
+									_mm_store_ps(gr + i, _mm_and_ps(v, msk));
+									mcount = _mm_sub_epi32(mcount, _mm_castps_si128(msk));
+								}
+								mcount = _mm_hadd_epi32(mcount, mcount);
+								mcount = _mm_hadd_epi32(mcount, mcount);
+								wsum += (float)_mm_cvtsi128_si32(mcount);
+							}
+							else
+							{
+								float* gp = group_pilot + ch * max_group * patch_area;
+								groupDCT(gp, gsize, ps, temp, true);
+								groupHadamard(gp, gsize, patch_area);
+
+								const __m128 ms2 = _mm_set1_ps(sigma2);
+								__m128 mw2 = _mm_setzero_ps();
+								for (int i = 0; i < size; i += 4)
+								{
+									const __m128 b = _mm_load_ps(gp + i);
+									const __m128 b2 = _mm_mul_ps(b, b);
+									const __m128 w = _mm_div_ps(b2, _mm_add_ps(b2, ms2));
+									_mm_store_ps(gr + i, _mm_mul_ps(_mm_load_ps(gr + i), w));
+									mw2 = _mm_add_ps(mw2, _mm_mul_ps(w, w));
+								}
+								mw2 = _mm_hadd_ps(mw2, mw2);
+								mw2 = _mm_hadd_ps(mw2, mw2);
+								wsum += _mm_cvtss_f32(mw2);
+							}
+
+							groupHadamard(gr, gsize, patch_area);
+							groupDCT(gr, gsize, ps, temp, false);
+						}
+
+						//aggregation with the weight of the group and the Kaiser window
+						const float weight = (wsum > 0.f) ? 1.f / (sigma2 * wsum) : 1.f;
+						const __m128 mw = _mm_set1_ps(weight);
+						for (int l = 0; l < gsize; l++)
+						{
+							const int py = cand[l].second / step - band.y;
+							const int px = cand[l].second % step;
+							for (int j = 0; j < ps; j++)
+							{
+								float* dw = band.denom.ptr<float>(py + j) + px;
+								for (int i = 0; i < ps; i += 4)
+								{
+									const __m128 mk = _mm_mul_ps(mw, _mm_loadu_ps(kaiser + ps * j + i));
+									_mm_storeu_ps(dw + i, _mm_add_ps(_mm_loadu_ps(dw + i), mk));
+									for (int ch = 0; ch < cn; ch++)
+									{
+										const float* gr = group + (ch * max_group + l) * patch_area + ps * j;
+										float* dn = band.numer[ch].ptr<float>(py + j) + px;
+										_mm_storeu_ps(dn + i, _mm_add_ps(_mm_loadu_ps(dn + i), _mm_mul_ps(mk, _mm_load_ps(gr + i))));
+									}
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	};
+
+	DenoiseBM3D::DenoiseBM3D()
+	{
+		searchWindowSize = 39;
+		step = 3;
+		maxGroupSizeHT = 16;
+		maxGroupSizeWiener = 32;
+		matchThresholdHT = 2500.f;
+		matchThresholdWiener = 400.f;
+		lambda3D = 2.7f;
+		isWiener = true;
+		meanGroupSizeHT = 0.f;
+		meanGroupSizeWiener = 0.f;
+	}
+
+	float DenoiseBM3D::stage(const vector<Mat>& noisy, const vector<Mat>* pilot, vector<Mat>& dest, float sigma)
+	{
+		const int cn = (int)noisy.size();
+		const int width = noisy[0].cols;
+		const int height = noisy[0].rows;
+		const int ps = patch_size.width;
+		const int search_range = searchWindowSize / 2;
+		const bool isW = pilot != NULL;
+		const int max_group = max(1, min((isW) ? maxGroupSizeWiener : maxGroupSizeHT, 64));
+		//the noisy patches of a high noise level are matched with the doubled threshold
+		const float match_thresh = (isW) ? matchThresholdWiener : ((sigma > 40.f) ? 2.f * matchThresholdHT : matchThresholdHT);
+
+		//the last row and column are always references, so that every pixel is covered
+		vector<int> refy, refx;
+		for (int j = 0; j < height - ps; j += step) refy.push_back(j);
+		refy.push_back(height - ps);
+		for (int i = 0; i < width - ps; i += step) refx.push_back(i);
+		refx.push_back(width - ps);
+
+		const int nstripes = max(1, min((int)refy.size(), getNumThreads()));
+		vector<BM3DBand> bands(nstripes);
+		for (int n = 0; n < nstripes; n++)
+		{
+			const int r0 = (int)refy.size() * n / nstripes;
+			const int r1 = (int)refy.size() * (n + 1) / nstripes;
+			const int y0 = max(0, refy[r0] - search_range);
+			const int y1 = min(height, refy[r1 - 1] + search_range + ps);
+			bands[n].y = y0;
+			bands[n].numer.resize(cn);
+			for (int c = 0; c < cn; c++) bands[n].numer[c] = Mat::zeros(y1 - y0, width, CV_32F);
+			bands[n].denom = Mat::zeros(y1 - y0, width, CV_32F);
+			bands[n].groups = 0;
+			bands[n].groupSizeSum = 0.0;
+		}
+
+		BM3DStage_Invoker invoker(noisy, pilot, refy, refx, bands, kaiser.ptr<float>(0), ps, search_range, max_group, match_thresh, sigma, lambda3D * sigma, nstripes);
+		parallel_for_(Range(0, nstripes), invoker);
+
+		Mat denom = Mat::zeros(height, width, CV_32F);
+		dest.resize(cn);
+		for (int c = 0; c < cn; c++) dest[c] = Mat::zeros(height, width, CV_32F);
+		int groups = 0;
+		double groupSizeSum = 0.0;
+		for (int n = 0; n < nstripes; n++)
+		{
+			const Rect roi(0, bands[n].y, width, bands[n].denom.rows);
+			denom(roi) += bands[n].denom;
+			for (int c = 0; c < cn; c++) dest[c](roi) += bands[n].numer[c];
+			groups += bands[n].groups;
+			groupSizeSum += bands[n].groupSizeSum;
+		}
+		for (int c = 0; c < cn; c++) divide(dest[c], denom, dest[c]);
+		return (groups > 0) ? (float)(groupSizeSum / groups) : 0.f;
+	}
+
+	void DenoiseBM3D::operator()(const Mat& src, Mat& dest, float sigma, Size psize)
+	{
+		CV_Assert(src.channels() == 1 || src.channels() == 3);
+		CV_Assert(psize.width == psize.height && (psize.width == 4 || psize.width == 8));
+		CV_Assert(src.cols >= psize.width && src.rows >= psize.height);
+		CV_Assert(step >= 1 && searchWindowSize >= 1);
+
+		if (psize != patch_size)
+		{
+			//separable Kaiser window (beta=2)
+			patch_size = psize;
+			const int ps = psize.width;
+			vector<float> k1(ps);
+			const double beta = 2.0;
+			for (int i = 0; i < ps; i++)
+			{
+				const double t = 2.0 * i / (ps - 1) - 1.0;
+				const double x = beta * sqrt(1.0 - t * t);
+				double v = 1.0, term = 1.0;
+				for (int m = 1; m < 20; m++)
+				{
+					term *= (x / (2.0 * m)) * (x / (2.0 * m));
+					v += term;
+				}
+				k1[i] = (float)v;
+			}
+			kaiser.create(ps, ps, CV_32F);
+			for (int j = 0; j < ps; j++)
+			{
+				for (int i = 0; i < ps; i++) kaiser.at<float>(j, i) = k1[j] * k1[i];
+			}
+		}
+
+		Mat srcf;
+		src.convertTo(srcf, CV_32F);
+		//orthonormal color decorrelation keeps the noise level of each channel
+		const Matx33f decorrelate(
+			0.57735f, 0.57735f, 0.57735f,
+			0.707107f, 0.f, -0.707107f,
+			0.408248f, -0.816497f, 0.408248f);
+		if (src.channels() == 3) transform(srcf, srcf, decorrelate);
+		split(srcf, noisy);
+
+		meanGroupSizeHT = stage(noisy, NULL, basic, sigma);
+		if (isWiener) meanGroupSizeWiener = stage(noisy, &basic, wiener, sigma);
+		else
+		{
+			meanGroupSizeWiener = 0.f;
+			wiener.resize(basic.size());
+			for (int c = 0; c < (int)basic.size(); c++) wiener[c] = basic[c];
+		}
+
+		Mat dst;
+		merge(wiener, dst);
+		if (src.channels() == 3) transform(dst, dst, decorrelate.t());
+		dst.convertTo(dest, src.type());
+	}
+}
@@ -48,94 +48,96 @@ namespace cp
 		const int step = src.size().width;
 
 
-#pragma omp parallel for
-		for (int i = 0; i < src.size().height; i++)
+		parallelFor(Range(0, src.size().height), [&](const Range& range)
 		{
-			T* jptr = sim.ptr<T>(i + radiush); jptr += radiusw;
-			T* dst = dest.ptr<T>(i);
-			T* sr = (T*)src.ptr<T>(i);
-			for (int j = 0; j < src.cols; j++)
+			for (int i = range.start; i < range.end; i++)
 			{
-				T val0 = sr[j];
-
-				vector<BRFData<T>> rdata(0);
-				for (int k = 0; k < maxk; k++)
+				T* jptr = sim.ptr<T>(i + radiush); jptr += radiusw;
+				T* dst = dest.ptr<T>(i);
+				T* sr = (T*)src.ptr<T>(i);
+				for (int j = 0; j < src.cols; j++)
 				{
-					const T val = jptr[j + space_ofs_before[k]];
+					T val0 = sr[j];
 
-					bool flag = true;
-					for (int n = 0; n < (int)rdata.size(); n++)
+					vector<BRFData<T>> rdata(0);
+					for (int k = 0; k < maxk; k++)
 					{
-						if (val == rdata[n].val)
+						const T val = jptr[j + space_ofs_before[k]];
+
+						bool flag = true;
+						for (int n = 0; n < (int)rdata.size(); n++)
 						{
-							flag = false;
-							rdata[n].count++;
-							rdata[n].distance += space_dist[k];
-							break;
+							if (val == rdata[n].val)
+							{
+								flag = false;
+								rdata[n].count++;
+								rdata[n].distance += space_dist[k];
+								break;
+							}
 						}
-					}
-					if (flag)
-					{
-						BRFData<T> rd;
-						rd.count = 1;
-						rd.distance = space_dist[k];
-						rd.val = val;
+						if (flag)
+						{
+							BRFData<T> rd;
+							rd.count = 1;
+							rd.distance = space_dist[k];
+							rd.val = val;
 
-						rdata.push_back(rd);
+							rdata.push_back(rd);
+						}
 					}
-				}
-
-				if (rdata.size() == 1)
-				{
-					dst[j] = rdata[0].val;
-					continue;
-				}
 
-				float maxDis = 0.f;
-				float minDis = FLT_MAX;
-				int maxOcc = 0;
-				int minOcc = maxk;
+					if (rdata.size() == 1)
+					{
+						dst[j] = rdata[0].val;
+						continue;
+					}
 
-				T maxDiff = 0;
-				T minDiff = 255;
-				for (int n = 0; n < (int)rdata.size(); n++)
-				{
-					rdata[n].distance = (float)(rdata[n].distance / (double)rdata[n].count);
-					rdata[n].sub = (float)abs(rdata[n].val - val0);
-					maxDis = std::max<float>(rdata[n].distance, maxDis);
-					minDis = std::min<float>(rdata[n].distance, minDis);
-					maxOcc = std::max<int>(rdata[n].count, maxOcc);
-					minOcc = std::min<int>(rdata[n].count, minOcc);
-					maxDiff = std::max<T>((T)abs(rdata[n].sub), maxDiff);
-					minDiff = std::min<T>((T)abs(rdata[n].sub), minDiff);
-				}
+					float maxDis = 0.f;
+					float minDis = FLT_MAX;
+					int maxOcc = 0;
+					int minOcc = maxk;
 
-				float divOcc = (maxOcc == minOcc) ? 0.00000001f : 1.0f / (float)(maxOcc - minOcc);
-				float divDiff = (maxDiff == minDiff) ? 0.00000001f : 1.0f / (float)(maxDiff - minDiff);
-				float divDis = (maxDis == minDis) ? 0.00000001f : 1.0f / (float)(maxDis - minDis);
+					T maxDiff = 0;
+					T minDiff = 255;
+					for (int n = 0; n < (int)rdata.size(); n++)
+					{
+						rdata[n].distance = (float)(rdata[n].distance / (double)rdata[n].count);
+						rdata[n].sub = (float)abs(rdata[n].val - val0);
+						maxDis = std::max<float>(rdata[n].distance, maxDis);
+						minDis = std::min<float>(rdata[n].distance, minDis);
+						maxOcc = std::max<int>(rdata[n].count, maxOcc);
+						minOcc = std::min<int>(rdata[n].count, minOcc);
+						maxDiff = std::max<T>((T)abs(rdata[n].sub), maxDiff);
+						minDiff = std::min<T>((T)abs(rdata[n].sub), minDiff);
+					}
 
+					float divOcc = (maxOcc == minOcc) ? 0.00000001f : 1.0f / (float)(maxOcc - minOcc);
+					float divDiff = (maxDiff == minDiff) ? 0.00000001f : 1.0f / (float)(maxDiff - minDiff);
+					float divDis = (maxDis == minDis) ? 0.00000001f : 1.0f / (float)(maxDis - minDis);
 
-				float maxE = 0.f;
-				T mind = val0;
 
-				for (int n = 0; n < (int)rdata.size(); n++)
-				{
-					float J = frec*(rdata[n].count - minOcc)*divOcc;
-					J += color*((float)maxDiff - rdata[n].sub)*divDiff;
-					J += space*(maxDis - rdata[n].distance)*divDis;
+					float maxE = 0.f;
+					T mind = val0;
 
-					if (J > maxE)
+					for (int n = 0; n < (int)rdata.size(); n++)
 					{
-						maxE = J;
-						mind = rdata[n].val;
+						float J = frec*(rdata[n].count - minOcc)*divOcc;
+						J += color*((float)maxDiff - rdata[n].sub)*divDiff;
+						J += space*(maxDis - rdata[n].distance)*divDis;
+
+						if (J > maxE)
+						{
+							maxE = J;
+							mind = rdata[n].val;
+						}
 					}
+					dst[j] = mind;
 				}
-				dst[j] = mind;
+				jptr += steps;
+				dst += step;
+				sr += step;
 			}
-			jptr += steps;
-			dst += step;
-			sr += step;
-		}
+		});
 	}
 
 	void boundaryReconstructionFilter(InputArray src, OutputArray dest, Size ksize, const float frec, const float color, const float space)
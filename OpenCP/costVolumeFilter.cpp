@@ -1152,6 +1152,340 @@ CostVolumeRefinement::CostVolumeRefinement(int disparitymin, int disparity_range
 	numDisparity = disparity_range;
 	dsv.resize(disparity_range + 1);
 	dsv2.resize(disparity_range + 1);
+	volumeDepth = VOLUME_TYPE;
+	quantScale = 1.f;
+}
+
+//interleaved cost volume: vol(y, x*cn + i) is the cost of the disparity minDisparity + i of the pixel x, and cn = numDisparity + 1
+template <typename T>
+static void buildCostVolumeInterleaved_(const Mat& disp, Mat& vol, const int minDisparity, const int cn, const vector<float>& lut)
+{
+	const int L = (int)lut.size() - 1;
+	for (int y = 0; y < disp.rows; y++)
+	{
+		const short* d = disp.ptr<short>(y);
+		T* v = vol.ptr<T>(y);
+		for (int x = 0; x < disp.cols; x++, v += cn)
+		{
+			for (int i = 0; i < cn; i++)
+			{
+				v[i] = saturate_cast<T>(lut[min(abs(minDisparity + i - d[x]), L)]);
+			}
+		}
+	}
+}
+
+void CostVolumeRefinement::buildCostVolume(Mat& disp, int dtrunc, int metric, Mat& vol)
+{
+	CV_Assert(volumeDepth == CV_8U || volumeDepth == CV_16U);
+	Mat disps;
+	if (disp.depth() == CV_16S)disps = disp;
+	else disp.convertTo(disps, CV_16S);
+
+	//the costs are scaled into the range of the depth when they are larger than it, and the scale is kept in quantScale
+	const float maxv = (volumeDepth == CV_8U) ? 255.f : 65535.f;
+	const int L = (metric == EXP) ? 255 : dtrunc;
+	vector<float> lut(L + 1);
+	if (metric == EXP)
+	{
+		const double coeff = -0.5 / (dtrunc*dtrunc);
+		for (int i = 0; i <= L; i++)
+		{
+			lut[i] = 1.f - (float)std::exp(i*i*coeff);
+			if (lut[i] < 1.0 / 255.0)lut[i] = 0.f;
+		}
+		quantScale = maxv;
+	}
+	else
+	{
+		for (int i = 0; i <= L; i++) lut[i] = (metric == L1_NORM) ? (float)i : (float)(i*i);
+		quantScale = min(1.f, maxv / max(lut[L], 1.f));
+	}
+	for (int i = 0; i <= L; i++) lut[i] = (float)cvRound(lut[i] * quantScale);
+
+	const int cn = numDisparity + 1;
+	vol.create(disp.rows, disp.cols*cn, volumeDepth);
+	if (volumeDepth == CV_8U) buildCostVolumeInterleaved_<uchar>(disps, vol, minDisparity, cn, lut);
+	else buildCostVolumeInterleaved_<ushort>(disps, vol, minDisparity, cn, lut);
+}
+
+//8 costs as 16-bit integers
+static inline __m128i loadCost8(const uchar* s)
+{
+	return _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)s));
+}
+static inline __m128i loadCost8(const ushort* s)
+{
+	return _mm_loadu_si128((const __m128i*)s);
+}
+
+template <typename T>
+static void wtaInterleaved_(const Mat& vol, Mat& dest, const int minDisparity, const int cn)
+{
+	for (int y = 0; y < dest.rows; y++)
+	{
+		const T* v = vol.ptr<T>(y);
+		short* dst = dest.ptr<short>(y);
+		for (int x = 0; x < dest.cols; x++, v += cn)
+		{
+			//the first minimum as wta of the planes
+			int mine = INT_MAX;
+			int minv = 0;
+			int i = 0;
+			for (; i <= cn - 8; i += 8)
+			{
+				const int r = _mm_cvtsi128_si32(_mm_minpos_epu16(loadCost8(v + i)));
+				if ((r & 0xffff) < mine)
+				{
+					mine = r & 0xffff;
+					minv = i + (r >> 16);
+				}
+			}
+			for (; i < cn; i++)
+			{
+				if (v[i] < mine)
+				{
+					mine = v[i];
+					minv = i;
+				}
+			}
+			dst[x] = (short)(minv + minDisparity);
+		}
+	}
+}
+
+void CostVolumeRefinement::wta(const Mat& vol, Mat& dest)
+{
+	const int cn = numDisparity + 1;
+	CV_Assert(vol.cols == dest.cols*cn && vol.rows == dest.rows);
+	if (vol.depth() == CV_8U) wtaInterleaved_<uchar>(vol, dest, minDisparity, cn);
+	else wtaInterleaved_<ushort>(vol, dest, minDisparity, cn);
+}
+
+template <typename T>
+static void subpixelInterleaved_(const Mat& vol, Mat& dest, const int method, const int minDisparity, const int numDisparity)
+{
+	const int cn = numDisparity + 1;
+	for (int y = 0; y < dest.rows; y++)
+	{
+		const T* v = vol.ptr<T>(y);
+		short* disp = dest.ptr<short>(y);
+		for (int x = 0; x < dest.cols; x++, v += cn)
+		{
+			const short d = disp[x];
+			const int l = d - minDisparity;
+			if (l<1 || l>numDisparity - 2)
+			{
+				disp[x] = 16 * d;
+			}
+			else if (method == CostVolumeRefinement::SUBPIXEL_QUAD)
+			{
+				const float f = v[l];
+				const float p = v[l + 1];
+				const float m = v[l - 1];
+				const float md = ((p + m - (f*2.f))*2.f);
+				disp[x] = (md != 0) ? (short)(16.f*((float)d - (p - m) / md) + 0.5f) : 16 * d;
+			}
+			else
+			{
+				const double m1 = v[l];
+				const double m3 = v[l + 1];
+				const double m2 = v[l - 1];
+				const double m31 = m3 - m1;
+				const double m21 = m2 - m1;
+				double md;
+				if (m2 > m3) md = 0.5 - 0.25*((m31*m31) / (m21*m21) + m31 / m21);
+				else md = -(0.5 - 0.25*((m21*m21) / (m31*m31) + m21 / m31));
+				disp[x] = (short)(16.0*((double)d + md) + 0.5);
+			}
+		}
+	}
+}
+
+void CostVolumeRefinement::subpixelInterpolation(const Mat& vol, Mat& dest, int method)
+{
+	if (method == SUBPIXEL_NONE)
+	{
+		dest *= 16;
+		return;
+	}
+	if (vol.depth() == CV_8U) subpixelInterleaved_<uchar>(vol, dest, method, minDisparity, numDisparity);
+	else subpixelInterleaved_<ushort>(vol, dest, method, minDisparity, numDisparity);
+}
+
+//separable filter of the interleaved volume with the replicated border; the stripe s filters its rows through a ring of the horizontally filtered rows
+template <typename T>
+class separableFilterInterleaved_Invoker : public cv::ParallelLoopBody
+{
+public:
+	separableFilterInterleaved_Invoker(const Mat& _src, Mat& _dest, const int _cn, const vector<float>& _kernel, const int _stripes) :
+		src(&_src), dest(&_dest), cn(_cn), kernel(&_kernel), stripes(_stripes)
+	{
+		;
+	}
+
+	virtual void operator() (const Range& range) const
+	{
+		const int r = (int)kernel->size() / 2;
+		const int ksize = 2 * r + 1;
+		const int width = src->cols / cn;
+		const int height = src->rows;
+		const float* k = &(*kernel)[0];
+		const int cols = src->cols;
+		const int offset = ksize * (r + 1);//for the negative rows
+		Mat ring(ksize, cols, CV_32F);
+		vector<float> acc(cols);
+		for (int s = range.start; s < range.end; s++)
+		{
+			const int y0 = height * s / stripes;
+			const int y1 = height * (s + 1) / stripes;
+			for (int y = y0 - r; y < y0 + r; y++) filterRow(y, ring.ptr<float>((y + offset) % ksize), width, r, k);
+			for (int y = y0; y < y1; y++)
+			{
+				filterRow(y + r, ring.ptr<float>((y + r + offset) % ksize), width, r, k);
+				for (int i = 0; i < cols; i++) acc[i] = 0.f;
+				for (int n = -r; n <= r; n++)
+				{
+					const float* h = ring.ptr<float>((y + n + offset) % ksize);
+					const float w = k[n + r];
+					for (int i = 0; i < cols; i++) acc[i] += w*h[i];
+				}
+				T* d = dest->ptr<T>(y);
+				for (int i = 0; i < cols; i++) d[i] = saturate_cast<T>(acc[i]);
+			}
+		}
+	}
+private:
+	void filterRow(const int y, float* dst, const int width, const int r, const float* k) const
+	{
+		const T* sp = src->ptr<T>(std::max(0, std::min(y, src->rows - 1)));
+		for (int x = 0; x < width; x++)
+		{
+			float* o = dst + x*cn;
+			for (int i = 0; i < cn; i++) o[i] = 0.f;
+			for (int n = -r; n <= r; n++)
+			{
+				const T* q = sp + std::max(0, std::min(x + n, width - 1))*cn;
+				const float w = k[n + r];
+				for (int i = 0; i < cn; i++) o[i] += w*q[i];
+			}
+		}
+	}
+
+	const Mat* src;
+	Mat* dest;
+	const int cn;
+	const vector<float>* kernel;
+	const int stripes;
+};
+
+static void separableFilterInterleaved(const Mat& src, Mat& dest, const int cn, const vector<float>& kernel)
+{
+	Mat dst(src.size(), src.type());
+	const int stripes = max(1, min(getNumThreads(), src.rows));
+	if (src.depth() == CV_8U)
+	{
+		separableFilterInterleaved_Invoker<uchar> body(src, dst, cn, kernel, stripes);
+		parallel_for_(Range(0, stripes), body, stripes);
+	}
+	else
+	{
+		separableFilterInterleaved_Invoker<ushort> body(src, dst, cn, kernel, stripes);
+		parallel_for_(Range(0, stripes), body, stripes);
+	}
+	dest = dst;
+}
+
+//joint bilateral filter of the interleaved volume: the weights of a neighbor are computed once and applied to all the costs of the pixel
+template <typename T>
+class jointBilateralInterleaved_Invoker : public cv::ParallelLoopBody
+{
+public:
+	jointBilateralInterleaved_Invoker(const Mat& _src, const Mat& _guide, Mat& _dest, const int _cn, const int _r, const float* _space_weight, const float* _color_weight) :
+		src(&_src), guide(&_guide), dest(&_dest), cn(_cn), r(_r), space_weight(_space_weight), color_weight(_color_weight)
+	{
+		;
+	}
+
+	virtual void operator() (const Range& range) const
+	{
+		const int width = guide->cols;
+		const int height = guide->rows;
+		const int gc = guide->channels();
+		vector<float> acc(cn);
+		for (int y = range.start; y < range.end; y++)
+		{
+			T* d = dest->ptr<T>(y);
+			const uchar* g0 = guide->ptr<uchar>(y);
+			for (int x = 0; x < width; x++)
+			{
+				for (int i = 0; i < cn; i++) acc[i] = 0.f;
+				float wsum = 0.f;
+				const float* spw = space_weight;
+				for (int m = -r; m <= r; m++)
+				{
+					const int ys = std::max(0, std::min(y + m, height - 1));
+					const uchar* g = guide->ptr<uchar>(ys);
+					const T* s = src->ptr<T>(ys);
+					for (int n = -r; n <= r; n++, spw++)
+					{
+						if (*spw == 0.f) continue;
+						const int xs = std::max(0, std::min(x + n, width - 1));
+						int diff = 0;
+						for (int c = 0; c < gc; c++) diff += abs(g0[x*gc + c] - g[xs*gc + c]);
+						const float w = *spw * color_weight[diff];
+						const T* q = s + xs*cn;
+						for (int i = 0; i < cn; i++) acc[i] += w*q[i];
+						wsum += w;
+					}
+				}
+				const float inv = 1.f / wsum;
+				for (int i = 0; i < cn; i++) d[x*cn + i] = saturate_cast<T>(acc[i] * inv);
+			}
+		}
+	}
+private:
+	const Mat* src;
+	const Mat* guide;
+	Mat* dest;
+	const int cn;
+	const int r;
+	const float* space_weight;
+	const float* color_weight;
+};
+
+static void jointBilateralFilterInterleaved(const Mat& src, const Mat& guide, Mat& dest, const int cn, const int r, const double sigma_c, const double sigma_s)
+{
+	CV_Assert(guide.depth() == CV_8U);
+	const int gc = guide.channels();
+	vector<float> color_weight(256 * gc);
+	const double gauss_color_coeff = -0.5 / (sigma_c*sigma_c);
+	for (int i = 0; i < 256 * gc; i++) color_weight[i] = (float)std::exp(i*i*gauss_color_coeff);
+
+	//circular kernel as jointBilateralFilter
+	vector<float> space_weight((2 * r + 1)*(2 * r + 1));
+	const double gauss_space_coeff = -0.5 / (sigma_s*sigma_s);
+	for (int m = -r, k = 0; m <= r; m++)
+	{
+		for (int n = -r; n <= r; n++, k++)
+		{
+			const double d = std::sqrt((double)m*m + (double)n*n);
+			space_weight[k] = (d > r) ? 0.f : (float)std::exp(d*d*gauss_space_coeff);
+		}
+	}
+
+	Mat dst(src.size(), src.type());
+	if (src.depth() == CV_8U)
+	{
+		jointBilateralInterleaved_Invoker<uchar> body(src, guide, dst, cn, r, &space_weight[0], &color_weight[0]);
+		parallel_for_(Range(0, src.rows), body);
+	}
+	else
+	{
+		jointBilateralInterleaved_Invoker<ushort> body(src, guide, dst, cn, r, &space_weight[0], &color_weight[0]);
+		parallel_for_(Range(0, src.rows), body);
+	}
+	dest = dst;
 }
 /*
 void CostVolumeRefinement::crossBasedAdaptiveboxRefinement(Mat& disp, Mat& guide,Mat& dest, int data_trunc, int metric, int r, int thresh,int iter)
@@ -1231,6 +1565,20 @@ void CostVolumeRefinement::gaussianRefinement(Mat& disp, Mat& dest, int data_tru
 	if (dest.empty())dest.create(disp.size(), CV_16S);
 
 	Mat in; disp.convertTo(in, CV_16S);
+	if (volumeDepth != VOLUME_TYPE)
+	{
+		Mat k = getGaussianKernel(2 * r + 1, sigma, CV_32F);
+		vector<float> kernel(k.begin<float>(), k.end<float>());
+		for (int i = 0; i < iter; i++)
+		{
+			buildCostVolume(in, data_trunc, metric, volume);
+			separableFilterInterleaved(volume, volume, numDisparity + 1, kernel);
+			wta(volume, dest);
+			dest.copyTo(in);
+			subpixelInterpolation(volume, dest, sub_method);
+		}
+		return;
+	}
 	for (int i = 0; i < iter; i++)
 	{
 		{
@@ -1239,11 +1587,13 @@ void CostVolumeRefinement::gaussianRefinement(Mat& disp, Mat& dest, int data_tru
 		}
 		{
 			//			CalcTime t("filter");
-#pragma omp parallel for
-			for (int n = 0; n <= numDisparity; n++)
+			parallelFor(Range(0, numDisparity + 1), [&](const Range& range)
 			{
-				GaussianBlur(dsv[n], dsv[n], Size(2 * r + 1, 2 * r + 1), sigma);
-			}
+				for (int n = range.start; n < range.end; n++)
+				{
+					GaussianBlur(dsv[n], dsv[n], Size(2 * r + 1, 2 * r + 1), sigma);
+				}
+			});
 		}
 		{
 			//		CalcTime t("wta");
@@ -1272,11 +1622,13 @@ void CostVolumeRefinement::weightedGaussianRefinement(Mat& disp, Mat& weight, Ma
 		}
 		{
 			//			CalcTime t("filter");
-#pragma omp parallel for
-			for (int n = 0; n <= numDisparity; n++)
+			parallelFor(Range(0, numDisparity + 1), [&](const Range& range)
 			{
-				GaussianBlur(dsv[n], dsv[n], Size(2 * r + 1, 2 * r + 1), sigma); \
-			}
+				for (int n = range.start; n < range.end; n++)
+				{
+					GaussianBlur(dsv[n], dsv[n], Size(2 * r + 1, 2 * r + 1), sigma);
+				}
+			});
 		}
 		{
 			//		CalcTime t("wta");
@@ -1296,6 +1648,20 @@ void CostVolumeRefinement::boxRefinement(Mat& disp, Mat& dest, int data_trunc, i
 	if (iter == 0)disp.convertTo(dest, CV_16S, 16);
 	if (dest.empty())dest.create(disp.size(), CV_16S);
 	Mat in = disp.clone();
+	if (volumeDepth != VOLUME_TYPE)
+	{
+		//normalized to keep the costs in the range of the depth
+		vector<float> kernel(2 * r + 1, 1.f / (2 * r + 1));
+		for (int i = 0; i < iter; i++)
+		{
+			buildCostVolume(in, data_trunc, metric, volume);
+			separableFilterInterleaved(volume, volume, numDisparity + 1, kernel);
+			wta(volume, dest);
+			dest.copyTo(in);
+			subpixelInterpolation(volume, dest, SUBPIXEL_NONE);
+		}
+		return;
+	}
 	for (int i = 0; i < iter; i++)
 	{
 		{
@@ -1306,12 +1672,14 @@ void CostVolumeRefinement::boxRefinement(Mat& disp, Mat& dest, int data_trunc, i
 		{
 			//cout<<"filter\n";
 			//			CalcTime t("filter");
-#pragma omp parallel for
-			for (int n = 0; n <= numDisparity; n++)
+			parallelFor(Range(0, numDisparity + 1), [&](const Range& range)
 			{
-				//Mat temp;
-				boxFilter(dsv[n], dsv[n], CV_32F, Size(2 * r + 1, 2 * r + 1), Point(-1, -1), false);
-			}
+				for (int n = range.start; n < range.end; n++)
+				{
+					//Mat temp;
+					boxFilter(dsv[n], dsv[n], CV_32F, Size(2 * r + 1, 2 * r + 1), Point(-1, -1), false);
+				}
+			});
 		}
 		{
 			//cout<<"wta\n";
@@ -1341,12 +1709,14 @@ void CostVolumeRefinement::weightedBoxRefinement(Mat& disp, Mat& weight, Mat& de
 			buildWeightedCostVolume(in, weight, data_trunc, metric);
 		}
 		{
-#pragma omp parallel for
-			for (int n = 0; n <= numDisparity; n++)
+			parallelFor(Range(0, numDisparity + 1), [&](const Range& range)
 			{
-				//Mat temp;
-				boxFilter(dsv[n], dsv[n], CV_32F, Size(2 * r + 1, 2 * r + 1), Point(-1, -1), false);
-			}
+				for (int n = range.start; n < range.end; n++)
+				{
+					//Mat temp;
+					boxFilter(dsv[n], dsv[n], CV_32F, Size(2 * r + 1, 2 * r + 1), Point(-1, -1), false);
+				}
+			});
 		}
 		{
 			wta(dest);
@@ -1391,6 +1761,19 @@ void CostVolumeRefinement::jointBilateralRefinement(Mat& disp, Mat& guide, Mat&
 	if (dest.empty())dest.create(disp.size(), CV_16S);
 
 	Mat in; disp.convertTo(in, CV_16S);
+	if (volumeDepth != VOLUME_TYPE)
+	{
+		Mat guide8u; guide.convertTo(guide8u, CV_8U);
+		for (int i = 0; i < iter; i++)
+		{
+			buildCostVolume(in, data_trunc, metric, volume);
+			jointBilateralFilterInterleaved(volume, guide8u, volume, numDisparity + 1, r, sigma_c, sigma_s);
+			wta(volume, dest);
+			dest.copyTo(in);
+			subpixelInterpolation(volume, dest, sub_method);
+		}
+		return;
+	}
 	Mat guidef; guide.convertTo(guidef, VOLUME_TYPE);
 	for (int i = 0; i < iter; i++)
 	{
@@ -1621,6 +2004,189 @@ void CostVolumeRefinement::weightedJointBilateralRefinementSP(Mat& disp, Mat& we
 	}
 }
 #endif
+
+//guided filter of all the disparity planes, where the guide statistics (mean and the inverse of the covariance plus eps) are computed once.
+//the per-plane box filters are fused into one multi-channel box filter for (p, I*p) and one for (a, b), and the planes are processed in parallel.
+class guidedCostVolume_Invoker : public cv::ParallelLoopBody
+{
+public:
+	guidedCostVolume_Invoker(vector<Mat>& _volume, const vector<Mat>& _I, const vector<Mat>& _mean_I, const vector<Mat>& _inv, const int _radius) :
+		volume(&_volume), I(&_I), mean_I(&_mean_I), inv(&_inv), radius(_radius)
+	{
+		;
+	}
+
+	virtual void operator() (const Range& range) const
+	{
+		const int cn = (int)I->size();
+		const Size ksize(2 * radius + 1, 2 * radius + 1);
+		const Size imsize = (*I)[0].size();
+		const int size = imsize.area();
+		Mat pIp(imsize, CV_MAKETYPE(CV_32F, cn + 1));
+		Mat ab(imsize, CV_MAKETYPE(CV_32F, cn + 1));
+		Mat mean(imsize, CV_MAKETYPE(CV_32F, cn + 1));
+
+		const float* i0 = (*I)[0].ptr<float>(0);
+		const float* i1 = (cn == 3) ? (*I)[1].ptr<float>(0) : NULL;
+		const float* i2 = (cn == 3) ? (*I)[2].ptr<float>(0) : NULL;
+		const float* m0 = (*mean_I)[0].ptr<float>(0);
+		const float* m1 = (cn == 3) ? (*mean_I)[1].ptr<float>(0) : NULL;
+		const float* m2 = (cn == 3) ? (*mean_I)[2].ptr<float>(0) : NULL;
+		for (int n = range.start; n != range.end; n++)
+		{
+			Mat& p = (*volume)[n];
+			float* pp = p.ptr<float>(0);
+
+			//(p, I*p)
+			float* s = pIp.ptr<float>(0);
+			if (cn == 1)
+			{
+				for (int i = 0; i < size; i++, s += 2)
+				{
+					s[0] = pp[i];
+					s[1] = i0[i] * pp[i];
+				}
+			}
+			else
+			{
+				for (int i = 0; i < size; i++, s += 4)
+				{
+					s[0] = pp[i];
+					s[1] = i0[i] * pp[i];
+					s[2] = i1[i] * pp[i];
+					s[3] = i2[i] * pp[i];
+				}
+			}
+			boxFilter(pIp, mean, CV_32F, ksize, Point(-1, -1), true, BORDER_REPLICATE);
+
+			//a = inv(cov_I + eps) * cov_Ip, b = mean_p - a * mean_I
+			const float* m = mean.ptr<float>(0);
+			float* d = ab.ptr<float>(0);
+			if (cn == 1)
+			{
+				const float* iv = (*inv)[0].ptr<float>(0);
+				for (int i = 0; i < size; i++, m += 2, d += 2)
+				{
+					const float a = (m[1] - m0[i] * m[0]) * iv[i];
+					d[0] = a;
+					d[1] = m[0] - a * m0[i];
+				}
+			}
+			else
+			{
+				const float* rr = (*inv)[0].ptr<float>(0);
+				const float* rg = (*inv)[1].ptr<float>(0);
+				const float* rb = (*inv)[2].ptr<float>(0);
+				const float* gg = (*inv)[3].ptr<float>(0);
+				const float* gb = (*inv)[4].ptr<float>(0);
+				const float* bb = (*inv)[5].ptr<float>(0);
+				for (int i = 0; i < size; i++, m += 4, d += 4)
+				{
+					const float cr = m[1] - m0[i] * m[0];
+					const float cg = m[2] - m1[i] * m[0];
+					const float cb = m[3] - m2[i] * m[0];
+					const float ar = rr[i] * cr + rg[i] * cg + rb[i] * cb;
+					const float ag = rg[i] * cr + gg[i] * cg + gb[i] * cb;
+					const float abb = rb[i] * cr + gb[i] * cg + bb[i] * cb;
+					d[0] = ar;
+					d[1] = ag;
+					d[2] = abb;
+					d[3] = m[0] - ar * m0[i] - ag * m1[i] - abb * m2[i];
+				}
+			}
+			boxFilter(ab, mean, CV_32F, ksize, Point(-1, -1), true, BORDER_REPLICATE);
+
+			//q = mean_a * I + mean_b
+			m = mean.ptr<float>(0);
+			if (cn == 1)
+			{
+				for (int i = 0; i < size; i++, m += 2) pp[i] = m[0] * i0[i] + m[1];
+			}
+			else
+			{
+				for (int i = 0; i < size; i++, m += 4) pp[i] = m[0] * i0[i] + m[1] * i1[i] + m[2] * i2[i] + m[3];
+			}
+		}
+	}
+private:
+	vector<Mat>* volume;
+	const vector<Mat>* I;
+	const vector<Mat>* mean_I;
+	const vector<Mat>* inv;
+	const int radius;
+};
+
+static void guidedFilterCostVolume(vector<Mat>& volume, const int planes, const Mat& guide, const int radius, const float eps)
+{
+	if (radius == 0) return;
+	CV_Assert(guide.channels() == 1 || guide.channels() == 3);
+
+	//the guide is normalized as guidedFilter
+	const int cn = guide.channels();
+	const Size ksize(2 * radius + 1, 2 * radius + 1);
+	vector<Mat> g(cn), I(cn), mean_I(cn);
+	split(guide, g);
+	for (int c = 0; c < cn; c++)
+	{
+		g[c].convertTo(I[c], CV_32F, 1.0 / 255);
+		boxFilter(I[c], mean_I[c], CV_32F, ksize, Point(-1, -1), true, BORDER_REPLICATE);
+	}
+
+	vector<Mat> inv;
+	if (cn == 1)
+	{
+		Mat var;
+		boxFilter(I[0].mul(I[0]), var, CV_32F, ksize, Point(-1, -1), true, BORDER_REPLICATE);
+		var -= mean_I[0].mul(mean_I[0]);
+		inv.resize(1);
+		divide(1.0, var + eps, inv[0]);
+	}
+	else
+	{
+		//covariance rr, rg, rb, gg, gb, bb and its inverse by the cofactors
+		const int idx[6][2] = { { 0, 0 }, { 0, 1 }, { 0, 2 }, { 1, 1 }, { 1, 2 }, { 2, 2 } };
+		vector<Mat> cov(6);
+		for (int k = 0; k < 6; k++)
+		{
+			const int a = idx[k][0], b = idx[k][1];
+			boxFilter(I[a].mul(I[b]), cov[k], CV_32F, ksize, Point(-1, -1), true, BORDER_REPLICATE);
+			cov[k] -= mean_I[a].mul(mean_I[b]);
+			if (a == b) cov[k] += eps;
+		}
+		inv.resize(6);
+		for (int k = 0; k < 6; k++) inv[k].create(guide.size(), CV_32F);
+		float* i_rr = inv[0].ptr<float>(0);
+		float* i_rg = inv[1].ptr<float>(0);
+		float* i_rb = inv[2].ptr<float>(0);
+		float* i_gg = inv[3].ptr<float>(0);
+		float* i_gb = inv[4].ptr<float>(0);
+		float* i_bb = inv[5].ptr<float>(0);
+		const int size = guide.size().area();
+		const float* rr = cov[0].ptr<float>(0);
+		const float* rg = cov[1].ptr<float>(0);
+		const float* rb = cov[2].ptr<float>(0);
+		const float* gg = cov[3].ptr<float>(0);
+		const float* gb = cov[4].ptr<float>(0);
+		const float* bb = cov[5].ptr<float>(0);
+		for (int i = 0; i < size; i++)
+		{
+			const float c0 = gg[i] * bb[i] - gb[i] * gb[i];
+			const float c1 = gb[i] * rb[i] - rg[i] * bb[i];
+			const float c2 = rg[i] * gb[i] - gg[i] * rb[i];
+			const float det = 1.f / (rr[i] * c0 + rg[i] * c1 + rb[i] * c2);
+			i_rr[i] = c0 * det;
+			i_rg[i] = c1 * det;
+			i_rb[i] = c2 * det;
+			i_gg[i] = (rr[i] * bb[i] - rb[i] * rb[i]) * det;
+			i_gb[i] = (rb[i] * rg[i] - rr[i] * gb[i]) * det;
+			i_bb[i] = (rr[i] * gg[i] - rg[i] * rg[i]) * det;
+		}
+	}
+
+	guidedCostVolume_Invoker body(volume, I, mean_I, inv, radius);
+	parallel_for_(Range(0, planes), body);
+}
+
 void CostVolumeRefinement::weightedGuidedRefinement(Mat& disp, Mat& weight, Mat& guide, Mat& dest, int data_trunc, int metric, int r, double eps, int iter)
 {
 	if (iter == 0)disp.convertTo(dest, CV_16S, 16);
@@ -1635,11 +2201,7 @@ void CostVolumeRefinement::weightedGuidedRefinement(Mat& disp, Mat& weight, Mat&
 		}
 		{
 			//	CalcTime t("filter");
-#pragma omp parallel for
-			for (int n = 0; n <= numDisparity; n++)
-			{
-				guidedFilter(dsv[n], guide, dsv[n], r, (float)eps);
-			}
+			guidedFilterCostVolume(dsv, numDisparity + 1, guide, r, (float)eps);
 		}
 		{
 			//	CalcTime t("wta");
@@ -1697,8 +2259,7 @@ void CostVolumeRefinement::guidedRefinement(Mat& disp, Mat& guide, Mat& dest, in
 		{
 			//CalcTime t("filter");
 
-			guided_Invoker body(dsv, dsv, guide, r, (float)eps);
-			parallel_for_(Range(0, numDisparity + 1), body);
+			guidedFilterCostVolume(dsv, numDisparity + 1, guide, r, (float)eps);
 
 			//#pragma omp parallel for
 			/*	for(int n=0;n<=numDisparity;n++)
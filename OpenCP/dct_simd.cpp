@@ -1,4 +1,5 @@
 #include <nmmintrin.h> //SSE4.2
+#include <opencv2/core/cvdef.h>
 #define  _USE_MATH_DEFINES
 #include <math.h>
 #include <string.h>
@@ -31,7 +32,7 @@ inline int getNonzero(float* s, int size)
 
 void fDCT2D8x4_and_threshold_keep00_32f(const float* x, float* y, float thresh)
 {
-	const int __declspec(align(16)) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
+	const int CV_DECL_ALIGNED(16) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
 	const __m128 mth = _mm_set1_ps(thresh);
 	const __m128 zeros = _mm_setzero_ps();
 
@@ -160,7 +161,7 @@ void fDCT2D8x4_and_threshold_keep00_32f(const float* x, float* y, float thresh)
 }
 void fDCT2D8x4_and_threshold_32f(const float* x, float* y, float thresh)
 {
-	const int __declspec(align(16)) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
+	const int CV_DECL_ALIGNED(16) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
 	const __m128 mth = _mm_set1_ps(thresh);
 	const __m128 zeros = _mm_setzero_ps();
 
@@ -935,7 +936,7 @@ void fDCT2x2_2pack_32f_and_thresh_and_iDCT2x2_2pack(float* src, float* dest, flo
 	a = _mm_mul_ps(mm, _mm_add_ps(ms0, ms1));
 	b = _mm_mul_ps(mm, _mm_sub_ps(ms0, ms1));
 
-	const int __declspec(align(16)) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
+	const int CV_DECL_ALIGNED(16) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
 	const __m128 mth = _mm_set1_ps(thresh);
 
 	__m128 msk = _mm_cmpgt_ps(_mm_and_ps(a, *(const __m128*)v32f_absmask), mth);
@@ -1130,7 +1131,7 @@ void dct4x4_llm_sse(float* a, float* b, float* temp, int flag)
 }
 void fDCT2D4x4_and_threshold_keep00_32f(float* s, float* d, float thresh)
 {
-	const int __declspec(align(16)) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
+	const int CV_DECL_ALIGNED(16) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
 	const __m128 mth = _mm_set1_ps(thresh);
 	const __m128 zeros = _mm_setzero_ps();
 	const __m128 c2 = _mm_set1_ps(1.30656f);//cos(CV_PI*2/16.0)*sqrt(2);
@@ -1171,7 +1172,7 @@ void fDCT2D4x4_and_threshold_keep00_32f(float* s, float* d, float thresh)
 
 void fDCT2D4x4_and_threshold_32f(float* s, float* d, float thresh)
 {
-	const int __declspec(align(16)) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
+	const int CV_DECL_ALIGNED(16) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
 	const __m128 mth = _mm_set1_ps(thresh);
 	const __m128 zeros = _mm_setzero_ps();
 	const __m128 c2 = _mm_set1_ps(1.30656f);//cos(CV_PI*2/16.0)*sqrt(2);
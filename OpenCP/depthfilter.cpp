@@ -1043,38 +1043,40 @@ namespace cp
 		Mat rdisp = right_disp.clone();
 		Mat ldisp = left_disp.clone();
 		double iamp = 1.0 / amp;
-#pragma omp parallel for
-		for (int j = 0; j<left_disp.rows; j++)
+		parallelFor(Range(0, left_disp.rows), [&](const Range& range)
 		{
-			T* dld = left_disp.ptr<T>(j);
-			T* drd = right_disp.ptr<T>(j);
-			T* ld = ldisp.ptr<T>(j);
-			T* rd = rdisp.ptr<T>(j);
-			for (int i = 0; i < left_disp.cols; i++)
+			for (int j = range.start; j < range.end; j++)
 			{
-				T d = ld[i];
-				int move = (int)(d*iamp);
-				if (i - move > 0)
+				T* dld = left_disp.ptr<T>(j);
+				T* drd = right_disp.ptr<T>(j);
+				T* ld = ldisp.ptr<T>(j);
+				T* rd = rdisp.ptr<T>(j);
+				for (int i = 0; i < left_disp.cols; i++)
 				{
-					if (abs(rd[i - move] - d)>disp12diff)
+					T d = ld[i];
+					int move = (int)(d*iamp);
+					if (i - move > 0)
 					{
-						//drd[i-move]=invalidvalue;
-						dld[i] = (T)((rd[i - move] + d)*0.5);
+						if (abs(rd[i - move] - d)>disp12diff)
+						{
+							//drd[i-move]=invalidvalue;
+							dld[i] = (T)((rd[i - move] + d)*0.5);
+						}
 					}
-				}
 
-				d = rd[i];
-				move = (int)(d*iamp);
-				if (i + move<left_disp.cols)
-				{
-					if (abs(ld[i + move] - d)>disp12diff)
+					d = rd[i];
+					move = (int)(d*iamp);
+					if (i + move<left_disp.cols)
 					{
-						//dld[i+move]=invalidvalue;
-						drd[i] = (T)((ld[i + move] + d)*0.5);
+						if (abs(ld[i + move] - d)>disp12diff)
+						{
+							//dld[i+move]=invalidvalue;
+							drd[i] = (T)((ld[i + move] + d)*0.5);
+						}
 					}
 				}
 			}
-		}
+		});
 	}
 
 	void LRCheckDisparity(Mat& left_disp, Mat& right_disp, int disparity_max, const int disp12diff, double invalidvalue, const int amp, const int mode)
@@ -1,4 +1,5 @@
 #include "opencp.hpp"
+#include "dxtDenoiseSIMD.h"
 
 using namespace std;
 using namespace cv;
@@ -923,6 +924,164 @@ namespace cp
 		}
 	};
 
+	//shrinkage of the patches on a grid of step pixels; the patch row k is at y=k*step and its columns start at offset[k] (shifted or randomized grid).
+	//a stripe has rowsPerStripe patch rows covering at least the patch height, so that the stripes of the same parity do not overlap and are accumulated in parallel.
+	class DenoiseDXTShrinkageStrideInvorker : public cv::ParallelLoopBody
+	{
+	private:
+		float* src;
+		float* dest;
+		float thresh;
+		int width;
+		int height;
+		Size patch_size;
+		int step;
+		const int* offset;
+		int rows;
+		int rowsPerStripe;
+		int parity;
+		void(*shrink)(float*, float);//NULL: cv::dct
+
+	public:
+
+		DenoiseDXTShrinkageStrideInvorker(float *sim, float* dim, float Th, int w, int h, Size psize, int step_, const int* offset_, int rows_, int rowsPerStripe_, int parity_, void(*shrink_)(float*, float))
+			: src(sim), dest(dim), thresh(Th), width(w), height(h), patch_size(psize), step(step_), offset(offset_), rows(rows_), rowsPerStripe(rowsPerStripe_), parity(parity_), shrink(shrink_)
+		{
+			;
+		}
+		virtual void operator() (const Range& range) const
+		{
+			const int pwidth = patch_size.width;
+			const int pheight = patch_size.height;
+			const int wstep = width - pwidth + 1;
+			const int sz = sizeof(float)*pwidth;
+
+			Mat patch(patch_size, CV_32F);
+			Mat mask;
+			float* ptch = patch.ptr<float>(0);
+			for (int n = range.start; n != range.end; n++)
+			{
+				const int stripe = 2 * n + parity;
+				const int kend = min((stripe + 1)*rowsPerStripe, rows);
+				for (int k = stripe*rowsPerStripe; k < kend; k++)
+				{
+					const int j = k*step;
+					for (int i = offset[k]; i < wstep; i += step)
+					{
+						float* s0 = &src[width*j + i];
+						float* d0 = &dest[width*j + i];
+						for (int l = 0; l < pheight; l++)
+						{
+							memcpy(ptch + l*pwidth, s0 + l*width, sz);
+						}
+
+						if (shrink != NULL)
+						{
+							shrink(ptch, thresh);
+						}
+						else
+						{
+							dct(patch, patch);
+#ifdef _KEEP_00_COEF_
+							float f0 = *(float*)patch.data;
+#endif
+							compare(abs(patch), thresh, mask, CMP_LT);
+							patch.setTo(0.f, mask);
+#ifdef _KEEP_00_COEF_
+							*(float*)patch.data = f0;
+#endif
+							dct(patch, patch, DCT_INVERSE);
+						}
+
+						//add data
+						for (int jp = 0; jp < pheight; jp++)
+						{
+							float* s = ptch + jp*pwidth;
+							float* d = d0 + jp*width;
+							int ip = 0;
+							for (; ip <= pwidth - 4; ip += 4)
+							{
+								_mm_storeu_ps(d + ip, _mm_add_ps(_mm_loadu_ps(d + ip), _mm_loadu_ps(s + ip)));
+							}
+							for (; ip < pwidth; ip++)
+							{
+								d[ip] += s[ip];
+							}
+						}
+					}
+				}
+			}
+		}
+	};
+
+	//shrinkage of the patches at every pixel by the batch kernels in dxtDenoiseSIMD.h, which process batch horizontally neighbouring patches per call.
+	//the remaining patches of a row are processed by the SSE kernel. the stripes are accumulated by parity as DenoiseDXTShrinkageStrideInvorker.
+	class DenoiseDXTShrinkageBatchInvorker : public cv::ParallelLoopBody
+	{
+	private:
+		float* src;
+		float* dest;
+		float thresh;
+		int width;
+		int patch_size;
+		int rows;
+		int rowsPerStripe;
+		int parity;
+		int batch;
+		void(*shrinkBatch)(const float*, float*, int, float);
+		void(*shrink)(float*, float);
+
+	public:
+
+		DenoiseDXTShrinkageBatchInvorker(float *sim, float* dim, float Th, int w, int psize, int rows_, int rowsPerStripe_, int parity_, int batch_, void(*shrinkBatch_)(const float*, float*, int, float), void(*shrink_)(float*, float))
+			: src(sim), dest(dim), thresh(Th), width(w), patch_size(psize), rows(rows_), rowsPerStripe(rowsPerStripe_), parity(parity_), batch(batch_), shrinkBatch(shrinkBatch_), shrink(shrink_)
+		{
+			;
+		}
+		virtual void operator() (const Range& range) const
+		{
+			const int wstep = width - patch_size + 1;
+			const int sz = sizeof(float)*patch_size;
+
+			Mat patch(Size(patch_size, patch_size), CV_32F);
+			float* ptch = patch.ptr<float>(0);
+			for (int n = range.start; n != range.end; n++)
+			{
+				const int stripe = 2 * n + parity;
+				const int jend = min((stripe + 1)*rowsPerStripe, rows);
+				for (int j = stripe*rowsPerStripe; j < jend; j++)
+				{
+					float* s0 = &src[width*j];
+					float* d0 = &dest[width*j];
+					int i = 0;
+					for (; i <= wstep - batch; i += batch)
+					{
+						shrinkBatch(s0 + i, d0 + i, width, thresh);
+					}
+					for (; i < wstep; i++)
+					{
+						for (int l = 0; l < patch_size; l++)
+						{
+							memcpy(ptch + l*patch_size, s0 + i + l*width, sz);
+						}
+						shrink(ptch, thresh);
+
+						//add data
+						for (int jp = 0; jp < patch_size; jp++)
+						{
+							float* s = ptch + jp*patch_size;
+							float* d = d0 + i + jp*width;
+							for (int ip = 0; ip < patch_size; ip += 4)
+							{
+								_mm_storeu_ps(d + ip, _mm_add_ps(_mm_loadu_ps(d + ip), _mm_load_ps(s + ip)));
+							}
+						}
+					}
+				}
+			}
+		}
+	};
+
 	class DenoiseDHTShrinkageInvorker16x16 : public cv::ParallelLoopBody
 	{
 	private:
@@ -1675,11 +1834,17 @@ namespace cp
 	DenoiseDXTShrinkage::DenoiseDXTShrinkage()
 	{
 		isSSE = true;
+		isWideSIMD = true;
+		wmapPatchStep = 0;
+		wmapStepMode = -1;
 	}
 
 	DenoiseDXTShrinkage::DenoiseDXTShrinkage(Size size_, int color, Size patch_size_)
 	{
 		isSSE = true;
+		isWideSIMD = true;
+		wmapPatchStep = 0;
+		wmapStepMode = -1;
 		init(size_, color, patch_size_);
 	}
 
@@ -1777,7 +1942,7 @@ namespace cp
 		const int w5=5*width;
 		const int w6=6*width;
 		const int w7=7*width;
-		#pragma omp parallel for
+		//#pragma omp parallel for
 		for (int j = 0; j < hstep; j ++)
 		{
 		Mat temp(patch_size, CV_32F);
@@ -1988,6 +2153,8 @@ namespace cp
 
 	void DenoiseDXTShrinkage::body(float *src, float* dest, float Th)
 	{
+		if (isSSE && isWideSIMD && bodyBatch(src, dest, Th)) return;
+
 		if (basis == DenoiseDCT)
 		{
 			if (isSSE)
@@ -2162,6 +2329,117 @@ namespace cp
 	}
 
 
+	void DenoiseDXTShrinkage::setPatchStep(int patch_step, int step_mode)
+	{
+		const int rows = (size.height - patch_size.height + patch_step - 1) / patch_step;
+		patch_offset.resize(rows);
+		for (int k = 0; k < rows; k++)
+		{
+			if (step_mode == PATCH_STEP_SHIFTED_GRID) patch_offset[k] = (k & 1) * (patch_step >> 1);
+			else if (step_mode == PATCH_STEP_RANDOM) patch_offset[k] = rng.uniform(0, patch_step);
+			else patch_offset[k] = 0;
+		}
+	}
+
+	void DenoiseDXTShrinkage::patchStepWeight(int patch_step, int step_mode)
+	{
+		//the offsets of the grids are fixed, so that the weight map is reused while the size, the patch and the step are the same
+		if (step_mode != PATCH_STEP_RANDOM && step_mode == wmapStepMode && patch_step == wmapPatchStep && patch_size == wmapPatchSize && wmap.size() == size) return;
+		wmapStepMode = step_mode;
+		wmapPatchStep = patch_step;
+		wmapPatchSize = patch_size;
+
+		//count.row(o) is the number of the patches covering each column in a patch row whose offset is o
+		const int wstep = size.width - patch_size.width + 1;
+		Mat count = Mat::zeros(patch_step, size.width, CV_32F);
+		for (int o = 0; o < patch_step; o++)
+		{
+			float* c = count.ptr<float>(o);
+			for (int i = o; i < wstep; i += patch_step)
+			{
+				for (int n = 0; n < patch_size.width; n++) c[i + n] += 1.f;
+			}
+		}
+
+		wmap = Mat::zeros(size, CV_32F);
+		for (int k = 0; k < (int)patch_offset.size(); k++)
+		{
+			for (int n = 0; n < patch_size.height; n++)
+			{
+				Mat r = wmap.row(k*patch_step + n);
+				r += count.row(patch_offset[k]);
+			}
+		}
+		//the uncovered pixels are in the border, which is cropped
+		cv::max(wmap, 1.f, wmap);
+	}
+
+	void DenoiseDXTShrinkage::bodyStride(float *src, float* dest, float Th, int patch_step)
+	{
+		void(*shrink)(float*, float) = NULL;
+		if (isSSE && patch_size.width == patch_size.height)
+		{
+			if (basis == DenoiseDCT)
+			{
+				if (patch_size.width == 4) shrink = fDCT4x4_32f_and_threshold_and_iDCT4x4_32f;
+				else if (patch_size.width == 8) shrink = fDCT8x8_32f_and_threshold_and_iDCT8x8_32f;
+			}
+			else if (basis == DenoiseDHT)
+			{
+				//the 4x4 DHT of body() is the DCT, so that patch_step does not change the transform
+				if (patch_size.width == 4) shrink = fDCT4x4_32f_and_threshold_and_iDCT4x4_32f;
+				else if (patch_size.width == 8) shrink = Hadamard2D8x8andThreshandIDHT;
+				else if (patch_size.width == 16) shrink = Hadamard2D16x16andThreshandIDHT;
+			}
+		}
+
+		const int rows = (int)patch_offset.size();
+		const int rowsPerStripe = max((patch_size.height + patch_step - 1) / patch_step, rows / (4 * getNumThreads()));
+		const int nstripes = (rows + rowsPerStripe - 1) / rowsPerStripe;
+		for (int parity = 0; parity < 2; parity++)
+		{
+			DenoiseDXTShrinkageStrideInvorker invork(src, dest, Th, size.width, size.height, patch_size, patch_step, &patch_offset[0], rows, rowsPerStripe, parity, shrink);
+			parallel_for_(Range(0, (nstripes + 1 - parity) / 2), invork);
+		}
+	}
+
+	bool DenoiseDXTShrinkage::bodyBatch(float *src, float* dest, float Th)
+	{
+		const bool isAVX512 = haveDXTShrinkageAVX512();
+		if (!isAVX512 && !haveDXTShrinkageAVX2()) return false;
+		if (patch_size.width != patch_size.height) return false;
+
+		void(*shrinkBatch)(const float*, float*, int, float) = NULL;
+		void(*shrink)(float*, float) = NULL;
+		if (basis == DenoiseDCT && patch_size.width == 8)
+		{
+			shrinkBatch = (isAVX512) ? DCTShrinkage8x8Batch_AVX512 : DCTShrinkage8x8Batch_AVX2;
+			shrink = fDCT8x8_32f_and_threshold_and_iDCT8x8_32f;
+		}
+		else if (basis == DenoiseDHT && patch_size.width == 8)
+		{
+			shrinkBatch = (isAVX512) ? DHTShrinkage8x8Batch_AVX512 : DHTShrinkage8x8Batch_AVX2;
+			shrink = Hadamard2D8x8andThreshandIDHT;
+		}
+		else if (basis == DenoiseDHT && patch_size.width == 16)
+		{
+			shrinkBatch = (isAVX512) ? DHTShrinkage16x16Batch_AVX512 : DHTShrinkage16x16Batch_AVX2;
+			shrink = Hadamard2D16x16andThreshandIDHT;
+		}
+		else return false;
+
+		const int batch = (isAVX512) ? 16 : 8;
+		const int rows = size.height - patch_size.height;
+		const int rowsPerStripe = max(patch_size.height, rows / (4 * getNumThreads()));
+		const int nstripes = (rows + rowsPerStripe - 1) / rowsPerStripe;
+		for (int parity = 0; parity < 2; parity++)
+		{
+			DenoiseDXTShrinkageBatchInvorker invork(src, dest, Th, size.width, patch_size.width, rows, rowsPerStripe, parity, batch, shrinkBatch, shrink);
+			parallel_for_(Range(0, (nstripes + 1 - parity) / 2), invork);
+		}
+		return true;
+	}
+
 	void DenoiseDXTShrinkage::shearable(Mat& src_, Mat& dest, float sigma, Size psize, int transform_basis, int direct)
 	{
 		Mat src;
@@ -2396,8 +2674,10 @@ namespace cp
 	}
 	}
 
-	void DenoiseDXTShrinkage::operator()(Mat& src_, Mat& dest, float sigma, Size psize, int transform_basis)
+	void DenoiseDXTShrinkage::operator()(Mat& src_, Mat& dest, float sigma, Size psize, int transform_basis, int patch_step, int step_mode)
 	{
+		CV_Assert(patch_step >= 1 && patch_step <= min(psize.width, psize.height));
+
 		Mat src;
 		if (src_.depth() != CV_32F)src_.convertTo(src, CV_MAKETYPE(CV_32F, src_.channels()));
 		else src = src_;
@@ -2405,6 +2685,12 @@ namespace cp
 		basis = transform_basis;
 		if (src.size() != size || src.channels() != channel || psize != patch_size) init(src.size(), src.channels(), psize);
 
+		//the DWT has no strided path
+		if (basis == DenoiseDWT) patch_step = 1;
+		//when the step divides the patch size, every pixel is covered by area/step^2 patches for any row offsets,
+		//so that the weight map is only needed for the other steps
+		const bool isUniformWeight = patch_step == 1 || (psize.width % patch_step == 0 && psize.height % patch_step == 0);
+
 		int w = src.cols + 2 * psize.width;
 		w = ((4 - w % 4) % 4);
 
@@ -2447,15 +2733,34 @@ namespace cp
 #ifdef _CALCTIME_
 		CalcTime t("body");
 #endif
-		if (channel == 3)
+		if (patch_step == 1)
 		{
-			body(ipixels, opixels, Th);
-			body(ipixels + size1, opixels + size1, Th);
-			body(ipixels + 2 * size1, opixels + 2 * size1, Th);
+			if (channel == 3)
+			{
+				body(ipixels, opixels, Th);
+				body(ipixels + size1, opixels + size1, Th);
+				body(ipixels + 2 * size1, opixels + 2 * size1, Th);
+			}
+			else
+			{
+				body(ipixels, opixels, Th);
+			}
 		}
 		else
 		{
-			body(ipixels, opixels, Th);
+			setPatchStep(patch_step, step_mode);
+			if (!isUniformWeight) patchStepWeight(patch_step, step_mode);
+
+			if (channel == 3)
+			{
+				bodyStride(ipixels, opixels, Th, patch_step);
+				bodyStride(ipixels + size1, opixels + size1, Th, patch_step);
+				bodyStride(ipixels + 2 * size1, opixels + 2 * size1, Th, patch_step);
+			}
+			else
+			{
+				bodyStride(ipixels, opixels, Th, patch_step);
+			}
 		}
 		//body(ipixels, opixels,ipixels+size1, opixels+size1,ipixels+2*size1, opixels+2*size1,Th);
 
@@ -2471,12 +2776,18 @@ namespace cp
 			float* d0 = &opixels[0];
 			float* d1 = &opixels[size1];
 			float* d2 = &opixels[2 * size1];
-			div(d0, d1, d2, patch_size.area(), size1);
+			if (isUniformWeight) div(d0, d1, d2, patch_size.area() / (patch_step*patch_step), size1);
+			else
+			{
+				float* w = wmap.ptr<float>(0);
+				div(d0, d1, d2, w, w, w, size1);
+			}
 		}
 		else
 		{
 			float* d0 = &opixels[0];
-			div(d0, patch_size.area(), size1);
+			if (isUniformWeight) div(d0, patch_size.area() / (patch_step*patch_step), size1);
+			else div(d0, wmap.ptr<float>(0), size1);
 		}
 	}
 
@@ -0,0 +1,228 @@
+#include "opencp.hpp"
+#include "dxtDenoiseSIMD.h"
+
+using namespace std;
+using namespace cv;
+
+namespace cp
+{
+#if defined(__AVX2__)
+
+	bool haveDXTShrinkageAVX2()
+	{
+		return checkHardwareSupport(CV_CPU_AVX2) && checkHardwareSupport(CV_CPU_FMA3);
+	}
+
+	//8-point DCT of LLM, which is the same as fDCT2D8x4_32f; v[k] is the k-th sample of 8 lanes
+	static inline void fDCT1D8_AVX2(__m256* v)
+	{
+		const __m256 t0 = _mm256_add_ps(v[0], v[7]);
+		const __m256 t7 = _mm256_sub_ps(v[0], v[7]);
+		const __m256 t1 = _mm256_add_ps(v[1], v[6]);
+		const __m256 t6 = _mm256_sub_ps(v[1], v[6]);
+		const __m256 t2 = _mm256_add_ps(v[2], v[5]);
+		const __m256 t5 = _mm256_sub_ps(v[2], v[5]);
+		const __m256 t3 = _mm256_add_ps(v[3], v[4]);
+		const __m256 t4 = _mm256_sub_ps(v[3], v[4]);
+
+		__m256 c0 = _mm256_add_ps(t0, t3);
+		__m256 c3 = _mm256_sub_ps(t0, t3);
+		__m256 c1 = _mm256_add_ps(t1, t2);
+		__m256 c2 = _mm256_sub_ps(t1, t2);
+
+		const __m256 invsqrt2h = _mm256_set1_ps(0.353554f);
+		v[0] = _mm256_mul_ps(_mm256_add_ps(c0, c1), invsqrt2h);
+		v[4] = _mm256_mul_ps(_mm256_sub_ps(c0, c1), invsqrt2h);
+
+		__m256 w0 = _mm256_set1_ps(0.541196f);
+		__m256 w1 = _mm256_set1_ps(1.306563f);
+		v[2] = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(w0, c2), _mm256_mul_ps(w1, c3)), invsqrt2h);
+		v[6] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(w0, c3), _mm256_mul_ps(w1, c2)), invsqrt2h);
+
+		w0 = _mm256_set1_ps(1.175876f);
+		w1 = _mm256_set1_ps(0.785695f);
+		c3 = _mm256_add_ps(_mm256_mul_ps(w0, t4), _mm256_mul_ps(w1, t7));
+		c0 = _mm256_sub_ps(_mm256_mul_ps(w0, t7), _mm256_mul_ps(w1, t4));
+
+		w0 = _mm256_set1_ps(1.387040f);
+		w1 = _mm256_set1_ps(0.275899f);
+		c2 = _mm256_add_ps(_mm256_mul_ps(w0, t5), _mm256_mul_ps(w1, t6));
+		c1 = _mm256_sub_ps(_mm256_mul_ps(w0, t6), _mm256_mul_ps(w1, t5));
+
+		v[3] = _mm256_mul_ps(_mm256_sub_ps(c0, c2), invsqrt2h);
+		v[5] = _mm256_mul_ps(_mm256_sub_ps(c3, c1), invsqrt2h);
+
+		const __m256 invsqrt2 = _mm256_set1_ps(0.707107f);
+		c0 = _mm256_mul_ps(_mm256_add_ps(c0, c2), invsqrt2);
+		c3 = _mm256_mul_ps(_mm256_add_ps(c3, c1), invsqrt2);
+		v[1] = _mm256_mul_ps(_mm256_add_ps(c0, c3), invsqrt2h);
+		v[7] = _mm256_mul_ps(_mm256_sub_ps(c0, c3), invsqrt2h);
+	}
+
+	//8-point inverse DCT of LLM, which is the same as iDCT2D8x4_32f
+	static inline void iDCT1D8_AVX2(__m256* v)
+	{
+		__m256 z0 = _mm256_add_ps(v[1], v[7]);
+		__m256 z1 = _mm256_add_ps(v[3], v[5]);
+		__m256 z2 = _mm256_add_ps(v[3], v[7]);
+		__m256 z3 = _mm256_add_ps(v[1], v[5]);
+		__m256 z4 = _mm256_mul_ps(_mm256_add_ps(z0, z1), _mm256_set1_ps(1.175876f));
+
+		z2 = _mm256_add_ps(_mm256_mul_ps(z2, _mm256_set1_ps(-1.961571f)), z4);
+		z3 = _mm256_add_ps(_mm256_mul_ps(z3, _mm256_set1_ps(-0.390181f)), z4);
+		z0 = _mm256_mul_ps(z0, _mm256_set1_ps(-0.899976f));
+		z1 = _mm256_mul_ps(z1, _mm256_set1_ps(-2.562915f));
+
+		const __m256 b3 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v[7], _mm256_set1_ps(0.298631f)), z0), z2);
+		const __m256 b2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v[5], _mm256_set1_ps(2.053120f)), z1), z3);
+		const __m256 b1 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v[3], _mm256_set1_ps(3.072711f)), z1), z2);
+		const __m256 b0 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v[1], _mm256_set1_ps(1.501321f)), z0), z3);
+
+		z4 = _mm256_mul_ps(_mm256_add_ps(v[2], v[6]), _mm256_set1_ps(0.541196f));
+		z0 = _mm256_add_ps(v[0], v[4]);
+		z1 = _mm256_sub_ps(v[0], v[4]);
+		z2 = _mm256_add_ps(z4, _mm256_mul_ps(v[6], _mm256_set1_ps(-1.847759f)));
+		z3 = _mm256_add_ps(z4, _mm256_mul_ps(v[2], _mm256_set1_ps(0.765367f)));
+
+		const __m256 a0 = _mm256_add_ps(z0, z3);
+		const __m256 a3 = _mm256_sub_ps(z0, z3);
+		const __m256 a1 = _mm256_add_ps(z1, z2);
+		const __m256 a2 = _mm256_sub_ps(z1, z2);
+
+		const __m256 w = _mm256_set1_ps(0.353554f);
+		v[0] = _mm256_mul_ps(w, _mm256_add_ps(a0, b0));
+		v[7] = _mm256_mul_ps(w, _mm256_sub_ps(a0, b0));
+		v[1] = _mm256_mul_ps(w, _mm256_add_ps(a1, b1));
+		v[6] = _mm256_mul_ps(w, _mm256_sub_ps(a1, b1));
+		v[2] = _mm256_mul_ps(w, _mm256_add_ps(a2, b2));
+		v[5] = _mm256_mul_ps(w, _mm256_sub_ps(a2, b2));
+		v[3] = _mm256_mul_ps(w, _mm256_add_ps(a3, b3));
+		v[4] = _mm256_mul_ps(w, _mm256_sub_ps(a3, b3));
+	}
+
+	//N-point Walsh-Hadamard transform without normalization, which is the inverse of itself up to the scale N
+	template <int N>
+	static inline void Hadamard1D_AVX2(__m256* v)
+	{
+		for (int h = 1; h < N; h <<= 1)
+		{
+			for (int k = 0; k < N; k += 2 * h)
+			{
+				for (int l = k; l < k + h; l++)
+				{
+					const __m256 a = v[l];
+					v[l] = _mm256_add_ps(a, v[l + h]);
+					v[l + h] = _mm256_sub_ps(a, v[l + h]);
+				}
+			}
+		}
+	}
+
+	template <int N, bool isDCT>
+	static inline void forward1D_AVX2(__m256* v)
+	{
+		if (isDCT) fDCT1D8_AVX2(v);
+		else Hadamard1D_AVX2<N>(v);
+	}
+
+	template <int N, bool isDCT>
+	static inline void inverse1D_AVX2(__m256* v)
+	{
+		if (isDCT) iDCT1D8_AVX2(v);
+		else Hadamard1D_AVX2<N>(v);
+	}
+
+	//shrinkage of the NxN patches at src+0,...,src+7; the lane p of the vectors is the patch p
+	template <int N, bool isDCT>
+	static void shrinkageBatch_AVX2(const float* src, float* dest, const int step, const float thresh)
+	{
+		const int L = 8;
+		const int VW = L + N;
+		CV_DECL_ALIGNED(32) float V[N * VW];
+		__m256 coef[N * N];
+
+		//column transforms of the L+N-1 columns shared by the patches
+		for (int o = 0;; o = min(o + L, N - 1))
+		{
+			__m256 v[N];
+			for (int k = 0; k < N; k++) v[k] = _mm256_loadu_ps(src + step * k + o);
+			forward1D_AVX2<N, isDCT>(v);
+			for (int k = 0; k < N; k++) _mm256_storeu_ps(V + VW * k + o, v[k]);
+			if (o == N - 1) break;
+		}
+
+		//row transforms: the column c of the patch p is V[p + c]
+		for (int r = 0; r < N; r++)
+		{
+			__m256* h = coef + N * r;
+			for (int c = 0; c < N; c++) h[c] = _mm256_loadu_ps(V + VW * r + c);
+			forward1D_AVX2<N, isDCT>(h);
+		}
+
+		//hard thresholding except the DC; the Hadamard coefficients are N times the normalized ones
+		const __m256 mth = _mm256_set1_ps((isDCT) ? thresh : thresh * N);
+		const __m256 mabs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+		for (int i = 1; i < N * N; i++)
+		{
+			coef[i] = _mm256_and_ps(coef[i], _mm256_cmp_ps(_mm256_and_ps(coef[i], mabs), mth, _CMP_GT_OQ));
+		}
+
+		for (int r = 0; r < N; r++)
+		{
+			inverse1D_AVX2<N, isDCT>(coef + N * r);
+		}
+
+		//inverse column transforms and aggregation
+		const __m256 mscale = _mm256_set1_ps((isDCT) ? 1.f : 1.f / (N * N));
+		for (int c = 0; c < N; c++)
+		{
+			__m256 v[N];
+			for (int k = 0; k < N; k++) v[k] = coef[N * k + c];
+			inverse1D_AVX2<N, isDCT>(v);
+			for (int k = 0; k < N; k++)
+			{
+				float* d = dest + step * k + c;
+				const __m256 p = (isDCT) ? v[k] : _mm256_mul_ps(v[k], mscale);
+				_mm256_storeu_ps(d, _mm256_add_ps(_mm256_loadu_ps(d), p));
+			}
+		}
+	}
+
+	void DCTShrinkage8x8Batch_AVX2(const float* src, float* dest, int step, float thresh)
+	{
+		shrinkageBatch_AVX2<8, true>(src, dest, step, thresh);
+	}
+
+	void DHTShrinkage8x8Batch_AVX2(const float* src, float* dest, int step, float thresh)
+	{
+		shrinkageBatch_AVX2<8, false>(src, dest, step, thresh);
+	}
+
+	void DHTShrinkage16x16Batch_AVX2(const float* src, float* dest, int step, float thresh)
+	{
+		shrinkageBatch_AVX2<16, false>(src, dest, step, thresh);
+	}
+
+#else //compiled without AVX2 code generation
+
+	bool haveDXTShrinkageAVX2()
+	{
+		return false;
+	}
+
+	void DCTShrinkage8x8Batch_AVX2(const float* src, float* dest, int step, float thresh)
+	{
+		CV_Error(Error::StsNotImplemented, "dxtDenoiseAVX2.cpp is compiled without AVX2");
+	}
+
+	void DHTShrinkage8x8Batch_AVX2(const float* src, float* dest, int step, float thresh)
+	{
+		CV_Error(Error::StsNotImplemented, "dxtDenoiseAVX2.cpp is compiled without AVX2");
+	}
+
+	void DHTShrinkage16x16Batch_AVX2(const float* src, float* dest, int step, float thresh)
+	{
+		CV_Error(Error::StsNotImplemented, "dxtDenoiseAVX2.cpp is compiled without AVX2");
+	}
+#endif
+}
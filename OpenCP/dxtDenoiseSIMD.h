@@ -0,0 +1,25 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+namespace cp
+{
+	//wide vector kernels of dxtDenoise.cpp, which are selected at runtime.
+	//dxtDenoiseAVX2.cpp and dxtDenoiseAVX512.cpp are compiled with AVX2/FMA and AVX-512F/BW/DQ/VL code generation, respectively.
+	//have*() returns false when the translation unit is compiled without the instruction set or the CPU does not support it,
+	//then the SSE4 invokers in dxtDenoise.cpp are used.
+
+	//a call shrinks the 8 (AVX2) or 16 (AVX-512) horizontally neighbouring patches at src+i (one patch per vector lane), and adds them to dest+i.
+	//the column transforms of the columns shared by the patches are computed once, and the row transforms need no transposition.
+	//step is the row step of src and dest in floats. the threshold and the kept DC coefficient are the same as
+	//fDCT8x8_32f_and_threshold_and_iDCT8x8_32f, Hadamard2D8x8andThreshandIDHT and Hadamard2D16x16andThreshandIDHT.
+	bool haveDXTShrinkageAVX2();
+	void DCTShrinkage8x8Batch_AVX2(const float* src, float* dest, int step, float thresh);
+	void DHTShrinkage8x8Batch_AVX2(const float* src, float* dest, int step, float thresh);
+	void DHTShrinkage16x16Batch_AVX2(const float* src, float* dest, int step, float thresh);
+
+	bool haveDXTShrinkageAVX512();
+	void DCTShrinkage8x8Batch_AVX512(const float* src, float* dest, int step, float thresh);
+	void DHTShrinkage8x8Batch_AVX512(const float* src, float* dest, int step, float thresh);
+	void DHTShrinkage16x16Batch_AVX512(const float* src, float* dest, int step, float thresh);
+}
@@ -0,0 +1,237 @@
+#include "opencp.hpp"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+using namespace cv;
+
+namespace cp
+{
+	static bool setCurrentThreadAffinity(const vector<int>& cores)
+	{
+#ifdef _WIN32
+		DWORD_PTR mask = 0;
+		for (size_t i = 0; i < cores.size(); i++)
+		{
+			if (cores[i] >= 0 && cores[i] < (int)sizeof(DWORD_PTR) * 8) mask |= (DWORD_PTR)1 << cores[i];
+		}
+		if (mask == 0) return false;
+		return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (size_t i = 0; i < cores.size(); i++)
+		{
+			if (cores[i] >= 0 && cores[i] < CPU_SETSIZE) CPU_SET(cores[i], &set);
+		}
+		if (CPU_COUNT(&set) == 0) return false;
+		return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+#else
+		return false;
+#endif
+	}
+
+	//pins the threads which execute the stripes; the stripes are oversubscribed so that every worker of the pool is visited
+	class SetAffinity_Invoker : public cv::ParallelLoopBody
+	{
+		const vector<int>& cores;
+	public:
+		SetAffinity_Invoker(const vector<int>& cores_) : cores(cores_) { ; }
+
+		void operator()(const Range& range) const
+		{
+			for (int i = range.start; i < range.end; i++)
+			{
+				setCurrentThreadAffinity(cores);
+				std::this_thread::yield();
+			}
+		}
+	};
+
+	void setExecutionContext(int numThreads, const vector<int>& cores)
+	{
+		const int th = (numThreads <= 0) ? getNumberOfCPUs() : numThreads;
+		cv::setNumThreads(th);
+
+		if (!cores.empty())
+		{
+			setCurrentThreadAffinity(cores);
+			const int n = 4 * th;
+			parallel_for_(Range(0, n), SetAffinity_Invoker(cores), n);
+		}
+	}
+
+	int getExecutionThreads()
+	{
+		return cv::getNumThreads();
+	}
+
+	int TaskGraph::addTask(const ParallelLoopBody& body, const Range& range, const vector<int>& dependencies, int nstripes)
+	{
+		CV_Assert(range.size() > 0);
+		for (size_t i = 0; i < dependencies.size(); i++)
+		{
+			CV_Assert(0 <= dependencies[i] && dependencies[i] < (int)tasks.size());
+		}
+
+		Task t;
+		t.body = &body;
+		t.range = range;
+		t.nstripes = (nstripes <= 0) ? getNumThreads() : nstripes;
+		t.nstripes = max(1, min(t.nstripes, range.size()));
+		t.dependencies = dependencies;
+		tasks.push_back(t);
+		return (int)tasks.size() - 1;
+	}
+
+	int TaskGraph::addTask(const Ptr<ParallelLoopBody>& body, const Range& range, const vector<int>& dependencies, int nstripes)
+	{
+		CV_Assert(!body.empty());
+		const int id = addTask(*body, range, dependencies, nstripes);
+		tasks[id].owner = body;
+		return id;
+	}
+
+	void TaskGraph::clear()
+	{
+		tasks.clear();
+	}
+
+	int TaskGraph::size() const
+	{
+		return (int)tasks.size();
+	}
+
+	//workers pop ready stripes from a shared queue; when the last stripe of a task finishes, the stripes of the tasks depending only on finished tasks are pushed.
+	//idle workers sleep on the condition variable until a stripe is pushed, the graph is finished or a body has thrown.
+	struct TaskGraphState
+	{
+		std::mutex mutex;
+		std::condition_variable cond;
+		deque<Point> ready;//(task, stripe)
+		vector<int> waiting;//number of unfinished dependencies
+		vector<int> remaining;//number of unfinished stripes
+		vector<vector<int> > children;
+		int finished;
+		bool failed;
+		std::exception_ptr error;//the first exception thrown by a body, which is rethrown by run()
+	};
+
+	class TaskGraphRun_Invoker : public cv::ParallelLoopBody
+	{
+		const vector<const ParallelLoopBody*>& bodies;
+		const vector<Range>& ranges;
+		const vector<int>& nstripes;
+		TaskGraphState& state;
+
+		void push(const int task) const
+		{
+			for (int s = 0; s < nstripes[task]; s++) state.ready.push_back(Point(task, s));
+		}
+
+	public:
+		TaskGraphRun_Invoker(const vector<const ParallelLoopBody*>& bodies_, const vector<Range>& ranges_, const vector<int>& nstripes_, TaskGraphState& state_)
+			: bodies(bodies_), ranges(ranges_), nstripes(nstripes_), state(state_)
+		{
+			;
+		}
+
+		void operator()(const Range& range) const
+		{
+			const int numTasks = (int)bodies.size();
+			for (;;)
+			{
+				Point job;
+				{
+					std::unique_lock<std::mutex> lock(state.mutex);
+					state.cond.wait(lock, [&] { return state.failed || state.finished == numTasks || !state.ready.empty(); });
+					if (state.failed || state.finished == numTasks) break;
+					job = state.ready.front();
+					state.ready.pop_front();
+				}
+
+				const Range& r = ranges[job.x];
+				const int n = nstripes[job.x];
+				const Range sub(r.start + (int)((int64)r.size() * job.y / n), r.start + (int)((int64)r.size() * (job.y + 1) / n));
+				try
+				{
+					(*bodies[job.x])(sub);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(state.mutex);
+					if (!state.failed) state.error = std::current_exception();
+					state.failed = true;
+					state.cond.notify_all();
+					break;
+				}
+
+				std::lock_guard<std::mutex> lock(state.mutex);
+				if (--state.remaining[job.x] == 0)
+				{
+					state.finished++;
+					const vector<int>& c = state.children[job.x];
+					for (size_t i = 0; i < c.size(); i++)
+					{
+						if (--state.waiting[c[i]] == 0) push(c[i]);
+					}
+					state.cond.notify_all();
+				}
+			}
+		}
+
+		void start() const
+		{
+			for (int i = 0; i < (int)bodies.size(); i++)
+			{
+				if (state.waiting[i] == 0) push(i);
+			}
+		}
+	};
+
+	void TaskGraph::run()
+	{
+		const int n = (int)tasks.size();
+		if (n == 0) return;
+
+		vector<const ParallelLoopBody*> bodies(n);
+		vector<Range> ranges(n);
+		vector<int> nstripes(n);
+		TaskGraphState state;
+		state.waiting.resize(n);
+		state.remaining.resize(n);
+		state.children.resize(n);
+		state.finished = 0;
+		state.failed = false;
+
+		int stripes = 0;
+		for (int i = 0; i < n; i++)
+		{
+			bodies[i] = tasks[i].body;
+			ranges[i] = tasks[i].range;
+			nstripes[i] = tasks[i].nstripes;
+			state.waiting[i] = (int)tasks[i].dependencies.size();
+			state.remaining[i] = tasks[i].nstripes;
+			for (size_t d = 0; d < tasks[i].dependencies.size(); d++) state.children[tasks[i].dependencies[d]].push_back(i);
+			stripes += tasks[i].nstripes;
+		}
+
+		TaskGraphRun_Invoker body(bodies, ranges, nstripes, state);
+		body.start();
+		const int workers = max(1, min(getNumThreads(), stripes));
+		parallel_for_(Range(0, workers), body, workers);
+
+		//the original exception keeps its type and error code
+		if (state.failed) std::rethrow_exception(state.error);
+	}
+}
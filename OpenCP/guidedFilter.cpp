@@ -1810,17 +1810,19 @@ namespace cp
 			split(src, v);
 			if (sse)
 			{
-#pragma omp parallel for
-				for (int i = 0; i < 3;i++) 
-					guidedFilterSrc1Guidance3SSE_(v[i], guidance, d[i], radius, eps);
-				
+				parallelFor(Range(0, 3), [&](const Range& range)
+				{
+					for (int i = range.start; i < range.end; i++)
+						guidedFilterSrc1Guidance3SSE_(v[i], guidance, d[i], radius, eps);
+				});
 			}
 			else
 			{
-#pragma omp parallel for
-				for (int i = 0; i < 3; i++)
-				guidedFilterSrc1Guidance3_(v[i], guidance, d[i], radius, eps);
-				
+				parallelFor(Range(0, 3), [&](const Range& range)
+				{
+					for (int i = range.start; i < range.end; i++)
+						guidedFilterSrc1Guidance3_(v[i], guidance, d[i], radius, eps);
+				});
 			}
 			merge(d, dest);
 		}
@@ -1831,17 +1833,19 @@ namespace cp
 			split(src, v);
 			if (sse)
 			{
-#pragma omp parallel for
-				for (int i = 0; i < 3; i++)
-				guidedFilterSrc1Guidance1SSE_(v[i], guidance, d[i], radius, eps);
-				
+				parallelFor(Range(0, 3), [&](const Range& range)
+				{
+					for (int i = range.start; i < range.end; i++)
+						guidedFilterSrc1Guidance1SSE_(v[i], guidance, d[i], radius, eps);
+				});
 			}
 			else
 			{
-#pragma omp parallel for
-				for (int i = 0; i < 3; i++)
-				guidedFilterSrc1Guidance1_(v[i], guidance, d[i], radius, eps);
-				
+				parallelFor(Range(0, 3), [&](const Range& range)
+				{
+					for (int i = range.start; i < range.end; i++)
+						guidedFilterSrc1Guidance1_(v[i], guidance, d[i], radius, eps);
+				});
 			}
 			merge(d, dest);
 		}
@@ -1,4 +1,5 @@
 #include <nmmintrin.h> //SSE4.2
+#include <opencv2/core/cvdef.h>
 #include <string.h>
 #include <stdio.h>
 void transpose4x4(float* src);
@@ -13,7 +14,7 @@ void print_m128(__m128 src);
 void Hadamard1D4(float *val)
 {
 	__m128 xmm0, xmm1, xmm2, xmm3;
-	__declspec(align(16)) float sign[2][4] = { { 1.0f, -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f, -1.0f } };
+	CV_DECL_ALIGNED(16) float sign[2][4] = { { 1.0f, -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f, -1.0f } };
 
 	xmm2 = _mm_load_ps(sign[0]);
 	xmm3 = _mm_load_ps(sign[1]);
@@ -33,8 +34,8 @@ void Hadamard1D8(float *val)
 {
 	__m128 xmm0, xmm1, xmm2;
 
-	__declspec(align(16)) float sign0[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
-	__declspec(align(16)) float sign1[4] = { 1.0f, 1.0f, -1.0f, -1.0f };
+	CV_DECL_ALIGNED(16) float sign0[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
+	CV_DECL_ALIGNED(16) float sign1[4] = { 1.0f, 1.0f, -1.0f, -1.0f };
 
 	xmm2 = _mm_load_ps(sign0);
 
@@ -73,7 +74,7 @@ void Hadamard1D16(float *val)
 {
 	__m128 xmm0, xmm1, xmm2;
 	__m128 mmadd0, mmadd1, mmadd2, mmadd3;
-	__declspec(align(16)) float sign[2][4] = { { 1.0f, -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f, -1.0f } };
+	CV_DECL_ALIGNED(16) float sign[2][4] = { { 1.0f, -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f, -1.0f } };
 
 	xmm2 = _mm_load_ps(sign[0]);
 
@@ -149,7 +150,7 @@ void Hadamard1D16(float *val)
 
 void Hadamard1D16x16(float *val)
 {
-	__declspec(align(16)) float sign[2][4] = { { 1.0f, -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f, -1.0f } };
+	CV_DECL_ALIGNED(16) float sign[2][4] = { { 1.0f, -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f, -1.0f } };
 	const __m128 sgn0 = _mm_load_ps(sign[0]);
 	const __m128 sgn1 = _mm_load_ps(sign[1]);
 
@@ -235,7 +236,7 @@ void Hadamard1Dn(float *val, size_t n)
 	size_t i, j, k;
 	__m128 xmm0, xmm1, xmm2;
 	float *addvalue, *subvalue;
-	__declspec(align(16)) float sign[2][4] = { { 1.0f, -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f, -1.0f } };
+	CV_DECL_ALIGNED(16) float sign[2][4] = { { 1.0f, -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f, -1.0f } };
 
 	xmm2 = _mm_load_ps(sign[0]);
 	for (i = 0, addvalue = val; i < n; i += 4, addvalue++)
@@ -290,7 +291,7 @@ void divval(float* src, int size, float div)
 void divvalandthresh(float* src, int size, float thresh, float div)
 {
 	const __m128 h = _mm_set1_ps(div);
-	const int __declspec(align(16)) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
+	const int CV_DECL_ALIGNED(16) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
 	const __m128 mth = _mm_set1_ps(thresh);
 	const __m128 zeros = _mm_setzero_ps();
 
@@ -372,11 +373,11 @@ void Hadamard2D4x4andThresh(float* src, float thresh)
 void Hadamard2D4x4andThreshandIDHT(float* src, float thresh)
 {
 	const __m128 h = _mm_set1_ps(0.25f);
-	const int __declspec(align(16)) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
+	const int CV_DECL_ALIGNED(16) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
 	const __m128 mth = _mm_set1_ps(thresh);
 	const __m128 zeros = _mm_setzero_ps();
 
-	__declspec(align(16)) float sign[2][4] = { { 1.0f, -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f, -1.0f } };
+	CV_DECL_ALIGNED(16) float sign[2][4] = { { 1.0f, -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f, -1.0f } };
 	float* val = src;
 
 	for (int i = 0; i < 4; i++)
@@ -566,8 +567,8 @@ void Hadamard2D8x8andThresh(float* src, float thresh)
 void Hadamard2D8x8i(float *vall)
 {
 	float* val = vall;
-	__declspec(align(16)) float sign0[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
-	__declspec(align(16)) float sign1[4] = { 1.0f, 1.0f, -1.0f, -1.0f };
+	CV_DECL_ALIGNED(16) float sign0[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
+	CV_DECL_ALIGNED(16) float sign1[4] = { 1.0f, 1.0f, -1.0f, -1.0f };
 
 	const __m128 sgn0 = _mm_load_ps(sign0);
 	const __m128 sgn1 = _mm_load_ps(sign1);
@@ -607,7 +608,7 @@ void Hadamard2D8x8i(float *vall)
 
 	float* src = vall;
 	{
-		__declspec(align(16)) float temp[16];
+		CV_DECL_ALIGNED(16) float temp[16];
 		__m128 m0 = _mm_load_ps(src);
 		__m128 m1 = _mm_load_ps(src + 8);
 		__m128 m2 = _mm_load_ps(src + 16);
@@ -698,8 +699,8 @@ void Hadamard2D8x8i(float *vall)
 void Hadamard2D8x8i_and_thresh(float *vall, float thresh)
 {
 	float* val = vall;
-	__declspec(align(16)) float sign0[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
-	__declspec(align(16)) float sign1[4] = { 1.0f, 1.0f, -1.0f, -1.0f };
+	CV_DECL_ALIGNED(16) float sign0[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
+	CV_DECL_ALIGNED(16) float sign1[4] = { 1.0f, 1.0f, -1.0f, -1.0f };
 
 	const __m128 sgn0 = _mm_load_ps(sign0);
 	const __m128 sgn1 = _mm_load_ps(sign1);
@@ -739,7 +740,7 @@ void Hadamard2D8x8i_and_thresh(float *vall, float thresh)
 
 	float* src = vall;
 	{
-		__declspec(align(16)) float temp[16];
+		CV_DECL_ALIGNED(16) float temp[16];
 		__m128 m0 = _mm_load_ps(src);
 		__m128 m1 = _mm_load_ps(src + 8);
 		__m128 m2 = _mm_load_ps(src + 16);
@@ -794,7 +795,7 @@ void Hadamard2D8x8i_and_thresh(float *vall, float thresh)
 	val = vall;
 
 	const __m128 h = _mm_set1_ps(0.125f);
-	const int __declspec(align(16)) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
+	const int CV_DECL_ALIGNED(16) v32f_absmask[] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
 	const __m128 mth = _mm_set1_ps(thresh);
 	const __m128 zeros = _mm_setzero_ps();
 
@@ -1,4 +1,5 @@
 #include "opencp.hpp"
+#include "nonLocalMeansIntegral.h"
 
 using namespace std;
 using namespace cv;
@@ -1807,6 +1808,10 @@ namespace cp
 		{
 			jointNonLocalMeansFilter_SP(src, guide, dest, templeteWindowSize, searchWindowSize, h, sigma, borderType);
 		}
+		else if (method == FILTER_INTEGRAL)
+		{
+			nonLocalMeansFilterIntegral(src, guide, dest, templeteWindowSize, searchWindowSize, h, sigma, borderType);
+		}
 	}
 
 	void jointNonLocalMeansFilter(Mat& src, Mat& guide, Mat& dest, int templeteWindowSize, int searchWindowSize, double h, double sigma, int method, int borderType)
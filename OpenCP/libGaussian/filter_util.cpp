@@ -87,7 +87,7 @@ void recursive_filter_impulse(T *h, long N,  const T *b, int p, const T *a, int
 template<typename T>
 void init_recursive_filter_(T *dest, const T *src, long N, long stride, const T *b, int p, const T *a, int q, T sum, T tol, int max_iter)
 {
-	__declspec(align(16)) T h[MAX_Q + 1];
+	CV_DECL_ALIGNED(16) T h[MAX_Q + 1];
     long n;
     int m;
     
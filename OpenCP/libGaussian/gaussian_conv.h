@@ -1,5 +1,6 @@
 #pragma once
 #include <fftw3.h>
+#include <opencv2/core/cvdef.h>
 /**
 * \author Pascal Getreuer <getreuer@cmla.ens-cachan.fr>
 *
@@ -293,8 +294,8 @@ void dct_gaussian_conv(dct_coeffs<double> c);
 *
 * \{
 */
-void am_gaussian_conv(float *dest, const float *src, long N, long stride, double sigma, int K, float tol, bool use_adjusted_q);
-void am_gaussian_conv_(double *dest, const double *src, long N, long stride, double sigma, int K, double tol, bool use_adjuste);
+void am_gaussian_conv(float *dest, const float *src, long N, long stride, float sigma, int K, float tol, bool use_adjusted_q);
+void am_gaussian_conv(double *dest, const double *src, long N, long stride, double sigma, int K, double tol, bool use_adjusted_q);
 
 void am_gaussian_conv_image(double *dest, const double *src, int width, int height, int num_channels, double sigma, int K, double tol, bool use_adjusted_q);
 void am_gaussian_conv_image(float *dest,  const float *src,  int width, int height, int num_channels, float sigma,  int K, float tol, bool use_adjusted_q);
@@ -489,8 +490,8 @@ free(buffer);
 template<typename T>
 struct sii_coeffs
 {
-	__declspec(align(16)) T weights[SII_MAX_K];     /**< Box weights     */
-	__declspec(align(16)) int radii[SII_MAX_K];      /**< Box radii       */
+	CV_DECL_ALIGNED(16) T weights[SII_MAX_K];     /**< Box weights     */
+	CV_DECL_ALIGNED(16) int radii[SII_MAX_K];      /**< Box radii       */
 	int K;                      /**< Number of boxes */
 };
 
@@ -573,9 +574,9 @@ free(buffer);
 template<typename T>
 struct deriche_coeffs
 {
-	__declspec(align(16)) T a[DERICHE_MAX_K + 1];             /**< Denominator coeffs          */
-	__declspec(align(16)) T b_causal[DERICHE_MAX_K];          /**< Causal numerator            */
-	__declspec(align(16)) T b_anticausal[DERICHE_MAX_K + 1];  /**< Anticausal numerator        */
+	CV_DECL_ALIGNED(16) T a[DERICHE_MAX_K + 1];             /**< Denominator coeffs          */
+	CV_DECL_ALIGNED(16) T b_causal[DERICHE_MAX_K];          /**< Causal numerator            */
+	CV_DECL_ALIGNED(16) T b_anticausal[DERICHE_MAX_K + 1];  /**< Anticausal numerator        */
 	T sum_causal;                       /**< Causal filter sum           */
 	T sum_anticausal;                   /**< Anticausal filter sum       */
 	T sigma;                            /**< Gaussian standard deviation */
@@ -653,8 +654,8 @@ vyv_gaussian_conv(c, dest, src, N, stride);
 template <typename T>
 struct vyv_coeffs
 {
-	__declspec(align(16)) T filter[VYV_MAX_K + 1];     /**< Recursive filter coefficients       */
-	__declspec(align(16)) T M[VYV_MAX_K * VYV_MAX_K];  /**< Matrix for handling right boundary  */
+	CV_DECL_ALIGNED(16) T filter[VYV_MAX_K + 1];     /**< Recursive filter coefficients       */
+	CV_DECL_ALIGNED(16) T M[VYV_MAX_K * VYV_MAX_K];  /**< Matrix for handling right boundary  */
 	T sigma;                     /**< Gaussian standard deviation         */
 	T tol;                       /**< Boundary accuracy                   */
 	int K;                         /**< Filter order                        */
@@ -180,17 +180,17 @@ template <typename T>
 void vyv_precomp_(vyv_coeffs<T> *c, T sigma, int K, T tol)
 {
 	/* Optimized unscaled pole locations. */
-	__declspec(align(16)) static const complex4c poles0[VYV_MAX_K - VYV_MIN_K + 1][5] = {
+	CV_DECL_ALIGNED(16) static const complex4c poles0[VYV_MAX_K - VYV_MIN_K + 1][5] = {
 		{ { 1.4165, 1.00829 }, { 1.4165, -1.00829 }, { 1.86543, 0 } },
 		{ { 1.13228, 1.28114 }, { 1.13228, -1.28114 },
 		{ 1.78534, 0.46763 }, { 1.78534, -0.46763 } },
 		{ { 0.8643, 1.45389 }, { 0.8643, -1.45389 },
 		{ 1.61433, 0.83134 }, { 1.61433, -0.83134 }, { 1.87504, 0 } }
 	};
-	__declspec(align(16)) complex4c poles[VYV_MAX_K];
+	CV_DECL_ALIGNED(16) complex4c poles[VYV_MAX_K];
 	double q;
-	__declspec(align(16)) double filter[VYV_MAX_K + 1];
-	__declspec(align(16)) double A[VYV_MAX_K * VYV_MAX_K], inv_A[VYV_MAX_K * VYV_MAX_K];
+	CV_DECL_ALIGNED(16) double filter[VYV_MAX_K + 1];
+	CV_DECL_ALIGNED(16) double A[VYV_MAX_K * VYV_MAX_K], inv_A[VYV_MAX_K * VYV_MAX_K];
 	int i, j, matrix_size;
 
 	assert(c && sigma > 0 && VYV_VALID_K(K) && tol > 0);
@@ -287,7 +287,7 @@ void vyv_gaussian_conv(const vyv_coeffs<T> c, T *dest, const T *src, const int N
 
 
 	/* Handle the left boundary. */
-	init_recursive_filter<T>(q, src, N, stride, c.filter, 0, c.filter, c.K, (T)1.0, c.tol, c.max_iter);
+	init_recursive_filter(q, src, N, stride, c.filter, 0, c.filter, c.K, (T)1.0, c.tol, c.max_iter);
 
 	for (m = 0; m < c.K; ++m)
 		dest[stride * m] = q[m];
@@ -392,7 +392,7 @@ template <typename T>
 void vyv_gaussian_conv_w(const vyv_coeffs<T> c, T *dest, const T *src, const int N)
 {
 	//const vyv_coeffs<T> c = c_;
-	__declspec(align(16)) T q[VYV_MAX_K];
+	CV_DECL_ALIGNED(16) T q[VYV_MAX_K];
 	long i;
 	int m, n;
 
@@ -406,7 +406,7 @@ void vyv_gaussian_conv_w(const vyv_coeffs<T> c, T *dest, const T *src, const int
 
 
 	/* Handle the left boundary. */
-	init_recursive_filter<T>(q, src, N, 1, c.filter, 0, c.filter, c.K, (T)1.0, c.tol, c.max_iter);
+	init_recursive_filter(q, src, N, 1, c.filter, 0, c.filter, c.K, (T)1.0, c.tol, c.max_iter);
 
 	for (m = 0; m < c.K; ++m)
 		dest[m] = q[m];
@@ -511,7 +511,7 @@ template <>
 void vyv_gaussian_conv_w<float>(const vyv_coeffs<float> c, float *dest, const float *src, const int N)
 {
 	//const vyv_coeffs<T> c = c_;
-	__declspec(align(16)) float q[VYV_MAX_K];
+	CV_DECL_ALIGNED(16) float q[VYV_MAX_K];
 	long i;
 	int m, n;
 
@@ -524,7 +524,7 @@ void vyv_gaussian_conv_w<float>(const vyv_coeffs<float> c, float *dest, const fl
 	}
 
 	/* Handle the left boundary. */
-	init_recursive_filter<float>(q, src, N, 1, c.filter, 0, c.filter, c.K, 1.f, c.tol, c.max_iter);
+	init_recursive_filter(q, src, N, 1, c.filter, 0, c.filter, c.K, 1.f, c.tol, c.max_iter);
 
 	for (m = 0; m < c.K; ++m)
 		dest[m] = q[m];
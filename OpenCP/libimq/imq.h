@@ -1,7 +1,9 @@
 #pragma once
 
 #define PC601
+#ifdef _WIN32
 #include <tchar.h>
+#endif
 #include <fftw3.h>
 
 #ifdef REC601
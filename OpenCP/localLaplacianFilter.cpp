@@ -1,62 +1,204 @@
 #include "opencp.hpp"
+#include "fmath.hpp"
 #include <iostream>
-#ifdef _OPENMP
-#include <omp.h>
-#endif
 
 using namespace std;
 using namespace cv;
 
 namespace cp
 {
+	//remapping function of the local Laplacian filter around g:
+	//|d| <= sigma_r: g + sign(d) sigma_r (|d|/sigma_r)^alpha (detail), |d| > sigma_r: g + sign(d) (beta (|d| - sigma_r) + sigma_r) (edge)
+	class LocalLaplacianRemap_Invoker : public cv::ParallelLoopBody
+	{
+		const Mat* src;
+		Mat* dest;
+		float g, sigma_r, alpha, beta;
 
+	public:
+		LocalLaplacianRemap_Invoker(const Mat& src_, Mat& dest_, float g_, float sigma_r_, float alpha_, float beta_)
+			: src(&src_), dest(&dest_), g(g_), sigma_r(sigma_r_), alpha(alpha_), beta(beta_)
+		{
+			;
+		}
 
+		void operator()(const Range& range) const
+		{
+			const float inv_sigma_r = 1.f / sigma_r;
+			for (int y = range.start; y < range.end; y++)
+			{
+				const float* s = src->ptr<float>(y);
+				float* d = dest->ptr<float>(y);
+				int x = 0;
+#if CV_SSE4_1
+				const __m128 mg = _mm_set1_ps(g);
+				const __m128 msigma = _mm_set1_ps(sigma_r);
+				const __m128 minv = _mm_set1_ps(inv_sigma_r);
+				const __m128 malpha = _mm_set1_ps(alpha);
+				const __m128 mbeta = _mm_set1_ps(beta);
+				const __m128 mtiny = _mm_set1_ps(1.0e-8f);
+				const __m128 msign = _mm_set1_ps(-0.f);
+				for (; x <= dest->cols - 4; x += 4)
+				{
+					const __m128 diff = _mm_sub_ps(_mm_loadu_ps(s + x), mg);
+					const __m128 sgn = _mm_and_ps(diff, msign);
+					const __m128 a = _mm_andnot_ps(msign, diff);
+
+					//detail: sigma_r * (a/sigma_r)^alpha = sigma_r * exp(alpha * log(a/sigma_r)); t is clamped only to avoid log(0), and the detail of a==0 is masked to 0 as the scalar pow
+					const __m128 t = _mm_max_ps(_mm_mul_ps(a, minv), mtiny);
+					const __m128 detail = _mm_and_ps(_mm_cmpgt_ps(a, _mm_setzero_ps()), _mm_mul_ps(msigma, fmath::exp_ps(_mm_mul_ps(malpha, fmath::log_ps(t)))));
+					const __m128 edge = _mm_add_ps(_mm_mul_ps(mbeta, _mm_sub_ps(a, msigma)), msigma);
+					const __m128 v = _mm_blendv_ps(edge, detail, _mm_cmple_ps(a, msigma));
+					_mm_storeu_ps(d + x, _mm_add_ps(mg, _mm_or_ps(v, sgn)));
+				}
+#endif
+				for (; x < dest->cols; x++)
+				{
+					const float diff = s[x] - g;
+					const float a = abs(diff);
+					const float v = (a <= sigma_r) ? sigma_r * pow(a * inv_sigma_r, alpha) : beta * (a - sigma_r) + sigma_r;
+					d[x] = (diff < 0.f) ? g - v : g + v;
+				}
+			}
+		}
+	};
 
-	double fd(double d, double tau, double alpha)
+	//out += w * (cur - up), w = max(0, 1 - |gauss - g| / step): linear interpolation between the nearest two sampled levels
+	class LocalLaplacianAccumulate_Invoker : public cv::ParallelLoopBody
 	{
-		return tau * pow(d, alpha) + (1.0 - tau) * d;
-	}
+		const Mat* cur;
+		const Mat* up;
+		const Mat* gauss;
+		Mat* out;
+		float g, inv_step;
+
+	public:
+		LocalLaplacianAccumulate_Invoker(const Mat& cur_, const Mat& up_, const Mat& gauss_, Mat& out_, float g_, float inv_step_)
+			: cur(&cur_), up(&up_), gauss(&gauss_), out(&out_), g(g_), inv_step(inv_step_)
+		{
+			;
+		}
 
-	double fe(double d)
-	{
-		return d;
-	}
+		void operator()(const Range& range) const
+		{
+			for (int y = range.start; y < range.end; y++)
+			{
+				const float* c = cur->ptr<float>(y);
+				const float* u = up->ptr<float>(y);
+				const float* s = gauss->ptr<float>(y);
+				float* d = out->ptr<float>(y);
+				int x = 0;
+#if CV_SSE4_1
+				const __m128 mg = _mm_set1_ps(g);
+				const __m128 minv = _mm_set1_ps(inv_step);
+				const __m128 mone = _mm_set1_ps(1.f);
+				const __m128 msign = _mm_set1_ps(-0.f);
+				for (; x <= out->cols - 4; x += 4)
+				{
+					const __m128 t = _mm_andnot_ps(msign, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(s + x), mg), minv));
+					const __m128 w = _mm_max_ps(_mm_sub_ps(mone, t), _mm_setzero_ps());
+					const __m128 lap = _mm_sub_ps(_mm_loadu_ps(c + x), _mm_loadu_ps(u + x));
+					_mm_storeu_ps(d + x, _mm_add_ps(_mm_loadu_ps(d + x), _mm_mul_ps(w, lap)));
+				}
+#endif
+				for (; x < out->cols; x++)
+				{
+					const float w = max(0.f, 1.f - abs(s[x] - g) * inv_step);
+					d[x] += w * (c[x] - u[x]);
+				}
+			}
+		}
+	};
 
-	double sign(double d)
+	static int getLocalLaplacianDefaultLevels(const Size size)
 	{
-		if (d > 0.0) return 1.0;
-		if (d < 0.0) return -1.0;
-		return 0.0;
+		//the coarsest level is around 16 pixels
+		const int n = (int)floor(log((double)min(size.width, size.height)) / log(2.0));
+		return max(1, n - 3);
 	}
 
-	// remapping function
-	void remapping(cv::Mat& R, cv::Vec3f g0, double sigma_r, double tau, double alpha)
+	void LocalLaplacianFilter::filterPlane(const Mat& src, Mat& dest, float sigma_r, float alpha, float beta, int levels, int numSamples)
 	{
-		for (int y = 0; y < R.rows; y++)
+		double minv, maxv;
+		minMaxLoc(src, &minv, &maxv);
+		if (levels == 1 || maxv - minv <= 0.0)
+		{
+			src.copyTo(dest);
+			return;
+		}
+
+		gaussianPyramid.resize(levels);
+		outputPyramid.resize(levels);
+		remapPyramid.resize(levels);
+		gaussianPyramid[0] = src;
+		for (int l = 1; l < levels; l++) pyrDown(gaussianPyramid[l - 1], gaussianPyramid[l]);
+		for (int l = 0; l < levels - 1; l++)
+		{
+			outputPyramid[l].create(gaussianPyramid[l].size(), CV_32F);
+			outputPyramid[l].setTo(0);
+		}
+
+		const int K = (numSamples > 1) ? numSamples : max(2, min(64, (int)ceil((maxv - minv) / (0.5 * sigma_r)) + 1));
+		const float step = (float)((maxv - minv) / (K - 1));
+		for (int k = 0; k < K; k++)
 		{
-			for (int x = 0; x < R.cols; x++)
+			const float g = (float)(minv + k * step);
+
+			remapPyramid[0].create(src.size(), CV_32F);
+			parallel_for_(Range(0, src.rows), LocalLaplacianRemap_Invoker(src, remapPyramid[0], g, sigma_r, alpha, beta));
+
+			//Laplacian pyramid of the remapped image, which is accumulated level by level
+			for (int l = 0; l < levels - 1; l++)
 			{
-				cv::Vec3f i = R.at<cv::Vec3f>(y, x);
-				cv::Vec3f v = i - g0;
-				double nrm = cv::norm(v);
-				if (nrm != 0.0) v = v / nrm;
-				if (nrm <= sigma_r)
-				{
-					R.at<cv::Vec3f>(y, x) = g0 + v * sigma_r * fd(nrm / sigma_r, tau, alpha);
-				}
-				else
-				{
-					R.at<cv::Vec3f>(y, x) = g0 + v * (fe(nrm - sigma_r) + sigma_r);
-				}
+				pyrDown(remapPyramid[l], remapPyramid[l + 1]);
+				pyrUp(remapPyramid[l + 1], up, remapPyramid[l].size());
+				parallel_for_(Range(0, up.rows), LocalLaplacianAccumulate_Invoker(remapPyramid[l], up, gaussianPyramid[l], outputPyramid[l], g, 1.f / step));
 			}
 		}
+
+		//collapse with the residual of the input
+		gaussianPyramid[levels - 1].copyTo(dest);
+		for (int l = levels - 2; l >= 0; l--)
+		{
+			pyrUp(dest, up, outputPyramid[l].size());
+			add(up, outputPyramid[l], dest);
+		}
+	}
+
+	void LocalLaplacianFilter::operator()(InputArray src_, OutputArray dest, const double sigma_r, const double alpha, const double beta, const int levels, const int numSamples)
+	{
+		CV_Assert(!src_.empty() && sigma_r > 0.0);
+		Mat src = src_.getMat();
+		const int depth = src.depth();
+		const double scale = (depth == CV_8U) ? 255.0 : (depth == CV_16U) ? 65535.0 : 1.0;
+		const int L = (levels > 0) ? levels : getLocalLaplacianDefaultLevels(src.size());
+
+		src.convertTo(normalized, CV_32F, 1.0 / scale);
+		split(normalized, planes);
+		for (size_t c = 0; c < planes.size(); c++)
+		{
+			filterPlane(planes[c], result, (float)sigma_r, (float)alpha, (float)beta, L, numSamples);
+			result.copyTo(planes[c]);
+		}
+		merge(planes, normalized);
+
+		if (depth == CV_8U || depth == CV_16U || depth == CV_16S || depth == CV_32S)
+			normalized.convertTo(dest, depth, scale, 0.5);
+		else
+			normalized.convertTo(dest, depth, scale);
+	}
+
+	void localLaplacianFilter(InputArray src, OutputArray dest, const double sigma_r, const double alpha, const double beta, const int levels, const int numSamples)
+	{
+		LocalLaplacianFilter llf;
+		llf(src, dest, sigma_r, alpha, beta, levels, numSamples);
 	}
 
 	// main function
 	int llf(int argc, char** argv)
 	{
 		if (argc <= 1) {
-			cout << "usage: LocalLaplacianFilter.exe [input image] ([sigma_r] [max level] [alpha] [tau])" << endl;
+			cout << "usage: LocalLaplacianFilter.exe [input image] ([sigma_r] [max level] [alpha] [beta])" << endl;
 			return -1;
 		}
 
@@ -66,110 +208,20 @@ namespace cp
 			return -1;
 		}
 
-		const int width = img.cols;
-		const int height = img.rows;
-		const int dim = img.channels();
-		img.convertTo(img, CV_32F, 1.0 / 255.0);
-
 		// initial parameter values
 		const double sigma_r = argc > 2 ? atof(argv[2]) : 0.2;
-		const int    maxLevel = argc > 3 ? atoi(argv[3]) : 3;
-		const double alpha = argc > 4 ? atof(argv[4]) : 4.0;
-		const double tau = argc > 5 ? atof(argv[5]) : 0.8;
-
-		// stdout info.
-		printf("*** Local Laplacian Filter ***\n");
-		printf("  sigma_r   = %f\n", sigma_r);
-		printf("  max level = %d\n", maxLevel);
-		printf("  alpha     = %f\n", alpha);
-		printf("  tau       = %f\n", tau);
-		printf("\n");
-
-		// building a Gaussian pyramid
-		cv::Mat tmp;
-		double sigma = 2.0;
-		vector<cv::Mat> GaussianPyramid(maxLevel + 1);
-		img.convertTo(GaussianPyramid[0], CV_32F);
-		for (int level = 1; level <= maxLevel; level++)
-		{
-			cv::GaussianBlur(GaussianPyramid[level - 1], tmp, cv::Size(), sigma);
-			cv::pyrDown(tmp, GaussianPyramid[level]);
-		}
-
-		// building a Laplacian pyramid, and remapping the coefficients
-		vector<cv::Mat> laplacePyramid(maxLevel);
-		for (int level = 0; level < maxLevel; level++)
-		{
-			printf("  Process Lv. %d ...\n", level);
-			laplacePyramid[level] = cv::Mat::zeros(GaussianPyramid[level].size(), CV_MAKETYPE(CV_32F, dim));
+		const int    maxLevel = argc > 3 ? atoi(argv[3]) : 0;
+		const double alpha = argc > 4 ? atof(argv[4]) : 0.25;
+		const double beta = argc > 5 ? atof(argv[5]) : 1.0;
 
-#pragma omp parallel for
-			for (int y = 0; y < GaussianPyramid[level].rows; y++)
-			{
-				for (int x = 0; x < GaussianPyramid[level].cols; x++)
-				{
-					int rx = x;
-					int ry = y;
-					int K = 4;
-					int l = level;
-					while (l > 0)
-					{
-						rx *= 2;
-						ry *= 2;
-						K *= 2;
-						l--;
-					}
-
-					K = 3 * (K - 1);
-					int cx = max(0, rx - K);
-					int cy = max(0, ry - K);
-					int bx = min(width - 1, rx + K);
-					int by = min(height - 1, ry + K);
-
-					cv::Mat R, tmp;
-					tmp = img(cv::Rect(cx, cy, bx - cx + 1, by - cy + 1));
-					tmp.convertTo(R, CV_32F);
-					cv::Vec3f g0 = GaussianPyramid[level].at<cv::Vec3f>(y, x);
-					remapping(R, g0, sigma_r, tau, alpha);
-
-					for (int sublev = 0; sublev < level; sublev++)
-					{
-						cv::pyrDown(R, tmp);
-						tmp.convertTo(R, CV_32F);
-					}
-
-					cv::Mat subR;
-					cv::pyrDown(R, tmp);
-					cv::pyrUp(tmp, subR, R.size());
-					cv::Mat L = R - subR;
-
-					for (int sublev = 0; sublev < level; sublev++)
-					{
-						cv::pyrUp(L, tmp);
-						tmp.convertTo(L, CV_32F);
-					}
-
-					int dx = cx - (rx - K);
-					int dy = cy - (ry - K);
-					laplacePyramid[level].at<cv::Vec3f>(y, x) = L.at<cv::Vec3f>(K + 1 - dy, K + 1 - dx);
-				}
-			}
-		}
-		printf("  Finish!\n\n");
-
-		// reconstruct resulting image from laplacian pyramid
 		cv::Mat res;
-		GaussianPyramid[maxLevel].convertTo(res, CV_32F);
-		for (int level = maxLevel - 1; level >= 0; level--)
-		{
-			cv::pyrUp(res, tmp, GaussianPyramid[level].size());
-			res = tmp + laplacePyramid[level];
-		}
+		localLaplacianFilter(img, res, sigma_r, alpha, beta, maxLevel);
 
 		// show results
 		cv::imshow("Input", img);
 		cv::imshow("Result", res);
 		cv::waitKey(0);
 		cv::destroyAllWindows();
+		return 0;
 	}
-}
\ No newline at end of file
+}
@@ -1,4 +1,5 @@
 #include <nmmintrin.h> //SSE4.2
+#include <opencv2/core/cvdef.h>
 #include <string.h>
 #include <stdio.h>
 void transpose4x4(float* src)
@@ -72,7 +73,7 @@ void transpose8x8(const float* src, float* dest)
 
 void transpose8x8(float* src)
 {
-	__declspec(align(16)) float temp[16];
+	CV_DECL_ALIGNED(16) float temp[16];
 	__m128 m0 = _mm_load_ps(src);
 	__m128 m1 = _mm_load_ps(src + 8);
 	__m128 m2 = _mm_load_ps(src + 16);
@@ -126,8 +127,8 @@ void transpose8x8(float* src)
 
 void transpose16x16(float* src)
 {
-	__declspec(align(16)) float temp[64];
-	__declspec(align(16)) float tmp[64];
+	CV_DECL_ALIGNED(16) float temp[64];
+	CV_DECL_ALIGNED(16) float tmp[64];
 	int sz = sizeof(float) * 8;
 	for (int i = 0; i < 8; i++)
 	{
@@ -1,4 +1,5 @@
 #include "opencp.hpp"
+#include "nonLocalMeansIntegral.h"
 
 using namespace std;
 using namespace cv;
@@ -773,6 +774,194 @@ namespace cp
 	};
 
 
+	//FILTER_INTEGRAL: box sums of the difference image of each search offset in row stripes.
+	//a stripe keeps the last templeteWindowSizeY difference rows, and their column sums are slid down the stripe.
+	//frame 0 is the current frame, and the others are reference frames (previous frames of video) searched with their own search window.
+	class NonlocalMeansFilterIntegralInvorker : public cv::ParallelLoopBody
+	{
+	private:
+		const vector<Mat>* im;
+		const vector<Mat>* gim;
+		const vector<Size>* searchWindowSize;
+		Mat* dest;
+		int templeteWindowSizeX;
+		int templeteWindowSizeY;
+		int bbx;
+		int bby;
+		const float* w;
+		int wsize;
+		int nstripes;
+
+	public:
+		NonlocalMeansFilterIntegralInvorker(const vector<Mat>& src_, const vector<Mat>& guide_, const vector<Size>& searchWindowSize_, Mat& dest_, int templeteWindowSizeX_, int templeteWindowSizeY_, int bbx_, int bby_, const float* weight, int wsize_, int nstripes_)
+			: im(&src_), gim(&guide_), searchWindowSize(&searchWindowSize_), dest(&dest_), templeteWindowSizeX(templeteWindowSizeX_), templeteWindowSizeY(templeteWindowSizeY_), bbx(bbx_), bby(bby_), w(weight), wsize(wsize_), nstripes(nstripes_)
+		{
+			;
+		}
+
+		virtual void operator()(const cv::Range &r) const
+		{
+			const int tr_x = templeteWindowSizeX >> 1;
+			const int tr_y = templeteWindowSizeY >> 1;
+			//top-left of the templete window of the pixel (0, 0)
+			const int ox = bbx - tr_x;
+			const int oy = bby - tr_y;
+			const int cn = dest->channels();
+			const int gcn = (*gim)[0].channels();
+			const int width = dest->cols;
+			const int dwidth = width + templeteWindowSizeX - 1;//width of the difference rows
+
+			const float tdiv = 1.f / (float)(templeteWindowSizeX*templeteWindowSizeY);//templete square div
+
+			for (int n = r.start; n < r.end; n++)
+			{
+				const int y0 = dest->rows * n / nstripes;
+				const int y1 = dest->rows * (n + 1) / nstripes;
+				const int height = y1 - y0;
+				if (height == 0) continue;
+
+				vector<float> diff(templeteWindowSizeY*dwidth);
+				vector<float> colsum(dwidth);
+				vector<float> value(height*width*cn, 0.f);
+				vector<float> tweight(height*width, 0.f);
+
+				for (int f = 0; f < (int)im->size(); f++)
+				{
+					const Mat& cim = (*gim)[0];
+					const Mat& rim = (*im)[f];
+					const Mat& rgim = (*gim)[f];
+					const int sr_x = (*searchWindowSize)[f].width >> 1;
+					const int sr_y = (*searchWindowSize)[f].height >> 1;
+
+					//search loop
+					for (int dy = -sr_y; dy <= sr_y; dy++)
+					{
+						for (int dx = -sr_x; dx <= sr_x; dx++)
+						{
+							std::fill(colsum.begin(), colsum.end(), 0.f);
+
+							for (int rr = 0; rr < height + templeteWindowSizeY - 1; rr++)
+							{
+								const float* g = cim.ptr<float>(oy + y0 + rr) + gcn*ox;
+								const float* gs = rgim.ptr<float>(oy + y0 + rr + dy) + gcn*(ox + dx);
+								float* drow = &diff[(rr % templeteWindowSizeY)*dwidth];
+								if (rr >= templeteWindowSizeY)
+								{
+									for (int i = 0; i < dwidth; i++) colsum[i] -= drow[i];
+								}
+
+								//color L1 norm
+								if (gcn == 1)
+								{
+									for (int i = 0; i < dwidth; i++)
+									{
+										drow[i] = abs(g[i] - gs[i]);
+										colsum[i] += drow[i];
+									}
+								}
+								else
+								{
+									for (int i = 0; i < dwidth; i++)
+									{
+										drow[i] = abs(g[3 * i + 0] - gs[3 * i + 0]) + abs(g[3 * i + 1] - gs[3 * i + 1]) + abs(g[3 * i + 2] - gs[3 * i + 2]);
+										colsum[i] += drow[i];
+									}
+								}
+								if (rr < templeteWindowSizeY - 1) continue;
+
+								//the templete window of the row j is complete
+								const int j = rr - (templeteWindowSizeY - 1);
+								const float* s = rim.ptr<float>(bby + y0 + j + dy) + cn*(bbx + dx);
+								float* v = &value[j*width*cn];
+								float* tw = &tweight[j*width];
+
+								float e = 0.f;
+								for (int m = 0; m < templeteWindowSizeX - 1; m++) e += colsum[m];
+								for (int i = 0; i < width; i++)
+								{
+									e += colsum[i + templeteWindowSizeX - 1];
+									const float www = w[min(cvRound(e*tdiv), wsize - 1)];
+									e -= colsum[i];
+
+									for (int c = 0; c < cn; c++) v[cn*i + c] += www*s[cn*i + c];
+									tw[i] += www;
+								}
+							}
+						}
+					}
+				}
+
+				//weight normalization
+				for (int j = 0; j < height; j++)
+				{
+					float* d = dest->ptr<float>(y0 + j);
+					const float* v = &value[j*width*cn];
+					const float* tw = &tweight[j*width];
+					for (int i = 0; i < width; i++)
+					{
+						const float div = 1.f / tw[i];
+						for (int c = 0; c < cn; c++) d[cn*i + c] = v[cn*i + c] * div;
+					}
+				}
+			}
+		}
+	};
+
+	void nonLocalMeansFilterIntegralPadded(const vector<Mat>& srcs, const vector<Mat>& guides, const vector<Size>& searchWindowSizes, Mat& dest, Size templeteWindowSize, Point border, double h, double sigma)
+	{
+		CV_Assert(!srcs.empty() && srcs.size() == guides.size() && srcs.size() == searchWindowSizes.size());
+		CV_Assert(srcs[0].depth() == CV_32F && guides[0].depth() == CV_32F);
+		CV_Assert(srcs[0].channels() == 1 || srcs[0].channels() == 3);
+		CV_Assert(guides[0].channels() == 1 || guides[0].channels() == 3);
+		for (int i = 0; i < (int)searchWindowSizes.size(); i++)
+		{
+			CV_Assert((templeteWindowSize.width >> 1) + (searchWindowSizes[i].width >> 1) <= border.x);
+			CV_Assert((templeteWindowSize.height >> 1) + (searchWindowSizes[i].height >> 1) <= border.y);
+		}
+
+		//weight computation; the same table as nonLocalMeansFilter_SSE, and larger distances are clipped to the last entry
+		const int gcn = guides[0].channels();
+		const int wsize = 256 * gcn;
+		vector<float> weight(wsize);
+		float* w = &weight[0];
+		const double gauss_sd = (sigma == 0.0) ? h : sigma;
+		double gauss_color_coeff = -(1.0 / (double)(gcn))*(1.0 / (h*h));
+		for (int i = 0; i < wsize; i++)
+		{
+			double v = std::exp(max(i*i - 2.0*gauss_sd*gauss_sd, 0.0)*gauss_color_coeff);
+			w[i] = (float)v;
+		}
+
+		dest.create(Size(srcs[0].cols - 2 * border.x, srcs[0].rows - 2 * border.y), srcs[0].type());
+		const int nstripes = max(1, min(getNumThreads(), dest.rows));
+		NonlocalMeansFilterIntegralInvorker body(srcs, guides, searchWindowSizes, dest, templeteWindowSize.width, templeteWindowSize.height, border.x, border.y, w, wsize, nstripes);
+		cv::parallel_for_(Range(0, nstripes), body, nstripes);
+	}
+
+	void nonLocalMeansFilterIntegral(const Mat& src, const Mat& guide, Mat& dest, Size templeteWindowSize, Size searchWindowSize, double h, double sigma, int borderType)
+	{
+		CV_Assert(src.channels() == 1 || src.channels() == 3);
+		CV_Assert(guide.channels() == 1 || guide.channels() == 3);
+		CV_Assert(src.size() == guide.size());
+
+		const int bbx = (templeteWindowSize.width >> 1) + (searchWindowSize.width >> 1);
+		const int bby = (templeteWindowSize.height >> 1) + (searchWindowSize.height >> 1);
+
+		//create large size image for bounding box;
+		vector<Mat> im(1), gim(1);
+		{
+			Mat temp;
+			copyMakeBorder(src, temp, bby, bby, bbx, bbx, borderType);
+			temp.convertTo(im[0], CV_32F);
+			copyMakeBorder(guide, temp, bby, bby, bbx, bbx, borderType);
+			temp.convertTo(gim[0], CV_32F);
+		}
+
+		Mat dst;
+		nonLocalMeansFilterIntegralPadded(im, gim, vector<Size>(1, searchWindowSize), dst, templeteWindowSize, Point(bbx, bby), h, sigma);
+		dst.convertTo(dest, src.depth());
+	}
+
 	void nonLocalMeansFilterBase(Mat& src, Mat& dest, Size templeteWindowSize, Size searchWindowSize, double h, double sigma, int borderType)
 	{
 		if (dest.empty())dest = Mat::zeros(src.size(), src.type());
@@ -933,6 +1122,10 @@ namespace cp
 		{
 			nonLocalMeansFilter_SP(src, dest, templeteWindowSize, searchWindowSize, h, sigma, borderType);
 		}
+		else if (method == FILTER_INTEGRAL)
+		{
+			nonLocalMeansFilterIntegral(src, src, dest, templeteWindowSize, searchWindowSize, h, sigma, borderType);
+		}
 	}
 
 	void nonLocalMeansFilter(Mat& src, Mat& dest, int templeteWindowSize, int searchWindowSize, double h, double sigma, int method, int borderType)
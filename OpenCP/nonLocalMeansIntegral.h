@@ -0,0 +1,16 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+namespace cp
+{
+	//non-local means of FILTER_INTEGRAL, which is used in nonLocalMeans.cpp and jointNonLocalMeans.cpp.
+	//the difference image of each search offset is computed once and the template distances are its box sums,
+	//so that the cost does not depend on the template window size.
+	//the distances are computed on guide (1 or 3 channels) and src (1 or 3 channels) is averaged; src and guide can be the same.
+	void nonLocalMeansFilterIntegral(const cv::Mat& src, const cv::Mat& guide, cv::Mat& dest, cv::Size templeteWindowSize, cv::Size searchWindowSize, double h, double sigma, int borderType);
+
+	//FILTER_INTEGRAL on CV_32F frames padded by border; srcs[0] and guides[0] are the current frame, and the others are reference frames such as the previous frames of video.
+	//the frame i is searched in searchWindowSizes[i], and templeteWindowSize/2 + searchWindowSizes[i]/2 must be within border. dest is CV_32F of the unpadded size.
+	void nonLocalMeansFilterIntegralPadded(const std::vector<cv::Mat>& srcs, const std::vector<cv::Mat>& guides, const std::vector<cv::Size>& searchWindowSizes, cv::Mat& dest, cv::Size templeteWindowSize, cv::Point border, double h, double sigma);
+}
@@ -0,0 +1,129 @@
+#include "opencp.hpp"
+#include "nonLocalMeansIntegral.h"
+
+using namespace std;
+using namespace cv;
+
+namespace cp
+{
+	VideoNonLocalMeansFilter::VideoNonLocalMeansFilter(int numberOfFrames_)
+	{
+		numberOfFrames = numberOfFrames_;
+		temporalSearchWindowSize = Size(7, 7);
+		isMotionCompensation = false;
+		flowKernelSize = Size(7, 7);
+		flowSearchRange = 4;
+
+		imageType = -1;
+	}
+
+	void VideoNonLocalMeansFilter::clear()
+	{
+		ringSrc.clear();
+		ringSrcPad.clear();
+		ringMapx.clear();
+		ringMapy.clear();
+		prevGray.release();
+	}
+
+	void VideoNonLocalMeansFilter::operator()(const Mat& src, Mat& dest, Size templeteWindowSize, Size searchWindowSize, double h, double sigma, int borderType)
+	{
+		CV_Assert(src.channels() == 1 || src.channels() == 3);
+		if (sigma < 1.0) sigma = h;
+
+		//the border covers the larger one of the spatial and the temporal search windows
+		const Point b((templeteWindowSize.width >> 1) + (max(searchWindowSize.width, temporalSearchWindowSize.width) >> 1),
+			(templeteWindowSize.height >> 1) + (max(searchWindowSize.height, temporalSearchWindowSize.height) >> 1));
+		if (src.size() != imageSize || src.type() != imageType || b != border)
+		{
+			clear();
+			imageSize = src.size();
+			imageType = src.type();
+			border = b;
+		}
+
+		Mat srcf, srcfPad;
+		src.convertTo(srcf, CV_32F);
+		copyMakeBorder(srcf, srcfPad, border.y, border.y, border.x, border.x, borderType);
+
+		if (isMotionCompensation)
+		{
+			Mat gray;
+			if (src.channels() == 3) cvtColor(src, gray, COLOR_BGR2GRAY);
+			else gray = src;
+			if (gray.depth() != CV_8U) gray.convertTo(gray, CV_8U);
+
+			if (!ringSrc.empty() && !prevGray.empty())
+			{
+				//the current frame at x corresponds to the last frame at x + flow(x)
+				opticalFlow(gray, prevGray, flowx, flowy, flowKernelSize, -flowSearchRange, flowSearchRange, -flowSearchRange, flowSearchRange, flowSearchRange + max(flowKernelSize.width, flowKernelSize.height));
+
+				Mat mapx(src.size(), CV_32F);
+				Mat mapy(src.size(), CV_32F);
+				for (int j = 0; j < src.rows; j++)
+				{
+					const float* fx = flowx.ptr<float>(j);
+					const float* fy = flowy.ptr<float>(j);
+					float* mx = mapx.ptr<float>(j);
+					float* my = mapy.ptr<float>(j);
+					for (int i = 0; i < src.cols; i++)
+					{
+						mx[i] = i + fx[i];
+						my[i] = j + fy[i];
+					}
+				}
+
+				//the maps from the last frame to the previous frames are composed with the motion, and each original frame is resampled only once
+				for (int i = 0; i < (int)ringSrc.size(); i++)
+				{
+					if (ringMapx[i].empty())
+					{
+						mapx.copyTo(ringMapx[i]);
+						mapy.copyTo(ringMapy[i]);
+					}
+					else
+					{
+						Mat cx, cy;
+						remap(ringMapx[i], cx, mapx, mapy, INTER_LINEAR, BORDER_REPLICATE);
+						remap(ringMapy[i], cy, mapx, mapy, INTER_LINEAR, BORDER_REPLICATE);
+						ringMapx[i] = cx;
+						ringMapy[i] = cy;
+					}
+					Mat aligned;
+					remap(ringSrc[i], aligned, ringMapx[i], ringMapy[i], INTER_LINEAR, borderType);
+					copyMakeBorder(aligned, ringSrcPad[i], border.y, border.y, border.x, border.x, borderType);
+				}
+			}
+			gray.copyTo(prevGray);
+		}
+
+		vector<Mat> frames(1 + ringSrcPad.size());
+		vector<Size> searchWindowSizes(frames.size(), temporalSearchWindowSize);
+		frames[0] = srcfPad;
+		searchWindowSizes[0] = searchWindowSize;
+		for (int i = 0; i < (int)ringSrcPad.size(); i++) frames[i + 1] = ringSrcPad[i];
+
+		Mat dst;
+		nonLocalMeansFilterIntegralPadded(frames, frames, searchWindowSizes, dst, templeteWindowSize, border, h, sigma);
+
+		//the noisy current frame is pushed into the ring buffer, whose map is the identity (empty) until the next motion
+		ringSrc.insert(ringSrc.begin(), srcf);
+		ringSrcPad.insert(ringSrcPad.begin(), srcfPad);
+		ringMapx.insert(ringMapx.begin(), Mat());
+		ringMapy.insert(ringMapy.begin(), Mat());
+		if ((int)ringSrc.size() > numberOfFrames)
+		{
+			ringSrc.resize(max(numberOfFrames, 0));
+			ringSrcPad.resize(max(numberOfFrames, 0));
+			ringMapx.resize(max(numberOfFrames, 0));
+			ringMapy.resize(max(numberOfFrames, 0));
+		}
+
+		dst.convertTo(dest, src.depth());
+	}
+
+	void VideoNonLocalMeansFilter::operator()(const Mat& src, Mat& dest, int templeteWindowSize, int searchWindowSize, double h, double sigma, int borderType)
+	{
+		operator()(src, dest, Size(templeteWindowSize, templeteWindowSize), Size(searchWindowSize, searchWindowSize), h, sigma, borderType);
+	}
+}
@@ -415,41 +415,43 @@ namespace cp
 		Mat ccost;
 		Mat occost;
 
-#pragma omp parallel for
-		for (int j = 0; j < rangey; j++)
+		parallelFor(Range(0, rangey), [&](const Range& range)
 		{
-			Mat diff;
-			Mat odiff;
-			for (int i = 0; i < rangex; i++)
+			for (int j = range.start; j < range.end; j++)
 			{
-				int count = j*rangex + i;
-				cost[count] = Mat::zeros(cim.size(), CV_32S);
-				ocost[count] = Mat::zeros(cim.size(), CV_32S);
-
-				for (int c = 0; c < cn; c++)
+				Mat diff;
+				Mat odiff;
+				for (int i = 0; i < rangex; i++)
 				{
-					warpShift(v1[c], diff, (i + minx), (j + miny), BORDER_REPLICATE);
-					absdiff(diff, v0[c], diff);
-					add(diff, cost[count], cost[count], noArray(), CV_32S);
+					int count = j*rangex + i;
+					cost[count] = Mat::zeros(cim.size(), CV_32S);
+					ocost[count] = Mat::zeros(cim.size(), CV_32S);
 
-					warpShift(v0[c], odiff, -(i + minx), -(j + miny), BORDER_REPLICATE);
-					absdiff(odiff, v1[c], odiff);
-					add(odiff, ocost[count], ocost[count], noArray(), CV_32S);
+					for (int c = 0; c < cn; c++)
+					{
+						warpShift(v1[c], diff, (i + minx), (j + miny), BORDER_REPLICATE);
+						absdiff(diff, v0[c], diff);
+						add(diff, cost[count], cost[count], noArray(), CV_32S);
 
-					warpShift(s1[c], diff, (i + minx), (j + miny), BORDER_REPLICATE);
-					absdiff(diff, s0[c], diff);
-					add(a*diff, cost[count], cost[count], noArray(), CV_32S);
+						warpShift(v0[c], odiff, -(i + minx), -(j + miny), BORDER_REPLICATE);
+						absdiff(odiff, v1[c], odiff);
+						add(odiff, ocost[count], ocost[count], noArray(), CV_32S);
 
-					warpShift(s0[c], odiff, -(i + minx), -(j + miny), BORDER_REPLICATE);
-					absdiff(odiff, s1[c], odiff);
-					add(a*odiff, ocost[count], ocost[count], noArray(), CV_32S);
-				}
+						warpShift(s1[c], diff, (i + minx), (j + miny), BORDER_REPLICATE);
+						absdiff(diff, s0[c], diff);
+						add(a*diff, cost[count], cost[count], noArray(), CV_32S);
 
-				blur(cost[count], cost[count], ksize);
-				//guidedFilter(cost[count],cim,cost[count],7,0.1);
-				blur(ocost[count], ocost[count], ksize);
+						warpShift(s0[c], odiff, -(i + minx), -(j + miny), BORDER_REPLICATE);
+						absdiff(odiff, s1[c], odiff);
+						add(a*odiff, ocost[count], ocost[count], noArray(), CV_32S);
+					}
+
+					blur(cost[count], cost[count], ksize);
+					//guidedFilter(cost[count],cim,cost[count],7,0.1);
+					blur(ocost[count], ocost[count], ksize);
+				}
 			}
-		}
+		});
 		int count = 0;
 		Mat mask;
 		for (int j = 0; j < rangey; j++)
@@ -3,6 +3,11 @@
 using namespace std;
 using namespace cv;
 
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
 namespace cp
 {
 	
@@ -10,23 +15,22 @@ namespace cp
 	gnuplot::gnuplot(string gnuplotpath)
 	{
 
-		if ((fp = _popen(gnuplotpath.c_str(), "w")) == NULL)
+		if ((fp = popen(gnuplotpath.c_str(), "w")) == NULL)
 		{
-			fprintf(stderr, "Cannot open gnuplot @ %s\n", gnuplotpath);
+			fprintf(stderr, "Cannot open gnuplot @ %s\n", gnuplotpath.c_str());
 			exit(1);
 		}
 	}
 	void gnuplot::cmd(string name)
 	{
-		fprintf(fp, name.c_str());
-		fprintf(fp, "\n");
+		fprintf(fp, "%s\n", name.c_str());
 		fflush(fp);
 	}
 	gnuplot::~gnuplot()
 	{
 		//fclose(fp);
 		cmd("exit");
-		_pclose(fp);
+		pclose(fp);
 	}
 
 	void plotGraph(OutputArray graph_, vector<Point2d>& data, double xmin, double xmax, double ymin, double ymax,
@@ -1,5 +1,4 @@
 #include "opencp.hpp"
-#define USE_OPENMP 1
 
 using namespace std;
 using namespace cv;
@@ -123,18 +122,19 @@ namespace cp
 	{
 		Mat src, dest;
 
-		downsampleSizeBlurring = max(downsampleSizeBlurring, 1);
-		downsampleSizeSplatting = max(downsampleSizeSplatting, 1);
+		//local copies: blurring is called from the parallel loops over bins
+		const int dsb = max(downsampleSizeBlurring, 1);
+		const int dss = max(downsampleSizeSplatting, 1);
 
-		int dsize = downsampleSizeSplatting*downsampleSizeBlurring;
-		if (downsampleSizeBlurring == 1)
+		int dsize = dss*dsb;
+		if (dsb == 1)
 		{
 			src = src_;
 			dest = dest_;
 		}
 		else
 		{
-			resize(src_, src, Size(src_.cols / downsampleSizeBlurring, src_.rows / downsampleSizeBlurring), 0.0, 0.0, downsampleMethod);
+			resize(src_, src, Size(src_.cols / dsb, src_.rows / dsb), 0.0, 0.0, downsampleMethod);
 		}
 		
 		if (filter_type == FIR_SEPARABLE)
@@ -164,7 +164,7 @@ namespace cp
 			cout << "not supported filter" << endl;
 		}
 
-		if (downsampleSizeBlurring != 1)
+		if (dsb != 1)
 		{
 			resize(dest, dest_, src_.size(), 0.0, 0.0, upsampleMethod);
 		}
@@ -771,32 +771,30 @@ namespace cp
 		T* d = dest.ptr<T>(0);
 		if (src.channels() == 1 && guide.channels() == 1)
 		{
-#ifdef USE_OPENMP
-#pragma omp parallel for schedule (dynamic)
-			for (int b = 0; b < num_bin; b++)
-#else
-			for (int b = 0; b < num_bin; b++)
-#endif
+			parallelFor(Range(0, num_bin), [&](const Range& range)
 			{
-				S* su = sub_range[b].ptr<S>(0);//upper
-				S* sd = normalize_sub_range[b].ptr<S>(0);//down
+				for (int b = range.start; b < range.end; b++)
+				{
+					S* su = sub_range[b].ptr<S>(0);//upper
+					S* sd = normalize_sub_range[b].ptr<S>(0);//down
 
-				uchar v = bin2num[b];
+					uchar v = bin2num[b];
 
-				splatting<T, S>(s, su, sd, j, v, imageSize, src.channels());
+					splatting<T, S>(s, su, sd, j, v, imageSize, src.channels());
 
-				blurring(sub_range[b], sub_range[b]);
-				blurring(normalize_sub_range[b], normalize_sub_range[b]);
-				if (downsampleSizeSplatting == 1)
-				{
-					divide(sub_range[b], normalize_sub_range[b], bgrid[b]);
-				}
-				else
-				{
-					divide(sub_range[b], normalize_sub_range[b], sub_range[b]);
-					resize(sub_range[b], bgrid[b], src_.size(), 0, 0, upsampleMethod);
+					blurring(sub_range[b], sub_range[b]);
+					blurring(normalize_sub_range[b], normalize_sub_range[b]);
+					if (downsampleSizeSplatting == 1)
+					{
+						divide(sub_range[b], normalize_sub_range[b], bgrid[b]);
+					}
+					else
+					{
+						divide(sub_range[b], normalize_sub_range[b], sub_range[b]);
+						resize(sub_range[b], bgrid[b], src_.size(), 0, 0, upsampleMethod);
+					}
 				}
-			}
+			});
 			for (int i = 0; i < imageSizeFull; i++)
 			{
 				int id = idx[jfull[i]];
@@ -807,32 +805,30 @@ namespace cp
 		}
 		else if (src.channels() == 3 && guide.channels() == 1)
 		{
-#ifdef USE_OPENMP
-#pragma omp parallel for schedule (dynamic)
-			for (int b = 0; b < num_bin; b++)
-#else
-			for (int b = 0; b < num_bin; b++)
-#endif
+			parallelFor(Range(0, num_bin), [&](const Range& range)
 			{
-				S* su = sub_range[b].ptr<S>(0);//upper
-				S* sd = normalize_sub_range[b].ptr<S>(0);//down
+				for (int b = range.start; b < range.end; b++)
+				{
+					S* su = sub_range[b].ptr<S>(0);//upper
+					S* sd = normalize_sub_range[b].ptr<S>(0);//down
 
-				uchar v = bin2num[b];
-				splatting<T, S>(s, su, sd, j, v, imageSize, src.channels());
+					uchar v = bin2num[b];
+					splatting<T, S>(s, su, sd, j, v, imageSize, src.channels());
 
-				blurring(sub_range[b], sub_range[b]);
-				blurring(normalize_sub_range[b], normalize_sub_range[b]);
+					blurring(sub_range[b], sub_range[b]);
+					blurring(normalize_sub_range[b], normalize_sub_range[b]);
 
-				if (downsampleSizeSplatting == 1)
-				{
-					divide(sub_range[b], normalize_sub_range[b], bgrid[b]);
-				}
-				else
-				{
-					divide(sub_range[b], normalize_sub_range[b], sub_range[b]);
-					resize(sub_range[b], bgrid[b], src_.size(), 0, 0, upsampleMethod);
+					if (downsampleSizeSplatting == 1)
+					{
+						divide(sub_range[b], normalize_sub_range[b], bgrid[b]);
+					}
+					else
+					{
+						divide(sub_range[b], normalize_sub_range[b], sub_range[b]);
+						resize(sub_range[b], bgrid[b], src_.size(), 0, 0, upsampleMethod);
+					}
 				}
-			}
+			});
 
 			for (int i = 0; i < imageSizeFull; i++)
 			{
@@ -850,67 +846,65 @@ namespace cp
 			vector<Mat> dst(num_bin);
 			if (typeid(S) == typeid(double)) for (int b = 0; b < num_bin; b++) dst[b] = Mat::zeros(src_.size(), CV_64FC1);
 			else for (int b = 0; b < num_bin; b++) dst[b] = Mat::zeros(src_.size(), CV_32FC1);
-#ifdef USE_OPENMP
-#pragma omp parallel for schedule (dynamic)
-			for (int b = 0; b < num_bin; b++)
-#else
-			for (int b = 0; b < num_bin; b++)
-#endif
+			parallelFor(Range(0, num_bin), [&](const Range& range)
 			{
-				S* dtemp = dst[b].ptr<S>(0);
-				CV_DECL_ALIGNED(16) uchar bgr[3];
-				for (int g = 0; g < num_bin; g++)
+				for (int b = range.start; b < range.end; b++)
 				{
-					for (int r = 0; r < num_bin; r++)
+					S* dtemp = dst[b].ptr<S>(0);
+					CV_DECL_ALIGNED(16) uchar bgr[3];
+					for (int g = 0; g < num_bin; g++)
 					{
-						S* su = sub_range[b].ptr<S>(0);//upper
-						S* sd = normalize_sub_range[b].ptr<S>(0);//down
+						for (int r = 0; r < num_bin; r++)
+						{
+							S* su = sub_range[b].ptr<S>(0);//upper
+							S* sd = normalize_sub_range[b].ptr<S>(0);//down
 
-						bgr[0] = bin2num[b];
-						bgr[1] = bin2num[g];
-						bgr[2] = bin2num[r];
-						splattingColor<T, S>(s, su, sd, j, bgr, imageSize, src.channels(), normType);
+							bgr[0] = bin2num[b];
+							bgr[1] = bin2num[g];
+							bgr[2] = bin2num[r];
+							splattingColor<T, S>(s, su, sd, j, bgr, imageSize, src.channels(), normType);
 
-						blurring(sub_range[b], sub_range[b]);
-						blurring(normalize_sub_range[b], normalize_sub_range[b]);
-						if (downsampleSizeSplatting == 1)
-						{
-							divide(sub_range[b], normalize_sub_range[b], bgrid[b]);
-						}
-						else
-						{
-							divide(sub_range[b], normalize_sub_range[b], sub_range[b]);
-							resize(sub_range[b], bgrid[b], src_.size(), 0, 0, upsampleMethod);
-						}
+							blurring(sub_range[b], sub_range[b]);
+							blurring(normalize_sub_range[b], normalize_sub_range[b]);
+							if (downsampleSizeSplatting == 1)
+							{
+								divide(sub_range[b], normalize_sub_range[b], bgrid[b]);
+							}
+							else
+							{
+								divide(sub_range[b], normalize_sub_range[b], sub_range[b]);
+								resize(sub_range[b], bgrid[b], src_.size(), 0, 0, upsampleMethod);
+							}
 
-						for (int i = 0; i < imageSizeFull; i++)
-						{
-							S inter = (S)1.0;
-							int id = idx[jfull[3 * i + 0]];
-							S ca = a[jfull[3 * i + 0]];
-
-							if (id + 1 == b) inter *= ((S)1.0 - ca);
-							else if (id == b) inter *= ca;
-							else goto jump1;
-
-							id = idx[jfull[3 * i + 1]];
-							ca = a[jfull[3 * i + 1]];
-							if (id + 1 == g) inter *= ((S)1.0 - ca);
-							else if (id == g)inter *= ca;
-							else goto jump1;
-
-							id = idx[jfull[3 * i + 2]];
-							ca = a[jfull[3 * i + 2]];
-							if (id + 1 == r) inter *= ((S)1.0 - ca);
-							else if (id == r) inter *= ca;
-							else goto jump1;
-
-							dtemp[i] += inter*bgrid[b].at<S>(i);
-						jump1:;
+							for (int i = 0; i < imageSizeFull; i++)
+							{
+								S inter = (S)1.0;
+								int id = idx[jfull[3 * i + 0]];
+								S ca = a[jfull[3 * i + 0]];
+
+								if (id + 1 == b) inter *= ((S)1.0 - ca);
+								else if (id == b) inter *= ca;
+								else goto jump1;
+
+								id = idx[jfull[3 * i + 1]];
+								ca = a[jfull[3 * i + 1]];
+								if (id + 1 == g) inter *= ((S)1.0 - ca);
+								else if (id == g)inter *= ca;
+								else goto jump1;
+
+								id = idx[jfull[3 * i + 2]];
+								ca = a[jfull[3 * i + 2]];
+								if (id + 1 == r) inter *= ((S)1.0 - ca);
+								else if (id == r) inter *= ca;
+								else goto jump1;
+
+								dtemp[i] += inter*bgrid[b].at<S>(i);
+							jump1:;
+							}
 						}
 					}
 				}
-			}
+			});
 			for (int b = 1; b < num_bin; b++)
 			{
 				dst[0] += dst[b];
@@ -922,73 +916,71 @@ namespace cp
 			vector<Mat> dst(num_bin);
 			if (typeid(S) == typeid(double)) for (int b = 0; b < num_bin; b++) dst[b] = Mat::zeros(src_.size(), CV_64FC3);
 			else for (int b = 0; b < num_bin; b++) dst[b] = Mat::zeros(src_.size(), CV_32FC3);
-#ifdef USE_OPENMP
-#pragma omp parallel for schedule (dynamic)
-			for (int b = 0; b < num_bin; b++)
-#else
-			for (int b = 0; b < num_bin; b++)
-#endif
+			parallelFor(Range(0, num_bin), [&](const Range& range)
 			{
-				for (int g = 0; g < num_bin; g++)
+				for (int b = range.start; b < range.end; b++)
 				{
-					for (int r = 0; r < num_bin; r++)
+					for (int g = 0; g < num_bin; g++)
 					{
-						S* su = sub_range[b].ptr<S>(0);//upper
-						S* sd = normalize_sub_range[b].ptr<S>(0);//down
-						CV_DECL_ALIGNED(16) uchar bgr[3];
-						bgr[0] = bin2num[b];
-						bgr[1] = bin2num[g];
-						bgr[2] = bin2num[r];
-						splattingColor<T, S>(s, su, sd, j, bgr, imageSize, src.channels(), normType);
-
-						blurring(sub_range[b], sub_range[b]);
-						blurring(normalize_sub_range[b], normalize_sub_range[b]);
-						if (downsampleSizeSplatting == 1)
+						for (int r = 0; r < num_bin; r++)
 						{
-							divide(sub_range[b], normalize_sub_range[b], bgrid[b]);
-						}
-						else
-						{
-							divide(sub_range[b], normalize_sub_range[b], sub_range[b]);
-							resize(sub_range[b], bgrid[b], src_.size(), 0, 0, upsampleMethod);
-						}
+							S* su = sub_range[b].ptr<S>(0);//upper
+							S* sd = normalize_sub_range[b].ptr<S>(0);//down
+							CV_DECL_ALIGNED(16) uchar bgr[3];
+							bgr[0] = bin2num[b];
+							bgr[1] = bin2num[g];
+							bgr[2] = bin2num[r];
+							splattingColor<T, S>(s, su, sd, j, bgr, imageSize, src.channels(), normType);
+
+							blurring(sub_range[b], sub_range[b]);
+							blurring(normalize_sub_range[b], normalize_sub_range[b]);
+							if (downsampleSizeSplatting == 1)
+							{
+								divide(sub_range[b], normalize_sub_range[b], bgrid[b]);
+							}
+							else
+							{
+								divide(sub_range[b], normalize_sub_range[b], sub_range[b]);
+								resize(sub_range[b], bgrid[b], src_.size(), 0, 0, upsampleMethod);
+							}
 
-						S* bgridPtr = bgrid[b].ptr<S>(0);
-						S* dtemp = dst[b].ptr<S>(0);
-						uchar* ref = (uchar*)jfull;
-						for (int i = 0; i < imageSizeFull; i++)
-						{
-							S inter = (S)1.0;
-							int id = idx[ref[0]];
-							S ca = a[ref[0]];
-
-							if (id + 1 == b) inter *= ((S)1.0 - ca);
-							else if (id == b) inter *= ca;
-							else goto jump2;
-
-							id = idx[ref[1]];
-							ca = a[ref[1]];
-							if (id + 1 == g) inter *= ((S)1.0 - ca);
-							else if (id == g)inter *= ca;
-							else goto jump2;
-
-							id = idx[ref[2]];
-							ca = a[ref[2]];
-							if (id + 1 == r) inter *= ((S)1.0 - ca);
-							else if (id == r) inter *= ca;
-							else goto jump2;
-
-							dtemp[0] += inter*bgridPtr[0];
-							dtemp[1] += inter*bgridPtr[1];
-							dtemp[2] += inter*bgridPtr[2];
-						jump2:
-							dtemp += 3;
-							bgridPtr += 3;
-							ref += 3;
+							S* bgridPtr = bgrid[b].ptr<S>(0);
+							S* dtemp = dst[b].ptr<S>(0);
+							uchar* ref = (uchar*)jfull;
+							for (int i = 0; i < imageSizeFull; i++)
+							{
+								S inter = (S)1.0;
+								int id = idx[ref[0]];
+								S ca = a[ref[0]];
+
+								if (id + 1 == b) inter *= ((S)1.0 - ca);
+								else if (id == b) inter *= ca;
+								else goto jump2;
+
+								id = idx[ref[1]];
+								ca = a[ref[1]];
+								if (id + 1 == g) inter *= ((S)1.0 - ca);
+								else if (id == g)inter *= ca;
+								else goto jump2;
+
+								id = idx[ref[2]];
+								ca = a[ref[2]];
+								if (id + 1 == r) inter *= ((S)1.0 - ca);
+								else if (id == r) inter *= ca;
+								else goto jump2;
+
+								dtemp[0] += inter*bgridPtr[0];
+								dtemp[1] += inter*bgridPtr[1];
+								dtemp[2] += inter*bgridPtr[2];
+							jump2:
+								dtemp += 3;
+								bgridPtr += 3;
+								ref += 3;
+							}
 						}
 					}
 				}
-			}
+			});
 
 			for (int b = 1; b < num_bin; b++)
 			{
@@ -1040,4 +1032,246 @@ namespace cp
 		gaussIIR(src, joint, dest, sigma_color, sigma_space, num_bin, method, K);
 	}
 
-}
\ No newline at end of file
+	static int getBatchGaussianFilterMethod(const int filter_type, const int bin_depth)
+	{
+		switch (filter_type)
+		{
+		case RealtimeO1BilateralFilter::IIR_AM: return (bin_depth == CV_64F) ? GAUSSIAN_FILTER_AM2 : GAUSSIAN_FILTER_AM;
+		case RealtimeO1BilateralFilter::IIR_SR: return GAUSSIAN_FILTER_SR;
+		case RealtimeO1BilateralFilter::IIR_Deriche: return GAUSSIAN_FILTER_DERICHE;
+		case RealtimeO1BilateralFilter::IIR_YVY: return GAUSSIAN_FILTER_VYV;
+		default: return -1;
+		}
+	}
+
+	void RealtimeO1BilateralFilter::createBatchBin(Size imsize, Size fullsize, int channels)
+	{
+		//create() does not reallocate when the size and type are not changed
+		const int type = CV_MAKETYPE(bin_depth, channels);
+		for (int s = 0; s < 2; s++)
+		{
+			batch_sub_range[s].resize(num_bin);
+			batch_normalize_sub_range[s].resize(num_bin);
+			batch_bgrid[s].resize(num_bin);
+			for (int b = 0; b < num_bin; b++)
+			{
+				batch_sub_range[s][b].create(imsize, type);
+				batch_normalize_sub_range[s][b].create(imsize, type);
+				if (downsampleSizeSplatting == 1) batch_bgrid[s][b] = batch_sub_range[s][b];//divided in place
+				else batch_bgrid[s][b].create(fullsize, type);
+			}
+		}
+
+		batch_plan.resize(2 * num_bin);
+		for (int i = 0; i < 2 * num_bin; i++)
+		{
+			if (batch_plan[i].empty()) batch_plan[i] = makePtr<GaussianFilterPlan>();
+		}
+	}
+
+	void RealtimeO1BilateralFilter::blurringBatch(Mat& srcdest, GaussianFilterPlan& plan)
+	{
+		const int dsize = downsampleSizeSplatting*downsampleSizeBlurring;
+		Mat src;
+		if (downsampleSizeBlurring == 1) src = srcdest;
+		else resize(srcdest, src, Size(srcdest.cols / downsampleSizeBlurring, srcdest.rows / downsampleSizeBlurring), 0.0, 0.0, downsampleMethod);
+
+		if (filter_type == FIR_SEPARABLE)
+		{
+			Size kernel = Size(2 * (radius / dsize) + 1, 2 * (radius / dsize) + 1);
+			GaussianBlur(src, src, kernel, sigma_space / dsize, 0.0, BORDER_REPLICATE);
+		}
+		else
+		{
+			plan(src, src);
+		}
+
+		if (downsampleSizeBlurring != 1)
+		{
+			resize(src, srcdest, srcdest.size(), 0.0, 0.0, upsampleMethod);
+		}
+	}
+
+	template <typename T, typename S>
+	void RealtimeO1BilateralFilter::bodyBatch_(const vector<Mat>& src, const vector<Mat>& guide, vector<Mat>& dest)
+	{
+		const int frames = (int)src.size();
+		const Size fullsize = src[0].size();
+		const Size imsize = Size(fullsize.width / downsampleSizeSplatting, fullsize.height / downsampleSizeSplatting);
+		const int cn = src[0].channels();
+
+		num_bin = max(num_bin, 2);// for 0 and 255
+		setColorLUT(sigma_color, 1);
+		disposeBin(num_bin);
+		createBatchBin(imsize, fullsize, cn);
+		if (filter_type != FIR_SEPARABLE)
+		{
+			//only the coefficients are recomputed if the size is not changed
+			const int dsize = downsampleSizeSplatting*downsampleSizeBlurring;
+			const Size bsize = Size(imsize.width / downsampleSizeBlurring, imsize.height / downsampleSizeBlurring);
+			for (int i = 0; i < 2 * num_bin; i++)
+			{
+				batch_plan[i]->init(bsize, CV_MAKETYPE(bin_depth, cn), sigma_space / dsize, getBatchGaussianFilterMethod(filter_type, bin_depth), filterK);
+			}
+		}
+		for (int f = 0; f < frames; f++)
+		{
+			if (dest[f].size() != fullsize || dest[f].type() != src[f].type()) dest[f].create(fullsize, src[f].type());
+		}
+
+		//frame f uses the bin set f%2. splatting and blurring of frame f wait for interpolation of frame f-2, which reads the same set.
+		TaskGraph graph;
+		vector<int> interpolation(frames);
+		for (int f = 0; f < frames; f++)
+		{
+			const int slot = f % 2;
+			vector<int> deps;
+			if (f >= 2) deps.push_back(interpolation[f - 2]);
+
+			if (downsampleSizeSplatting != 1)
+			{
+				const int prep = graph.addTask(Range(0, 1), [=, &src, &guide](const Range&)
+				{
+					resize(src[f], batch_src[slot], imsize, 0, 0, downsampleMethod);
+					resize(guide[f], batch_guide[slot], imsize, 0, 0, downsampleMethod);
+				}, deps, 1);
+				deps.assign(1, prep);
+			}
+
+			const int bins = graph.addTask(Range(0, num_bin), [=, &src, &guide](const Range& range)
+			{
+				const Mat& s = (downsampleSizeSplatting == 1) ? src[f] : batch_src[slot];
+				const Mat& j = (downsampleSizeSplatting == 1) ? guide[f] : batch_guide[slot];
+				for (int b = range.start; b < range.end; b++)
+				{
+					Mat& su = batch_sub_range[slot][b];
+					Mat& sd = batch_normalize_sub_range[slot][b];
+					splatting<T, S>(s.ptr<T>(0), su.ptr<S>(0), sd.ptr<S>(0), j.ptr<uchar>(0), bin2num[b], imsize.area(), cn);
+
+					GaussianFilterPlan& plan = *batch_plan[slot * num_bin + b];
+					blurringBatch(su, plan);
+					blurringBatch(sd, plan);
+					divide(su, sd, su);
+					if (downsampleSizeSplatting != 1) resize(su, batch_bgrid[slot][b], fullsize, 0, 0, upsampleMethod);
+				}
+			}, deps, num_bin);
+
+			interpolation[f] = graph.addTask(Range(0, fullsize.height), [=, &guide, &dest](const Range& range)
+			{
+				vector<const S*> grid(num_bin);
+				for (int y = range.start; y < range.end; y++)
+				{
+					for (int b = 0; b < num_bin; b++) grid[b] = batch_bgrid[slot][b].ptr<S>(y);
+					const uchar* j = guide[f].ptr<uchar>(y);
+					T* d = dest[f].ptr<T>(y);
+					for (int x = 0; x < fullsize.width; x++)
+					{
+						const int id = idx[j[x]];
+						const S ca = (S)a[j[x]];
+						const S ica = (S)(1.f - ca);
+						const S* g0 = grid[id] + cn * x;
+						const S* g1 = grid[id + 1] + cn * x;
+						for (int c = 0; c < cn; c++)
+						{
+							d[cn * x + c] = saturate_cast<T>(ca*g0[c] + ica*g1[c]);
+						}
+					}
+				}
+			}, vector<int>(1, bins));
+		}
+		graph.run();
+	}
+
+	void RealtimeO1BilateralFilter::bodyBatch(const vector<Mat>& src_, const vector<Mat>& joint_, vector<Mat>& dest)
+	{
+		CV_Assert(bin_depth == CV_32F || bin_depth == CV_64F);
+		CV_Assert(!src_.empty() && src_.size() == joint_.size());
+		//the splatting reads the images as one line of size.area() pixels, so that ROIs are copied to continuous images
+		vector<Mat> src(src_.size());
+		vector<Mat> joint(joint_.size());
+		for (size_t i = 0; i < src_.size(); i++)
+		{
+			CV_Assert(src_[i].size() == src_[0].size() && src_[i].type() == src_[0].type());
+			CV_Assert(joint_[i].size() == src_[0].size() && joint_[i].type() == joint_[0].type() && joint_[i].depth() == CV_8U);
+			src[i] = (src_[i].isContinuous()) ? src_[i] : src_[i].clone();
+			joint[i] = (joint_[i].isContinuous()) ? joint_[i] : joint_[i].clone();
+		}
+		dest.resize(src.size());
+
+		if (joint[0].channels() != 1 || src[0].channels() == 2 || src[0].channels() > 3 || isSaveMemory)
+		{
+			for (size_t i = 0; i < src.size(); i++) body(src[i], joint[i], dest[i], isSaveMemory);
+			return;
+		}
+		CV_Assert(filter_type == FIR_SEPARABLE || getBatchGaussianFilterMethod(filter_type, bin_depth) >= 0);
+
+		downsampleSizeBlurring = max(downsampleSizeBlurring, 1);
+		downsampleSizeSplatting = max(downsampleSizeSplatting, 1);
+
+		const int depth = src[0].depth();
+		if (bin_depth == CV_32F)
+		{
+			if (depth == CV_8U)  bodyBatch_<uchar, float>(src, joint, dest);
+			if (depth == CV_16U) bodyBatch_<ushort, float>(src, joint, dest);
+			if (depth == CV_16S) bodyBatch_<short, float>(src, joint, dest);
+			if (depth == CV_32S) bodyBatch_<int, float>(src, joint, dest);
+			if (depth == CV_32F) bodyBatch_<float, float>(src, joint, dest);
+			if (depth == CV_64F) bodyBatch_<double, float>(src, joint, dest);
+		}
+		else if (bin_depth == CV_64F)
+		{
+			if (depth == CV_8U)  bodyBatch_<uchar, double>(src, joint, dest);
+			if (depth == CV_16U) bodyBatch_<ushort, double>(src, joint, dest);
+			if (depth == CV_16S) bodyBatch_<short, double>(src, joint, dest);
+			if (depth == CV_32S) bodyBatch_<int, double>(src, joint, dest);
+			if (depth == CV_32F) bodyBatch_<float, double>(src, joint, dest);
+			if (depth == CV_64F) bodyBatch_<double, double>(src, joint, dest);
+		}
+	}
+
+	static void getBatchJoint(const vector<Mat>& src, vector<Mat>& joint)
+	{
+		joint.resize(src.size());
+		for (size_t i = 0; i < src.size(); i++)
+		{
+			if (src[i].depth() != CV_8U) src[i].convertTo(joint[i], CV_8U);
+			else joint[i] = src[i];
+		}
+	}
+
+	void RealtimeO1BilateralFilter::gaussFIRBatch(const vector<Mat>& src, const vector<Mat>& joint, vector<Mat>& dest, int r, float sigma_color_, float sigma_space_, int num_bin_)
+	{
+		radius = r;
+		sigma_color = sigma_color_;
+		sigma_space = sigma_space_;
+		num_bin = num_bin_;
+		filter_type = FIR_SEPARABLE;
+
+		bodyBatch(src, joint, dest);
+	}
+
+	void RealtimeO1BilateralFilter::gaussFIRBatch(const vector<Mat>& src, vector<Mat>& dest, int r, float sigma_color, float sigma_space, int num_bin)
+	{
+		vector<Mat> joint;
+		getBatchJoint(src, joint);
+		gaussFIRBatch(src, joint, dest, r, sigma_color, sigma_space, num_bin);
+	}
+
+	void RealtimeO1BilateralFilter::gaussIIRBatch(const vector<Mat>& src, const vector<Mat>& joint, vector<Mat>& dest, float sigma_color_, float sigma_space_, int num_bin_, int method, int K)
+	{
+		filterK = K;
+		sigma_color = sigma_color_;
+		sigma_space = sigma_space_;
+		num_bin = num_bin_;
+		filter_type = method;
+
+		bodyBatch(src, joint, dest);
+	}
+
+	void RealtimeO1BilateralFilter::gaussIIRBatch(const vector<Mat>& src, vector<Mat>& dest, float sigma_color, float sigma_space, int num_bin, int method, int K)
+	{
+		vector<Mat> joint;
+		getBatchJoint(src, joint);
+		gaussIIRBatch(src, joint, dest, sigma_color, sigma_space, num_bin, method, K);
+	}
+}
@@ -10,7 +10,7 @@ namespace cp
 	void splitToGrid_(const Mat& src, vector<Mat>& dest, Size gridNum, int borderRadius)
 	{
 		int w = (src.cols%gridNum.width == 0) ? src.cols / gridNum.width : src.cols / gridNum.width + 1;
-		int h = (src.rows%gridNum.height == 0) ? src.rows / gridNum.height : src.cols / gridNum.height + 1;
+		int h = (src.rows%gridNum.height == 0) ? src.rows / gridNum.height : src.rows / gridNum.height + 1;
 		Size grid = Size(w, h);
 
 		int remW = w*gridNum.width - src.cols;
@@ -53,6 +53,7 @@ O(pixPerRow*log(pixPerRow)*maxDisparity) in the above paper.
 \****************************************************************************************/
 
 #include "opencp.hpp"
+#include "StereoTemporal.h"
 
 using namespace std;
 using namespace cv;
@@ -375,6 +376,232 @@ namespace cp
 
 
 
+	//SIMD version of the DP above with the same result, where the cells are stored as separate arrays of the sums and the steps.
+	//the left and the diagonal steps depend only on the previous column, and they are computed across the disparities by SSE;
+	//the up step depends on the cell of the next disparity in the same column, and it is applied by a short scalar pass.
+	//the buffers of a stripe are reused for its rows and across frames.
+	static int birchfieldDPScratchSize(const int imgW, const int maxDisparity)
+	{
+		const int dispH = maxDisparity + 3;
+		return (sizeof(int) + 2) * imgW*dispH + 4 * (imgW + 16);
+	}
+
+	static void birchfieldDPRowsSIMD(const uchar* src1, const uchar* src2, uchar* dest, const int imgW, const int maxDisparity,
+		const int param1, const int param2, const int y0, const int y1, uchar* scratch)
+	{
+		const int dispH = maxDisparity + 3;
+		int* sums = (int*)scratch;
+		uchar* steps = (uchar*)(sums + imgW*dispH);
+		uchar* dsi = steps + imgW*dispH;//dsi[x*dispH + d]: contiguous in the disparities
+		uchar* rmax = dsi + imgW*dispH;//reversed: rmax[imgW - 1 - j] = max of the right pixel j
+		uchar* rmin = rmax + imgW + 16;
+		uchar* edges = rmin + imgW + 16;
+		uchar* redges = edges + imgW + 16;//reversed edges
+
+		const int INF = INT_MAX / 2;
+		const __m128i mp1 = _mm_set1_epi32(param1);
+		const __m128i mp2 = _mm_set1_epi32(param2);
+		const __m128i minf = _mm_set1_epi32(INF);
+		const __m128i mup = _mm_set1_epi32(ICV_DP_STEP_UP);
+		const __m128i mdiag = _mm_set1_epi32(ICV_DP_STEP_DIAG);
+		const __m128i mtwo = _mm_set1_epi32(2);
+		const __m128i zero = _mm_setzero_si128();
+		int temp3;
+
+		for (int y = y0; y < y1; y++)
+		{
+			const uchar* srcdata1 = src1 + imgW * y;
+			const uchar* srcdata2 = src2 + imgW * y;
+
+			//min/max of the right pixels over the half pixels
+			uchar prevval, prev, val, curr;
+			prevval = prev = srcdata2[0];
+			for (int j = 1; j < imgW; j++)
+			{
+				curr = srcdata2[j];
+				val = (uchar)((curr + prev) >> 1);
+				rmax[imgW - j] = (uchar)CV_IMAX3(val, prevval, prev);
+				rmin[imgW - j] = (uchar)CV_IMIN3(val, prevval, prev);
+				prevval = val;
+				prev = curr;
+			}
+			rmax[0] = rmax[1];
+			rmin[0] = rmin[1];
+
+			//dsi of the pixel j and the disparity i is the BT cost with the right pixel j + 1 - i, i.e., rmax[imgW - 2 - j + i]
+			for (int j = 0; j < imgW; j++)
+			{
+				const int imax = min(j + 1, maxDisparity + 1);
+				const uchar* mx = rmax + imgW - 2 - j;
+				const uchar* mn = rmin + imgW - 2 - j;
+				uchar* s = dsi + j*dispH;
+				const __m128i u = _mm_set1_epi8((char)srcdata1[j]);
+				int i = 1;
+				for (; i <= imax - 15; i += 16)
+				{
+					const __m128i a = _mm_subs_epu8(u, _mm_loadu_si128((const __m128i*)(mx + i)));
+					const __m128i b = _mm_subs_epu8(_mm_loadu_si128((const __m128i*)(mn + i)), u);
+					_mm_storeu_si128((__m128i*)(s + i), _mm_or_si128(a, b));
+				}
+				for (; i <= imax; i++)
+				{
+					s[i] = (uchar)(max(srcdata1[j] - mx[i], 0) | max(mn[i] - srcdata1[j], 0));
+				}
+			}
+
+			//intensity gradients
+			memset(edges, 0, imgW);
+			edges[0] = edges[1] = edges[2] = 2;
+			edges[imgW - 1] = edges[imgW - 2] = edges[imgW - 3] = 1;
+			for (int j = 3; j < imgW - 4; j++)
+			{
+				if ((CV_IMAX3(srcdata1[j - 3], srcdata1[j - 2], srcdata1[j - 1]) -
+					CV_IMIN3(srcdata1[j - 3], srcdata1[j - 2], srcdata1[j - 1])) >= ICV_BIRCH_DIFF_LUM)
+				{
+					edges[j] |= 1;
+				}
+				if ((CV_IMAX3(srcdata2[j + 3], srcdata2[j + 2], srcdata2[j + 1]) -
+					CV_IMIN3(srcdata2[j + 3], srcdata2[j + 2], srcdata2[j + 1])) >= ICV_BIRCH_DIFF_LUM)
+				{
+					edges[j] |= 2;
+				}
+			}
+			for (int j = 0; j < imgW; j++) redges[imgW - 1 - j] = edges[j];
+
+			//init DP table
+			for (int x = 0; x < imgW; x++)
+			{
+				sums[x*dispH] = sums[x*dispH + dispH - 1] = ICV_MAX_DP_SUM_VAL;
+				steps[x*dispH] = steps[x*dispH + dispH - 1] = ICV_DP_STEP_LEFT;
+			}
+			for (int d = 2; d < dispH && d - 2 < imgW; d++)
+			{
+				sums[(d - 2)*dispH + d] = ICV_MAX_DP_SUM_VAL;
+				steps[(d - 2)*dispH + d] = ICV_DP_STEP_UP;
+			}
+			sums[1] = 0;
+			steps[1] = ICV_DP_STEP_LEFT;
+
+			for (int x = 1; x < imgW; x++)
+			{
+				const int dpmax = min(x + 1, maxDisparity + 1);
+				const int* psum = sums + (x - 1)*dispH;
+				const uchar* pstep = steps + (x - 1)*dispH;
+				int* csum = sums + x*dispH;
+				uchar* cstep = steps + x*dispH;
+				const uchar* s = dsi + x*dispH;
+				const uchar* e = redges + imgW - 2 - x;//e[dp] = edges[x + 1 - dp]
+
+				//left and diagonal steps: the left step wins the tie
+				int dp = 1;
+				for (; dp <= dpmax - 3; dp += 4)
+				{
+					const __m128i l = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(psum + dp)), mp2);
+					__m128i g = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(psum + dp - 1)), mp1);
+					const __m128i ps = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int*)(pstep + dp - 1)));
+					const __m128i pe = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int*)(e + dp)));
+					const __m128i off = _mm_or_si128(_mm_cmpeq_epi32(ps, mup), _mm_cmpeq_epi32(_mm_and_si128(pe, mtwo), zero));
+					g = _mm_blendv_epi8(g, minf, off);
+
+					const __m128i cost = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int*)(s + dp)));
+					_mm_storeu_si128((__m128i*)(csum + dp), _mm_add_epi32(_mm_min_epi32(l, g), cost));
+					const __m128i st = _mm_and_si128(_mm_cmpgt_epi32(l, g), mdiag);
+					*(int*)(cstep + dp) = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(st, st), st));
+				}
+				for (; dp <= dpmax; dp++)
+				{
+					const int l = psum[dp] - param2;
+					const int g = (pstep[dp - 1] != ICV_DP_STEP_UP && (e[dp] & 2)) ? psum[dp - 1] + param1 : INF;
+					csum[dp] = min(l, g) + s[dp];
+					cstep[dp] = (l > g) ? ICV_DP_STEP_DIAG : ICV_DP_STEP_LEFT;
+				}
+
+				//up step: it wins the tie with the diagonal step but not with the left step
+				if (edges[x] & 1)
+				{
+					for (dp = dpmax; dp >= 1; dp--)
+					{
+						if (cstep[dp + 1] == ICV_DP_STEP_DIAG) continue;
+						const int u = csum[dp + 1] + param1 + s[dp];
+						if (u < csum[dp] || (u == csum[dp] && cstep[dp] == ICV_DP_STEP_DIAG))
+						{
+							csum[dp] = u;
+							cstep[dp] = ICV_DP_STEP_UP;
+						}
+					}
+				}
+			}
+
+			//find min_val
+			uchar* dispdata = dest + imgW * y;
+			const int* lsum = sums + (imgW - 1)*dispH;
+			int min_val = ICV_MAX_DP_SUM_VAL;
+			int d = 1;
+			for (int i = 1; i <= maxDisparity + 1; i++)
+			{
+				if (min_val > lsum[i])
+				{
+					d = i;
+					min_val = lsum[i];
+				}
+			}
+
+			//track optimal pass
+			for (int x = imgW - 1; x > 0; x--)
+			{
+				dispdata[x] = (uchar)(d - 1);
+				while (steps[x*dispH + d] == ICV_DP_STEP_UP) d++;
+				if (steps[x*dispH + d] == ICV_DP_STEP_DIAG)
+				{
+					const int sx = x;
+					while (steps[x*dispH + d] == ICV_DP_STEP_DIAG)
+					{
+						d--;
+						x--;
+					}
+					for (int i = x; i < sx; i++)
+					{
+						dispdata[i] = (uchar)(d - 1);
+					}
+				}
+			}
+		}
+	}
+
+	//the stripe s processes a batch of contiguous rows with buffers[s]
+	class StereoCorrespondenceByBirchfieldDPSIMD_Invoker : public cv::ParallelLoopBody
+	{
+		const uchar* src1;
+		const uchar* src2;
+		uchar* disparities;
+		Size size;
+		int maxDisparity;
+		int param1;
+		int param2;
+		vector<Mat>* buffers;
+
+	public:
+		StereoCorrespondenceByBirchfieldDPSIMD_Invoker(const uchar* src1_, const uchar* src2_, uchar* disparities_, Size size_, int maxDisparity_, int param1_, int param2_, vector<Mat>& buffers_)
+			: src1(src1_), src2(src2_), disparities(disparities_), size(size_), maxDisparity(maxDisparity_), param1(param1_), param2(param2_), buffers(&buffers_)
+		{
+			;
+		}
+
+		void operator()(const Range& range) const
+		{
+			const int stripes = (int)buffers->size();
+			for (int s = range.start; s < range.end; s++)
+			{
+				const int y0 = size.height * s / stripes;
+				const int y1 = size.height * (s + 1) / stripes;
+				Mat& buf = (*buffers)[s];
+				const int bufSize = birchfieldDPScratchSize(size.width, maxDisparity);
+				if ((int)buf.total() < bufSize) buf.create(1, bufSize, CV_8U);
+				birchfieldDPRowsSIMD(src1, src2, disparities, size.width, maxDisparity, param1, param2, y0, y1, buf.ptr<uchar>(0));
+			}
+		}
+	};
+
 	static void icvFindStereoCorrespondenceByBirchfieldDPBase(uchar* src1, uchar* src2,
 		uchar* disparities,
 		CvSize size, int widthStep,
@@ -801,6 +1028,11 @@ namespace cp
 		param3 CV_DEFAULT(CV_IDP_BIRCHFIELD_PARAM3);
 		param4 CV_DEFAULT(CV_IDP_BIRCHFIELD_PARAM4);
 		param5 CV_DEFAULT(CV_IDP_BIRCHFIELD_PARAM5);
+		isSIMD = true;
+
+		pyramidLevels = 0;
+		pyramidTileSize = 32;
+		pyramidMargin = 2;
 	}
 
 
@@ -825,15 +1057,9 @@ namespace cp
 		}
 	}
 
-	void StereoDP::operator()(Mat& leftim, Mat& rightim, Mat& disp, int bd)
+	//DP of [0, range) on r shifted by shift; disp is the raw disparity (CV_16S, x16), where 0 is the occlusion
+	void StereoDP::solveDP(Mat& l, Mat& r, const int shift, const int range, int bd, Mat& disp)
 	{
-		int dmax = disparityRange;
-		Mat l, r;
-		if (leftim.channels() == 3)cvtColor(leftim, l, CV_BGR2GRAY);
-		else l = leftim;
-		if (rightim.channels() == 3)cvtColor(rightim, r, CV_BGR2GRAY);
-		else r = rightim;
-
 		Mat lb, rb;
 		if ((l.cols + bd) % 2 == 0)
 		{
@@ -841,23 +1067,107 @@ namespace cp
 		}
 		cv::copyMakeBorder(l, lb, 0, 0, bd, bd, cv::BORDER_REPLICATE);
 		cv::copyMakeBorder(r, rb, 0, 0, bd, bd, cv::BORDER_REPLICATE);
-		shiftImage(rb, rb, minDisparity);
+		shiftImage(rb, rb, shift);
 
 		Mat ipldisp(lb.size(), CV_8U);
 
-		icvFindStereoCorrespondenceByBirchfieldDP(lb.data, rb.data, ipldisp.data, lb.size(), lb.cols, disparityRange,
-			CV_IDP_BIRCHFIELD_PARAM1, CV_IDP_BIRCHFIELD_PARAM2, CV_IDP_BIRCHFIELD_PARAM3, CV_IDP_BIRCHFIELD_PARAM4, CV_IDP_BIRCHFIELD_PARAM5);
+		if (isSIMD)
+		{
+			const int nstripes = max(1, min(getNumThreads(), lb.rows));
+			scratchBuffer.resize(nstripes);
+			parallel_for_(Range(0, nstripes), StereoCorrespondenceByBirchfieldDPSIMD_Invoker(lb.data, rb.data, ipldisp.data, lb.size(), range,
+				CV_IDP_BIRCHFIELD_PARAM1, CV_IDP_BIRCHFIELD_PARAM2, scratchBuffer), nstripes);
+		}
+		else
+		{
+			icvFindStereoCorrespondenceByBirchfieldDP(lb.data, rb.data, ipldisp.data, lb.size(), lb.cols, range,
+				CV_IDP_BIRCHFIELD_PARAM1, CV_IDP_BIRCHFIELD_PARAM2, CV_IDP_BIRCHFIELD_PARAM3, CV_IDP_BIRCHFIELD_PARAM4, CV_IDP_BIRCHFIELD_PARAM5);
+		}
+
+		ipldisp(cv::Rect(bd, 0, l.cols, l.rows)).convertTo(disp, CV_16S, 16);
+	}
 
-		Mat disptemp = ipldisp;
-		disptemp.convertTo(disptemp, CV_16S, 16);
+	//the full range is searched only at the coarsest level, and the tiles of each finer level run the DP on their bands around the upsampled disparity.
+	//a tile is extended to the left by its range and a halo, and the right image is shifted by the minimum of the band, so that the DP of the tile is [0, range).
+	void StereoDP::getDisparityPyramid(Mat& l, Mat& r, const int bd, Mat& disp)
+	{
+		const int levels = pyramidLevels;
+		vector<Mat> L(levels + 1), R(levels + 1);
+		L[0] = l;
+		R[0] = r;
+		for (int n = 1; n <= levels; n++)
+		{
+			pyrDown(L[n - 1], L[n]);
+			pyrDown(R[n - 1], R[n]);
+		}
 
-		Mat(disptemp(cv::Rect(bd, 0, leftim.cols, leftim.rows))).copyTo(disp);
+		const int maxD = minDisparity + disparityRange;
+		const int hx = 16;
+		Mat prev, lt, rt, dt, mask;
+		vector<StereoTile> tiles;
+		for (int n = levels; n >= 0; n--)
+		{
+			const int s = 1 << n;
+			const int minD = (n == 0) ? minDisparity : cvFloor((double)minDisparity / s);
+			const int range = (n == 0) ? disparityRange : cvCeil((double)maxD / s) - minD;
 
-		Mat mask;
-		disp.convertTo(mask, CV_8U);
-		compare(mask, 0, mask, cv::CMP_EQ);
-		disp += (16 * minDisparity);
-		disp.setTo(0, mask);
+			Mat d(L[n].size(), CV_16S);
+			if (n == levels)
+			{
+				solveDP(L[n], R[n], minD, range, bd, d);
+				compare(d, 0, mask, CMP_EQ);
+				d += (16 * minD);
+				d.setTo(0, mask);
+			}
+			else
+			{
+				Mat prior;
+				upsampleDisparityPrior(prev, d.size(), 0, 0, prior);
+				planStereoTiles(Mat(), Mat(), Mat(), Mat(), prior, 0, pyramidTileSize, 0, pyramidMargin, minD, range, 1, tiles);
+				for (size_t i = 0; i < tiles.size(); i++)
+				{
+					const Rect& roi = tiles[i].roi;
+					const int D = tiles[i].numberOfDisparities;
+					const int offset = 16 * tiles[i].minDisparity;
+					const Rect troi(roi.x - D - hx, roi.y, roi.width + D + 2 * hx, roi.height);
+					copyStereoTileROI(L[n], troi, lt);
+					copyStereoTileROI(R[n], troi - Point(tiles[i].minDisparity, 0), rt);
+					solveDP(lt, rt, 0, D, 0, dt);
+					for (int j = 0; j < roi.height; j++)
+					{
+						const short* src = dt.ptr<short>(j) + D + hx;
+						short* dst = d.ptr<short>(roi.y + j) + roi.x;
+						for (int x = 0; x < roi.width; x++) dst[x] = (src[x] == 0) ? 0 : (short)(src[x] + offset);
+					}
+				}
+			}
+			prev = d;
+		}
+		prev.copyTo(disp);
+	}
+
+	void StereoDP::operator()(Mat& leftim, Mat& rightim, Mat& disp, int bd)
+	{
+		Mat l, r;
+		if (leftim.channels() == 3)cvtColor(leftim, l, CV_BGR2GRAY);
+		else l = leftim;
+		if (rightim.channels() == 3)cvtColor(rightim, r, CV_BGR2GRAY);
+		else r = rightim;
+
+		if (pyramidLevels > 0)
+		{
+			getDisparityPyramid(l, r, bd, disp);
+		}
+		else
+		{
+			solveDP(l, r, minDisparity, disparityRange, bd, disp);
+
+			Mat mask;
+			disp.convertTo(mask, CV_8U);
+			compare(mask, 0, mask, cv::CMP_EQ);
+			disp += (16 * minDisparity);
+			disp.setTo(0, mask);
+		}
 		//cv::threshold(disp,disp,(minDisparity<<4)-1,0,cv::THRESH_TOZERO);
 		if (isOcclusion)
 		{
@@ -0,0 +1,166 @@
+#include "opencp.hpp"
+
+using namespace std;
+using namespace cv;
+
+namespace cp
+{
+	static int fseek64(FILE* fp, int64 offset)
+	{
+#ifdef _WIN32
+		return _fseeki64(fp, offset, SEEK_SET);
+#else
+		return fseeko(fp, (off_t)offset, SEEK_SET);
+#endif
+	}
+
+	MatTileSource::MatTileSource(const Mat& src_) : src(src_)
+	{
+		;
+	}
+
+	Size MatTileSource::size() const
+	{
+		return src.size();
+	}
+
+	int MatTileSource::type() const
+	{
+		return src.type();
+	}
+
+	void MatTileSource::read(const Rect& roi, Mat& dest)
+	{
+		src(roi).copyTo(dest);
+	}
+
+	MatTileSink::MatTileSink(Mat& dest_) : dest(dest_)
+	{
+		CV_Assert(!dest.empty());
+	}
+
+	void MatTileSink::write(const Rect& roi, const Mat& src)
+	{
+		CV_Assert(src.type() == dest.type());
+		src.copyTo(dest(roi));
+	}
+
+	RawFileTileSource::RawFileTileSource(const string& path, Size size, int type) : fp(NULL), imageSize(size), imageType(type)
+	{
+		fp = fopen(path.c_str(), "rb");
+		if (fp == NULL) CV_Error(Error::StsError, path + " cannot be opened");
+	}
+
+	RawFileTileSource::~RawFileTileSource()
+	{
+		if (fp != NULL) fclose(fp);
+	}
+
+	Size RawFileTileSource::size() const
+	{
+		return imageSize;
+	}
+
+	int RawFileTileSource::type() const
+	{
+		return imageType;
+	}
+
+	void RawFileTileSource::read(const Rect& roi, Mat& dest)
+	{
+		dest.create(roi.size(), imageType);
+		const int64 esize = (int64)CV_ELEM_SIZE(imageType);
+		const size_t lineSize = (size_t)(roi.width * esize);
+
+		AutoLock lock(mutex);
+		for (int j = 0; j < roi.height; j++)
+		{
+			const int64 offset = ((int64)(roi.y + j) * imageSize.width + roi.x) * esize;
+			if (fseek64(fp, offset) != 0 || fread(dest.ptr(j), 1, lineSize, fp) != lineSize)
+				CV_Error(Error::StsError, "RawFileTileSource: read error");
+		}
+	}
+
+	RawFileTileSink::RawFileTileSink(const string& path, Size size, int type) : fp(NULL), imageSize(size), imageType(type)
+	{
+		fp = fopen(path.c_str(), "w+b");
+		if (fp == NULL) CV_Error(Error::StsError, path + " cannot be opened");
+	}
+
+	RawFileTileSink::~RawFileTileSink()
+	{
+		if (fp != NULL) fclose(fp);
+	}
+
+	void RawFileTileSink::write(const Rect& roi, const Mat& src)
+	{
+		CV_Assert(src.type() == imageType && src.size() == roi.size());
+		const int64 esize = (int64)CV_ELEM_SIZE(imageType);
+		const size_t lineSize = (size_t)(roi.width * esize);
+
+		AutoLock lock(mutex);
+		for (int j = 0; j < roi.height; j++)
+		{
+			const int64 offset = ((int64)(roi.y + j) * imageSize.width + roi.x) * esize;
+			if (fseek64(fp, offset) != 0 || fwrite(src.ptr(j), 1, lineSize, fp) != lineSize)
+				CV_Error(Error::StsError, "RawFileTileSink: write error");
+		}
+	}
+
+	//each worker pulls the next tile index, so that only numThreads tiles are in flight
+	class FilterTiled_Invoker : public cv::ParallelLoopBody
+	{
+		TileSource* src;
+		TileSink* dest;
+		const TileFilter* filter;
+		Size tileSize;
+		Size tileNum;
+		int r;
+		int borderType;
+		int* next;
+
+	public:
+		FilterTiled_Invoker(TileSource& src_, TileSink& dest_, const TileFilter& filter_, Size tileSize_, int borderRadius, int borderType_, int* next_)
+			: src(&src_), dest(&dest_), filter(&filter_), tileSize(tileSize_), r(borderRadius), borderType(borderType_), next(next_)
+		{
+			const Size size = src->size();
+			tileNum = Size((size.width + tileSize.width - 1) / tileSize.width, (size.height + tileSize.height - 1) / tileSize.height);
+		}
+
+		void operator()(const Range& range) const
+		{
+			const Rect image(Point(0, 0), src->size());
+			Mat in, tile, out;
+			for (;;)
+			{
+				const int idx = CV_XADD(next, 1);
+				if (idx >= tileNum.area()) break;
+
+				const Rect roi = Rect((idx % tileNum.width) * tileSize.width, (idx / tileNum.width) * tileSize.height, tileSize.width, tileSize.height) & image;
+				const Rect halo(roi.x - r, roi.y - r, roi.width + 2 * r, roi.height + 2 * r);
+				const Rect valid = halo & image;
+
+				src->read(valid, in);
+				if (valid == halo) tile = in;
+				else copyMakeBorder(in, tile, valid.y - halo.y, halo.br().y - valid.br().y, valid.x - halo.x, halo.br().x - valid.br().x, borderType);
+
+				(*filter)(tile, out);
+				CV_Assert(out.size() == tile.size());
+				dest->write(roi, out(Rect(r, r, roi.width, roi.height)));
+			}
+		}
+	};
+
+	void filterTiled(TileSource& src, TileSink& dest, const TileFilter& filter, Size tileSize, int borderRadius, int borderType, int numThreads)
+	{
+		CV_Assert(tileSize.area() > 0 && borderRadius >= 0 && src.size().area() > 0);
+
+		const Size size = src.size();
+		const int tiles = ((size.width + tileSize.width - 1) / tileSize.width) * ((size.height + tileSize.height - 1) / tileSize.height);
+		const int th = max(1, min((numThreads <= 0) ? getNumThreads() : numThreads, tiles));
+
+		int next = 0;
+		FilterTiled_Invoker body(src, dest, filter, tileSize, borderRadius, borderType, &next);
+		parallel_for_(Range(0, th), body, th);
+	}
+}
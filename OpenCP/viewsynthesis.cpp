@@ -181,9 +181,9 @@ namespace cp
 
 		if (amp > 0)
 		{
+			Mat im; copyMakeBorder(srcim, im, 0, 0, 2, 0, BORDER_REPLICATE);
 			for (int j = 0; j < srcdisp.rows; j++)
 			{
-				Mat im; copyMakeBorder(srcim, im, 0, 0, 2, 0, BORDER_REPLICATE);
 				uchar* sim = (uchar*)im.ptr<uchar>(j); sim += 6;
 				uchar* dim = destim.ptr<uchar>(j);
 				T* s = srcdisp.ptr<T>(j);
@@ -868,7 +868,7 @@ namespace cp
 		Mat dsp; copyMakeBorder(srcdisp, dsp, 0, 0, 1, 1, BORDER_REPLICATE);
 		//const int offset = (int)(256*amp+0.5);
 		const int offset = (int)(256);
-		Mat dst = Mat::zeros(Size(destdisp.cols + offset, 1), destdisp.type());
+		Mat dst = Mat::zeros(Size(destdisp.cols + offset + 1, 1), destdisp.type());
 
 		if (amp > 0)
 		{
@@ -945,10 +945,10 @@ namespace cp
 	template <class T>
 	void shiftDisp_(const Mat& srcdisp, Mat& destdisp, float amp, const int large_jump, const int sub_gap)
 	{
-		Mat dsp; copyMakeBorder(srcdisp, dsp, 0, 0, 1, 1, BORDER_REPLICATE);
+		Mat dsp; copyMakeBorder(srcdisp, dsp, 0, 0, 1, 2, BORDER_REPLICATE);
 		//const int offset = (int)(256*amp);
 		const int offset = (int)(256);
-		Mat dst = Mat::zeros(Size(destdisp.cols + offset, 1), destdisp.type());
+		Mat dst = Mat::zeros(Size(destdisp.cols + offset + 1, 1), destdisp.type());
 
 		int ij = 0;
 		const int ljump = max(large_jump, 1);
@@ -1807,6 +1807,113 @@ namespace cp
 		}
 	}
 
+	enum
+	{
+		SHIFT_DISP_JUMP = 1,//large jump to a neighbor: the pixel is not warped
+		SHIFT_DISP_CRACK_L = 2,//small gap to the left neighbor: the crack is filled for amp > 0
+		SHIFT_DISP_CRACK_R = 4,//small gap to the right neighbor: the crack is filled for amp < 0
+	};
+
+	//the boundary and crack tests of shiftDisp_ only depend on the source disparity, so they are shared by all views.
+	//dsp is the source with the border of shiftDisp_, and flag has the tests of [0, cols].
+	template <class T>
+	void makeShiftDispFlag_(const Mat& srcdisp, Mat& dsp, Mat& flag, const int large_jump, const int sub_gap)
+	{
+		copyMakeBorder(srcdisp, dsp, 0, 0, 1, 2, BORDER_REPLICATE);
+		flag.create(srcdisp.rows, srcdisp.cols + 1, CV_8U);
+		const int ljump = max(large_jump, 1);
+		for (int j = 0; j < srcdisp.rows; j++)
+		{
+			const T* s = dsp.ptr<T>(j) + 1;
+			uchar* f = flag.ptr<uchar>(j);
+			for (int i = 0; i <= srcdisp.cols; i++)
+			{
+				const int subL = abs((int)s[i] - (int)s[i - 1]);
+				const int subR = abs((int)s[i] - (int)s[i + 1]);
+				uchar v = 0;
+				if (large_jump != 0 && (subL > ljump || subR > ljump)) v |= SHIFT_DISP_JUMP;
+				if (subL <= sub_gap && subL > 0) v |= SHIFT_DISP_CRACK_L;
+				if (subR <= sub_gap && subR > 0) v |= SHIFT_DISP_CRACK_R;
+				f[i] = v;
+			}
+		}
+	}
+
+	//shiftDisp_ with the precomputed tests
+	template <class T>
+	void shiftDispWithFlag_(const Mat& dsp, const Mat& flag, Mat& destdisp, float amp)
+	{
+		const int offset = 256;
+		Mat dst = Mat::zeros(Size(destdisp.cols + offset + 1, 1), destdisp.type());
+
+		if (amp > 0)
+		{
+			for (int j = 0; j < destdisp.rows; j++)
+			{
+				dst.setTo(0);
+				const T* s = dsp.ptr<T>(j) + 1;
+				const uchar* f = flag.ptr<uchar>(j);
+				T* d = dst.ptr<T>(0) + offset;
+
+				for (int i = destdisp.cols; i >= 0; i--)
+				{
+					if (f[i] & SHIFT_DISP_JUMP) continue;
+
+					const T disp = s[i];
+					const int dest = (int)(disp*amp);
+					if (disp > d[i - dest])
+					{
+						d[i - dest] = disp;
+						if ((f[i] & SHIFT_DISP_CRACK_L) && disp > d[i - dest - 1])
+						{
+							d[i - dest - 1] = (T)((disp + s[i - 1])*0.5);
+						}
+					}
+				}
+				memcpy(destdisp.ptr<T>(j), d, sizeof(T)*destdisp.cols);
+			}
+		}
+		else if (amp < 0)
+		{
+			for (int j = 0; j < destdisp.rows; j++)
+			{
+				dst.setTo(0);
+				const T* s = dsp.ptr<T>(j) + 1;
+				const uchar* f = flag.ptr<uchar>(j);
+				T* d = dst.ptr<T>(0);
+
+				for (int i = 0; i < destdisp.cols; i++)
+				{
+					if (f[i] & SHIFT_DISP_JUMP) continue;
+
+					const T disp = s[i];
+					const int dest = (int)(-amp*disp);
+					if (disp > d[i + dest])
+					{
+						d[i + dest] = disp;
+						if ((f[i] & SHIFT_DISP_CRACK_R) && disp > d[i + dest + 1])
+						{
+							d[i + dest + 1] = (T)((disp + s[i + 1])*0.5);
+						}
+					}
+				}
+				memcpy(destdisp.ptr<T>(j), d, sizeof(T)*destdisp.cols);
+			}
+		}
+		else
+		{
+			dsp(Rect(1, 0, destdisp.cols, destdisp.rows)).copyTo(destdisp);
+		}
+	}
+
+	//dsp and flag are made by makeShiftDispFlag_; destdisp must be allocated
+	static void shiftDispWithFlag(const Mat& dsp, const Mat& flag, Mat& destdisp, float amp)
+	{
+		if (dsp.depth() == CV_8U) shiftDispWithFlag_<uchar>(dsp, flag, destdisp, amp);
+		else if (dsp.depth() == CV_16S) shiftDispWithFlag_<short>(dsp, flag, destdisp, amp);
+		else if (dsp.depth() == CV_16U) shiftDispWithFlag_<ushort>(dsp, flag, destdisp, amp);
+	}
+
 	template <class T>
 	void fillOcclusionImDisp2_(Mat& im, Mat& src, T invalidvalue, int maxlength = 1000)
 	{
@@ -3943,9 +4050,46 @@ namespace cp
 			}
 		}
 	}
+	//crackRemove_<uchar> by SSE4.1
+	static void crackRemove8u_SSE(Mat& depth, Mat& depth_dest, uchar invalidvalue)
+	{
+		depth.copyTo(depth_dest);
+		const __m128i minv = _mm_set1_epi8((char)invalidvalue);
+		const __m128i mone = _mm_set1_epi8(1);
+		for (int j = 0; j < depth.rows; j++)
+		{
+			uchar* s = depth.ptr<uchar>(j);
+			uchar* d = depth_dest.ptr<uchar>(j);
+
+			int i = 1;
+			for (; i + 16 < depth.cols; i += 16)
+			{
+				const __m128i ml = _mm_loadu_si128((const __m128i*)(s + i - 1));
+				const __m128i mc = _mm_loadu_si128((const __m128i*)(s + i));
+				const __m128i mr = _mm_loadu_si128((const __m128i*)(s + i + 1));
+				const __m128i mcrack = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(ml, minv), _mm_cmpeq_epi8(mr, minv)), _mm_cmpeq_epi8(mc, minv));
+				//(l+r)*0.5 truncated
+				const __m128i mavg = _mm_sub_epi8(_mm_avg_epu8(ml, mr), _mm_and_si128(_mm_xor_si128(ml, mr), mone));
+				_mm_storeu_si128((__m128i*)(d + i), _mm_blendv_epi8(mc, mavg, mcrack));
+			}
+			for (; i < depth.cols - 1; i++)
+			{
+				if (s[i] == invalidvalue)
+				{
+					if (s[i - 1] != invalidvalue && s[i + 1] != invalidvalue)
+					{
+						d[i] = (uchar)((s[i - 1] + s[i + 1])*0.5);
+					}
+				}
+			}
+		}
+	}
+
 	void crackRemove(Mat& depth, Mat& depth_dest, double invalidvalue)
 	{
-		if (depth.depth() == CV_8U)
+		if (depth.depth() == CV_8U && depth.data != depth_dest.data)
+			crackRemove8u_SSE(depth, depth_dest, (uchar)invalidvalue);
+		else if (depth.depth() == CV_8U)
 			crackRemove_<uchar>(depth, depth_dest, (uchar)invalidvalue);
 		else if (depth.depth() == CV_16S)
 			crackRemove_<short>(depth, depth_dest, (short)invalidvalue);
@@ -4090,6 +4234,7 @@ namespace cp
 		inpaintMethod = FILL_OCCLUSION_HV;
 
 		large_jump = 0;
+		isParallel = true;
 		warpedMedianKernel = 3;
 		warpedSpeckesWindow = 100;
 		warpedSpeckesRange = 1;
@@ -4411,14 +4556,15 @@ namespace cp
 	void StereoViewSynthesis::analyzeSynthesizedViewDetail_(Mat& srcL, Mat& srcR, Mat& dispL, Mat& dispR, double alpha, int invalidvalue, double disp_amp, Mat& srcsynth, Mat& ref)
 	{
 		vector<Mat> draw;
-		allMask = Mat::ones(srcL.size(), CV_8U); allMask *= 255;//all mask 
-		nonOcclusionMask = Mat::zeros(srcL.size(), CV_8U);
-		occlusionMask = Mat::zeros(srcL.size(), CV_8U);//half and full occlusion
-		fullOcclusionMask = Mat::zeros(srcL.size(), CV_8U);//full occlusion
-		halfOcclusionMask = Mat::zeros(srcL.size(), CV_8U);//left and right half ooclusion
-
-		boundaryMask = Mat::zeros(srcL.size(), CV_8U);//disparity boundary
-		nonFullOcclusionMask = Mat::zeros(srcL.size(), CV_8U); //bar of full occlusion
+		//masks are kept across calls and reallocated only when the size changes
+		allMask.create(srcL.size(), CV_8U); allMask.setTo(255);//all mask 
+		nonOcclusionMask.create(srcL.size(), CV_8U); nonOcclusionMask.setTo(0);
+		occlusionMask.create(srcL.size(), CV_8U); occlusionMask.setTo(0);//half and full occlusion
+		fullOcclusionMask.create(srcL.size(), CV_8U); fullOcclusionMask.setTo(0);//full occlusion
+		halfOcclusionMask.create(srcL.size(), CV_8U); halfOcclusionMask.setTo(0);//left and right half ooclusion
+
+		boundaryMask.create(srcL.size(), CV_8U); boundaryMask.setTo(0);//disparity boundary
+		nonFullOcclusionMask.create(srcL.size(), CV_8U); nonFullOcclusionMask.setTo(0); //bar of full occlusion
 		Mat vis = Mat::zeros(srcL.size(), CV_8UC3);
 		Mat disp8Ubuff;
 		double sub_gap = (warpSputtering) ? disp_amp : -1.0;
@@ -4490,14 +4636,15 @@ namespace cp
 	void StereoViewSynthesis::makeMask_(Mat& srcL, Mat& srcR, Mat& dispL, Mat& dispR, double alpha, int invalidvalue, double disp_amp)
 	{
 		vector<Mat> draw;
-		allMask = Mat::ones(srcL.size(), CV_8U); allMask *= 255;//all mask 
-		nonOcclusionMask = Mat::zeros(srcL.size(), CV_8U);
-		occlusionMask = Mat::zeros(srcL.size(), CV_8U);//half and full occlusion
-		fullOcclusionMask = Mat::zeros(srcL.size(), CV_8U);//full occlusion
-		halfOcclusionMask = Mat::zeros(srcL.size(), CV_8U);//left and right half ooclusion
-
-		boundaryMask = Mat::zeros(srcL.size(), CV_8U);//disparity boundary
-		nonFullOcclusionMask = Mat::zeros(srcL.size(), CV_8U); //bar of full occlusion
+		//masks are kept across calls and reallocated only when the size changes
+		allMask.create(srcL.size(), CV_8U); allMask.setTo(255);//all mask 
+		nonOcclusionMask.create(srcL.size(), CV_8U); nonOcclusionMask.setTo(0);
+		occlusionMask.create(srcL.size(), CV_8U); occlusionMask.setTo(0);//half and full occlusion
+		fullOcclusionMask.create(srcL.size(), CV_8U); fullOcclusionMask.setTo(0);//full occlusion
+		halfOcclusionMask.create(srcL.size(), CV_8U); halfOcclusionMask.setTo(0);//left and right half ooclusion
+
+		boundaryMask.create(srcL.size(), CV_8U); boundaryMask.setTo(0);//disparity boundary
+		nonFullOcclusionMask.create(srcL.size(), CV_8U); nonFullOcclusionMask.setTo(0); //bar of full occlusion
 		Mat vis = Mat::zeros(srcL.size(), CV_8UC3);
 		Mat disp8Ubuff;
 		double sub_gap = (warpSputtering) ? disp_amp : -1.0;
@@ -4547,12 +4694,292 @@ namespace cp
 		maxFilter(boundaryMask, boundaryMask, Size(3, 3));
 	}
 
+	//expand 16 pixel masks to the 48 bytes of 3-channel pixels
+	static inline void expandMask3_SSE(const __m128i m, __m128i& m0, __m128i& m1, __m128i& m2)
+	{
+		m0 = _mm_shuffle_epi8(m, _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5));
+		m1 = _mm_shuffle_epi8(m, _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10));
+		m2 = _mm_shuffle_epi8(m, _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15));
+	}
+
+	//saturate_cast<uchar>(ia*l+a*r+0.5) of 4 int lanes in double precision, which is the same rounding as the scalar code
+	inline __m128i blendWeighted32s_SSE(const __m128i l, const __m128i r, const __m128d ma, const __m128d mia)
+	{
+		const __m128d mhalf = _mm_set1_pd(0.5);
+		const __m128d mlo = _mm_add_pd(_mm_add_pd(_mm_mul_pd(mia, _mm_cvtepi32_pd(l)), _mm_mul_pd(ma, _mm_cvtepi32_pd(r))), mhalf);
+		const __m128d mhi = _mm_add_pd(_mm_add_pd(_mm_mul_pd(mia, _mm_cvtepi32_pd(_mm_srli_si128(l, 8))), _mm_mul_pd(ma, _mm_cvtepi32_pd(_mm_srli_si128(r, 8)))), mhalf);
+		return _mm_unpacklo_epi64(_mm_cvtpd_epi32(mlo), _mm_cvtpd_epi32(mhi));
+	}
+
+	//saturate_cast<uchar>(ia*l+a*r+0.5) of 16 bytes
+	inline __m128i blendWeighted8u_SSE(const __m128i l, const __m128i r, const __m128d ma, const __m128d mia)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i l16[2] = { _mm_unpacklo_epi8(l, zero), _mm_unpackhi_epi8(l, zero) };
+		const __m128i r16[2] = { _mm_unpacklo_epi8(r, zero), _mm_unpackhi_epi8(r, zero) };
+
+		__m128i v32[4];
+		for (int k = 0; k < 2; k++)
+		{
+			v32[2 * k + 0] = blendWeighted32s_SSE(_mm_unpacklo_epi16(l16[k], zero), _mm_unpacklo_epi16(r16[k], zero), ma, mia);
+			v32[2 * k + 1] = blendWeighted32s_SSE(_mm_unpackhi_epi16(l16[k], zero), _mm_unpackhi_epi16(r16[k], zero), ma, mia);
+		}
+		return _mm_packus_epi16(_mm_packs_epi32(v32[0], v32[1]), _mm_packs_epi32(v32[2], v32[3]));
+	}
+
+	//blendLRS for 8u disparity maps by SSE4.1; dest and destdisp can alias imr and dispL
+	static void blendLRS_8u_SSE(Mat& iml, Mat& imr, Mat& dispL, Mat& dispR, Mat& dest, Mat& destdisp, double a, uchar invalid)
+	{
+		a = max(0.0, min(a, 1.0));
+		const double ia = 1.0 - a;
+
+		const __m128d ma = _mm_set1_pd(a);
+		const __m128d mia = _mm_set1_pd(ia);
+		const __m128i minv = _mm_set1_epi8((char)invalid);
+		const __m128i mone = _mm_set1_epi8(1);
+		const __m128i mall = _mm_set1_epi8(-1);
+
+		for (int j = 0; j < iml.rows; j++)
+		{
+			uchar* d = dest.ptr<uchar>(j);
+			uchar* l = iml.ptr<uchar>(j);
+			uchar* r = imr.ptr<uchar>(j);
+
+			uchar* dd = destdisp.ptr<uchar>(j);
+			uchar* dl = dispL.ptr<uchar>(j);
+			uchar* dr = dispR.ptr<uchar>(j);
+
+			int i = 0;
+			for (; i <= iml.cols - 16; i += 16)
+			{
+				const __m128i mdl = _mm_loadu_si128((const __m128i*)(dl + i));
+				const __m128i mdr = _mm_loadu_si128((const __m128i*)(dr + i));
+				const __m128i meqL = _mm_cmpeq_epi8(mdl, minv);
+				const __m128i meqR = _mm_cmpeq_epi8(mdr, minv);
+				const __m128i mboth = _mm_andnot_si128(_mm_or_si128(meqL, meqR), mall);
+				const __m128i monlyL = _mm_andnot_si128(meqL, meqR);
+				const __m128i monlyR = _mm_andnot_si128(meqR, meqL);
+
+				//(dl+dr)*0.5 truncated
+				const __m128i mavg = _mm_sub_epi8(_mm_avg_epu8(mdl, mdr), _mm_and_si128(_mm_xor_si128(mdl, mdr), mone));
+				__m128i mdd = _mm_loadu_si128((const __m128i*)(dd + i));
+				mdd = _mm_blendv_epi8(mdd, mdl, monlyL);
+				mdd = _mm_blendv_epi8(mdd, mdr, monlyR);
+				mdd = _mm_blendv_epi8(mdd, mavg, mboth);
+
+				__m128i mb[3], mL[3], mR[3];
+				expandMask3_SSE(mboth, mb[0], mb[1], mb[2]);
+				expandMask3_SSE(monlyL, mL[0], mL[1], mL[2]);
+				expandMask3_SSE(monlyR, mR[0], mR[1], mR[2]);
+				const bool isBoth = _mm_movemask_epi8(mboth) != 0;
+
+				__m128i md[3];
+				for (int k = 0; k < 3; k++)
+				{
+					const __m128i ml = _mm_loadu_si128((const __m128i*)(l + 3 * i + 16 * k));
+					const __m128i mr = _mm_loadu_si128((const __m128i*)(r + 3 * i + 16 * k));
+					md[k] = _mm_loadu_si128((const __m128i*)(d + 3 * i + 16 * k));
+					md[k] = _mm_blendv_epi8(md[k], ml, mL[k]);
+					md[k] = _mm_blendv_epi8(md[k], mr, mR[k]);
+					if (isBoth) md[k] = _mm_blendv_epi8(md[k], blendWeighted8u_SSE(ml, mr, ma, mia), mb[k]);
+				}
+				for (int k = 0; k < 3; k++) _mm_storeu_si128((__m128i*)(d + 3 * i + 16 * k), md[k]);
+				_mm_storeu_si128((__m128i*)(dd + i), mdd);
+			}
+			for (; i < iml.cols; i++)
+			{
+				if (dl[i] != invalid && dr[i] != invalid)
+				{
+					dd[i] = (uchar)((dl[i] + dr[i])*0.5);
+					d[3 * i + 0] = saturate_cast<uchar>(ia*l[3 * i + 0] + a*r[3 * i + 0] + 0.5f);
+					d[3 * i + 1] = saturate_cast<uchar>(ia*l[3 * i + 1] + a*r[3 * i + 1] + 0.5f);
+					d[3 * i + 2] = saturate_cast<uchar>(ia*l[3 * i + 2] + a*r[3 * i + 2] + 0.5f);
+				}
+				else if (dl[i] != invalid)
+				{
+					dd[i] = dl[i];
+					d[3 * i + 0] = l[3 * i + 0];
+					d[3 * i + 1] = l[3 * i + 1];
+					d[3 * i + 2] = l[3 * i + 2];
+				}
+				else if (dr[i] != invalid)
+				{
+					dd[i] = dr[i];
+					d[3 * i + 0] = r[3 * i + 0];
+					d[3 * i + 1] = r[3 * i + 1];
+					d[3 * i + 2] = r[3 * i + 2];
+				}
+			}
+		}
+	}
+
+	template <class T>
+	inline void blendLRSStripe(Mat& iml, Mat& imr, Mat& dispL, Mat& dispR, Mat& dest, Mat& destdisp, double a, T invalid)
+	{
+		blendLRS<T>(iml, imr, dispL, dispR, dest, destdisp, a, invalid);
+	}
+
+	template <>
+	inline void blendLRSStripe<uchar>(Mat& iml, Mat& imr, Mat& dispL, Mat& dispR, Mat& dest, Mat& destdisp, double a, uchar invalid)
+	{
+		blendLRS_8u_SSE(iml, imr, dispL, dispR, dest, destdisp, a, invalid);
+	}
+
+	//The parallax is horizontal only, so the z-buffer of a row never touches the other rows.
+	//Each row stripe is warped independently; stripes [0, nstripes) are the left view and [nstripes, 2*nstripes) the right view.
+	class ShiftDispStripe_Invoker : public cv::ParallelLoopBody
+	{
+		const Mat* dispL;
+		const Mat* dispR;
+		Mat* destL;
+		Mat* destR;
+		float ampL;
+		float ampR;
+		float sub_gap;
+		int large_jump;
+		int nstripes;
+		const Mat* flagL;
+		const Mat* flagR;
+
+	public:
+		//with flagL and flagR, dispL and dispR are the bordered sources of makeShiftDispFlag_
+		ShiftDispStripe_Invoker(const Mat& dispL_, const Mat& dispR_, Mat& destL_, Mat& destR_, float ampL_, float ampR_, float sub_gap_, int large_jump_, int nstripes_, const Mat* flagL_ = NULL, const Mat* flagR_ = NULL) :
+			dispL(&dispL_), dispR(&dispR_), destL(&destL_), destR(&destR_), ampL(ampL_), ampR(ampR_), sub_gap(sub_gap_), large_jump(large_jump_), nstripes(nstripes_), flagL(flagL_), flagR(flagR_)
+		{
+		}
+
+		void operator()(const Range& range) const
+		{
+			for (int n = range.start; n < range.end; n++)
+			{
+				const bool isLeft = n < nstripes;
+				const int s = (isLeft) ? n : n - nstripes;
+				const Mat& src = (isLeft) ? *dispL : *dispR;
+				const Mat* flag = (isLeft) ? flagL : flagR;
+				const int y0 = src.rows * s / nstripes;
+				const int y1 = src.rows * (s + 1) / nstripes;
+
+				Mat dst = ((isLeft) ? *destL : *destR).rowRange(y0, y1);
+				if (flag != NULL) shiftDispWithFlag(src.rowRange(y0, y1), flag->rowRange(y0, y1), dst, (isLeft) ? ampL : ampR);
+				else shiftDisp(src.rowRange(y0, y1), dst, (isLeft) ? ampL : ampR, sub_gap, large_jump);
+			}
+		}
+	};
+
+	//inverse warping of the left and right views and their blending in row stripes
+	template <class T>
+	class ShiftImInvBlendStripe_Invoker : public cv::ParallelLoopBody
+	{
+		const Mat* srcL;
+		const Mat* srcR;
+		Mat* dispL;
+		Mat* dispR;
+		Mat* destL;
+		Mat* destR;
+		float ampL;
+		float ampR;
+		int interpolation;
+		bool isBlend;
+		int blendMethod;
+		bool isZThresh;
+		double alpha;
+		T dth;
+		T invalid;
+		int nstripes;
+
+	public:
+		ShiftImInvBlendStripe_Invoker(const Mat& srcL_, const Mat& srcR_, Mat& dispL_, Mat& dispR_, Mat& destL_, Mat& destR_, float ampL_, float ampR_, int interpolation_,
+			bool isBlend_, int blendMethod_, bool isZThresh_, double alpha_, T dth_, T invalid_, int nstripes_) :
+			srcL(&srcL_), srcR(&srcR_), dispL(&dispL_), dispR(&dispR_), destL(&destL_), destR(&destR_), ampL(ampL_), ampR(ampR_), interpolation(interpolation_),
+			isBlend(isBlend_), blendMethod(blendMethod_), isZThresh(isZThresh_), alpha(alpha_), dth(dth_), invalid(invalid_), nstripes(nstripes_)
+		{
+		}
+
+		void operator()(const Range& range) const
+		{
+			for (int n = range.start; n < range.end; n++)
+			{
+				const int y0 = srcL->rows * n / nstripes;
+				const int y1 = srcL->rows * (n + 1) / nstripes;
+
+				Mat dl = dispL->rowRange(y0, y1);
+				Mat dr = dispR->rowRange(y0, y1);
+				Mat il = destL->rowRange(y0, y1);
+				Mat ir = destR->rowRange(y0, y1);
+
+				shiftImInv(srcL->rowRange(y0, y1), dl, il, ampL, 0, interpolation);
+				shiftImInv(srcR->rowRange(y0, y1), dr, ir, ampR, 0, interpolation);
+
+				if (!isBlend) continue;
+
+				if (!isZThresh)
+				{
+					if (blendMethod == 0) blendLRSStripe<T>(il, ir, dl, dr, ir, dl, alpha, invalid);
+					else
+					{
+						blendLRS_8u_leftisout(il, ir, dl, dr, alpha, (uchar)invalid);
+						il.copyTo(ir);
+					}
+				}
+				else
+				{
+					blendLR<T>(il, ir, dl, dr, ir, dl, alpha, dth, invalid);
+				}
+			}
+		}
+	};
+
+	//forward warping (shiftImDisp) or masked inverse warping (shiftImInvWithMask_) of a single view in row stripes
+	template <class T>
+	class ShiftImSingleStripe_Invoker : public cv::ParallelLoopBody
+	{
+		const Mat* src;
+		Mat* disp;
+		Mat* dest;
+		Mat* destdisp;
+		Mat* mask;
+		double amp;
+		double sub_gap;
+		int large_jump;
+		bool isForward;
+		int nstripes;
+
+	public:
+		ShiftImSingleStripe_Invoker(const Mat& src_, Mat& disp_, Mat& dest_, Mat& destdisp_, Mat& mask_, double amp_, double sub_gap_, int large_jump_, bool isForward_, int nstripes_) :
+			src(&src_), disp(&disp_), dest(&dest_), destdisp(&destdisp_), mask(&mask_), amp(amp_), sub_gap(sub_gap_), large_jump(large_jump_), isForward(isForward_), nstripes(nstripes_)
+		{
+		}
+
+		void operator()(const Range& range) const
+		{
+			for (int n = range.start; n < range.end; n++)
+			{
+				const int y0 = src->rows * n / nstripes;
+				const int y1 = src->rows * (n + 1) / nstripes;
+
+				Mat s = src->rowRange(y0, y1);
+				Mat d = disp->rowRange(y0, y1);
+				Mat im = dest->rowRange(y0, y1);
+				if (isForward)
+				{
+					Mat dd = destdisp->rowRange(y0, y1);
+					shiftImDisp<T>(s, d, im, dd, amp, sub_gap, large_jump);
+				}
+				else
+				{
+					Mat m = mask->rowRange(y0, y1);
+					shiftImInvWithMask_<T>(s, d, im, amp, m);
+				}
+			}
+		}
+	};
+
 	//#define VIS_SYNTH_INFO 0
 	template <class T>
-	void StereoViewSynthesis::viewsynth(const Mat& srcL, const Mat& srcR, const Mat& dispL, const Mat& dispR, Mat& dest, Mat& destdisp, double alpha, int invalidvalue, double disp_amp, int disptype)
+	void StereoViewSynthesis::viewsynth(const Mat& srcL, const Mat& srcR, const Mat& dispL, const Mat& dispR, Mat& dest, Mat& destdisp, double alpha, int invalidvalue, double disp_amp, int disptype, SynthesisBuffer& buf, const WarpSource* ws)
 	{
-		Mat disp8Ubuff;
-		Mat edge;
+		Mat& disp8Ubuff = buf.disp8U;
+		Mat& edge = buf.edge;
 
 		double sub_gap = (warpSputtering) ? disp_amp : -1.0;
 
@@ -4580,10 +5007,11 @@ namespace cp
 
 		Mat maskTemp(srcL.size(),CV_8U,Scalar(0));*/
 
-		Mat destR(srcL.size(), CV_8UC3);
-		Mat destdispR(srcL.size(), disptype);
-		Mat temp(srcL.size(), disptype);
-		Mat m;
+		Mat& destR = buf.destR; destR.create(srcL.size(), CV_8UC3);
+		Mat& destdispR = buf.destdispR; destdispR.create(srcL.size(), disptype);
+		Mat& temp = buf.temp; temp.create(srcL.size(), disptype);
+		Mat& m = buf.mask;
+		bool isBlended = false;
 
 #ifdef VIS_SYNTH_INFO
 		Mat vis = Mat::zeros(dest.size(), CV_8UC3);
@@ -4615,19 +5043,42 @@ namespace cp
 			bitwise_or(maskR,maskTemp,maskR);
 			*/
 		}
+		else if (warpMethod == WAPR_IMG_INV && isParallel)
+		{
+#ifdef VIS_SYNTH_INFO
+			CalcTime t("warp");
+#endif
+			//only the depth filter runs on the full image; the warps and the blend run in row stripes
+			const int nstripes = max(1, min(getNumThreads(), srcL.rows));
+			Mat& tempR = buf.tempR; tempR.create(srcL.size(), disptype);
+			if (ws != NULL)
+				parallel_for_(Range(0, 2 * nstripes), ShiftDispStripe_Invoker(ws->dispL, ws->dispR, temp, tempR, (float)(alpha / disp_amp), (float)((alpha - 1.0) / disp_amp), (float)sub_gap, (int)(large_jump*disp_amp), nstripes, &ws->flagL, &ws->flagR), 2 * nstripes);
+			else
+				parallel_for_(Range(0, 2 * nstripes), ShiftDispStripe_Invoker(dispL, dispR, temp, tempR, (float)(alpha / disp_amp), (float)((alpha - 1.0) / disp_amp), (float)sub_gap, (int)(large_jump*disp_amp), nstripes), 2 * nstripes);
+
+			depthfilter(temp, destdisp, Mat(), cvRound(abs(alpha)), disp_amp);
+			depthfilter(tempR, destdispR, Mat(), cvRound(abs(alpha)), disp_amp);
+
+			//blendLR_NearestMax uses a 2D max filter, so it runs after the stripes
+			isBlended = (blend_z_thresh <= 0.0 || blendMethod == 0);
+			parallel_for_(Range(0, nstripes), ShiftImInvBlendStripe_Invoker<T>(srcL, srcR, destdisp, destdispR, dest, destR, (float)(-alpha / disp_amp), (float)((1.0 - alpha) / disp_amp), warpInterpolationMethod,
+				isBlended, blendMethod, blend_z_thresh > 0.0, alpha, (T)(blend_z_thresh*disp_amp), (T)invalidvalue, nstripes), nstripes);
+		}
 		else if (warpMethod == WAPR_IMG_INV)
 		{
 #ifdef VIS_SYNTH_INFO
 			CalcTime t("warp");
 #endif
-			shiftDisp(dispL, temp, (float)(alpha / disp_amp), (float)sub_gap, (int)(large_jump*disp_amp));
+			if (ws != NULL) shiftDispWithFlag(ws->dispL, ws->flagL, temp, (float)(alpha / disp_amp));
+			else shiftDisp(dispL, temp, (float)(alpha / disp_amp), (float)sub_gap, (int)(large_jump*disp_amp));
 			depthfilter(temp, destdisp, Mat(), cvRound(abs(alpha)), disp_amp);
 			shiftImInv(srcL, destdisp, dest, (float)(-alpha / disp_amp), 0, warpInterpolationMethod);
 
 
 			{
 				//	CalcTime t("shift");
-				shiftDisp(dispR, temp, (float)((alpha - 1.0) / disp_amp), (float)sub_gap, (int)(large_jump*disp_amp));
+				if (ws != NULL) shiftDispWithFlag(ws->dispR, ws->flagR, temp, (float)((alpha - 1.0) / disp_amp));
+				else shiftDisp(dispR, temp, (float)((alpha - 1.0) / disp_amp), (float)sub_gap, (int)(large_jump*disp_amp));
 			}
 		{
 			//	CalcTime t("filter");
@@ -4664,6 +5115,7 @@ namespace cp
 		*/
 	}
 
+		if (!isBlended)
 		{
 #ifdef VIS_SYNTH_INFO
 			CalcTime t("blend");
@@ -4738,7 +5190,7 @@ namespace cp
 		}
 		else
 		{
-			Mat dst = destR.clone(); //used for destR as temp buffer
+			Mat& dst = buf.blur; destR.copyTo(dst); //used for destR as temp buffer
 
 			GaussianFilterwithMask(dst, dst, boundaryKernelSize.width / 2, (float)boundarySigma, FILTER_SLOWEST, edge);
 			//	GaussianBlur(dst,dest,boundaryKernelSize, boundarySigma);
@@ -4939,8 +5391,8 @@ namespace cp
 	template <class T>
 	void StereoViewSynthesis::viewsynthSingle(Mat& src, Mat& disp, Mat& dest, Mat& destdisp, double alpha, int invalidvalue, double disp_amp, int disptype)
 	{
-		Mat disp8Ubuff;
-		Mat edge;
+		Mat& disp8Ubuff = buffer.disp8U;
+		Mat& edge = buffer.edge;
 		if (alpha == 0.0)
 		{
 			src.copyTo(dest);
@@ -4957,12 +5409,20 @@ namespace cp
 		else destdisp.setTo(0);
 
 
-		Mat mask(src.size(), CV_8U);
-		Mat destR(src.size(), CV_8UC3);
-		Mat destdispR(src.size(), disptype);
-		Mat temp(src.size(), disptype);
+		Mat& mask = buffer.mask; mask.create(src.size(), CV_8U);
+		Mat& destR = buffer.destR; destR.create(src.size(), CV_8UC3);
+		Mat& temp = buffer.temp; temp.create(src.size(), disptype);
+
+		if (isParallel)
+		{
+			const int nstripes = max(1, min(getNumThreads(), src.rows));
+			parallel_for_(Range(0, nstripes), ShiftImSingleStripe_Invoker<T>(src, disp, dest, temp, mask, alpha / disp_amp, disp_amp, large_jump, true, nstripes), nstripes);
 
+			depthfilter(temp, destdisp, mask, cvRound(abs(alpha)), disp_amp);
 
+			parallel_for_(Range(0, nstripes), ShiftImSingleStripe_Invoker<T>(src, destdisp, dest, temp, mask, -alpha / disp_amp, disp_amp, large_jump, false, nstripes), nstripes);
+		}
+		else
 		{
 			//CalcTime t("warp");
 			shiftImDisp<T>(src, disp, dest, temp, alpha / disp_amp, disp_amp, large_jump);
@@ -4992,7 +5452,7 @@ namespace cp
 
 			//imshow("ee",edge);waitKey();
 			//dilate(edge,edge,Mat(),Point(-1,-1),2);
-			Mat a;
+			Mat& a = buffer.blur;
 			dest.copyTo(destR);
 			GaussianBlur(dest, a, boundaryKernelSize, boundarySigma);
 
@@ -5025,21 +5485,98 @@ namespace cp
 		int type = dispL.depth();
 		if (type == CV_8U)
 		{
-			viewsynth<uchar>(srcL, srcR, dispL, dispR, dest, destdisp, alpha, invalidvalue, disp_amp, CV_8U);
+			viewsynth<uchar>(srcL, srcR, dispL, dispR, dest, destdisp, alpha, invalidvalue, disp_amp, CV_8U, buffer);
 		}
 		else if (type == CV_16S)
 		{
-			viewsynth<short>(srcL, srcR, dispL, dispR, dest, destdisp, alpha, invalidvalue, disp_amp, CV_16S);
+			viewsynth<short>(srcL, srcR, dispL, dispR, dest, destdisp, alpha, invalidvalue, disp_amp, CV_16S, buffer);
 		}
 		else if (type == CV_16U)
 		{
-			viewsynth<ushort>(srcL, srcR, dispL, dispR, dest, destdisp, alpha, invalidvalue, disp_amp, CV_16U);
+			viewsynth<ushort>(srcL, srcR, dispL, dispR, dest, destdisp, alpha, invalidvalue, disp_amp, CV_16U, buffer);
 		}
 		else
 		{
 			cout << "not support" << endl;
 		}
 	}
+	//Views of the batched synthesis in stripes of views; each stripe has its own buffers and the parameters are read only.
+	class ViewSynthesisBatch_Invoker : public cv::ParallelLoopBody
+	{
+		StereoViewSynthesis* vs;
+		const Mat* srcL;
+		const Mat* srcR;
+		const Mat* dispL;
+		const Mat* dispR;
+		vector<Mat>* dest;
+		vector<Mat>* destdisp;
+		const vector<double>* alpha;
+		int invalidvalue;
+		double disp_amp;
+		int nstripes;
+
+	public:
+		ViewSynthesisBatch_Invoker(StereoViewSynthesis* vs_, const Mat& srcL_, const Mat& srcR_, const Mat& dispL_, const Mat& dispR_, vector<Mat>& dest_, vector<Mat>& destdisp_, const vector<double>& alpha_, int invalidvalue_, double disp_amp_, int nstripes_) :
+			vs(vs_), srcL(&srcL_), srcR(&srcR_), dispL(&dispL_), dispR(&dispR_), dest(&dest_), destdisp(&destdisp_), alpha(&alpha_), invalidvalue(invalidvalue_), disp_amp(disp_amp_), nstripes(nstripes_)
+		{
+		}
+
+		void operator()(const Range& range) const
+		{
+			const int num = (int)alpha->size();
+			const int type = dispL->depth();
+			for (int n = range.start; n < range.end; n++)
+			{
+				StereoViewSynthesis::SynthesisBuffer& buf = vs->viewBuffer[n];
+				for (int i = num * n / nstripes; i < num * (n + 1) / nstripes; i++)
+				{
+					if (type == CV_8U) vs->viewsynth<uchar>(*srcL, *srcR, *dispL, *dispR, (*dest)[i], (*destdisp)[i], (*alpha)[i], invalidvalue, disp_amp, CV_8U, buf, &vs->warpSource);
+					else if (type == CV_16S) vs->viewsynth<short>(*srcL, *srcR, *dispL, *dispR, (*dest)[i], (*destdisp)[i], (*alpha)[i], invalidvalue, disp_amp, CV_16S, buf, &vs->warpSource);
+					else if (type == CV_16U) vs->viewsynth<ushort>(*srcL, *srcR, *dispL, *dispR, (*dest)[i], (*destdisp)[i], (*alpha)[i], invalidvalue, disp_amp, CV_16U, buf, &vs->warpSource);
+				}
+			}
+		}
+	};
+
+	void StereoViewSynthesis::operator()(const Mat& srcL, const Mat& srcR, const Mat& dispL, const Mat& dispR, vector<Mat>& dest, vector<Mat>& destdisp, const vector<double>& alpha, int invalidvalue, double disp_amp)
+	{
+		const int type = dispL.depth();
+		if (type != CV_8U && type != CV_16S && type != CV_16U)
+		{
+			cout << "not support" << endl;
+			return;
+		}
+
+		const int num = (int)alpha.size();
+		dest.resize(num);
+		destdisp.resize(num);
+		if (num == 0) return;
+
+		//the boundary and crack tests of the source disparity maps are made once and shared by all views;
+		//the warped disparity maps depend on alpha, so views are distributed over threads and the buffers are shared within a stripe of views
+		const int sub_gap = (warpSputtering) ? (int)disp_amp : -1;
+		const int ljump = (int)(large_jump*disp_amp);
+		if (type == CV_8U)
+		{
+			makeShiftDispFlag_<uchar>(dispL, warpSource.dispL, warpSource.flagL, ljump, sub_gap);
+			makeShiftDispFlag_<uchar>(dispR, warpSource.dispR, warpSource.flagR, ljump, sub_gap);
+		}
+		else if (type == CV_16S)
+		{
+			makeShiftDispFlag_<short>(dispL, warpSource.dispL, warpSource.flagL, ljump, sub_gap);
+			makeShiftDispFlag_<short>(dispR, warpSource.dispR, warpSource.flagR, ljump, sub_gap);
+		}
+		else
+		{
+			makeShiftDispFlag_<ushort>(dispL, warpSource.dispL, warpSource.flagL, ljump, sub_gap);
+			makeShiftDispFlag_<ushort>(dispR, warpSource.dispR, warpSource.flagR, ljump, sub_gap);
+		}
+
+		const int nstripes = max(1, min(getNumThreads(), num));
+		if ((int)viewBuffer.size() < nstripes) viewBuffer.resize(nstripes);
+		parallel_for_(Range(0, nstripes), ViewSynthesisBatch_Invoker(this, srcL, srcR, dispL, dispR, dest, destdisp, alpha, invalidvalue, disp_amp, nstripes), nstripes);
+	}
+
 	void StereoViewSynthesis::operator()(Mat& src, Mat& disp, Mat& dest, Mat& destdisp, double alpha, int invalidvalue, double disp_amp)
 	{
 		int type = disp.depth();
@@ -343,93 +343,99 @@ namespace cp
 
 			if (method == Histogram::BILATERAL)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						h.clear();
-						const uchar ss = src.at<uchar>(y, x);
-						const uchar bb = B.at<uchar>(y, x);
-						const uchar gg = G.at<uchar>(y, x);
-						const uchar rr = R.at<uchar>(y, x);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							uchar* bp = guideB.ptr<uchar>(y + j); bp += x;
-							uchar* gp = guideG.ptr<uchar>(y + j); gp += x;
-							uchar* rp = guideR.ptr<uchar>(y + j); rp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							h.clear();
+							const uchar ss = src.at<uchar>(y, x);
+							const uchar bb = B.at<uchar>(y, x);
+							const uchar gg = G.at<uchar>(y, x);
+							const uchar rr = R.at<uchar>(y, x);
+
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-
-								int diff1 = abs(ss - *sp);
-								int diff = abs(bb - *bp) + abs(gg - *gp) + abs(rr - *rp);
-								addval *= lutc1[diff] * lutc2[diff];
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
-								bp++;
-								gp++;
-								rp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								uchar* bp = guideB.ptr<uchar>(y + j); bp += x;
+								uchar* gp = guideG.ptr<uchar>(y + j); gp += x;
+								uchar* rp = guideR.ptr<uchar>(y + j); rp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+
+									int diff1 = abs(ss - *sp);
+									int diff = abs(bb - *bp) + abs(gg - *gp) + abs(rr - *rp);
+									addval *= lutc1[diff] * lutc2[diff];
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+									bp++;
+									gp++;
+									rp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::GAUSSIAN)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						h.clear();
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							h.clear();
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::NO_WEIGHT)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						Histogram h(truncate, mode);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						for (int x = 0; x < width; x++)
 						{
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							Histogram h(truncate, mode);
+
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = *w;
-								h.add(addval, src2.at<uchar>(y + j, x + i), metric);
-								w++;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = *w;
+									h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+									w++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			delete[] lutc1;
 			delete[] lutc2;
@@ -459,87 +465,93 @@ namespace cp
 
 			if (method == Histogram::BILATERAL)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						h.clear();
-						const uchar gg = guide.at<uchar>(y, x);
-						const uchar ss = src.at<uchar>(y, x);
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							uchar* gp = G.ptr<uchar>(y + j); gp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							h.clear();
+							const uchar gg = guide.at<uchar>(y, x);
+							const uchar ss = src.at<uchar>(y, x);
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-								int diff1 = abs(ss - *sp);
-								int diff = abs(gg - *gp);
-								addval *= lutc1[diff1] * lutc2[diff];
-
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
-								gp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								uchar* gp = G.ptr<uchar>(y + j); gp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+									int diff1 = abs(ss - *sp);
+									int diff = abs(gg - *gp);
+									addval *= lutc1[diff1] * lutc2[diff];
+
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+									gp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::GAUSSIAN)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						h.clear();
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							h.clear();
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::NO_WEIGHT)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						Histogram h(truncate, mode);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						for (int x = 0; x < width; x++)
 						{
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
-							{
-								float addval = *w;
-								h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+							Histogram h(truncate, mode);
 
-								w++;
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+							{
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = *w;
+									h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+
+									w++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			delete[] lutc1;
 			delete[] lutc2;
@@ -600,91 +612,97 @@ namespace cp
 
 			if (method == Histogram::BILATERAL)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						h.clear();
-						const uchar bb = B.at<uchar>(y, x);
-						const uchar gg = G.at<uchar>(y, x);
-						const uchar rr = R.at<uchar>(y, x);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							uchar* bp = guideB.ptr<uchar>(y + j); bp += x;
-							uchar* gp = guideG.ptr<uchar>(y + j); gp += x;
-							uchar* rp = guideR.ptr<uchar>(y + j); rp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
-							{
-								float addval = luts[idx] * *w;
-
-								int diff = abs(bb - *bp) + abs(gg - *gp) + abs(rr - *rp);
-								addval *= lutc[diff];
-								h.add(addval, *sp, metric);
+							h.clear();
+							const uchar bb = B.at<uchar>(y, x);
+							const uchar gg = G.at<uchar>(y, x);
+							const uchar rr = R.at<uchar>(y, x);
 
-								w++;
-								sp++;
-								bp++;
-								gp++;
-								rp++;
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+							{
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								uchar* bp = guideB.ptr<uchar>(y + j); bp += x;
+								uchar* gp = guideG.ptr<uchar>(y + j); gp += x;
+								uchar* rp = guideR.ptr<uchar>(y + j); rp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+
+									int diff = abs(bb - *bp) + abs(gg - *gp) + abs(rr - *rp);
+									addval *= lutc[diff];
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+									bp++;
+									gp++;
+									rp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::GAUSSIAN)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						h.clear();
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							h.clear();
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::NO_WEIGHT)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						Histogram h(truncate, mode);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						for (int x = 0; x < width; x++)
 						{
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							Histogram h(truncate, mode);
+
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = *w;
-								h.add(addval, src2.at<uchar>(y + j, x + i), metric);
-								w++;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = *w;
+									h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+									w++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			delete[] lutc;
 			delete[] luts;
@@ -711,84 +729,90 @@ namespace cp
 
 			if (method == Histogram::BILATERAL)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						h.clear();
-						const uchar gg = guide.at<uchar>(y, x);
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							uchar* gp = G.ptr<uchar>(y + j); gp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							h.clear();
+							const uchar gg = guide.at<uchar>(y, x);
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-								int diff = abs(gg - *gp);
-								addval *= lutc[diff];
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
-								gp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								uchar* gp = G.ptr<uchar>(y + j); gp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+									int diff = abs(gg - *gp);
+									addval *= lutc[diff];
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+									gp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::GAUSSIAN)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						h.clear();
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							h.clear();
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::NO_WEIGHT)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						Histogram h(truncate, mode);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						for (int x = 0; x < width; x++)
 						{
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
-							{
-								float addval = *w;
-								h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+							Histogram h(truncate, mode);
 
-								w++;
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+							{
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = *w;
+									h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+
+									w++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			delete[] lutc;
 			delete[] luts;
@@ -838,85 +862,91 @@ namespace cp
 
 			if (method == Histogram::BILATERAL)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						h.clear();
-						const uchar bb = B.at<uchar>(y, x);
-						const uchar gg = G.at<uchar>(y, x);
-						const uchar rr = R.at<uchar>(y, x);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							uchar* bp = guideB.ptr<uchar>(y + j); bp += x;
-							uchar* gp = guideG.ptr<uchar>(y + j); gp += x;
-							uchar* rp = guideR.ptr<uchar>(y + j); rp += x;
+							h.clear();
+							const uchar bb = B.at<uchar>(y, x);
+							const uchar gg = G.at<uchar>(y, x);
+							const uchar rr = R.at<uchar>(y, x);
 
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx];
-
-								int diff = abs(bb - *bp) + abs(gg - *gp) + abs(rr - *rp);
-								addval *= lutc[diff];
-								h.add(addval, *sp, metric);
-
-								sp++;
-								bp++;
-								gp++;
-								rp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								uchar* bp = guideB.ptr<uchar>(y + j); bp += x;
+								uchar* gp = guideG.ptr<uchar>(y + j); gp += x;
+								uchar* rp = guideR.ptr<uchar>(y + j); rp += x;
+
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx];
+
+									int diff = abs(bb - *bp) + abs(gg - *gp) + abs(rr - *rp);
+									addval *= lutc[diff];
+									h.add(addval, *sp, metric);
+
+									sp++;
+									bp++;
+									gp++;
+									rp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			if (method == Histogram::GAUSSIAN)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						h.clear();
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							h.clear();
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx];
-								h.add(addval, *sp, metric);
-								sp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx];
+									h.add(addval, *sp, metric);
+									sp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::NO_WEIGHT)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						Histogram h(truncate, mode);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						for (int x = 0; x < width; x++)
 						{
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							Histogram h(truncate, mode);
+
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = 1.f;
-								h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = 1.f;
+									h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			delete[] lutc;
 			delete[] luts;
@@ -943,75 +973,81 @@ namespace cp
 
 			if (method == Histogram::BILATERAL)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						h.clear();
-						const uchar gg = guide.at<uchar>(y, x);
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							uchar* gp = G.ptr<uchar>(y + j); gp += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							h.clear();
+							const uchar gg = guide.at<uchar>(y, x);
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx];
-								int diff = abs(gg - *gp);
-								addval *= lutc[diff];
-								h.add(addval, *sp, metric);
-								sp++;
-								gp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								uchar* gp = G.ptr<uchar>(y + j); gp += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx];
+									int diff = abs(gg - *gp);
+									addval *= lutc[diff];
+									h.add(addval, *sp, metric);
+									sp++;
+									gp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			if (method == Histogram::GAUSSIAN)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						h.clear();
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							h.clear();
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx];
-								h.add(addval, *sp, metric);
-								sp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx];
+									h.add(addval, *sp, metric);
+									sp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::NO_WEIGHT)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						Histogram h(truncate, mode);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						for (int x = 0; x < width; x++)
 						{
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							Histogram h(truncate, mode);
+
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = 1.f;
-								h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = 1.f;
+									h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			delete[] lutc;
 			delete[] luts;
@@ -1019,7 +1055,6 @@ namespace cp
 	}
 
 	//with mask
-#include<omp.h>
 	void weightedweightedHistogramFilter(Mat& src, Mat& weightMap, Mat& guide, Mat& mask, Mat& dst, int r, int truncate, double sig_c1, double sig_c2, double sig_s, int metric, int method)
 	{
 		src.copyTo(dst);
@@ -1076,99 +1111,105 @@ namespace cp
 
 			if (method == Histogram::BILATERAL)
 			{
-#pragma omp parallel for schedule(dynamic,1)
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					uchar* msk = mask.ptr<uchar>(y);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						if (msk[x] == 0)continue;
-						h.clear();
-						const uchar ss = src.at<uchar>(y, x);
-						const uchar bb = B.at<uchar>(y, x);
-						const uchar gg = G.at<uchar>(y, x);
-						const uchar rr = R.at<uchar>(y, x);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						uchar* msk = mask.ptr<uchar>(y);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							uchar* bp = guideB.ptr<uchar>(y + j); bp += x;
-							uchar* gp = guideG.ptr<uchar>(y + j); gp += x;
-							uchar* rp = guideR.ptr<uchar>(y + j); rp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							if (msk[x] == 0)continue;
+							h.clear();
+							const uchar ss = src.at<uchar>(y, x);
+							const uchar bb = B.at<uchar>(y, x);
+							const uchar gg = G.at<uchar>(y, x);
+							const uchar rr = R.at<uchar>(y, x);
+
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-
-								int diff1 = abs(ss - *sp);
-								int diff = abs(bb - *bp) + abs(gg - *gp) + abs(rr - *rp);
-								addval *= lutc1[diff] * lutc2[diff];
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
-								bp++;
-								gp++;
-								rp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								uchar* bp = guideB.ptr<uchar>(y + j); bp += x;
+								uchar* gp = guideG.ptr<uchar>(y + j); gp += x;
+								uchar* rp = guideR.ptr<uchar>(y + j); rp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+
+									int diff1 = abs(ss - *sp);
+									int diff = abs(bb - *bp) + abs(gg - *gp) + abs(rr - *rp);
+									addval *= lutc1[diff] * lutc2[diff];
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+									bp++;
+									gp++;
+									rp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				}, height);//dynamic scheduling: the cost of a row depends on the mask
 			}
 			else if (method == Histogram::GAUSSIAN)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					uchar* msk = mask.ptr<uchar>(y);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						if (msk[x] == 0)continue;
-						h.clear();
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						uchar* msk = mask.ptr<uchar>(y);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							if (msk[x] == 0)continue;
+							h.clear();
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::NO_WEIGHT)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					uchar* msk = mask.ptr<uchar>(y);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						if (msk[x] == 0) continue;
-						Histogram h(truncate, mode);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						uchar* msk = mask.ptr<uchar>(y);
+						for (int x = 0; x < width; x++)
 						{
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							if (msk[x] == 0) continue;
+							Histogram h(truncate, mode);
+
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = *w;
-								h.add(addval, src2.at<uchar>(y + j, x + i), metric);
-								w++;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = *w;
+									h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+									w++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			delete[] lutc1;
 			delete[] lutc2;
@@ -1198,93 +1239,99 @@ namespace cp
 
 			if (method == Histogram::BILATERAL)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					uchar* msk = mask.ptr<uchar>(y);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						if (msk[x] == 0)continue;
-						h.clear();
-						const uchar gg = guide.at<uchar>(y, x);
-						const uchar ss = src.at<uchar>(y, x);
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						uchar* msk = mask.ptr<uchar>(y);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							uchar* gp = G.ptr<uchar>(y + j); gp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							if (msk[x] == 0)continue;
+							h.clear();
+							const uchar gg = guide.at<uchar>(y, x);
+							const uchar ss = src.at<uchar>(y, x);
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-								int diff1 = abs(ss - *sp);
-								int diff = abs(gg - *gp);
-								addval *= lutc1[diff1] * lutc2[diff];
-
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
-								gp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								uchar* gp = G.ptr<uchar>(y + j); gp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+									int diff1 = abs(ss - *sp);
+									int diff = abs(gg - *gp);
+									addval *= lutc1[diff1] * lutc2[diff];
+
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+									gp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::GAUSSIAN)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					uchar* msk = mask.ptr<uchar>(y);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						if (msk[x] == 0)continue;
-						h.clear();
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						uchar* msk = mask.ptr<uchar>(y);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							if (msk[x] == 0)continue;
+							h.clear();
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::NO_WEIGHT)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					uchar* msk = mask.ptr<uchar>(y);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						if (msk[x] == 0)continue;
-						Histogram h(truncate, mode);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						uchar* msk = mask.ptr<uchar>(y);
+						for (int x = 0; x < width; x++)
 						{
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
-							{
-								float addval = *w;
-								h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+							if (msk[x] == 0)continue;
+							Histogram h(truncate, mode);
 
-								w++;
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+							{
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = *w;
+									h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+
+									w++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			delete[] lutc1;
 			delete[] lutc2;
@@ -1346,98 +1393,104 @@ namespace cp
 
 			if (method == Histogram::BILATERAL)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					uchar* msk = mask.ptr<uchar>(y);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						if (msk[x] == 0)continue;
-
-						h.clear();
-						const uchar bb = B.at<uchar>(y, x);
-						const uchar gg = G.at<uchar>(y, x);
-						const uchar rr = R.at<uchar>(y, x);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						uchar* msk = mask.ptr<uchar>(y);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							uchar* bp = guideB.ptr<uchar>(y + j); bp += x;
-							uchar* gp = guideG.ptr<uchar>(y + j); gp += x;
-							uchar* rp = guideR.ptr<uchar>(y + j); rp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
-							{
-								float addval = luts[idx] * *w;
+							if (msk[x] == 0)continue;
 
-								int diff = abs(bb - *bp) + abs(gg - *gp) + abs(rr - *rp);
-								addval *= lutc[diff];
-								h.add(addval, *sp, metric);
+							h.clear();
+							const uchar bb = B.at<uchar>(y, x);
+							const uchar gg = G.at<uchar>(y, x);
+							const uchar rr = R.at<uchar>(y, x);
 
-								w++;
-								sp++;
-								bp++;
-								gp++;
-								rp++;
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+							{
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								uchar* bp = guideB.ptr<uchar>(y + j); bp += x;
+								uchar* gp = guideG.ptr<uchar>(y + j); gp += x;
+								uchar* rp = guideR.ptr<uchar>(y + j); rp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+
+									int diff = abs(bb - *bp) + abs(gg - *gp) + abs(rr - *rp);
+									addval *= lutc[diff];
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+									bp++;
+									gp++;
+									rp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::GAUSSIAN)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					uchar* msk = mask.ptr<uchar>(y);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						if (msk[x] == 0)continue;
-						h.clear();
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						uchar* msk = mask.ptr<uchar>(y);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							if (msk[x] == 0)continue;
+							h.clear();
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::NO_WEIGHT)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					uchar* msk = mask.ptr<uchar>(y);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						if (msk[x] == 0)continue;
-						Histogram h(truncate, mode);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						uchar* msk = mask.ptr<uchar>(y);
+						for (int x = 0; x < width; x++)
 						{
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							if (msk[x] == 0)continue;
+							Histogram h(truncate, mode);
+
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = *w;
-								h.add(addval, src2.at<uchar>(y + j, x + i), metric);
-								w++;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = *w;
+									h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+									w++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			delete[] lutc;
 			delete[] luts;
@@ -1464,90 +1517,96 @@ namespace cp
 
 			if (method == Histogram::BILATERAL)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					uchar* msk = mask.ptr<uchar>(y);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						if (msk[x] == 0)continue;
-						h.clear();
-						const uchar gg = guide.at<uchar>(y, x);
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						uchar* msk = mask.ptr<uchar>(y);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							uchar* gp = G.ptr<uchar>(y + j); gp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							if (msk[x] == 0)continue;
+							h.clear();
+							const uchar gg = guide.at<uchar>(y, x);
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-								int diff = abs(gg - *gp);
-								addval *= lutc[diff];
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
-								gp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								uchar* gp = G.ptr<uchar>(y + j); gp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+									int diff = abs(gg - *gp);
+									addval *= lutc[diff];
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+									gp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::GAUSSIAN)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					Histogram h(truncate, mode);
-					uchar* msk = mask.ptr<uchar>(y);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						if (msk[x] == 0)continue;
-						h.clear();
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						Histogram h(truncate, mode);
+						uchar* msk = mask.ptr<uchar>(y);
+						for (int x = 0; x < width; x++)
 						{
-							uchar* sp = src2.ptr<uchar>(y + j); sp += x;
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
+							if (msk[x] == 0)continue;
+							h.clear();
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
 							{
-								float addval = luts[idx] * *w;
-								h.add(addval, *sp, metric);
-
-								w++;
-								sp++;
+								uchar* sp = src2.ptr<uchar>(y + j); sp += x;
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = luts[idx] * *w;
+									h.add(addval, *sp, metric);
+
+									w++;
+									sp++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			else if (method == Histogram::NO_WEIGHT)
 			{
-#pragma omp parallel for
-				for (int y = 0; y < height; y++)
+				parallelFor(Range(0, height), [&](const Range& range)
 				{
-					uchar* msk = mask.ptr<uchar>(y);
-					for (int x = 0; x < width; x++)
+					for (int y = range.start; y < range.end; y++)
 					{
-						if (msk[x] == 0)continue;
-						Histogram h(truncate, mode);
-
-						for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+						uchar* msk = mask.ptr<uchar>(y);
+						for (int x = 0; x < width; x++)
 						{
-							float* w = wmap.ptr<float>(y + j); w += x;
-							for (int i = 0; i < 2 * r + 1; i++, idx++)
-							{
-								float addval = *w;
-								h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+							if (msk[x] == 0)continue;
+							Histogram h(truncate, mode);
 
-								w++;
+							for (int j = 0, idx = 0; j < 2 * r + 1; j++)
+							{
+								float* w = wmap.ptr<float>(y + j); w += x;
+								for (int i = 0; i < 2 * r + 1; i++, idx++)
+								{
+									float addval = *w;
+									h.add(addval, src2.at<uchar>(y + j, x + i), metric);
+
+									w++;
+								}
 							}
+							dst.at<uchar>(y, x) = h.returnVal();
 						}
-						dst.at<uchar>(y, x) = h.returnVal();
 					}
-				}
+				});
 			}
 			delete[] lutc;
 			delete[] luts;
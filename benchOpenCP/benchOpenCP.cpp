@@ -0,0 +1,404 @@
+#include <opencp.hpp>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+
+using namespace std;
+using namespace cv;
+using namespace cp;
+
+//headless throughput benchmark of the cp:: filters.
+//every filter runs over a synthetic image for each size/type/radius, and reports megapixels per second (MP/s).
+//
+//options (the other options are passed to Google Benchmark):
+//  --sizes=1920x1080,640x480     image sizes
+//  --types=8UC1,8UC3,32FC1,32FC3 image types
+//  --radii=3,7                   filter radii (search window radius of NLM, window radius of stereo, 2r+1 region size of SLIC)
+//JSON output: --benchmark_format=json or --benchmark_out=result.json
+
+struct BenchConfig
+{
+	vector<Size> sizes;
+	vector<int> types;
+	vector<int> radii;
+
+	BenchConfig()
+	{
+		sizes.push_back(Size(1920, 1080));
+		sizes.push_back(Size(640, 480));
+		types.push_back(CV_8UC1);
+		types.push_back(CV_8UC3);
+		types.push_back(CV_32FC1);
+		types.push_back(CV_32FC3);
+		radii.push_back(3);
+		radii.push_back(7);
+	}
+};
+
+static vector<string> splitString(const string& src, char delim)
+{
+	vector<string> ret;
+	stringstream ss(src);
+	string item;
+	while (getline(ss, item, delim))
+	{
+		if (!item.empty()) ret.push_back(item);
+	}
+	return ret;
+}
+
+static int stringToType(const string& s)
+{
+	if (s == "8UC1") return CV_8UC1;
+	if (s == "8UC3") return CV_8UC3;
+	if (s == "16SC1") return CV_16SC1;
+	if (s == "16SC3") return CV_16SC3;
+	if (s == "32FC1") return CV_32FC1;
+	if (s == "32FC3") return CV_32FC3;
+	if (s == "64FC1") return CV_64FC1;
+	if (s == "64FC3") return CV_64FC3;
+	CV_Error(Error::StsBadArg, "unsupported type: " + s);
+	return -1;
+}
+
+static string typeToString(int type)
+{
+	const char* depth[] = { "8U", "8S", "16U", "16S", "32S", "32F", "64F", "USR" };
+	return format("%sC%d", depth[CV_MAT_DEPTH(type)], CV_MAT_CN(type));
+}
+
+//consume own options and remove them from argv
+static BenchConfig parseConfig(int& argc, char** argv)
+{
+	BenchConfig config;
+	int n = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		const string arg = argv[i];
+		if (arg.find("--sizes=") == 0)
+		{
+			config.sizes.clear();
+			vector<string> v = splitString(arg.substr(8), ',');
+			for (size_t j = 0; j < v.size(); j++)
+			{
+				int w = 0, h = 0;
+				if (sscanf(v[j].c_str(), "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0)
+					CV_Error(Error::StsBadArg, "invalid size: " + v[j]);
+				config.sizes.push_back(Size(w, h));
+			}
+		}
+		else if (arg.find("--types=") == 0)
+		{
+			config.types.clear();
+			vector<string> v = splitString(arg.substr(8), ',');
+			for (size_t j = 0; j < v.size(); j++) config.types.push_back(stringToType(v[j]));
+		}
+		else if (arg.find("--radii=") == 0)
+		{
+			config.radii.clear();
+			vector<string> v = splitString(arg.substr(8), ',');
+			for (size_t j = 0; j < v.size(); j++) config.radii.push_back(atoi(v[j].c_str()));
+		}
+		else
+		{
+			argv[n++] = argv[i];
+		}
+	}
+	argc = n;
+	return config;
+}
+
+//deterministic natural-like image: smooth gradient, edges, texture and noise.
+static Mat createSyntheticImage(Size size, int type)
+{
+	Mat base(size, CV_8UC3);
+	for (int j = 0; j < size.height; j++)
+	{
+		uchar* d = base.ptr<uchar>(j);
+		for (int i = 0; i < size.width; i++)
+		{
+			d[3 * i + 0] = saturate_cast<uchar>(255.0 * i / size.width);
+			d[3 * i + 1] = saturate_cast<uchar>(255.0 * j / size.height);
+			d[3 * i + 2] = saturate_cast<uchar>(128.0 + 64.0 * sin(0.05 * i) * cos(0.07 * j));
+		}
+	}
+	RNG rng(0x12345678);
+	const int step = max(16, min(size.width, size.height) / 8);
+	for (int k = 0; k < 32; k++)
+	{
+		Point pt(rng.uniform(0, size.width), rng.uniform(0, size.height));
+		Scalar color(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+		if (k % 2 == 0) circle(base, pt, rng.uniform(step / 4, step), color, -1);
+		else rectangle(base, Rect(pt.x, pt.y, rng.uniform(step / 4, step), rng.uniform(step / 4, step)), color, -1);
+	}
+	Mat noise;
+	addNoise(base, noise, 10.0);
+
+	Mat src;
+	if (CV_MAT_CN(type) == 1) cvtColor(noise, src, COLOR_BGR2GRAY);
+	else src = noise;
+	src.convertTo(src, CV_MAT_DEPTH(type));
+	return src;
+}
+
+static const Mat& getSyntheticImage(Size size, int type)
+{
+	static map<string, Mat> cache;
+	const string key = format("%dx%d_%d", size.width, size.height, type);
+	map<string, Mat>::iterator it = cache.find(key);
+	if (it == cache.end()) it = cache.insert(make_pair(key, createSyntheticImage(size, type))).first;
+	return it->second;
+}
+
+//a filter returns a closure that processes one frame; stateful classes are constructed out of the timing loop.
+typedef function<void(const Mat& src, Mat& dest)> Runner;
+typedef function<Runner(const Mat& src, int r)> RunnerFactory;
+
+struct BenchEntry
+{
+	string name;
+	bool isUseRadius;
+	vector<int> depths;
+	int channels;//0: both 1 and 3
+	RunnerFactory factory;
+};
+
+static vector<int> depths8U32F()
+{
+	vector<int> v;
+	v.push_back(CV_8U);
+	v.push_back(CV_32F);
+	return v;
+}
+
+static vector<int> depths8U()
+{
+	return vector<int>(1, CV_8U);
+}
+
+static void addEntry(vector<BenchEntry>& entries, const string& name, bool isUseRadius, const vector<int>& depths, int channels, RunnerFactory factory)
+{
+	BenchEntry e;
+	e.name = name;
+	e.isUseRadius = isUseRadius;
+	e.depths = depths;
+	e.channels = channels;
+	e.factory = factory;
+	entries.push_back(e);
+}
+
+static vector<BenchEntry> createEntries()
+{
+	vector<BenchEntry> e;
+	const double sigma_color = 30.0;
+
+	//bilateral filters
+	addEntry(e, "bilateralFilter", true, depths8U32F(), 0, [=](const Mat&, int r)
+	{
+		return Runner([=](const Mat& src, Mat& dest){ bilateralFilter(src, dest, Size(2 * r + 1, 2 * r + 1), sigma_color, r / 2.0, FILTER_RECTANGLE); });
+	});
+	addEntry(e, "bilateralFilter_CIRCLE", true, depths8U32F(), 0, [=](const Mat&, int r)
+	{
+		return Runner([=](const Mat& src, Mat& dest){ bilateralFilter(src, dest, Size(2 * r + 1, 2 * r + 1), sigma_color, r / 2.0, FILTER_CIRCLE); });
+	});
+	addEntry(e, "bilateralFilter_SEPARABLE", true, depths8U32F(), 0, [=](const Mat&, int r)
+	{
+		return Runner([=](const Mat& src, Mat& dest){ bilateralFilter(src, dest, Size(2 * r + 1, 2 * r + 1), sigma_color, r / 2.0, FILTER_SEPARABLE); });
+	});
+	addEntry(e, "jointBilateralFilter", true, depths8U32F(), 0, [=](const Mat&, int r)
+	{
+		return Runner([=](const Mat& src, Mat& dest){ jointBilateralFilter(src, src, dest, Size(2 * r + 1, 2 * r + 1), sigma_color, r / 2.0, FILTER_RECTANGLE); });
+	});
+	addEntry(e, "binalyWeightedRangeFilter", true, depths8U32F(), 0, [=](const Mat&, int r)
+	{
+		return Runner([=](const Mat& src, Mat& dest){ binalyWeightedRangeFilter(src, dest, Size(2 * r + 1, 2 * r + 1), (float)sigma_color); });
+	});
+	addEntry(e, "RealtimeO1BilateralFilter_FIR", true, depths8U32F(), 0, [=](const Mat&, int r)
+	{
+		shared_ptr<RealtimeO1BilateralFilter> rbf = make_shared<RealtimeO1BilateralFilter>();
+		return Runner([=](const Mat& src, Mat& dest){ rbf->gaussFIR(src, dest, r, (float)sigma_color, r / 2.f, 8); });
+	});
+	addEntry(e, "RealtimeO1BilateralFilter_IIR_AM", true, depths8U32F(), 0, [=](const Mat&, int r)
+	{
+		shared_ptr<RealtimeO1BilateralFilter> rbf = make_shared<RealtimeO1BilateralFilter>();
+		return Runner([=](const Mat& src, Mat& dest){ rbf->gaussIIR(src, dest, (float)sigma_color, r / 2.f, 8, RealtimeO1BilateralFilter::IIR_AM, 5); });
+	});
+	addEntry(e, "recursiveBilateralFilter", false, depths8U(), 3, [=](const Mat&, int)
+	{
+		return Runner([=](const Mat& src, Mat& dest){ Mat s = src; recursiveBilateralFilter(s, dest, (float)sigma_color, 10.f); });
+	});
+
+	//edge-preserving filters
+	addEntry(e, "guidedFilter", true, depths8U32F(), 0, [=](const Mat&, int r)
+	{
+		return Runner([=](const Mat& src, Mat& dest){ guidedFilter(src, dest, r, 100.f); });
+	});
+	addEntry(e, "domainTransformFilter_RF", true, depths8U32F(), 0, [=](const Mat&, int r)
+	{
+		return Runner([=](const Mat& src, Mat& dest){ domainTransformFilter(src, dest, (float)sigma_color, (float)r, 2, DTF_L1, DTF_RF, DTF_BGRA_SSE_PARALLEL); });
+	});
+
+	addEntry(e, "localLaplacianFilter", false, depths8U32F(), 0, [=](const Mat&, int)
+	{
+		shared_ptr<LocalLaplacianFilter> llf = make_shared<LocalLaplacianFilter>();
+		return Runner([=](const Mat& src, Mat& dest){ llf->operator()(src, dest, 0.2, 0.5, 1.0); });
+	});
+
+	//non-local means: 3x3 template, (2r+1)x(2r+1) search window
+	addEntry(e, "nonLocalMeansFilter", true, depths8U32F(), 0, [=](const Mat&, int r)
+	{
+		return Runner([=](const Mat& src, Mat& dest){ Mat s = src; nonLocalMeansFilter(s, dest, 3, 2 * r + 1, 10.0); });
+	});
+
+	//Gaussian filters: sigma = r/3
+	const char* gaussianName[] = { "DCT", "FIR", "BOX", "EBOX", "SII", "AM", "AM2", "DERICHE", "VYV", "SR", "AUTO" };
+	const int gaussianMethod[] =
+	{
+		GAUSSIAN_FILTER_DCT, GAUSSIAN_FILTER_FIR, GAUSSIAN_FILTER_BOX, GAUSSIAN_FILTER_EBOX, GAUSSIAN_FILTER_SII,
+		GAUSSIAN_FILTER_AM, GAUSSIAN_FILTER_AM2, GAUSSIAN_FILTER_DERICHE, GAUSSIAN_FILTER_VYV, GAUSSIAN_FILTER_SR, GAUSSIAN_FILTER_AUTO
+	};
+	for (int i = 0; i < 11; i++)
+	{
+		const int method = gaussianMethod[i];
+		addEntry(e, string("GaussianFilter_") + gaussianName[i], true, depths8U32F(), 0, [=](const Mat&, int r)
+		{
+			return Runner([=](const Mat& src, Mat& dest){ GaussianFilter(src, dest, r / 3.0, method); });
+		});
+	}
+
+	//denoising
+	addEntry(e, "DenoiseDXTShrinkage_DCT", false, depths8U32F(), 0, [=](const Mat&, int)
+	{
+		shared_ptr<DenoiseDXTShrinkage> dxt = make_shared<DenoiseDXTShrinkage>();
+		return Runner([=](const Mat& src, Mat& dest){ Mat s = src; dxt->operator()(s, dest, 20.f, Size(8, 8), 0); });
+	});
+	addEntry(e, "DenoiseDXTShrinkage_DHT", false, depths8U32F(), 0, [=](const Mat&, int)
+	{
+		shared_ptr<DenoiseDXTShrinkage> dxt = make_shared<DenoiseDXTShrinkage>();
+		return Runner([=](const Mat& src, Mat& dest){ Mat s = src; dxt->operator()(s, dest, 20.f, Size(8, 8), 1); });
+	});
+	//the SSE kernels, which are the baseline of the AVX2/AVX-512 shrinkage of the entries above
+	addEntry(e, "DenoiseDXTShrinkage_DCT_SSE", false, depths8U32F(), 0, [=](const Mat&, int)
+	{
+		shared_ptr<DenoiseDXTShrinkage> dxt = make_shared<DenoiseDXTShrinkage>();
+		dxt->isWideSIMD = false;
+		return Runner([=](const Mat& src, Mat& dest){ Mat s = src; dxt->operator()(s, dest, 20.f, Size(8, 8), 0); });
+	});
+	addEntry(e, "DenoiseDXTShrinkage_DHT_SSE", false, depths8U32F(), 0, [=](const Mat&, int)
+	{
+		shared_ptr<DenoiseDXTShrinkage> dxt = make_shared<DenoiseDXTShrinkage>();
+		dxt->isWideSIMD = false;
+		return Runner([=](const Mat& src, Mat& dest){ Mat s = src; dxt->operator()(s, dest, 20.f, Size(8, 8), 1); });
+	});
+	//patch_step and step_mode of the table in testOpenCP/denoise/readme.md
+	const char* stepModeName[] = { "", "_Shifted", "_Random" };
+	const int stepMode[] = { DenoiseDXTShrinkage::PATCH_STEP_GRID, DenoiseDXTShrinkage::PATCH_STEP_SHIFTED_GRID, DenoiseDXTShrinkage::PATCH_STEP_RANDOM };
+	for (int step = 2; step <= 8; step *= 2)
+	{
+		for (int m = 0; m < 3; m++)
+		{
+			const int mode = stepMode[m];
+			addEntry(e, "DenoiseDXTShrinkage_DCT_Step" + to_string(step) + stepModeName[m], false, depths8U32F(), 0, [=](const Mat&, int)
+			{
+				shared_ptr<DenoiseDXTShrinkage> dxt = make_shared<DenoiseDXTShrinkage>();
+				return Runner([=](const Mat& src, Mat& dest){ Mat s = src; dxt->operator()(s, dest, 20.f, Size(8, 8), 0, step, mode); });
+			});
+		}
+	}
+
+	//segmentation
+	addEntry(e, "SLIC", true, depths8U32F(), 0, [=](const Mat&, int r)
+	{
+		return Runner([=](const Mat& src, Mat& dest){ SLIC(src, dest, 2 * r + 1, 20.f, 0.1f, 10); });
+	});
+
+	//stereo: the right image is the left image shifted by 16 pixels
+	const char* sgbmName[] = { "", "_ParallelExact", "_ParallelStripe", "_Census" };
+	const int sgbmMode[] = { StereoSGBM2::PARALLEL_NONE, StereoSGBM2::PARALLEL_EXACT, StereoSGBM2::PARALLEL_STRIPE, StereoSGBM2::PARALLEL_NONE };
+	const int sgbmCost[] = { StereoSGBM2::COST_BT, StereoSGBM2::COST_BT, StereoSGBM2::COST_BT, StereoSGBM2::COST_CENSUS };
+	for (int i = 0; i < 4; i++)
+	{
+		const int mode = sgbmMode[i];
+		const int cost = sgbmCost[i];
+		addEntry(e, string("StereoSGBM2") + sgbmName[i], true, depths8U(), 0, [=](const Mat& src, int r)
+		{
+			shared_ptr<StereoSGBM2> sgbm = make_shared<StereoSGBM2>(0, 64, Size(2 * r + 1, 2 * r + 1), 8 * src.channels() * (2 * r + 1)*(2 * r + 1), 32 * src.channels() * (2 * r + 1)*(2 * r + 1));
+			sgbm->parallelMode = mode;
+			sgbm->costType = cost;
+			shared_ptr<Mat> right = make_shared<Mat>();
+			Mat M = (Mat_<double>(2, 3) << 1, 0, -16, 0, 1, 0);
+			warpAffine(src, *right, M, src.size(), INTER_LINEAR, BORDER_REPLICATE);
+			return Runner([=](const Mat& left, Mat& dest){ sgbm->operator()(left, *right, dest); });
+		});
+	}
+
+	return e;
+}
+
+static void runBench(benchmark::State& state, RunnerFactory factory, Size size, int type, int r)
+{
+	const Mat& src = getSyntheticImage(size, type);
+	Runner run = factory(src, r);
+	Mat dest;
+	run(src, dest);//warm up: allocation and LUTs
+	for (auto _ : state)
+	{
+		run(src, dest);
+		benchmark::DoNotOptimize(dest.data);
+		benchmark::ClobberMemory();
+	}
+	state.counters["MP/s"] = benchmark::Counter(size.area() / 1000000.0, benchmark::Counter::kIsIterationInvariantRate);
+	state.counters["width"] = size.width;
+	state.counters["height"] = size.height;
+	state.counters["radius"] = r;
+	state.SetLabel(typeToString(type));
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config = parseConfig(argc, argv);
+
+	benchmark::AddCustomContext("opencv_version", CV_VERSION);
+	benchmark::AddCustomContext("opencv_threads", to_string(getNumThreads()));
+	benchmark::AddCustomContext("cpu_avx2", checkHardwareSupport(CV_CPU_AVX2) ? "1" : "0");
+	benchmark::AddCustomContext("cpu_avx512f", checkHardwareSupport(CV_CPU_AVX_512F) ? "1" : "0");
+
+	vector<BenchEntry> entries = createEntries();
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const BenchEntry& e = entries[i];
+		const vector<int> radii = e.isUseRadius ? config.radii : vector<int>(1, 0);
+		for (size_t s = 0; s < config.sizes.size(); s++)
+		{
+			for (size_t t = 0; t < config.types.size(); t++)
+			{
+				const int type = config.types[t];
+				if (find(e.depths.begin(), e.depths.end(), CV_MAT_DEPTH(type)) == e.depths.end()) continue;
+				if (e.channels != 0 && e.channels != CV_MAT_CN(type)) continue;
+
+				for (size_t k = 0; k < radii.size(); k++)
+				{
+					const Size size = config.sizes[s];
+					const int r = radii[k];
+					string name = format("%s/%dx%d/%s", e.name.c_str(), size.width, size.height, typeToString(type).c_str());
+					if (e.isUseRadius) name += format("/r%d", r);
+
+					benchmark::RegisterBenchmark(name.c_str(), runBench, e.factory, size, type, r)
+						->Unit(benchmark::kMillisecond)
+						->UseRealTime();
+				}
+			}
+		}
+	}
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,351 @@
+#include <opencp.hpp>
+
+#include <cfloat>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+using namespace cp;
+
+//headless numerical checks of the cp:: filters, which are run by ctest.
+//usage: checkOpenCP [name...] (all checks without names); the exit code is the number of the failed checks.
+
+typedef function<bool()> Check;
+
+struct CheckEntry
+{
+	string name;
+	Check check;
+};
+
+//smooth gradients with flat shapes, which have many similar patches
+static Mat createSyntheticImage(Size size)
+{
+	Mat base(size, CV_8UC3);
+	for (int j = 0; j < size.height; j++)
+	{
+		uchar* d = base.ptr<uchar>(j);
+		for (int i = 0; i < size.width; i++)
+		{
+			d[3 * i + 0] = saturate_cast<uchar>(255.0 * i / size.width);
+			d[3 * i + 1] = saturate_cast<uchar>(255.0 * j / size.height);
+			d[3 * i + 2] = saturate_cast<uchar>(128.0 + 64.0 * sin(0.05 * i) * cos(0.07 * j));
+		}
+	}
+	RNG rng(0x12345678);
+	const int step = max(16, min(size.width, size.height) / 8);
+	for (int k = 0; k < 32; k++)
+	{
+		Point pt(rng.uniform(0, size.width), rng.uniform(0, size.height));
+		Scalar color(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+		if (k % 2 == 0) circle(base, pt, rng.uniform(step / 4, step), color, -1);
+		else rectangle(base, Rect(pt.x, pt.y, rng.uniform(step / 4, step), rng.uniform(step / 4, step)), color, -1);
+	}
+	return base;
+}
+
+//a stereo pair of the synthetic image: the background has the disparity 8 and a centered rectangle has 16
+static void createSyntheticStereoPair(Size size, Mat& left, Mat& right)
+{
+	left = createSyntheticImage(size);
+	right.create(size, CV_8UC3);
+	const Rect fore(size.width / 4, size.height / 4, size.width / 2, size.height / 2);
+	for (int j = 0; j < size.height; j++)
+	{
+		const Vec3b* s = left.ptr<Vec3b>(j);
+		Vec3b* d = right.ptr<Vec3b>(j);
+		for (int i = 0; i < size.width; i++)
+		{
+			const bool isFore = fore.contains(Point(i + 16, j));
+			d[i] = s[min(i + ((isFore) ? 16 : 8), size.width - 1)];
+		}
+	}
+}
+
+//the number of the different values of two outputs, which must be the same
+static int countDiff(const Mat& ref, const Mat& dst)
+{
+	Mat diff;
+	compare(ref, dst, diff, CMP_NE);
+	return countNonZero(diff.reshape(1));
+}
+
+//the groups of BM3D must hold more than the reference patch at a moderate noise level
+static bool checkBM3DGroupSize()
+{
+	Mat gray, noisy, dest;
+	cvtColor(createSyntheticImage(Size(256, 256)), gray, COLOR_BGR2GRAY);
+	addNoise(gray, noisy, 20.0);
+
+	DenoiseBM3D bm3d;
+	bm3d(noisy, dest, 20.f);
+	const double psnrNoisy = PSNR(gray, noisy);
+	const double psnr = PSNR(gray, dest);
+	printf("BM3D sigma=20: mean group size HT %.2f, Wiener %.2f, PSNR %.2f -> %.2f dB\n", bm3d.meanGroupSizeHT, bm3d.meanGroupSizeWiener, psnrNoisy, psnr);
+	return bm3d.meanGroupSizeHT > 1.f && bm3d.meanGroupSizeWiener > 1.f && psnr > psnrNoisy;
+}
+
+//the batched AVX2/AVX-512 shrinkage of patch_step=1 must match the SSE kernels up to the float rounding.
+//a coefficient at the threshold can flip, so that the outputs are compared by the maximum difference and PSNR.
+static bool checkDXTShrinkageWideSIMD()
+{
+	Mat gray, noisy;
+	cvtColor(createSyntheticImage(Size(256, 256)), gray, COLOR_BGR2GRAY);
+	addNoise(gray, noisy, 20.0);
+	noisy.convertTo(noisy, CV_32F);
+
+	printf("DXT shrinkage: AVX2 %s, AVX-512 %s\n", checkHardwareSupport(CV_CPU_AVX2) ? "yes" : "no", checkHardwareSupport(CV_CPU_AVX_512F) ? "yes" : "no");
+	const char* names[] = { "DCT 8x8", "DHT 8x8", "DHT 16x16" };
+	const int bases[] = { 0, 1, 1 };
+	const int sizes[] = { 8, 8, 16 };
+	bool ok = true;
+	for (int k = 0; k < 3; k++)
+	{
+		Mat ref, dst;
+		DenoiseDXTShrinkage dxt;
+		dxt.isWideSIMD = false;
+		dxt(noisy, ref, 20.f, Size(sizes[k], sizes[k]), bases[k]);
+		dxt.isWideSIMD = true;
+		dxt(noisy, dst, 20.f, Size(sizes[k], sizes[k]), bases[k]);
+
+		//PSNR64F is 0 for the same images, which are the output without the wide kernels
+		const double maxdiff = norm(ref, dst, NORM_INF);
+		const double psnr = (maxdiff > 0.0) ? PSNR64F(ref, dst) : DBL_MAX;
+		printf("%-10s max diff %g, PSNR %.1f dB\n", names[k], maxdiff, (maxdiff > 0.0) ? psnr : 0.0);
+		ok &= maxdiff < 0.5 && psnr > 60.0;
+	}
+	return ok;
+}
+
+//the row-band pipeline of StereoBMSimple (bandHeight > 0) must give the same disparity map as the DSI path
+static bool checkStereoBMSimpleBand()
+{
+	Mat left, right;
+	createSyntheticStereoPair(Size(256, 192), left, right);
+
+	Mat ref;
+	StereoBMSimple dsi(7, 0, 32);
+	dsi(left, right, ref);
+
+	bool ok = true;
+	const int bandHeights[] = { 1, 16, 64 };
+	for (int k = 0; k < 3; k++)
+	{
+		Mat dst;
+		StereoBMSimple band(7, 0, 32);
+		band.bandHeight = bandHeights[k];
+		band(left, right, dst);
+
+		const int diff = countDiff(ref, dst);
+		printf("bandHeight %2d: %d different pixels\n", bandHeights[k], diff);
+		ok &= diff == 0;
+	}
+	return ok;
+}
+
+//PARALLEL_EXACT of StereoSGBM2 must give the same disparity maps as PARALLEL_NONE.
+//PARALLEL_STRIPE restarts the top-down paths above each stripe, so that a few pixels can differ by more than one disparity.
+static bool checkStereoSGBMParallel()
+{
+	Mat left, right, grayL, grayR;
+	createSyntheticStereoPair(Size(256, 192), left, right);
+	cvtColor(left, grayL, COLOR_BGR2GRAY);
+	cvtColor(right, grayR, COLOR_BGR2GRAY);
+
+	bool ok = true;
+	for (int fullDP = 0; fullDP < 2; fullDP++)
+	{
+		StereoSGBM2 sgbm(0, 32, Size(5, 5), 8 * 25, 32 * 25);
+		sgbm.fullDP = fullDP == 1;
+		Mat refL, refR;
+		sgbm.parallelMode = StereoSGBM2::PARALLEL_NONE;
+		sgbm(grayL, grayR, refL, refR);
+
+		Mat dstL, dstR;
+		sgbm.parallelMode = StereoSGBM2::PARALLEL_EXACT;
+		sgbm(grayL, grayR, dstL, dstR);
+		const int diff = countDiff(refL, dstL) + countDiff(refR, dstR);
+		printf("fullDP %d: PARALLEL_EXACT %d different pixels", fullDP, diff);
+		ok &= diff == 0;
+
+		sgbm.parallelMode = StereoSGBM2::PARALLEL_STRIPE;
+		sgbm(grayL, grayR, dstL, dstR);
+		Mat absdiff16, mask;
+		absdiff(refL, dstL, absdiff16);
+		compare(absdiff16, StereoSGBM2::DISP_SCALE, mask, CMP_GT);
+		const double rate = 100.0 * countNonZero(mask) / mask.total();
+		printf(", PARALLEL_STRIPE %.2f%% pixels over one disparity\n", rate);
+		ok &= rate < 5.0;
+	}
+	return ok;
+}
+
+//the vectorized DP of StereoDP (isSIMD) must give the same disparity map as the scalar DP
+static bool checkStereoDPSIMD()
+{
+	Mat left, right;
+	createSyntheticStereoPair(Size(256, 192), left, right);
+
+	bool ok = true;
+	const int minDisparities[] = { 0, 4 };
+	const int ranges[] = { 32, 24 };
+	for (int k = 0; k < 2; k++)
+	{
+		Mat ref, dst;
+		StereoDP dp(minDisparities[k], ranges[k]);
+		dp.isOcclusion = 0;
+		dp.medianKernel = 0;
+		dp.isSIMD = false;
+		dp(left, right, ref);
+		dp.isSIMD = true;
+		dp(left, right, dst);
+
+		const int diff = countDiff(ref, dst);
+		printf("disparity [%d, %d): %d different pixels\n", minDisparities[k], minDisparities[k] + ranges[k], diff);
+		ok &= diff == 0;
+	}
+	return ok;
+}
+
+//the row stripes of StereoViewSynthesis (isParallel) must give the same views as the serial warping and blending
+static bool checkViewSynthesisParallel()
+{
+	const Size size(256, 192);
+	Mat left, right;
+	createSyntheticStereoPair(size, left, right);
+
+	bool ok = true;
+	const char* presetNames[] = { "fastest", "slowest" };
+	const int presets[] = { StereoViewSynthesis::PRESET_FASTEST, StereoViewSynthesis::PRESET_SLOWEST };
+	const int types[] = { CV_8U, CV_16S };
+	const double amps[] = { 4.0, 16.0 };
+	for (int t = 0; t < 2; t++)
+	{
+		//the ground truth of createSyntheticStereoPair
+		Mat dispL(size, types[t]), dispR(size, types[t]);
+		const Rect fore(size.width / 4, size.height / 4, size.width / 2, size.height / 2);
+		for (int j = 0; j < size.height; j++)
+		{
+			for (int i = 0; i < size.width; i++)
+			{
+				const double dl = (fore.contains(Point(i, j))) ? 16.0 : 8.0;
+				const double dr = (fore.contains(Point(i + 16, j))) ? 16.0 : 8.0;
+				if (types[t] == CV_8U)
+				{
+					dispL.at<uchar>(j, i) = saturate_cast<uchar>(dl * amps[t]);
+					dispR.at<uchar>(j, i) = saturate_cast<uchar>(dr * amps[t]);
+				}
+				else
+				{
+					dispL.at<short>(j, i) = saturate_cast<short>(dl * amps[t]);
+					dispR.at<short>(j, i) = saturate_cast<short>(dr * amps[t]);
+				}
+			}
+		}
+
+		for (int p = 0; p < 2; p++)
+		{
+			const double alphas[] = { 0.25, 0.5 };
+			for (int a = 0; a < 2; a++)
+			{
+				StereoViewSynthesis serial(presets[p]), parallel(presets[p]);
+				serial.isParallel = false;
+				parallel.isParallel = true;
+
+				Mat ref, refdisp, dst, dstdisp;
+				serial(left, right, dispL, dispR, ref, refdisp, alphas[a], 0, amps[t]);
+				parallel(left, right, dispL, dispR, dst, dstdisp, alphas[a], 0, amps[t]);
+				int diff = countDiff(ref, dst) + countDiff(refdisp, dstdisp);
+
+				//the view from the left image only
+				serial(left, dispL, ref, refdisp, alphas[a], 0, amps[t]);
+				parallel(left, dispL, dst, dstdisp, alphas[a], 0, amps[t]);
+				diff += countDiff(ref, dst) + countDiff(refdisp, dstdisp);
+
+				printf("%s, %s, alpha %.2f: %d different values\n", (types[t] == CV_8U) ? "8U" : "16S", presetNames[p], alphas[a], diff);
+				ok &= diff == 0;
+			}
+		}
+	}
+	return ok;
+}
+
+//the box sums of FILTER_INTEGRAL must match the SSE kernels of the non-local means filter up to the float accumulation.
+//a template distance at the rounding boundary of the weight table can take the next weight, so that the outputs are compared by the maximum difference and PSNR.
+static bool checkNonLocalMeansIntegral()
+{
+	Mat color, noisyColor, gray, noisyGray;
+	color = createSyntheticImage(Size(256, 192));
+	addNoise(color, noisyColor, 20.0);
+	cvtColor(color, gray, COLOR_BGR2GRAY);
+	addNoise(gray, noisyGray, 20.0);
+
+	bool ok = true;
+	const int templeteSizes[] = { 3, 5 };
+	const int searchSizes[] = { 7, 11 };
+	for (int c = 0; c < 2; c++)
+	{
+		Mat& noisy = (c == 0) ? noisyGray : noisyColor;
+		for (int k = 0; k < 2; k++)
+		{
+			Mat ref, dst;
+			nonLocalMeansFilter(noisy, ref, templeteSizes[k], searchSizes[k], 20.0, -1.0, FILTER_DEFAULT);
+			nonLocalMeansFilter(noisy, dst, templeteSizes[k], searchSizes[k], 20.0, -1.0, FILTER_INTEGRAL);
+
+			const double maxdiff = norm(ref, dst, NORM_INF);
+			const double psnr = (maxdiff > 0.0) ? PSNR(ref, dst) : DBL_MAX;
+			printf("%s template %d search %2d: max diff %g, PSNR %.1f dB\n", (c == 0) ? "gray " : "color", templeteSizes[k], searchSizes[k], maxdiff, (maxdiff > 0.0) ? psnr : 0.0);
+			ok &= maxdiff <= 4.0 && psnr > 50.0;
+		}
+	}
+	return ok;
+}
+
+static vector<CheckEntry> createChecks()
+{
+	vector<CheckEntry> e;
+	CheckEntry c;
+	c.name = "BM3DGroupSize"; c.check = checkBM3DGroupSize; e.push_back(c);
+	c.name = "DXTShrinkageWideSIMD"; c.check = checkDXTShrinkageWideSIMD; e.push_back(c);
+	c.name = "StereoBMSimpleBand"; c.check = checkStereoBMSimpleBand; e.push_back(c);
+	c.name = "StereoSGBMParallel"; c.check = checkStereoSGBMParallel; e.push_back(c);
+	c.name = "StereoDPSIMD"; c.check = checkStereoDPSIMD; e.push_back(c);
+	c.name = "ViewSynthesisParallel"; c.check = checkViewSynthesisParallel; e.push_back(c);
+	c.name = "NonLocalMeansIntegral"; c.check = checkNonLocalMeansIntegral; e.push_back(c);
+	return e;
+}
+
+int main(int argc, char** argv)
+{
+	const vector<CheckEntry> checks = createChecks();
+	int failed = 0;
+	int run = 0;
+	for (size_t i = 0; i < checks.size(); i++)
+	{
+		bool isSelected = argc < 2;
+		for (int a = 1; a < argc; a++) isSelected |= checks[i].name == argv[a];
+		if (!isSelected) continue;
+
+		run++;
+		bool ok = false;
+		try
+		{
+			ok = checks[i].check();
+		}
+		catch (const cv::Exception& ex)
+		{
+			printf("%s\n", ex.what());
+		}
+		printf("[%s] %s\n", (ok) ? "PASS" : "FAIL", checks[i].name.c_str());
+		if (!ok) failed++;
+	}
+	if (run == 0)
+	{
+		printf("no check is selected\n");
+		return 1;
+	}
+	return failed;
+}
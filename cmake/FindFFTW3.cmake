@@ -0,0 +1,30 @@
+# Find FFTW3 (double, float and long double precision).
+#
+#   FFTW3_FOUND
+#   FFTW3_INCLUDE_DIRS
+#   FFTW3_LIBRARIES
+
+find_path(FFTW3_INCLUDE_DIR fftw3.h
+	HINTS ${FFTW3_ROOT} ENV FFTW3_ROOT
+	PATH_SUFFIXES include)
+
+foreach(prec "" f l)
+	find_library(FFTW3${prec}_LIBRARY
+		NAMES fftw3${prec} libfftw3${prec}-3 fftw3${prec}-3
+		HINTS ${FFTW3_ROOT} ENV FFTW3_ROOT
+		PATH_SUFFIXES lib lib64)
+endforeach()
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(FFTW3 DEFAULT_MSG
+	FFTW3_INCLUDE_DIR FFTW3_LIBRARY FFTW3f_LIBRARY)
+
+if(FFTW3_FOUND)
+	set(FFTW3_INCLUDE_DIRS ${FFTW3_INCLUDE_DIR})
+	set(FFTW3_LIBRARIES ${FFTW3_LIBRARY} ${FFTW3f_LIBRARY})
+	if(FFTW3l_LIBRARY)
+		list(APPEND FFTW3_LIBRARIES ${FFTW3l_LIBRARY})
+	endif()
+endif()
+
+mark_as_advanced(FFTW3_INCLUDE_DIR FFTW3_LIBRARY FFTW3f_LIBRARY FFTW3l_LIBRARY)
@@ -5,11 +5,19 @@
 #include <opencv2/xphoto.hpp>
 #include <opencv2/ximgproc.hpp>
 #ifdef CP_API
+#if defined(_WIN32)
 #define CP_EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define CP_EXPORT __attribute__((visibility("default")))
+#else
+#define CP_EXPORT 
+#endif
 #else 
 #define CP_EXPORT 
 #endif
 
+//auto linking is only for MSVC; CMake build links libraries by target_link_libraries.
+#ifdef _MSC_VER
 #define CV_LIB_PREFIX comment(lib, "opencv_"
 
 #define CV_LIB_VERSION CVAUX_STR(CV_MAJOR_VERSION)\
@@ -91,6 +99,7 @@
 #pragma comment(lib, "libfftw3-3.lib")
 #pragma comment(lib, "libfftw3f-3.lib")
 #pragma comment(lib, "libfftw3l-3.lib")
+#endif
 
 namespace cp
 {
@@ -648,6 +657,141 @@ namespace cp
 	CP_EXPORT void mergeFromGrid(std::vector<cv::Mat>& src, cv::Size beforeSize, cv::Mat& dest, cv::Size grid, int borderRadius);
 	CP_EXPORT void splitToGrid(const cv::Mat& src, std::vector<cv::Mat>& dest, cv::Size grid, int borderRadius);
 
+	//execution context (executionContext.cpp): parallel loops of OpenCP run on the persistent thread pool of cv::parallel_for_ and OpenMP is not used,
+	//so that filters called nested or back to back share one runtime and do not oversubscribe cores.
+	//numThreads<=0: number of CPUs. cores: CPU indices to which the workers are pinned (empty: no pinning; Windows and Linux only).
+	CP_EXPORT void setExecutionContext(int numThreads, const std::vector<int>& cores = std::vector<int>());
+	CP_EXPORT int getExecutionThreads();
+
+	//ParallelLoopBody of a function object, e.g., [&](const cv::Range& range){...}
+	template<class F>
+	class ParallelLoopFunction_ : public cv::ParallelLoopBody
+	{
+		F f;
+	public:
+		ParallelLoopFunction_(const F& f_) : f(f_) { ; }
+		void operator()(const cv::Range& range) const { f(range); }
+	};
+
+	template<class F>
+	void parallelFor(const cv::Range& range, const F& f, double nstripes = -1.0)
+	{
+		cv::parallel_for_(range, ParallelLoopFunction_<F>(f), nstripes);
+	}
+
+	//task graph on the execution context: a task is a parallel loop split into stripes, which starts as soon as its dependencies finish,
+	//so that independent stages of a multi-filter pipeline overlap. dependencies are IDs returned by addTask of tasks added before.
+	//nested parallel loops in a task run sequentially in the worker.
+	class CP_EXPORT TaskGraph
+	{
+		struct Task
+		{
+			cv::Ptr<cv::ParallelLoopBody> owner;
+			const cv::ParallelLoopBody* body;
+			cv::Range range;
+			int nstripes;
+			std::vector<int> dependencies;
+		};
+		std::vector<Task> tasks;
+
+	public:
+		//body must outlive run()
+		int addTask(const cv::ParallelLoopBody& body, const cv::Range& range, const std::vector<int>& dependencies = std::vector<int>(), int nstripes = -1);
+		int addTask(const cv::Ptr<cv::ParallelLoopBody>& body, const cv::Range& range, const std::vector<int>& dependencies = std::vector<int>(), int nstripes = -1);
+		template<class F>
+		int addTask(const cv::Range& range, const F& f, const std::vector<int>& dependencies = std::vector<int>(), int nstripes = -1)
+		{
+			return addTask(cv::Ptr<cv::ParallelLoopBody>(new ParallelLoopFunction_<F>(f)), range, dependencies, nstripes);
+		}
+
+		//blocks until all tasks finish; the graph can be run again.
+		//when a body throws, the stripes not started yet are skipped, and the first exception is rethrown as it is.
+		void run();
+		void clear();
+		int size() const;
+	};
+
+	//tiled streaming execution for images larger than RAM (tiling.cpp).
+	//tiles with a halo of borderRadius are read from a TileSource, filtered by a TileFilter on numThreads workers,
+	//and written to a TileSink as soon as they finish, so that peak memory is bounded by numThreads x (tile + halo).
+	//read/write are called from worker threads; the filter is called concurrently and must be reentrant.
+	class CP_EXPORT TileSource
+	{
+	public:
+		virtual ~TileSource(){ ; }
+		virtual cv::Size size() const = 0;
+		virtual int type() const = 0;
+		virtual void read(const cv::Rect& roi, cv::Mat& dest) = 0;//roi is inside of size()
+	};
+
+	class CP_EXPORT TileSink
+	{
+	public:
+		virtual ~TileSink(){ ; }
+		virtual void write(const cv::Rect& roi, const cv::Mat& src) = 0;
+	};
+
+	//src: tile with halo, dest: output of the same size (the halo of dest is discarded)
+	class CP_EXPORT TileFilter
+	{
+	public:
+		virtual ~TileFilter(){ ; }
+		virtual void operator()(const cv::Mat& src, cv::Mat& dest) const = 0;
+	};
+
+	//cv::Mat (e.g., a Mat header on a memory-mapped file)
+	class CP_EXPORT MatTileSource : public TileSource
+	{
+		cv::Mat src;
+	public:
+		MatTileSource(const cv::Mat& src);
+		cv::Size size() const;
+		int type() const;
+		void read(const cv::Rect& roi, cv::Mat& dest);
+	};
+
+	class CP_EXPORT MatTileSink : public TileSink
+	{
+		cv::Mat dest;
+	public:
+		MatTileSink(cv::Mat& dest);//dest must be allocated
+		void write(const cv::Rect& roi, const cv::Mat& src);
+	};
+
+	//headerless raw file (row major, interleaved channels), which is streamed by 64-bit seek and read/write
+	class CP_EXPORT RawFileTileSource : public TileSource
+	{
+		FILE* fp;
+		cv::Mutex mutex;
+		cv::Size imageSize;
+		int imageType;
+		RawFileTileSource(const RawFileTileSource&);
+		RawFileTileSource& operator=(const RawFileTileSource&);
+	public:
+		RawFileTileSource(const std::string& path, cv::Size size, int type);
+		~RawFileTileSource();
+		cv::Size size() const;
+		int type() const;
+		void read(const cv::Rect& roi, cv::Mat& dest);
+	};
+
+	class CP_EXPORT RawFileTileSink : public TileSink
+	{
+		FILE* fp;
+		cv::Mutex mutex;
+		cv::Size imageSize;
+		int imageType;
+		RawFileTileSink(const RawFileTileSink&);
+		RawFileTileSink& operator=(const RawFileTileSink&);
+	public:
+		RawFileTileSink(const std::string& path, cv::Size size, int type);//the file is created (overwritten)
+		~RawFileTileSink();
+		void write(const cv::Rect& roi, const cv::Mat& src);
+	};
+
+	//borderType is applied to the halo outside of the image; numThreads<=0: getNumThreads()
+	CP_EXPORT void filterTiled(TileSource& src, TileSink& dest, const TileFilter& filter, cv::Size tileSize, int borderRadius, int borderType = cv::BORDER_REPLICATE, int numThreads = -1);
+
 	//slic
 	CP_EXPORT void SLICSegment2Vector3D(cv::InputArray segment, cv::InputArray signal, std::vector<std::vector<cv::Point3f>>& segmentPoint);
 	CP_EXPORT void SLICSegment2Vector3D(cv::InputArray segment, cv::InputArray signal, std::vector<std::vector<cv::Point3i>>& segmentPoint);
@@ -678,6 +822,7 @@ namespace cp
 		FILTER_RECTANGLE,
 		FILTER_SEPARABLE,
 		FILTER_SLOWEST,// for just comparison.
+		FILTER_INTEGRAL,//box sums of the difference image of each search offset (nonLocalMeansFilter and jointNonLocalMeansFilter)
 	};
 
 	class CP_EXPORT PostFilterSet
@@ -703,8 +848,47 @@ namespace cp
 		GAUSSIAN_FILTER_DERICHE,
 		GAUSSIAN_FILTER_VYV,
 		GAUSSIAN_FILTER_SR,
+		GAUSSIAN_FILTER_AUTO,//fastest method for sigma, size, type and tol, which is tuned at first call (K is ignored)
 	};
 	CP_EXPORT void GaussianFilter(cv::InputArray src, cv::OutputArray dest, const double sigma_space, const int filter_method, const int K = 0, const double tol = 1.0e-6);
+	//GAUSSIAN_FILTER_AUTO: candidates, whose PSNR to the exact Gaussian filter is higher than the accuracy (default 40 dB), are benchmarked on the input,
+	//and the fastest one is cached in a per-machine tuning table (OPENCP_GAUSSIAN_TUNING_FILE or ~/.opencp_gaussian_tuning.yml).
+	CP_EXPORT int getGaussianFilterAutoMethod(cv::InputArray src, const double sigma_space, const double tol = 1.0e-6);
+	CP_EXPORT void setGaussianFilterAutoAccuracy(const double psnr);
+	CP_EXPORT void setGaussianFilterTuningFile(const std::string& path);//empty path disables persistence
+	CP_EXPORT void clearGaussianFilterTuningTable();
+
+	//reusable GaussianFilter for video: coefficients, FFTW plans and working buffers are created at init(), 
+	//so that repeated calls on the same size and type do not allocate (if dest is also reused) nor re-plan.
+	//changing sigma recomputes only the coefficients. AM2 and SR are not planned and call GaussianFilter directly.
+	class CP_EXPORT GaussianFilterPlan
+	{
+	public:
+		class Impl;//internal coefficients and buffers of libGaussian
+
+		GaussianFilterPlan();
+		GaussianFilterPlan(cv::Size size, int type, double sigma_space, int filter_method, int K = 0, double tol = 1.0e-6);
+		~GaussianFilterPlan();
+		void init(cv::Size size, int type, double sigma_space, int filter_method, int K = 0, double tol = 1.0e-6);
+		void setSigma(double sigma_space);
+
+		//src must have the planned size and type
+		void operator()(cv::InputArray src, cv::OutputArray dest);
+		//replan if the size or type of src is changed
+		void operator()(cv::InputArray src, cv::OutputArray dest, double sigma_space);
+
+	private:
+		GaussianFilterPlan(const GaussianFilterPlan&);
+		GaussianFilterPlan& operator=(const GaussianFilterPlan&);
+
+		Impl* impl;
+		cv::Size size;
+		int type;
+		int method;
+		int K;
+		double sigma_space;
+		double tol;
+	};
 	CP_EXPORT void GaussianFilterwithMask(const cv::Mat src, cv::Mat& dest, int r, float sigma, int method, cv::Mat& mask);//slowest
 
 	CP_EXPORT void weightedGaussianFilter(cv::Mat& src, cv::Mat& weight, cv::Mat& dest, cv::Size ksize, float sigma, int border_type = cv::BORDER_REPLICATE);
@@ -771,6 +955,25 @@ namespace cp
 
 	CP_EXPORT void L0Smoothing(cv::Mat &im8uc3, cv::Mat& dest, float lambda = 0.02f, float kappa = 2.f);
 
+	//local Laplacian filter (Paris et al. 2011) by the fast algorithm of Aubry et al. 2014:
+	//the remapping is applied to the whole image for sampled intensity levels, and the output Laplacian pyramid is
+	//linearly interpolated between the pyramids of the two nearest levels.
+	//sigma_r: detail threshold in normalized intensity [0, 1], alpha: detail (<1 enhances), beta: edge (<1 compresses the range),
+	//levels: pyramid levels (<=0: the coarsest level is about 16 pixels), numSamples: intensity levels (<=0: spacing of sigma_r/2).
+	//color images are filtered channel by channel. the class keeps the pyramids for repeated calls.
+	class CP_EXPORT LocalLaplacianFilter
+	{
+		std::vector<cv::Mat> gaussianPyramid;
+		std::vector<cv::Mat> outputPyramid;
+		std::vector<cv::Mat> remapPyramid;
+		std::vector<cv::Mat> planes;
+		cv::Mat normalized, result, up;
+		void filterPlane(const cv::Mat& src, cv::Mat& dest, float sigma_r, float alpha, float beta, int levels, int numSamples);
+	public:
+		void operator()(cv::InputArray src, cv::OutputArray dest, const double sigma_r, const double alpha, const double beta, const int levels = 0, const int numSamples = 0);
+	};
+	CP_EXPORT void localLaplacianFilter(cv::InputArray src, cv::OutputArray dest, const double sigma_r, const double alpha, const double beta, const int levels = 0, const int numSamples = 0);
+
 	class CP_EXPORT RealtimeO1BilateralFilter
 	{
 	protected:
@@ -812,6 +1015,19 @@ namespace cp
 		void body_(const cv::Mat& src, const cv::Mat& joint, cv::Mat& dest);
 
 		void body(cv::InputArray src, cv::InputArray joint, cv::OutputArray dest, bool save_memorySize);
+
+		//for batch: two sets of bins, which are kept across frames, so that splatting of the next frame overlaps interpolation of the current frame
+		std::vector<cv::Mat> batch_sub_range[2];
+		std::vector<cv::Mat> batch_normalize_sub_range[2];
+		std::vector<cv::Mat> batch_bgrid[2];
+		cv::Mat batch_src[2];
+		cv::Mat batch_guide[2];
+		std::vector<cv::Ptr<GaussianFilterPlan> > batch_plan;//IIR states for each bin of each set
+		void createBatchBin(cv::Size imsize, cv::Size fullsize, int channels);
+		void blurringBatch(cv::Mat& srcdest, GaussianFilterPlan& plan);
+		template <typename T, typename S>
+		void bodyBatch_(const std::vector<cv::Mat>& src, const std::vector<cv::Mat>& guide, std::vector<cv::Mat>& dest);
+		void bodyBatch(const std::vector<cv::Mat>& src, const std::vector<cv::Mat>& joint, std::vector<cv::Mat>& dest);
 	public:
 		RealtimeO1BilateralFilter();
 		~RealtimeO1BilateralFilter();
@@ -844,6 +1060,13 @@ namespace cp
 		void gaussIIR(cv::InputArray src, cv::InputArray joint, cv::OutputArray dest, float sigma_color, float sigma_space, int num_bin, int method, int K);
 		void gaussFIR(cv::InputArray src, cv::OutputArray dest, int r, float sigma_color, float sigma_space, int num_bin);
 		void gaussFIR(cv::InputArray src, cv::InputArray joint, cv::OutputArray dest, int r, float sigma_color, float sigma_space, int num_bin);
+
+		//batch for video: all frames have the same size and type. the bins and the IIR states are kept across frames and calls, 
+		//and the per-bin blurs of consecutive frames are pipelined by TaskGraph. 3 channel joint images and isSaveMemory are processed frame by frame.
+		void gaussIIRBatch(const std::vector<cv::Mat>& src, std::vector<cv::Mat>& dest, float sigma_color, float sigma_space, int num_bin, int method, int K);
+		void gaussIIRBatch(const std::vector<cv::Mat>& src, const std::vector<cv::Mat>& joint, std::vector<cv::Mat>& dest, float sigma_color, float sigma_space, int num_bin, int method, int K);
+		void gaussFIRBatch(const std::vector<cv::Mat>& src, std::vector<cv::Mat>& dest, int r, float sigma_color, float sigma_space, int num_bin);
+		void gaussFIRBatch(const std::vector<cv::Mat>& src, const std::vector<cv::Mat>& joint, std::vector<cv::Mat>& dest, int r, float sigma_color, float sigma_space, int num_bin);
 	};
 
 	enum
@@ -1046,6 +1269,16 @@ namespace cp
 		void wta(cv::Mat& dest);
 		void subpixelInterpolation(cv::Mat& dest, int method);
 
+		//CV_8U or CV_16U: box, gaussian and joint bilateral refinements use the quantized and interleaved volume instead of dsv, where
+		//volume(y, x*(numDisparity + 1) + i) is the saturated cost of the disparity minDisparity + i times quantScale, and the costs of a pixel are contiguous.
+		//VOLUME_TYPE (default): the planes of dsv.
+		int volumeDepth;
+		cv::Mat volume;
+		float quantScale;
+		void buildCostVolume(cv::Mat& disp, int dtrunc, int metric, cv::Mat& vol);
+		void wta(const cv::Mat& vol, cv::Mat& dest);
+		void subpixelInterpolation(const cv::Mat& vol, cv::Mat& dest, int method);
+
 		//void crossBasedAdaptiveboxRefinement(cv::Mat& disp, cv::Mat& guide,cv::Mat& dest, int data_trunc, int metric, int r, int thresh,int iter=1);
 		void medianRefinement(cv::Mat& disp, cv::Mat& dest, int data_trunc, int metric, int r, int iter = 1);
 
@@ -1099,6 +1332,17 @@ namespace cp
 
 		void body(float *src, float* dest, float Th, int dr);
 
+		cv::RNG rng;
+		std::vector<int> patch_offset;
+		cv::Mat wmap;//weight map of patch_step not dividing the patch size, which is kept except for PATCH_STEP_RANDOM
+		cv::Size wmapPatchSize;
+		int wmapPatchStep;
+		int wmapStepMode;
+		void setPatchStep(int patch_step, int step_mode);
+		void patchStepWeight(int patch_step, int step_mode);
+		void bodyStride(float *src, float* dest, float Th, int patch_step);
+		bool bodyBatch(float *src, float* dest, float Th);
+
 		void div(float* inplace0, float* inplace1, float* inplace2, float* w0, float* w1, float* w2, const int size1);
 		void div(float* inplace0, float* inplace1, float* inplace2, const int patch_area, const int size1);
 
@@ -1109,14 +1353,24 @@ namespace cp
 		void decorrelateColorInvert(float* src, float* dest, int width, int height);
 
 	public:
+		//patch positions for patch_step>1
+		enum
+		{
+			PATCH_STEP_GRID = 0,//every patch_step pixels
+			PATCH_STEP_SHIFTED_GRID = 1,//odd patch rows are shifted by patch_step/2
+			PATCH_STEP_RANDOM = 2//each patch row has a random offset
+		};
+
 		bool isSSE;
+		bool isWideSIMD;//AVX2/AVX-512 kernels for patch_step=1 when the CPU supports them (false: the SSE kernels)
 		void cvtColorOrder32F_BGR2BBBBGGGGRRRR(const cv::Mat& src, cv::Mat& dest);
 		void cvtColorOrder32F_BBBBGGGGRRRR2BGR(const cv::Mat& src, cv::Mat& dest);
 
 		void init(cv::Size size_, int color_, cv::Size patch_size_);
 		DenoiseDXTShrinkage(cv::Size size, int color, cv::Size patch_size_ = cv::Size(8, 8));
 		DenoiseDXTShrinkage();
-		void operator()(cv::Mat& src, cv::Mat& dest, float sigma, cv::Size psize = cv::Size(8, 8), int transform_basis = 0);
+		//patch_step>1 transforms the patches every patch_step pixels (1/patch_step^2 of the work; patch_step<=patch size)
+		void operator()(cv::Mat& src, cv::Mat& dest, float sigma, cv::Size psize = cv::Size(8, 8), int transform_basis = 0, int patch_step = 1, int step_mode = PATCH_STEP_GRID);
 
 		void shearable(cv::Mat& src, cv::Mat& dest, float sigma, cv::Size psize = cv::Size(8, 8), int transform_basis = 0, int direct = 0);
 		void weighted(cv::Mat& src, cv::Mat& dest, float sigma, cv::Size psize = cv::Size(8, 8), int transform_basis = 0);
@@ -1124,6 +1378,37 @@ namespace cp
 		void test(cv::Mat& src, cv::Mat& dest, float sigma, cv::Size psize = cv::Size(8, 8));
 	};
 
+	//block-matching and 3D filtering (BM3D) on the SIMD DCT kernels of DenoiseDXTShrinkage.
+	//similar patches are grouped by block matching, and each group is shrunk in the 2D DCT (4x4 or 8x8) and the 1D Walsh-Hadamard transform across the group.
+	//the first stage is the hard thresholding, and the second stage is the Wiener filtering whose pilot is the result of the first stage.
+	class CP_EXPORT DenoiseBM3D
+	{
+	private:
+		cv::Size patch_size;
+		cv::Mat kaiser;
+		std::vector<cv::Mat> noisy;
+		std::vector<cv::Mat> basic;
+		std::vector<cv::Mat> wiener;
+
+		float stage(const std::vector<cv::Mat>& noisy, const std::vector<cv::Mat>* pilot, std::vector<cv::Mat>& dest, float sigma);//returns the mean group size
+
+	public:
+		int searchWindowSize;
+		int step;//step of the reference blocks
+		int maxGroupSizeHT;//the group size is the largest power of 2 within this
+		int maxGroupSizeWiener;
+		float matchThresholdHT;//mean squared difference per pixel for grouping (2500), which is doubled for sigma > 40
+		float matchThresholdWiener;//on the basic estimate (400)
+		float lambda3D;//hard threshold is lambda3D*sigma
+		bool isWiener;
+
+		float meanGroupSizeHT;//mean number of the patches in a group of the last call
+		float meanGroupSizeWiener;
+
+		DenoiseBM3D();
+		void operator()(const cv::Mat& src, cv::Mat& dest, float sigma, cv::Size psize = cv::Size(8, 8));
+	};
+
 	class CP_EXPORT HazeRemove
 	{
 	public:
@@ -1379,6 +1664,8 @@ namespace cp
 	CP_EXPORT void correctDisparityBoundaryFillOcc(cv::Mat& src, cv::Mat& refimg, const int r, cv::Mat& dest);
 	CP_EXPORT void correctDisparityBoundary(cv::Mat& src, cv::Mat& refimg, const int r, const int edgeth, cv::Mat& dest, const int secondr = 0, const int minedge = 0);
 
+	struct StereoTile;//StereoTemporal.h
+
 	class CP_EXPORT StereoBMSimple
 	{
 		cv::Mat bufferGray;
@@ -1392,6 +1679,35 @@ namespace cp
 		std::vector<cv::Mat> target;
 		std::vector<cv::Mat> refference;
 		cv::Mat specklebuffer;
+
+		//buffers of the row-band pipeline
+		cv::Mat bandAlpha;
+		cv::Mat bandCost;
+		cv::Mat bandAggregation[3];
+		cv::Mat bandWinner;
+		cv::Mat bandMinus;
+		cv::Mat bandPlus;
+		cv::Mat bandPrefixMin;
+		cv::Mat bandSecond;
+		void getDisparityRowBand(cv::Mat& alpha, cv::Mat& dest);
+		void getDisparityBand(std::vector<cv::Mat>& tgt, std::vector<cv::Mat>& ref, cv::Mat& tcensus, cv::Mat& rcensus, cv::Mat& alpha,
+			const int minD, const int range, const int refShift, const int bandRows, cv::Mat& costMap, cv::Mat& dest);
+
+		//state of the temporal mode
+		cv::Mat temporalGray;//previous left image
+		cv::Mat temporalGrayR;//previous right image
+		cv::Mat temporalRaw;//previous disparity before the post filters, reused by the static tiles
+		cv::Mat temporalCost;//previous minCostMap
+		cv::Mat temporalPrior;//previous output disparity, which gives the search bands
+		int temporalFrame;
+		void getDisparityTemporal(cv::Mat& gray, cv::Mat& grayR, cv::Mat& alpha, cv::Mat& dest);
+		void getDisparityTiles(const std::vector<StereoTile>& tiles, cv::Mat& alpha, cv::Mat& dest);
+		void setTemporalFrame(cv::Mat& gray, cv::Mat& grayR, cv::Mat& dest);
+		void getDisparityPyramid(cv::Mat& leftim, cv::Mat& rightim, cv::Mat& alpha, cv::Mat& dest);
+
+		//census codes of the gray images (isCensus)
+		cv::Mat targetCensus;
+		cv::Mat refferenceCensus;
 	public:
 		int border;
 
@@ -1424,9 +1740,32 @@ namespace cp
 		cv::Mat minCostMap;
 
 		bool isBT;
+		//census cost (Hamming distance of censusWindow codes, 0-32) instead of the SAD/BT cost; it takes precedence over isBT
+		bool isCensus;
+		cv::Size censusWindow;
 		int P1;
 		int P2;
 
+		//>0: cost computation, aggregation and WTA are fused in bands of this number of rows, which are kept in cache, and DSI is not stored.
+		//the scanline optimization (P1 and P2) needs the full DSI and ignores it.
+		int bandHeight;
+
+		//temporal mode for video of a fixed rig: the tiles whose left and matched right images are unchanged reuse the previous disparity, and the others search a band around it
+		//(or the full range when the image is largely changed or the previous disparity is not confident). every temporalRefreshInterval-th frame is fully computed.
+		//the adjacent tiles of the same range are searched as a span. the temporal mode is ignored when the scanline optimization (P1 and P2) is used.
+		bool isTemporal;
+		int temporalTileSize;
+		int temporalMargin;//search margin around the previous disparities (pixels)
+		int temporalDiffThreshold;//intensity difference for the changed pixels
+		int temporalRefreshInterval;
+		void resetTemporal();
+
+		//coarse-to-fine mode for high resolution pairs: the full range is searched only at the pyramidLevels-th level of the image pyramid (0: off),
+		//and each finer level searches a band of +-pyramidMargin pixels around the upsampled disparity in tiles. the coarse-to-fine mode is ignored when the scanline optimization (P1 and P2) is used.
+		int pyramidLevels;
+		int pyramidTileSize;
+		int pyramidMargin;
+
 		cv::Mat costMap;
 		cv::Mat weightMap;
 
@@ -1445,6 +1784,7 @@ namespace cp
 		void halfPixel(cv::Mat& src, cv::Mat& srcp, cv::Mat& srcm);
 		void getMatchingCostBT(std::vector<cv::Mat>& target, std::vector<cv::Mat>& refference, const int d, cv::Mat& dest);
 		void getMatchingCostBTAlpha(std::vector<cv::Mat>& target, std::vector<cv::Mat>& refference, cv::Mat& alpha, const int d, cv::Mat& dest);
+		void getMatchingCostCensus(cv::Mat& tcensus, cv::Mat& rcensus, const int d, cv::Mat& dest);
 
 		void getOptScanline();
 		void getMatchingCost(const int d, cv::Mat& dest);
@@ -1501,6 +1841,7 @@ namespace cp
 		StereoBM2 bm;
 		void parameterUpdate();
 		void prefilter(cv::Mat& sl, cv::Mat& sr);
+		void getDisparityPyramid(cv::Mat& sl, cv::Mat& sr, cv::Mat& disp);
 	public:
 		double prefilterAlpha;
 		int preFilterType; // =CV_STEREO_BM_NORMALIZED_RESPONSE now
@@ -1528,6 +1869,12 @@ namespace cp
 		int isOcclusion;
 		int medianKernel;
 
+		//coarse-to-fine mode for high resolution pairs: the full range is searched only at the pyramidLevels-th level of the image pyramid (0: off),
+		//and each finer level searches a band of +-pyramidMargin pixels (rounded up to 16 disparities) around the upsampled disparity in tiles.
+		int pyramidLevels;
+		int pyramidTileSize;
+		int pyramidMargin;
+
 		StereoBMEx(int preset, int ndisparities = 0, int SADWindowSize_ = 21);
 		void showPostFilter();
 		void showPreFilter();
@@ -1542,6 +1889,9 @@ namespace cp
 	class CP_EXPORT StereoDP
 	{
 		void shiftImage(cv::Mat& src, cv::Mat& dest, const int shift);
+		std::vector<cv::Mat> scratchBuffer;//DP buffers of each stripe of isSIMD, kept across frames
+		void solveDP(cv::Mat& l, cv::Mat& r, const int shift, const int range, int bd, cv::Mat& disp);
+		void getDisparityPyramid(cv::Mat& l, cv::Mat& r, const int bd, cv::Mat& disp);
 	public:
 		int minDisparity;
 		int disparityRange;
@@ -1555,6 +1905,15 @@ namespace cp
 		double param4;
 		double param5;
 
+		//true (default): the DP is vectorized across the disparities and each thread processes a batch of rows (same result as the scalar version)
+		bool isSIMD;
+
+		//coarse-to-fine mode for high resolution pairs: the full range is searched only at the pyramidLevels-th level of the image pyramid (0: off),
+		//and each finer level runs the DP in tiles on the band of +-pyramidMargin pixels around the upsampled disparity (the full range for the tiles without the prior).
+		int pyramidLevels;
+		int pyramidTileSize;
+		int pyramidMargin;
+
 		StereoDP(int minDisparity_, int disparityRange_);
 
 		void operator()(cv::Mat& leftim, cv::Mat& rightim, cv::Mat& disp, int bd = 0);
@@ -1567,6 +1926,12 @@ namespace cp
 	{
 	public:
 		enum { DISP_SHIFT = 4, DISP_SCALE = (1 << DISP_SHIFT) };
+		//PARALLEL_EXACT: the cost volume and the path directions are split across threads (same result as PARALLEL_NONE, but the whole cost volume is kept),
+		//  the C and S volumes take 4*width*height*numberOfDisparities bytes, which must be at most PARALLEL_EXACT_MAX_BUFFER_GB GiB (e.g., 4K with 256 disparities needs 8.5 GB),
+		//PARALLEL_STRIPE: row stripes are processed independently, and the top-down paths restart stripeOverlap rows above each stripe (approximation)
+		enum { PARALLEL_NONE = 0, PARALLEL_EXACT, PARALLEL_STRIPE };
+		enum { PARALLEL_EXACT_MAX_BUFFER_GB = 16 };
+		enum { COST_BT = 0, COST_CENSUS };
 
 		//! the default constructor
 		StereoSGBM2();
@@ -1598,9 +1963,42 @@ namespace cp
 		int subpixel_th;
 		int ad_max;
 		double costAlpha;
+		int parallelMode;//PARALLEL_NONE (default), PARALLEL_EXACT, PARALLEL_STRIPE
+		int costType;//COST_BT (default): BT of the x-Sobel and the intensity blended by costAlpha, COST_CENSUS: Hamming distance of the census codes
+		cv::Size censusWindowSize;//census window for COST_CENSUS (width*height - 1 <= 32)
+		int stripeOverlap;//rows for warming up the paths of each stripe in PARALLEL_STRIPE
+
+		//temporal mode for video of a fixed rig: the tiles whose left and matched right images are unchanged reuse the previous disparities, and the others search a band around it
+		//(or the full range when the image is largely changed or the previous disparity is not confident). the adjacent tiles of the same range are solved as a span,
+		//the spans are processed in parallel instead of parallelMode, and every temporalRefreshInterval-th frame is fully computed.
+		//disp_r of the solved spans comes from their right costs, so that the LR check of each span is valid.
+		bool isTemporal;
+		int temporalTileSize;
+		int temporalMargin;//search margin around the previous disparities (pixels)
+		int temporalDiffThreshold;//intensity difference for the changed pixels
+		int temporalRefreshInterval;
+		void resetTemporal();
+
+		//coarse-to-fine mode for high resolution pairs: the full range is searched only at the pyramidLevels-th level of the image pyramid (0: off),
+		//and each finer level searches a band of +-pyramidMargin pixels around the upsampled disparity in tiles (the full range for the tiles without the confident prior).
+		//the tiles are processed in parallel instead of parallelMode, and disp_r comes from the right costs of the finest level.
+		int pyramidLevels;
+		int pyramidTileSize;
+		int pyramidMargin;
 
 	protected:
 		cv::Mat buffer;
+		std::vector<cv::Mat> stripeBuffer;
+		void computeDisparity(const cv::Mat& left, const cv::Mat& right, cv::Mat& disp_l, cv::Mat& disp_r);
+
+		cv::Mat temporalGray;//previous left image
+		cv::Mat temporalGrayR;//previous right image
+		cv::Mat temporalRaw;//previous disparity before the post filters, reused by the static tiles
+		cv::Mat temporalRawR;//previous right disparity before the post filters, reused by the static tiles
+		cv::Mat temporalPrior;//previous output disparity, which gives the search bands
+		int temporalFrame;
+		void computeDisparityTemporal(const cv::Mat& left, const cv::Mat& right, cv::Mat& disp_l, cv::Mat& disp_r);
+		void computeDisparityPyramid(const cv::Mat& left, const cv::Mat& right, cv::Mat& disp_l, cv::Mat& disp_r);
 	};
 
 	class CP_EXPORT StereoSGBMEx
@@ -1750,8 +2148,33 @@ namespace cp
 		void depthfilter(cv::Mat& depth, cv::Mat& depth2, cv::Mat& mask2, int viewstep, double disp_amp);
 		template <class T>
 		void analyzeSynthesizedViewDetail_(cv::Mat& srcL, cv::Mat& srcR, cv::Mat& dispL, cv::Mat& dispR, double alpha, int invalidvalue, double disp_amp, cv::Mat& srcsynth, cv::Mat& ref);
+		//working buffers kept across calls
+		struct SynthesisBuffer
+		{
+			cv::Mat destR;
+			cv::Mat destdispR;
+			cv::Mat temp;
+			cv::Mat tempR;
+			cv::Mat mask;
+			cv::Mat disp8U;
+			cv::Mat edge;
+			cv::Mat blur;
+		};
+		SynthesisBuffer buffer;
+		std::vector<SynthesisBuffer> viewBuffer;//one per stripe of views in the batched synthesis
+		//alpha-independent stages of the source disparity maps, shared by the views of the batched synthesis
+		struct WarpSource
+		{
+			cv::Mat dispL;//with the border of the warping
+			cv::Mat dispR;
+			cv::Mat flagL;//boundary and crack tests of the warping
+			cv::Mat flagR;
+		};
+		WarpSource warpSource;
+		friend class ViewSynthesisBatch_Invoker;
+
 		template <class T>
-		void viewsynth(const cv::Mat& srcL, const cv::Mat& srcR, const cv::Mat& dispL, const cv::Mat& dispR, cv::Mat& dest, cv::Mat& destdisp, double alpha, int invalidvalue, double disp_amp, int disptype);
+		void viewsynth(const cv::Mat& srcL, const cv::Mat& srcR, const cv::Mat& dispL, const cv::Mat& dispR, cv::Mat& dest, cv::Mat& destdisp, double alpha, int invalidvalue, double disp_amp, int disptype, SynthesisBuffer& buf, const WarpSource* ws = NULL);
 		template <class T>
 		void makeMask_(cv::Mat& srcL, cv::Mat& srcR, cv::Mat& dispL, cv::Mat& dispR, double alpha, int invalidvalue, double disp_amp);
 		template <class T>
@@ -1769,6 +2192,7 @@ namespace cp
 		int warpInterpolationMethod;//Nearest, Linear or Cubic
 		bool warpSputtering;
 		int large_jump;
+		bool isParallel;//warping and blending in row stripes, SIMD blending for 8u disparity maps (default true)
 
 		//warped depth filtering parameters
 		enum
@@ -1828,6 +2252,8 @@ namespace cp
 
 		void operator()(cv::Mat& src, cv::Mat& disp, cv::Mat& dest, cv::Mat& destdisp, double alpha, int invalidvalue, double disp_amp);
 		void operator()(const cv::Mat& srcL, const cv::Mat& srcR, const cv::Mat& dispL, const cv::Mat& dispR, cv::Mat& dest, cv::Mat& destdisp, double alpha, int invalidvalue, double disp_amp);
+		//synthesis of the views at each alpha in one call; the views are synthesized in parallel
+		void operator()(const cv::Mat& srcL, const cv::Mat& srcR, const cv::Mat& dispL, const cv::Mat& dispR, std::vector<cv::Mat>& dest, std::vector<cv::Mat>& destdisp, const std::vector<double>& alpha, int invalidvalue, double disp_amp);
 
 		cv::Mat diskMask;
 		cv::Mat allMask;//all mask
@@ -1862,6 +2288,36 @@ namespace cp
 		void cncheck(cv::Mat& srcx, cv::Mat& srcy, cv::Mat& destx, cv::Mat& desty, int thresh, int invalid);
 		void operator()(cv::Mat& curr, cv::Mat& next, cv::Mat& dstx, cv::Mat& dsty, cv::Size ksize, int minx, int maxx, int miny, int maxy, int bd = 30);
 	};
+	//non-local means of video, whose patches are searched in the current frame and in a ring buffer of the previous frames (FILTER_INTEGRAL).
+	//the previous frames are kept converted and padded, so that they are not processed again while they are in the ring buffer.
+	//when isMotionCompensation is true, the motion vectors of OpticalFlowBM are composed into a map from the current frame to each previous frame,
+	//and each previous frame is warped from the original once per call, so that the older frames are not blurred by the repeated resampling.
+	class CP_EXPORT VideoNonLocalMeansFilter
+	{
+		std::vector<cv::Mat> ringSrc;//original previous frames (CV_32F); ringSrc[0] is the last frame
+		std::vector<cv::Mat> ringSrcPad;//ringSrc with the border, which is aligned to the current frame with isMotionCompensation
+		std::vector<cv::Mat> ringMapx;//maps from the current frame to ringSrc (empty: identity)
+		std::vector<cv::Mat> ringMapy;
+		cv::Mat prevGray;//last frame for the optical flow
+		cv::Mat flowx;
+		cv::Mat flowy;
+		OpticalFlowBM opticalFlow;
+		cv::Size imageSize;
+		int imageType;
+		cv::Point border;
+
+	public:
+		int numberOfFrames;//size of the ring buffer (number of the previous frames)
+		cv::Size temporalSearchWindowSize;//search window in the previous frames
+		bool isMotionCompensation;
+		cv::Size flowKernelSize;
+		int flowSearchRange;
+
+		VideoNonLocalMeansFilter(int numberOfFrames = 2);
+		void clear();
+		void operator()(const cv::Mat& src, cv::Mat& dest, cv::Size templeteWindowSize, cv::Size searchWindowSize, double h, double sigma = -1.0, int borderType = cv::BORDER_REPLICATE);
+		void operator()(const cv::Mat& src, cv::Mat& dest, int templeteWindowSize, int searchWindowSize, double h, double sigma = -1.0, int borderType = cv::BORDER_REPLICATE);
+	};
 	CP_EXPORT void drawOpticalFlow(const cv::Mat_<cv::Point2f>& flow, cv::Mat& dst, float maxmotion = -1);
 	CP_EXPORT void mergeFlow(cv::Mat& flow, cv::Mat& xflow, cv::Mat& yflow);
 